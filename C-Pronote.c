@@ -10,13 +10,38 @@
 /*                                                                            */
 /* ************************************************************************** */
 
+#ifdef CPRONOTE_BENCH
+#define CPRONOTE_HEADLESS
+#endif
+
+#ifndef CPRONOTE_HEADLESS
 #include <gtk/gtk.h>
+#include <cairo-pdf.h>
+#endif
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <float.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <math.h>
+#include <zlib.h>
+#ifdef CPRONOTE_ZSTD
+#include <zstd.h>
+#endif
 
 #define DB_NAME "eleves.db"
 #define CSV_FILENAME "eleves.csv"
@@ -24,7 +49,26 @@
 #define MAX_EMAIL 100
 #define MAX_TELEPHONE 20
 #define MAX_GRADE 10
+#define MAX_MATIERE 64
+#define PRESENCE_JOURS 366
+#define PRESENCE_MOTS ((PRESENCE_JOURS + 63) / 64)
 #define MAX_QUERY 1024
+#define CSV_REJETS_FILENAME "eleves_rejets.csv"
+#define CSV_BUFFER_SIZE 65536
+#define CSV_NB_COLONNES 7
+#define CSV_MAX_CHAMPS 16
+#define IMPORT_LOT_DEFAUT 10000
+#define IMPORT_TRANCHE_GUI 2000
+#define EXEC_LOT_LIGNES 256
+#define EXEC_LOT_OCTETS (EXEC_LOT_LIGNES * 64)   // arène initiale d'un lot (chaînes)
+#define EXEC_LOTS_EN_VOL 4
+#define EXEC_BUSY_TIMEOUT_MS 5000         // attente cumulée maximale sur une base occupée
+#define ATTENTE_INITIALE_MS 1
+#define ATTENTE_MAX_MS 64
+#define MODELE_TAILLE_PAGE 128
+#define MODELE_NB_PAGES 8
+#define MODELE_CHARGEMENTS 3            // calculs des clés relancés si la table change entre-temps
+#define RECHERCHE_MAX_RESULTATS 1000
 typedef struct {
     int id;
     char nom[MAX_NOM];
@@ -33,32 +77,917 @@ typedef struct {
     char email[MAX_EMAIL];
     char telephone[MAX_TELEPHONE];
     char grade[MAX_GRADE];
+    int version;            // concurrence optimiste, 0 : inconnue
 } Personne;
 
 sqlite3 *db = NULL;
 
+/*
+ * Journal asynchrone : les appelants formatent leur ligne dans un anneau
+ * sans verrou (file bornée multi-producteurs de D. Vyukov) ; un thread de
+ * vidage l'écrit par lots dans log.txt, gardé ouvert, avec rotation par
+ * taille. Si l'anneau est plein, la ligne est comptée comme perdue plutôt
+ * que de bloquer l'appelant. Chaque entrée contient sa ligne complète,
+ * formatée par l'appelant : le gestionnaire des signaux fatals n'a plus qu'à
+ * la copier dans le fichier avec write(), seule fonction qu'il appelle.
+ * L'anneau est aussi vidé à la sortie (atexit).
+ */
+#define LOG_FILENAME "log.txt"
+#define LOG_ANNEAU_TAILLE 8192          // puissance de 2
+#define LOG_TEXTE_MAX 240               // message et champs
+#define LOG_LIGNE_MAX (LOG_TEXTE_MAX + 40)  // avec "[date heure] NIVEAU " et '\n'
+#define LOG_TAILLE_MAX (4L * 1024 * 1024)
+#define LOG_NB_ARCHIVES 3               // log.txt.1 .. log.txt.3
+#define LOG_INTERVALLE_MS 50
+
+typedef enum { LOG_DEBUG, LOG_INFO, LOG_AVERT, LOG_ERREUR } NiveauLog;
+typedef enum { JOURNAL_INACTIF, JOURNAL_ACTIF, JOURNAL_ARRETE } EtatJournal;
+
+const char *niveau_noms[] = { "DEBUG", "INFO", "AVERT", "ERREUR" };
+
+typedef struct {
+    _Atomic size_t seq;
+    size_t longueur;
+    char ligne[LOG_LIGNE_MAX];
+} EntreeJournal;
+
+typedef struct {
+    EntreeJournal anneau[LOG_ANNEAU_TAILLE];
+    _Atomic size_t ecriture;
+    _Atomic size_t lecture;
+    _Atomic long perdus;
+    _Atomic int etat;                   // EtatJournal
+    _Atomic int reveil;                 // un producteur a déjà réveillé le thread
+    int arret;
+    int fd;
+    long taille;                        // taille courante du fichier
+    _Atomic long decalage_utc;          // secondes, heure locale
+    const char *chemin;
+    pthread_t thread;
+    pthread_mutex_t mutex;              // démarrage, arrêt et écriture du fichier
+    pthread_cond_t cond;
+} Journal;
+
+Journal journal_global = { .fd = -1, .chemin = LOG_FILENAME,
+                           .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+NiveauLog journal_niveau = LOG_INFO;
+
+void dateCivile(long jour, char *out, size_t taille);
+
+void journalOuvrirFichier(Journal *j) {
+    j->fd = open(j->chemin, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st;
+    j->taille = j->fd >= 0 && fstat(j->fd, &st) == 0 ? (long)st.st_size : 0;
+}
+
+// log.txt -> log.txt.1 -> ... -> log.txt.N (la plus ancienne est écrasée)
+void journalRotation(Journal *j) {
+    char ancien[256], nouveau[256];
+    close(j->fd);
+    for (int i = LOG_NB_ARCHIVES - 1; i >= 1; i--) {
+        snprintf(ancien, sizeof(ancien), "%s.%d", j->chemin, i);
+        snprintf(nouveau, sizeof(nouveau), "%s.%d", j->chemin, i + 1);
+        rename(ancien, nouveau);
+    }
+    snprintf(nouveau, sizeof(nouveau), "%s.1", j->chemin);
+    rename(j->chemin, nouveau);
+    journalOuvrirFichier(j);
+}
+
+void journalEcrireTout(int fd, const char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w <= 0) return;
+        buf += w;
+        n -= (size_t)w;
+    }
+}
+
+// "[AAAA-MM-JJ HH:MM:SS.mmm] NIVEAU ", formaté par l'appelant de journal().
+// La date à la seconde est gardée par thread : seuls les millisecondes et le
+// niveau changent d'un message à l'autre dans la même seconde.
+size_t journalEntete(const Journal *j, const struct timespec *ts, NiveauLog niveau, char *out, size_t taille) {
+    static _Thread_local long seconde = -1;
+    static _Thread_local char date[64];     // "[AAAA-MM-JJ HH:MM:SS."
+    long secondes = (long)ts->tv_sec + atomic_load_explicit(&j->decalage_utc, memory_order_relaxed);
+    if (secondes != seconde) {
+        long jour = secondes >= 0 ? secondes / 86400 : (secondes - 86399) / 86400;
+        long reste = secondes - jour * 86400;
+        char civile[32];
+        dateCivile(jour, civile, sizeof(civile));
+        snprintf(date, sizeof(date), "[%s %02ld:%02ld:%02ld.", civile, reste / 3600, reste / 60 % 60, reste % 60);
+        seconde = secondes;
+    }
+    long ms = ts->tv_nsec / 1000000;
+    int n = snprintf(out, taille, "%s%03ld] %-6s ", date, ms, niveau_noms[niveau]);
+    return n < 0 ? 0 : (size_t)n < taille ? (size_t)n : taille - 1;
+}
+
+// Retire de l'anneau la plus ancienne entrée prête (NULL s'il n'y en a
+// pas) ; journalRendre() la libère pour les producteurs. Plusieurs
+// consommateurs peuvent s'y croiser (thread de vidage, gestionnaire de
+// signal) : sans verrou ni appel système, utilisable depuis ce dernier.
+EntreeJournal *journalPrendre(Journal *j, size_t *pos) {
+    size_t p = atomic_load_explicit(&j->lecture, memory_order_relaxed);
+    for (;;) {
+        EntreeJournal *e = &j->anneau[p & (LOG_ANNEAU_TAILLE - 1)];
+        size_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(p + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&j->lecture, &p, p + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos = p;
+                return e;
+            }
+        } else if (dif < 0) {
+            return NULL;
+        } else {
+            p = atomic_load_explicit(&j->lecture, memory_order_relaxed);
+        }
+    }
+}
+
+void journalRendre(EntreeJournal *e, size_t pos) {
+    atomic_store_explicit(&e->seq, pos + LOG_ANNEAU_TAILLE, memory_order_release);
+}
+
+// Retire de l'anneau toutes les entrées prêtes et les écrit en un seul
+// write() par tampon plein.
+void journalVider(Journal *j, bool rotation) {
+    char tampon[16384];
+    size_t n = 0;
+    long perdus = atomic_exchange(&j->perdus, 0);
+    if (perdus > 0) {
+        n += (size_t)snprintf(tampon, sizeof(tampon), "[journal] %ld lignes perdues (anneau plein)\n", perdus);
+    }
+    size_t pos;
+    EntreeJournal *e;
+    while ((e = journalPrendre(j, &pos))) {
+        if (sizeof(tampon) - n < LOG_LIGNE_MAX) {
+            journalEcrireTout(j->fd, tampon, n);
+            j->taille += (long)n;
+            n = 0;
+        }
+        memcpy(tampon + n, e->ligne, e->longueur);
+        n += e->longueur;
+        journalRendre(e, pos);
+    }
+    if (n > 0) {
+        journalEcrireTout(j->fd, tampon, n);
+        j->taille += (long)n;
+    }
+    if (rotation && j->taille > LOG_TAILLE_MAX) journalRotation(j);
+}
+
+void journalDecalageUTC(Journal *j) {
+    time_t maintenant = time(NULL);
+    struct tm local;
+    if (localtime_r(&maintenant, &local)) atomic_store_explicit(&j->decalage_utc, local.tm_gmtoff, memory_order_relaxed);
+}
+
+void *journal_thread(void *arg) {
+    Journal *j = arg;
+    pthread_mutex_lock(&j->mutex);
+    while (!j->arret) {
+        struct timespec echeance;
+        clock_gettime(CLOCK_REALTIME, &echeance);
+        echeance.tv_nsec += LOG_INTERVALLE_MS * 1000000L;
+        if (echeance.tv_nsec >= 1000000000L) {
+            echeance.tv_sec++;
+            echeance.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&j->cond, &j->mutex, &echeance);
+        atomic_store(&j->reveil, 0);
+        journalDecalageUTC(j);
+        journalVider(j, true);
+    }
+    journalVider(j, false);
+    close(j->fd);
+    j->fd = -1;
+    pthread_mutex_unlock(&j->mutex);
+    return NULL;
+}
+
+void journalArreter(void);
+
+// Écrit les lignes restées dans l'anneau, une par write(), puis laisse le
+// signal suivre son cours (fichier de core…). Les lignes perdues ne sont pas
+// signalées : il faudrait formater leur nombre.
+void journal_signal_fatal(int sig) {
+    Journal *j = &journal_global;
+    size_t pos;
+    EntreeJournal *e;
+    while (j->fd >= 0 && (e = journalPrendre(j, &pos))) {
+        journalEcrireTout(j->fd, e->ligne, e->longueur);
+        journalRendre(e, pos);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Appelé au premier message ; sans thread (échec de création), les
+// messages sont écrits directement par l'appelant.
+bool journalDemarrer(void) {
+    Journal *j = &journal_global;
+    static bool anneau_pret = false;
+    pthread_mutex_lock(&j->mutex);
+    if (atomic_load(&j->etat) == JOURNAL_ACTIF) {
+        pthread_mutex_unlock(&j->mutex);
+        return true;
+    }
+    if (!anneau_pret) {
+        for (size_t i = 0; i < LOG_ANNEAU_TAILLE; i++) atomic_store(&j->anneau[i].seq, i);
+        int signaux[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+        for (int i = 0; i < 5; i++) signal(signaux[i], journal_signal_fatal);
+        atexit(journalArreter);
+        anneau_pret = true;
+    }
+    journalDecalageUTC(j);
+    if (j->fd < 0) journalOuvrirFichier(j);
+    j->arret = 0;
+    bool ok = j->fd >= 0 && pthread_create(&j->thread, NULL, journal_thread, j) == 0;
+    atomic_store(&j->etat, ok ? JOURNAL_ACTIF : JOURNAL_ARRETE);
+    pthread_mutex_unlock(&j->mutex);
+    return ok;
+}
+
+// Arrête le thread de vidage après avoir tout écrit ; les messages suivants
+// sont écrits directement par l'appelant.
+void journalArreter(void) {
+    Journal *j = &journal_global;
+    pthread_mutex_lock(&j->mutex);
+    if (atomic_load(&j->etat) != JOURNAL_ACTIF) {
+        pthread_mutex_unlock(&j->mutex);
+        return;
+    }
+    j->arret = 1;
+    atomic_store(&j->etat, JOURNAL_ARRETE);
+    pthread_cond_signal(&j->cond);
+    pthread_mutex_unlock(&j->mutex);
+    pthread_join(j->thread, NULL);
+    // messages arrivés pendant l'arrêt
+    pthread_mutex_lock(&j->mutex);
+    if (atomic_load(&j->ecriture) != atomic_load(&j->lecture)) {
+        journalOuvrirFichier(j);
+        if (j->fd >= 0) journalVider(j, false);
+    }
+    pthread_mutex_unlock(&j->mutex);
+}
+
+// Message de niveau donné, suivi de champs clé=valeur au format printf :
+//   journal(LOG_ERREUR, "migration", "version=%d erreur=\"%s\"", v, msg);
+void journal(NiveauLog niveau, const char *message, const char *champs, ...) {
+    Journal *j = &journal_global;
+    if (niveau < journal_niveau) return;
+    if (atomic_load_explicit(&j->etat, memory_order_acquire) == JOURNAL_INACTIF) journalDemarrer();
+    size_t pos = atomic_load_explicit(&j->ecriture, memory_order_relaxed);
+    EntreeJournal *e;
+    for (;;) {
+        e = &j->anneau[pos & (LOG_ANNEAU_TAILLE - 1)];
+        size_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&j->ecriture, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            atomic_fetch_add_explicit(&j->perdus, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&j->ecriture, memory_order_relaxed);
+        }
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    size_t debut = journalEntete(j, &ts, niveau, e->ligne, LOG_LIGNE_MAX - LOG_TEXTE_MAX);
+    char *texte = e->ligne + debut;
+    size_t n = 0;
+    while (message[n] && n < LOG_TEXTE_MAX - 1) {
+        texte[n] = message[n] == '\n' ? ' ' : message[n];
+        n++;
+    }
+    texte[n] = '\0';
+    if (champs && n < LOG_TEXTE_MAX - 2) {
+        va_list args;
+        va_start(args, champs);
+        texte[n++] = ' ';
+        int k = vsnprintf(texte + n, LOG_TEXTE_MAX - n, champs, args);
+        va_end(args);
+        if (k > 0) n = n + (size_t)k < LOG_TEXTE_MAX ? n + (size_t)k : LOG_TEXTE_MAX - 1;
+    }
+    texte[n++] = '\n';
+    e->longueur = debut + n;
+    atomic_store_explicit(&e->seq, pos + 1, memory_order_release);
+
+    if (atomic_load_explicit(&j->etat, memory_order_acquire) != JOURNAL_ACTIF) {
+        pthread_mutex_lock(&j->mutex);
+        if (j->fd < 0) journalOuvrirFichier(j);
+        if (j->fd >= 0) journalVider(j, false);
+        pthread_mutex_unlock(&j->mutex);
+    } else if (pos - atomic_load_explicit(&j->lecture, memory_order_relaxed) > LOG_ANNEAU_TAILLE / 2 &&
+               !atomic_exchange_explicit(&j->reveil, 1, memory_order_relaxed)) {
+        pthread_cond_signal(&j->cond);
+    }
+}
+
 void log_error(const char *msg) {
-    FILE *fp = fopen("log.txt", "a");
-    if(fp) {
-        time_t now = time(NULL);
-        char time_str[26];
-        ctime_r(&now, time_str);
-        time_str[strcspn(time_str, "\n")] = '\0';
-        fprintf(fp, "[%s] %s\n", time_str, msg);
-        fclose(fp);
+    journal(LOG_ERREUR, msg, NULL);
+}
+
+/*
+ * Diagnostics (désactivés par défaut) : latences par fonction d'accès aux
+ * données et par texte SQL (sqlite3_trace_v2, événements STMT, ROW et PROFILE),
+ * lignes lues, succès des caches, et journal des requêtes lentes avec leur
+ * plan (EXPLAIN QUERY PLAN, sur une connexion à part en lecture seule). Les
+ * histogrammes ont une classe par puissance de 2 de microsecondes. Inactif,
+ * le traçage n'est pas branché sur les connexions et les minuteurs se
+ * réduisent à la lecture d'un booléen.
+ */
+#define DIAG_REQUETES_MAX 256           // textes SQL distincts suivis
+#define DIAG_CLASSES 24                 // classe c : [2^(c-1), 2^c[ µs, la dernière sans borne
+#define DIAG_LENTES_MAX 64              // dernières requêtes lentes gardées
+#define DIAG_CONNEXIONS_MAX 32
+#define DIAG_SEUIL_LENT_MS 100
+#define DIAG_SQL_MAX 512
+#define DIAG_PLAN_MAX 512
+#define DIAG_EXECUTIONS_EN_COURS 8      // requêtes ouvertes en même temps par thread
+#define DIAG_FICHIER "diagnostics.json"
+
+typedef enum {
+    DIAG_AJOUTER,
+    DIAG_MODIFIER,
+    DIAG_SUPPRIMER,
+    DIAG_RECHERCHER,
+    DIAG_EXECUTEUR,
+    DIAG_EXPORTER,
+    DIAG_EXPORTER_TABLES,
+    DIAG_BULLETINS,
+    DIAG_DERIVATION,
+    DIAG_IMPORTER,
+    DIAG_CONNEXION,
+    DIAG_PRESENCE,
+    DIAG_PRESENCES_CLASSE,
+    DIAG_LIRE_AUDIT,
+    DIAG_ECRIRE_AUDIT,
+    DIAG_PAGE,
+    DIAG_NB_FONCTIONS
+} DiagFonction;
+
+const char *diag_fonctions[DIAG_NB_FONCTIONS] = {
+    [DIAG_AJOUTER]          = "ajouterEleve",
+    [DIAG_MODIFIER]         = "modifierEleve",
+    [DIAG_SUPPRIMER]        = "supprimerEleve",
+    [DIAG_RECHERCHER]       = "rechercherEleve",
+    [DIAG_EXECUTEUR]        = "executerSelection",
+    [DIAG_EXPORTER]         = "exporterEleves",
+    [DIAG_EXPORTER_TABLES]  = "exporterTables",
+    [DIAG_BULLETINS]        = "genererBulletins",
+    [DIAG_DERIVATION]       = "pbkdf2Sha256",
+    [DIAG_IMPORTER]         = "importEtape",
+    [DIAG_CONNEXION]        = "check_login",
+    [DIAG_PRESENCE]         = "enregistrerPresence",
+    [DIAG_PRESENCES_CLASSE] = "chargerPresencesClasse",
+    [DIAG_LIRE_AUDIT]       = "lireAudit",
+    [DIAG_ECRIRE_AUDIT]     = "auditEcrireLot",
+    [DIAG_PAGE]             = "eleveModelChargerPage",
+};
+
+typedef enum { DIAG_CACHE_REQUETES, DIAG_CACHE_PAGES, DIAG_CACHE_RESULTATS, DIAG_CACHE_SESSIONS, DIAG_NB_CACHES } DiagCache;
+
+const char *diag_caches[DIAG_NB_CACHES] = {
+    [DIAG_CACHE_REQUETES] = "registre de requêtes",
+    [DIAG_CACHE_PAGES]    = "pages du modèle",
+    [DIAG_CACHE_RESULTATS] = "résultats",
+    [DIAG_CACHE_SESSIONS] = "sessions de connexion",
+};
+
+typedef struct {
+    long appels;
+    long lignes;
+    double total_ms;
+    double max_ms;
+    long classes[DIAG_CLASSES];
+} DiagMesure;
+
+typedef struct {
+    char *sql;                          // NULL : case libre
+    uint32_t hachage;
+    DiagMesure mesure;
+    long balayages;                     // pas de parcours complet (SQLITE_STMTSTATUS_FULLSCAN_STEP)
+    long tris;
+    char *plan;                         // relevé à la première lenteur
+} DiagRequete;
+
+typedef struct {
+    time_t quand;
+    double duree_ms;
+    char sql[DIAG_SQL_MAX];             // avec les valeurs liées
+    char plan[DIAG_PLAN_MAX];
+} DiagLente;
+
+typedef struct {
+    atomic_bool actif;
+    atomic_long seuil_lent_us;
+    pthread_mutex_t mutex;
+    pthread_mutex_t branchement;        // liste des connexions, pris avant mutex
+    sqlite3 *connexions[DIAG_CONNEXIONS_MAX];
+    int nb_connexions;
+    sqlite3 *explication;
+    DiagRequete requetes[DIAG_REQUETES_MAX * 2];   // adressage ouvert, au plus à moitié plein
+    int nb_requetes;
+    DiagMesure autres;                  // textes au-delà de DIAG_REQUETES_MAX
+    DiagMesure fonctions[DIAG_NB_FONCTIONS];
+    atomic_long caches[DIAG_NB_CACHES][2];         // succès, échecs
+    DiagLente lentes[DIAG_LENTES_MAX];
+    long nb_lentes;                     // depuis le début ; anneau des dernières
+    time_t depuis;
+} Diagnostics;
+
+typedef struct {
+    sqlite3_stmt *stmt;
+    double debut;                       // horloge au début de l'exécution
+    long lignes;
+} DiagExecution;
+
+Diagnostics diag = { .mutex = PTHREAD_MUTEX_INITIALIZER, .branchement = PTHREAD_MUTEX_INITIALIZER,
+                     .seuil_lent_us = DIAG_SEUIL_LENT_MS * 1000 };
+// STMT, ROW puis PROFILE : les événements d'une exécution arrivent dans le
+// même thread. La durée est mesurée de STMT au premier PROFILE : celle que
+// fournit SQLite n'est précise qu'à la milliseconde, et PROFILE peut se
+// répéter pour une même exécution.
+_Thread_local DiagExecution diag_executions[DIAG_EXECUTIONS_EN_COURS];
+
+bool diagActif(void) {
+    return atomic_load_explicit(&diag.actif, memory_order_relaxed);
+}
+
+double diagHorloge(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Début d'une mesure : 0 quand les diagnostics sont inactifs.
+double diagDebut(void) {
+    return diagActif() ? diagHorloge() : 0;
+}
+
+void diagClasser(DiagMesure *m, double ms, long lignes) {
+    m->appels++;
+    m->lignes += lignes;
+    m->total_ms += ms;
+    if (ms > m->max_ms) m->max_ms = ms;
+    long us = (long)(ms * 1e3);
+    int c = 0;
+    while (us > 0 && c < DIAG_CLASSES - 1) {
+        us >>= 1;
+        c++;
     }
+    m->classes[c]++;
 }
 
-bool initDB(sqlite3 **db) {
-    char *errMsg = NULL;
-    int rc = sqlite3_open(DB_NAME, db);
-    if (rc != SQLITE_OK) {
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer), "Erreur d'ouverture de la BD: %s", sqlite3_errmsg(*db));
-        log_error(buffer);
-        return false;
+void diagFin(DiagFonction f, double debut, long lignes) {
+    if (debut == 0) return;
+    double ms = (diagHorloge() - debut) * 1e3;
+    pthread_mutex_lock(&diag.mutex);
+    diagClasser(&diag.fonctions[f], ms, lignes);
+    pthread_mutex_unlock(&diag.mutex);
+}
+
+void diagCacheCompter(DiagCache c, bool succes) {
+    if (diagActif()) atomic_fetch_add_explicit(&diag.caches[c][succes ? 0 : 1], 1, memory_order_relaxed);
+}
+
+// Exécution en cours de stmt dans ce thread ; commencée si `debut`, sinon
+// NULL quand elle est inconnue.
+DiagExecution *diagExecution(sqlite3_stmt *stmt, bool debut) {
+    int libre = 0;
+    for (int i = 0; i < DIAG_EXECUTIONS_EN_COURS; i++) {
+        if (diag_executions[i].stmt == stmt) return &diag_executions[i];
+        if (!diag_executions[i].stmt) libre = i;
     }
-    const char *sql =
+    if (!debut) return NULL;
+    diag_executions[libre] = (DiagExecution){ stmt, diagHorloge(), 0 };
+    return &diag_executions[libre];
+}
+
+// Entrée du texte SQL, créée au besoin ; NULL si la table est pleine (mutex tenu).
+DiagRequete *diagRequete(const char *sql) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char*)sql; *c; c++) h = (h ^ *c) * 16777619u;
+    for (uint32_t i = h; ; i++) {
+        DiagRequete *r = &diag.requetes[i & (DIAG_REQUETES_MAX * 2 - 1)];
+        if (!r->sql) {
+            if (diag.nb_requetes == DIAG_REQUETES_MAX || !(r->sql = strdup(sql))) return NULL;
+            r->hachage = h;
+            diag.nb_requetes++;
+            return r;
+        }
+        if (r->hachage == h && strcmp(r->sql, sql) == 0) return r;
+    }
+}
+
+// Plan de la requête, une ligne par nœud séparées par " ; " (mutex tenu).
+// Délai d'attente nul : si la base est verrouillée, le plan est indisponible.
+void diagPlan(sqlite3 *source, const char *sql, char *out, size_t taille) {
+    snprintf(out, taille, "indisponible");
+    if (!diag.explication) {
+        const char *fichier = sqlite3_db_filename(source, "main");
+        if (!fichier || !*fichier) return;              // base en mémoire
+        if (sqlite3_open_v2(fichier, &diag.explication, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+            sqlite3_close(diag.explication);
+            diag.explication = NULL;
+            return;
+        }
+    }
+    char *requete = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", sql);
+    sqlite3_stmt *stmt = NULL;
+    if (requete && sqlite3_prepare_v2(diag.explication, requete, -1, &stmt, NULL) == SQLITE_OK) {
+        size_t n = 0;
+        out[0] = '\0';
+        while (n < taille && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *detail = (const char*)sqlite3_column_text(stmt, 3);
+            n += snprintf(out + n, taille - n, "%s%s", n ? " ; " : "", detail ? detail : "");
+        }
+        if (!out[0]) snprintf(out, taille, "aucun");
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_free(requete);
+}
+
+int diag_trace(unsigned type, void *ctx, void *p, void *x) {
+    sqlite3_stmt *stmt = p;
+    if (type == SQLITE_TRACE_STMT) {
+        diagExecution(stmt, true);      // les sous-programmes de triggers retombent sur la même
+        return 0;
+    }
+    DiagExecution *e = diagExecution(stmt, false);
+    if (!e) return 0;
+    if (type == SQLITE_TRACE_ROW) {
+        e->lignes++;
+        return 0;
+    }
+    double ms = (diagHorloge() - e->debut) * 1e3;
+    long lignes = e->lignes;
+    e->stmt = NULL;
+    const char *sql = sqlite3_sql(stmt);
+    if (!sql) return 0;
+    bool lente = ms * 1e3 >= atomic_load_explicit(&diag.seuil_lent_us, memory_order_relaxed);
+    char *etendu = lente ? sqlite3_expanded_sql(stmt) : NULL;
+    pthread_mutex_lock(&diag.mutex);
+    DiagRequete *r = diagRequete(sql);
+    diagClasser(r ? &r->mesure : &diag.autres, ms, lignes);
+    if (r) {
+        r->balayages += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        r->tris += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    }
+    if (lente) {
+        DiagLente *l = &diag.lentes[diag.nb_lentes++ % DIAG_LENTES_MAX];
+        if (r && !r->plan) {
+            diagPlan(sqlite3_db_handle(stmt), sql, l->plan, sizeof(l->plan));
+            r->plan = strdup(l->plan);
+        }
+        l->quand = time(NULL);
+        l->duree_ms = ms;
+        snprintf(l->sql, sizeof(l->sql), "%s", etendu ? etendu : sql);
+        snprintf(l->plan, sizeof(l->plan), "%s", r && r->plan ? r->plan : "indisponible");
+        journal(LOG_AVERT, "Requête lente", "duree_ms=%.1f plan=\"%s\" sql=\"%s\"", ms, l->plan, l->sql);
+    }
+    pthread_mutex_unlock(&diag.mutex);
+    sqlite3_free(etendu);
+    return 0;
+}
+
+// Branche ou débranche le traçage, sous diag.branchement mais jamais sous
+// diag.mutex : le rappel de trace prend celui-ci en tenant déjà le mutex de
+// la connexion.
+void diagTracer(sqlite3 *bdd, bool actif) {
+    sqlite3_trace_v2(bdd, actif ? SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW : 0,
+                     actif ? diag_trace : NULL, NULL);
+}
+
+// Connexion à instrumenter tant qu'elle est ouverte (diagOublier avant sqlite3_close).
+void diagSuivre(sqlite3 *bdd) {
+    if (!bdd) return;
+    pthread_mutex_lock(&diag.branchement);
+    pthread_mutex_lock(&diag.mutex);
+    if (diag.nb_connexions < DIAG_CONNEXIONS_MAX) diag.connexions[diag.nb_connexions++] = bdd;
+    pthread_mutex_unlock(&diag.mutex);
+    if (diagActif()) diagTracer(bdd, true);
+    pthread_mutex_unlock(&diag.branchement);
+}
+
+void diagOublier(sqlite3 *bdd) {
+    if (!bdd) return;
+    pthread_mutex_lock(&diag.branchement);
+    pthread_mutex_lock(&diag.mutex);
+    for (int i = 0; i < diag.nb_connexions; i++) {
+        if (diag.connexions[i] == bdd) diag.connexions[i--] = diag.connexions[--diag.nb_connexions];
+    }
+    pthread_mutex_unlock(&diag.mutex);
+    pthread_mutex_unlock(&diag.branchement);
+}
+
+void diagActiver(bool actif) {
+    sqlite3 *connexions[DIAG_CONNEXIONS_MAX];
+    pthread_mutex_lock(&diag.branchement);
+    pthread_mutex_lock(&diag.mutex);
+    atomic_store(&diag.actif, actif);
+    if (actif && !diag.depuis) diag.depuis = time(NULL);
+    int n = diag.nb_connexions;
+    memcpy(connexions, diag.connexions, sizeof(sqlite3*) * n);
+    pthread_mutex_unlock(&diag.mutex);
+    for (int i = 0; i < n; i++) diagTracer(connexions[i], actif);
+    pthread_mutex_unlock(&diag.branchement);
+}
+
+void diagSeuilLent(double ms) {
+    atomic_store(&diag.seuil_lent_us, (long)(ms * 1e3));
+}
+
+void diagReinitialiser(void) {
+    pthread_mutex_lock(&diag.mutex);
+    for (int i = 0; i < DIAG_REQUETES_MAX * 2; i++) {
+        free(diag.requetes[i].sql);
+        free(diag.requetes[i].plan);
+    }
+    memset(diag.requetes, 0, sizeof(diag.requetes));
+    memset(&diag.autres, 0, sizeof(diag.autres));
+    memset(diag.fonctions, 0, sizeof(diag.fonctions));
+    for (int c = 0; c < DIAG_NB_CACHES; c++) {
+        atomic_store(&diag.caches[c][0], 0);
+        atomic_store(&diag.caches[c][1], 0);
+    }
+    diag.nb_requetes = 0;
+    diag.nb_lentes = 0;
+    diag.depuis = time(NULL);
+    pthread_mutex_unlock(&diag.mutex);
+}
+
+// À la sortie, après diagOublier() des connexions suivies.
+void diagFermer(void) {
+    diagActiver(false);
+    pthread_mutex_lock(&diag.mutex);
+    sqlite3_close(diag.explication);
+    diag.explication = NULL;
+    pthread_mutex_unlock(&diag.mutex);
+}
+
+/*
+ * Registre des requêtes préparées : chaque requête des chemins CRUD est
+ * préparée une seule fois à l'ouverture de `db`, puis réinitialisée et
+ * re-liée à chaque appel. Les requêtes sont finalisées par fermerDB().
+ */
+typedef enum {
+    STMT_INSERT_ELEVE,
+    STMT_UPDATE_ELEVE,
+    STMT_DELETE_ELEVE,
+    STMT_SELECT_ELEVES,
+    STMT_LOGIN,
+    STMT_IMPORT_ELEVE,
+    STMT_NB_ELEVES,
+    STMT_PAGE_ELEVES,
+    STMT_IDS_ELEVES,
+    STMT_ELEVE_PAR_ID,
+    STMT_ELEVES_PAR_IDS,
+    STMT_RECHERCHE_ELEVES,
+    STMT_INSERT_NOTE,
+    STMT_MOYENNES_CLASSE,
+    STMT_MOYENNES_MATIERES,
+    STMT_REMPLACER_PRESENCE,
+    STMT_INSERT_PRESENCE,
+    STMT_LIRE_BITMAPS,
+    STMT_SAUVER_BITMAPS,
+    STMT_BITMAPS_CLASSE,
+    STMT_INSERT_AUDIT,
+    STMT_AUDIT_UTILISATEUR,
+    STMT_AUDIT_PERIODE,
+    STMT_LISTE_PARTITION,
+    STMT_RECHERCHE_PARTITION,
+    STMT_VERSION_ELEVE,
+    STMT_DEBUT_ECRITURE,
+    STMT_VALIDER,
+    STMT_ANNULER,
+    STMT_DATA_VERSION,
+    STMT_BULLETIN_ELEVES,
+    STMT_BULLETIN_MATIERES,
+    STMT_BULLETIN_APPRECIATIONS,
+    STMT_PARAMETRE_LIRE,
+    STMT_PARAMETRE_ECRIRE,
+    STMT_MOT_DE_PASSE,
+    STMT_COUT_EMPREINTES,
+    STMT_SESSION_LIRE,
+    STMT_SESSION_CREER,
+    STMT_SESSIONS_PURGER,
+    STMT_COUNT
+} StmtId;
+
+const char *stmt_sql[STMT_COUNT] = {
+    [STMT_INSERT_ELEVE]  = "INSERT INTO eleves (nom, age, taille, email, telephone, grade) VALUES (?, ?, ?, ?, ?, ?);",
+    [STMT_UPDATE_ELEVE]  = "UPDATE eleves SET nom=?, age=?, taille=?, email=?, telephone=?, grade=?, version = version + 1 "
+                           "WHERE id=?7 AND (?8 = 0 OR version = ?8);",
+    [STMT_DELETE_ELEVE]  = "DELETE FROM eleves WHERE id=?;",
+    [STMT_SELECT_ELEVES] = "SELECT * FROM eleves;",
+    [STMT_LOGIN]         = "SELECT id, password_hash FROM users WHERE username = ?;",
+    [STMT_IMPORT_ELEVE]  = "INSERT INTO eleves (id, nom, age, taille, email, telephone, grade) VALUES (?, ?, ?, ?, ?, ?, ?);",
+    [STMT_NB_ELEVES]     = "SELECT COUNT(*), COALESCE(MAX(id), 0) FROM eleves;",
+    [STMT_PAGE_ELEVES]   = "SELECT * FROM eleves WHERE id > ? ORDER BY id LIMIT ?;",
+    [STMT_IDS_ELEVES]    = "SELECT id FROM eleves WHERE id > ? ORDER BY id;",
+    [STMT_ELEVE_PAR_ID]  = "SELECT * FROM eleves WHERE id = ?;",
+    // ?1 : tableau JSON d'ids ("[12,7,40]"), lignes dans l'ordre des ids
+    [STMT_ELEVES_PAR_IDS] = "SELECT * FROM eleves WHERE id IN (SELECT value FROM json_each(?1)) ORDER BY id;",
+    [STMT_RECHERCHE_ELEVES] = "SELECT eleves.* FROM eleves_fts JOIN eleves ON eleves.id = eleves_fts.rowid "
+                              "WHERE eleves_fts MATCH ? ORDER BY eleves_fts.rank LIMIT ?;",
+    [STMT_INSERT_NOTE]   = "INSERT INTO notes (eleve_id, matiere, note, commentaire, date) VALUES (?, ?, ?, ?, ?);",
+    [STMT_MOYENNES_CLASSE] =
+        "WITH m AS ("
+            "SELECT a.eleve_id, e.nom, AVG(a.somme / a.nb) AS moyenne, SUM(a.nb) AS nb, "
+                   "MIN(a.note_min) AS note_min, MAX(a.note_max) AS note_max "
+            "FROM eleves e JOIN notes_agregats a ON a.eleve_id = e.id "
+            "WHERE e.grade = ?1 AND a.trimestre = ?2 AND (?3 IS NULL OR a.matiere = ?3) "
+            "GROUP BY a.eleve_id) "
+        "SELECT eleve_id, nom, moyenne, nb, note_min, note_max, RANK() OVER (ORDER BY moyenne DESC) AS rang "
+        "FROM m ORDER BY rang, eleve_id;",
+    [STMT_MOYENNES_MATIERES] =
+        "SELECT a.matiere, AVG(a.somme / a.nb), MIN(a.note_min), MAX(a.note_max), SUM(a.nb), COUNT(*) "
+        "FROM eleves e JOIN notes_agregats a ON a.eleve_id = e.id "
+        "WHERE e.grade = ?1 AND a.trimestre = ?2 "
+        "GROUP BY a.matiere ORDER BY a.matiere;",
+    [STMT_REMPLACER_PRESENCE] = "DELETE FROM presences WHERE eleve_id = ? AND date = ?;",
+    [STMT_INSERT_PRESENCE] = "INSERT INTO presences (eleve_id, date, status) VALUES (?, ?, ?);",
+    [STMT_LIRE_BITMAPS]  = "SELECT jours, absent, retard FROM presences_bitmaps WHERE eleve_id = ? AND annee = ?;",
+    [STMT_SAUVER_BITMAPS] = "INSERT OR REPLACE INTO presences_bitmaps (eleve_id, annee, jours, absent, retard) VALUES (?, ?, ?, ?, ?);",
+    [STMT_BITMAPS_CLASSE] =
+        "SELECT e.id, b.jours, b.absent, b.retard FROM eleves e "
+        "LEFT JOIN presences_bitmaps b ON b.eleve_id = e.id AND b.annee = ?2 "
+        "WHERE e.grade = ?1 ORDER BY e.id;",
+    [STMT_INSERT_AUDIT]  = "INSERT INTO logs (user_id, action, timestamp) VALUES (?, ?, ?);",
+    [STMT_AUDIT_UTILISATEUR] =
+        "SELECT l.id, l.user_id, u.username, l.action, l.timestamp FROM logs l LEFT JOIN users u ON u.id = l.user_id "
+        "WHERE l.user_id = ? AND l.timestamp >= ? AND l.timestamp < ? ORDER BY l.timestamp LIMIT ?;",
+    [STMT_AUDIT_PERIODE] =
+        "SELECT l.id, l.user_id, u.username, l.action, l.timestamp FROM logs l LEFT JOIN users u ON u.id = l.user_id "
+        "WHERE l.timestamp >= ? AND l.timestamp < ? ORDER BY l.timestamp LIMIT ?;",
+    // lectures par partition : la dernière colonne est la clé de fusion
+    [STMT_LISTE_PARTITION] = "SELECT *, id FROM eleves ORDER BY id;",
+    [STMT_RECHERCHE_PARTITION] = "SELECT eleves.*, eleves_fts.rank FROM eleves_fts JOIN eleves ON eleves.id = eleves_fts.rowid "
+                                 "WHERE eleves_fts MATCH ? ORDER BY eleves_fts.rank LIMIT ?;",
+    [STMT_VERSION_ELEVE] = "SELECT version FROM eleves WHERE id = ?;",
+    [STMT_DEBUT_ECRITURE] = "BEGIN IMMEDIATE;",
+    [STMT_VALIDER]       = "COMMIT;",
+    [STMT_ANNULER]       = "ROLLBACK;",
+    [STMT_DATA_VERSION]  = "PRAGMA data_version;",
+    // bulletins : toute une classe (ou toutes si ?1 est NULL), triée par élève
+    [STMT_BULLETIN_ELEVES] =
+        "SELECT e.id, e.nom, e.grade, b.jours, b.absent, b.retard FROM eleves e "
+        "LEFT JOIN presences_bitmaps b ON b.eleve_id = e.id AND b.annee = ?2 "
+        "WHERE ?1 IS NULL OR e.grade = ?1 ORDER BY e.id;",
+    [STMT_BULLETIN_MATIERES] =
+        "SELECT a.eleve_id, a.matiere, a.somme / a.nb, a.nb, a.note_min, a.note_max, "
+               "AVG(a.somme / a.nb) OVER (PARTITION BY e.grade, a.matiere) "
+        "FROM notes_agregats a JOIN eleves e ON e.id = a.eleve_id "
+        "WHERE a.trimestre = ?2 AND (?1 IS NULL OR e.grade = ?1) ORDER BY a.eleve_id, a.matiere;",
+    [STMT_BULLETIN_APPRECIATIONS] =
+        "SELECT n.eleve_id, coalesce(n.matiere, ''), n.commentaire FROM notes n JOIN eleves e ON e.id = n.eleve_id "
+        "WHERE n.date >= ?2 AND n.date < ?3 AND n.commentaire <> '' AND (?1 IS NULL OR e.grade = ?1) "
+        "ORDER BY n.eleve_id, 2, n.date, n.id;",
+    [STMT_PARAMETRE_LIRE]   = "SELECT valeur FROM parametres WHERE cle = ?;",
+    [STMT_PARAMETRE_ECRIRE] = "INSERT OR IGNORE INTO parametres (cle, valeur) VALUES (?, ?);",
+    [STMT_MOT_DE_PASSE]     = "UPDATE users SET password_hash = ?1 WHERE id = ?2 AND password_hash = ?3;",
+    [STMT_COUT_EMPREINTES]  =
+        "SELECT CAST(substr(password_hash, 16) AS INTEGER) AS n FROM users "
+        "WHERE substr(password_hash, 1, 15) = '$pbkdf2-sha256$' GROUP BY n ORDER BY count(*) DESC, n DESC LIMIT 1;",
+    [STMT_SESSION_LIRE]     = "SELECT user_id FROM sessions WHERE empreinte = ? AND expiration > ?;",
+    [STMT_SESSION_CREER]    = "INSERT INTO sessions (empreinte, user_id, expiration) VALUES (?, ?, ?);",
+    [STMT_SESSIONS_PURGER]  = "DELETE FROM sessions WHERE expiration <= ?;",
+};
+
+typedef struct {
+    sqlite3 *db;
+    sqlite3_stmt *stmts[STMT_COUNT];
+    bool a_la_demande;          // préparées au premier usage (ligne de commande)
+} StmtCache;
+
+StmtCache stmt_cache = { NULL, { NULL }, false };
+
+bool preparerRequetes(sqlite3 *db) {
+    if (stmt_cache.a_la_demande) {
+        stmt_cache.db = db;
+        return true;
+    }
+    for (int i = 0; i < STMT_COUNT; i++) {
+        if (sqlite3_prepare_v3(db, stmt_sql[i], -1, SQLITE_PREPARE_PERSISTENT,
+                               &stmt_cache.stmts[i], NULL) != SQLITE_OK) {
+            journal(LOG_ERREUR, "Erreur de préparation", "requete=%d erreur=\"%s\"", i, sqlite3_errmsg(db));
+            for (int j = 0; j < i; j++) {
+                sqlite3_finalize(stmt_cache.stmts[j]);
+                stmt_cache.stmts[j] = NULL;
+            }
+            return false;
+        }
+    }
+    stmt_cache.db = db;
+    return true;
+}
+
+void finaliserRequetes(void) {
+    for (int i = 0; i < STMT_COUNT; i++) {
+        sqlite3_finalize(stmt_cache.stmts[i]);
+        stmt_cache.stmts[i] = NULL;
+    }
+    stmt_cache.db = NULL;
+}
+
+// Renvoie la requête en cache pour la connexion partagée, sinon une requête
+// fraîchement préparée (autre connexion) que libererRequete() finalisera.
+sqlite3_stmt *obtenirRequete(sqlite3 *db, StmtId id) {
+    if (db == stmt_cache.db && stmt_cache.stmts[id]) {
+        diagCacheCompter(DIAG_CACHE_REQUETES, true);
+        return stmt_cache.stmts[id];
+    }
+    diagCacheCompter(DIAG_CACHE_REQUETES, false);
+    sqlite3_stmt *stmt = NULL;
+    if (db == stmt_cache.db && stmt_cache.a_la_demande) {
+        if (sqlite3_prepare_v3(db, stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT, &stmt_cache.stmts[id], NULL) != SQLITE_OK) {
+            journal(LOG_ERREUR, "Erreur de préparation", "requete=%d erreur=\"%s\"", (int)id, sqlite3_errmsg(db));
+            return NULL;
+        }
+        return stmt_cache.stmts[id];
+    }
+    if (sqlite3_prepare_v2(db, stmt_sql[id], -1, &stmt, NULL) != SQLITE_OK) {
+        journal(LOG_ERREUR, "Erreur de préparation", "requete=%d erreur=\"%s\"", (int)id, sqlite3_errmsg(db));
+        return NULL;
+    }
+    return stmt;
+}
+
+void libererRequete(sqlite3_stmt *stmt) {
+    if (!stmt) return;
+    if (sqlite3_db_handle(stmt) == stmt_cache.db) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    } else {
+        sqlite3_finalize(stmt);
+    }
+}
+
+/*
+ * Migrations du schéma : étapes ordonnées, numérotées comme PRAGMA
+ * user_version. Chaque étape manquante est appliquée dans sa propre
+ * transaction, qui enregistre aussi le nouveau numéro de version.
+ * Ne jamais modifier une étape publiée : en ajouter une nouvelle.
+ */
+typedef struct {
+    int version;
+    const char *description;
+    const char *sql;
+    bool (*apres)(sqlite3 *db);     // étape en C éventuelle, dans la même transaction
+} Migration;
+
+bool reconstruireBitmapsPresences(sqlite3 *db);
+bool hacherMotsDePasseClairs(sqlite3 *db);
+void crochetsTransaction(sqlite3 *db);
+void transactionConfirmer(sqlite3 *db);
+void cacheResultatsInvalider(void);
+
+// Trimestre scolaire d'une date 'AAAA-MM-JJ' : T1 septembre-décembre,
+// T2 janvier-mars, T3 avril-août, préfixé de l'année de rentrée ("2024-T2").
+#define SQL_TRIMESTRE(d) \
+    "coalesce(CASE " \
+        "WHEN CAST(strftime('%m', " d ") AS INTEGER) >= 9 THEN strftime('%Y', " d ") || '-T1' " \
+        "WHEN CAST(strftime('%m', " d ") AS INTEGER) <= 3 THEN (CAST(strftime('%Y', " d ") AS INTEGER) - 1) || '-T2' " \
+        "ELSE (CAST(strftime('%Y', " d ") AS INTEGER) - 1) || '-T3' END, '')"
+
+// Retire old.note de son agrégat ; min/max ne sont recalculés que si la note
+// retirée était l'extrême du groupe.
+#define SQL_AGREGAT_RETIRER \
+    "UPDATE notes_agregats SET " \
+        "somme = somme - old.note, nb = nb - 1, " \
+        "note_min = CASE WHEN old.note > note_min THEN note_min ELSE " \
+            "(SELECT MIN(note) FROM notes WHERE eleve_id = old.eleve_id AND coalesce(matiere, '') = coalesce(old.matiere, '') " \
+            "AND " SQL_TRIMESTRE("date") " = " SQL_TRIMESTRE("old.date") ") END, " \
+        "note_max = CASE WHEN old.note < note_max THEN note_max ELSE " \
+            "(SELECT MAX(note) FROM notes WHERE eleve_id = old.eleve_id AND coalesce(matiere, '') = coalesce(old.matiere, '') " \
+            "AND " SQL_TRIMESTRE("date") " = " SQL_TRIMESTRE("old.date") ") END " \
+    "WHERE eleve_id = old.eleve_id AND matiere = coalesce(old.matiere, '') AND trimestre = " SQL_TRIMESTRE("old.date") " " \
+        "AND old.note IS NOT NULL; " \
+    "DELETE FROM notes_agregats WHERE eleve_id = old.eleve_id AND matiere = coalesce(old.matiere, '') " \
+        "AND trimestre = " SQL_TRIMESTRE("old.date") " AND nb = 0; "
+
+#define SQL_AGREGAT_AJOUTER \
+    "INSERT INTO notes_agregats (eleve_id, matiere, trimestre, somme, nb, note_min, note_max) " \
+        "SELECT new.eleve_id, coalesce(new.matiere, ''), " SQL_TRIMESTRE("new.date") ", new.note, 1, new.note, new.note " \
+        "WHERE new.note IS NOT NULL " \
+    "ON CONFLICT (eleve_id, matiere, trimestre) DO UPDATE SET " \
+        "somme = somme + excluded.somme, nb = nb + 1, " \
+        "note_min = min(note_min, excluded.note_min), note_max = max(note_max, excluded.note_max); "
+
+#define SQL_AGREGAT_RECALCUL \
+    "SELECT eleve_id, coalesce(matiere, '') AS matiere, " SQL_TRIMESTRE("date") " AS trimestre, " \
+        "SUM(note) AS somme, COUNT(note) AS nb, MIN(note) AS note_min, MAX(note) AS note_max " \
+    "FROM notes WHERE note IS NOT NULL GROUP BY 1, 2, 3"
+
+const Migration migrations[] = {
+    { 1, "schéma initial",
         "CREATE TABLE IF NOT EXISTS eleves ("
             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
             "nom TEXT NOT NULL, "
@@ -96,234 +1025,7849 @@ bool initDB(sqlite3 **db) {
             "action TEXT, "
             "timestamp TEXT, "
             "FOREIGN KEY(user_id) REFERENCES users(id)"
-        ");";
-    rc = sqlite3_exec(*db, sql, 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        log_error(errMsg);
+        ");", NULL },
+    // Index plein texte (contenu externe : eleves) tenu à jour par triggers
+    { 2, "index de recherche plein texte",
+        "CREATE VIRTUAL TABLE IF NOT EXISTS eleves_fts USING fts5("
+            "nom, email, grade, "
+            "content='eleves', content_rowid='id', "
+            "tokenize='unicode61 remove_diacritics 2', "
+            "prefix='2 3'"
+        ");"
+        "CREATE TRIGGER IF NOT EXISTS eleves_fts_ai AFTER INSERT ON eleves BEGIN "
+            "INSERT INTO eleves_fts(rowid, nom, email, grade) VALUES (new.id, new.nom, new.email, new.grade); "
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS eleves_fts_ad AFTER DELETE ON eleves BEGIN "
+            "INSERT INTO eleves_fts(eleves_fts, rowid, nom, email, grade) VALUES ('delete', old.id, old.nom, old.email, old.grade); "
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS eleves_fts_au AFTER UPDATE ON eleves BEGIN "
+            "INSERT INTO eleves_fts(eleves_fts, rowid, nom, email, grade) VALUES ('delete', old.id, old.nom, old.email, old.grade); "
+            "INSERT INTO eleves_fts(rowid, nom, email, grade) VALUES (new.id, new.nom, new.email, new.grade); "
+        "END;"
+        // remplit l'index pour les élèves existants
+        "INSERT INTO eleves_fts(eleves_fts) VALUES ('rebuild');", NULL },
+    { 3, "index des notes et des présences",
+        // couvrants : les consultations par élève ne lisent jamais la table
+        "CREATE INDEX IF NOT EXISTS idx_notes_eleve_matiere_date ON notes(eleve_id, matiere, date, note);"
+        "CREATE INDEX IF NOT EXISTS idx_presences_eleve_date ON presences(eleve_id, date, status);"
+        "CREATE INDEX IF NOT EXISTS idx_presences_date ON presences(date, status, eleve_id);", NULL },
+    { 4, "agrégats de notes par élève, matière et trimestre",
+        "CREATE TABLE IF NOT EXISTS notes_agregats ("
+            "eleve_id INTEGER NOT NULL, "
+            "matiere TEXT NOT NULL, "
+            "trimestre TEXT NOT NULL, "
+            "somme REAL NOT NULL, "
+            "nb INTEGER NOT NULL, "
+            "note_min REAL, "
+            "note_max REAL, "
+            "PRIMARY KEY (eleve_id, matiere, trimestre)"
+        ") WITHOUT ROWID;"
+        "CREATE INDEX IF NOT EXISTS idx_eleves_grade ON eleves(grade);"
+        "CREATE TRIGGER IF NOT EXISTS notes_agregats_ai AFTER INSERT ON notes BEGIN "
+            SQL_AGREGAT_AJOUTER
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS notes_agregats_ad AFTER DELETE ON notes BEGIN "
+            SQL_AGREGAT_RETIRER
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS notes_agregats_au AFTER UPDATE OF eleve_id, matiere, note, date ON notes BEGIN "
+            SQL_AGREGAT_RETIRER
+            SQL_AGREGAT_AJOUTER
+        "END;"
+        "DELETE FROM notes_agregats;"
+        "INSERT INTO notes_agregats " SQL_AGREGAT_RECALCUL ";", NULL },
+    // tenue à jour par enregistrerPresence(), recalculable après un import
+    { 5, "bitmaps de présences par élève et année scolaire",
+        "CREATE TABLE IF NOT EXISTS presences_bitmaps ("
+            "eleve_id INTEGER NOT NULL, "
+            "annee INTEGER NOT NULL, "
+            "jours BLOB NOT NULL, "
+            "absent BLOB NOT NULL, "
+            "retard BLOB NOT NULL, "
+            "PRIMARY KEY (eleve_id, annee)"
+        ") WITHOUT ROWID;",
+      reconstruireBitmapsPresences },
+    // requêtes de la visionneuse d'audit
+    { 6, "index de la piste d'audit",
+        "CREATE INDEX IF NOT EXISTS idx_logs_user_timestamp ON logs(user_id, timestamp);"
+        "CREATE INDEX IF NOT EXISTS idx_logs_timestamp ON logs(timestamp);", NULL },
+    // concurrence optimiste : chaque modification incrémente la version
+    { 7, "version des élèves",
+        "ALTER TABLE eleves ADD COLUMN version INTEGER NOT NULL DEFAULT 1;", NULL },
+    // coût de dérivation des mots de passe, qui ne sont plus stockés en clair
+    { 8, "paramètres et mots de passe hachés",
+        "CREATE TABLE IF NOT EXISTS parametres ("
+            "cle TEXT PRIMARY KEY, "
+            "valeur"
+        ");", hacherMotsDePasseClairs },
+    // jetons de la ligne de commande, conservés sous forme de HMAC
+    { 9, "sessions de la ligne de commande",
+        "CREATE TABLE IF NOT EXISTS sessions ("
+            "empreinte BLOB PRIMARY KEY, "
+            "user_id INTEGER NOT NULL, "
+            "expiration INTEGER NOT NULL"
+        ") WITHOUT ROWID;", NULL },
+};
+
+#define NB_MIGRATIONS ((int)(sizeof(migrations) / sizeof(migrations[0])))
+
+int versionSchema(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+bool appliquerMigration(sqlite3 *db, const Migration *m) {
+    char *errMsg = NULL;
+    char pragma[64];
+    snprintf(pragma, sizeof(pragma), "PRAGMA user_version = %d;", m->version);
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, &errMsg) != SQLITE_OK ||
+        sqlite3_exec(db, m->sql, 0, 0, &errMsg) != SQLITE_OK ||
+        (m->apres && !m->apres(db)) ||
+        sqlite3_exec(db, pragma, 0, 0, &errMsg) != SQLITE_OK ||
+        sqlite3_exec(db, "COMMIT;", 0, 0, &errMsg) != SQLITE_OK) {
+        journal(LOG_ERREUR, "Erreur de migration", "version=%d description=\"%s\" erreur=\"%s\"",
+                m->version, m->description, errMsg ? errMsg : sqlite3_errmsg(db));
         sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
         return false;
     }
     return true;
 }
 
-bool ajouterEleve(sqlite3 *db, const Personne *e) {
-    sqlite3_stmt *stmt;
-    const char *sql = "INSERT INTO eleves (nom, age, taille, email, telephone, grade) VALUES (?, ?, ?, ?, ?, ?);";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer), "Erreur de préparation: %s", sqlite3_errmsg(db));
-        log_error(buffer);
+bool creerSchema(sqlite3 *db) {
+    int version = versionSchema(db);
+    if (version < 0) {
+        log_error(sqlite3_errmsg(db));
         return false;
     }
-    sqlite3_bind_text(stmt, 1, e->nom, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 2, e->age);
-    sqlite3_bind_double(stmt, 3, e->taille);
-    sqlite3_bind_text(stmt, 4, e->email, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, e->telephone, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 6, e->grade, -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    if (rc != SQLITE_DONE) {
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer), "Erreur d'insertion: %s", sqlite3_errmsg(db));
-        log_error(buffer);
+    if (version > migrations[NB_MIGRATIONS - 1].version) {
+        log_error("Erreur: base de données créée par une version plus récente de C-Pronote.");
         return false;
     }
+    for (int i = 0; i < NB_MIGRATIONS; i++) {
+        if (migrations[i].version > version && !appliquerMigration(db, &migrations[i])) {
+            return false;
+        }
+    }
     return true;
 }
 
-char* listerElevesStr(sqlite3 *db) {
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT * FROM eleves;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        return NULL;
-    }
-    char *result = malloc(4096);
-    if (!result) return NULL;
-    strcpy(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
-    strcat(result, "| ID | Nom                  | Age | Taille | Email                     | Téléphone      | Grade  |\n");
-    strcat(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
-    char line[256];
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        snprintf(line, sizeof(line), "| %-2d | %-20s | %-3d | %-6.2f | %-25s | %-14s | %-6s |\n",
-                 sqlite3_column_int(stmt, 0),
-                 sqlite3_column_text(stmt, 1) ? (const char*)sqlite3_column_text(stmt, 1) : "",
-                 sqlite3_column_int(stmt, 2),
-                 sqlite3_column_double(stmt, 3),
-                 sqlite3_column_text(stmt, 4) ? (const char*)sqlite3_column_text(stmt, 4) : "",
-                 sqlite3_column_text(stmt, 5) ? (const char*)sqlite3_column_text(stmt, 5) : "",
-                 sqlite3_column_text(stmt, 6) ? (const char*)sqlite3_column_text(stmt, 6) : "");
-        strcat(result, line);
-    }
-    strcat(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
-    sqlite3_finalize(stmt);
-    return result;
-}
+/*
+ * Plans attendus des requêtes chaudes : un index supprimé ou rendu
+ * inutilisable par un changement de schéma fait échouer la vérification
+ * (./C-Pronote-bench plans, code de sortie non nul).
+ */
+typedef struct {
+    const char *sql;
+    const char *plan_attendu;   // sous-chaîne du détail d'EXPLAIN QUERY PLAN
+} PlanAttendu;
 
-bool modifierEleve(sqlite3 *db, int id, const Personne *e) {
-    // Vérifie d'abord l'existence de l'élève
-    sqlite3_stmt *check_stmt;
-    const char *check_sql = "SELECT COUNT(*) FROM eleves WHERE id = ?;";
-    if (sqlite3_prepare_v2(db, check_sql, -1, &check_stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        return false;
-    }
-    sqlite3_bind_int(check_stmt, 1, id);
-    if (sqlite3_step(check_stmt) == SQLITE_ROW) {
-        int count = sqlite3_column_int(check_stmt, 0);
-        sqlite3_finalize(check_stmt);
-        if (count == 0) {
+const PlanAttendu plans_attendus[] = {
+    { "SELECT note, date FROM notes WHERE eleve_id = 1 AND matiere = 'maths' ORDER BY date;",
+      "USING COVERING INDEX idx_notes_eleve_matiere_date" },
+    { "SELECT matiere, AVG(note) FROM notes WHERE eleve_id = 1 GROUP BY matiere;",
+      "USING COVERING INDEX idx_notes_eleve_matiere_date" },
+    { "SELECT date, status FROM presences WHERE eleve_id = 1 AND date BETWEEN '2024-09-01' AND '2024-09-30';",
+      "USING COVERING INDEX idx_presences_eleve_date" },
+    { "SELECT eleve_id FROM presences WHERE date = '2024-09-02' AND status = 'absent';",
+      "USING COVERING INDEX idx_presences_date" },
+    { "SELECT a.eleve_id FROM eleves e JOIN notes_agregats a ON a.eleve_id = e.id WHERE e.grade = '3A' AND a.trimestre = '2024-T1';",
+      "USING COVERING INDEX idx_eleves_grade" },
+    { "SELECT id, password_hash FROM users WHERE username = 'admin';",
+      "USING INDEX sqlite_autoindex_users_1" },
+    { "SELECT action FROM logs WHERE user_id = 1 AND timestamp >= '2025-01-01' AND timestamp < '2025-02-01' ORDER BY timestamp;",
+      "USING INDEX idx_logs_user_timestamp" },
+    { "SELECT action FROM logs WHERE timestamp >= '2025-01-01' AND timestamp < '2025-02-01' ORDER BY timestamp;",
+      "USING INDEX idx_logs_timestamp" },
+    { "SELECT * FROM eleves WHERE id > 100 ORDER BY id LIMIT 128;",
+      "USING INTEGER PRIMARY KEY" },
+    { "SELECT eleves.* FROM eleves_fts JOIN eleves ON eleves.id = eleves_fts.rowid WHERE eleves_fts MATCH 'dup*';",
+      "VIRTUAL TABLE INDEX" },
+};
+
+bool verifierPlansRequetes(sqlite3 *db) {
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(plans_attendus) / sizeof(plans_attendus[0]); i++) {
+        char sql[MAX_QUERY];
+        snprintf(sql, sizeof(sql), "EXPLAIN QUERY PLAN %s", plans_attendus[i].sql);
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+            log_error(sqlite3_errmsg(db));
             return false;
         }
-    } else {
-        sqlite3_finalize(check_stmt);
-        log_error(sqlite3_errmsg(db));
-        return false;
-    }
-    sqlite3_stmt *stmt;
-    const char *sql = "UPDATE eleves SET nom=?, age=?, taille=?, email=?, telephone=?, grade=? WHERE id=?;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        return false;
+        bool trouve = false;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *detail = (const char*)sqlite3_column_text(stmt, 3);
+            if (detail && strstr(detail, plans_attendus[i].plan_attendu)) trouve = true;
+        }
+        sqlite3_finalize(stmt);
+        if (!trouve) {
+            char buffer[MAX_QUERY + 128];
+            snprintf(buffer, sizeof(buffer), "Régression de plan (attendu '%s'): %s",
+                     plans_attendus[i].plan_attendu, plans_attendus[i].sql);
+            log_error(buffer);
+            fprintf(stderr, "%s\n", buffer);
+            ok = false;
+        }
     }
-    sqlite3_bind_text(stmt, 1, e->nom, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 2, e->age);
-    sqlite3_bind_double(stmt, 3, e->taille);
-    sqlite3_bind_text(stmt, 4, e->email, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, e->telephone, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 6, e->grade, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 7, id);
-    int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error(sqlite3_errmsg(db));
+    return ok;
+}
+
+// Reconstruit eleves_fts depuis eleves (./C-Pronote --reindexer). La
+// migration qui crée l'index le remplit déjà ; ceci ne sert qu'après une
+// modification de eleves faite sans les triggers.
+bool reconstruireIndexRecherche(sqlite3 *db) {
+    char *errMsg = NULL;
+    if (sqlite3_exec(db, "INSERT INTO eleves_fts(eleves_fts) VALUES ('rebuild');", 0, 0, &errMsg) != SQLITE_OK) {
+        log_error(errMsg);
+        sqlite3_free(errMsg);
         return false;
     }
     return true;
 }
 
-bool supprimerEleve(sqlite3 *db, int id) {
-    sqlite3_stmt *check_stmt;
-    const char *check_sql = "SELECT COUNT(*) FROM eleves WHERE id = ?;";
-    if (sqlite3_prepare_v2(db, check_sql, -1, &check_stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        return false;
+/*
+ * Accès concurrent : plusieurs postes (processus) peuvent écrire dans la même
+ * base. Elle est en WAL, les lecteurs ne bloquent donc ni ne sont bloqués
+ * par l'écrivain. Chaque écriture prend le verrou d'entrée (BEGIN
+ * IMMEDIATE) : en WAL, une transaction qui passerait de la lecture à
+ * l'écriture recevrait SQLITE_BUSY sans que le gestionnaire d'occupation soit
+ * appelé. Ce gestionnaire réessaie avec une attente exponentielle bornée.
+ * Une modification porte la version lue : si un autre poste a modifié
+ * l'élève entre-temps, elle est refusée (MODIF_CONFLIT) au lieu d'écraser.
+ */
+atomic_long attentes_occupee;       // appels du gestionnaire, pour les mesures
+
+// Attentes de 1, 2, 4... ms plafonnées à ATTENTE_MAX_MS, à ±50 % près pour
+// désynchroniser les postes ; abandon au-delà de EXEC_BUSY_TIMEOUT_MS cumulées.
+int attente_occupee(void *donnees, int essais) {
+    static _Thread_local unsigned graine;
+    if (!graine) graine = (unsigned)getpid() * 2654435761u ^ (unsigned)(uintptr_t)&graine;
+    long cumul = 0, delai = ATTENTE_INITIALE_MS;
+    for (int k = 0; k < essais && cumul < EXEC_BUSY_TIMEOUT_MS; k++) {
+        cumul += delai;
+        if (delai < ATTENTE_MAX_MS) delai *= 2;
     }
-    sqlite3_bind_int(check_stmt, 1, id);
-    if (sqlite3_step(check_stmt) == SQLITE_ROW) {
-        int count = sqlite3_column_int(check_stmt, 0);
-        sqlite3_finalize(check_stmt);
-        if (count == 0) {
-            return false;
-        }
-    } else {
-        sqlite3_finalize(check_stmt);
-        log_error(sqlite3_errmsg(db));
+    if (cumul >= EXEC_BUSY_TIMEOUT_MS) return 0;
+    long us = delai * 500 + rand_r(&graine) % (delai * 1000);
+    struct timespec ts = { us / 1000000, us % 1000000 * 1000 };
+    nanosleep(&ts, NULL);
+    atomic_fetch_add_explicit(&attentes_occupee, 1, memory_order_relaxed);
+    return 1;
+}
+
+void configurerAttente(sqlite3 *bdd) {
+    sqlite3_busy_handler(bdd, attente_occupee, NULL);
+}
+
+// Ouvre `chemin` en WAL (mode enregistré dans le fichier : les autres
+// connexions en héritent), schéma à jour et requêtes préparées.
+bool ouvrirBase(const char *chemin, sqlite3 **db) {
+    int rc = sqlite3_open(chemin, db);
+    if (rc != SQLITE_OK) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "Erreur d'ouverture de la BD: %s", sqlite3_errmsg(*db));
+        log_error(buffer);
         return false;
     }
+    // la piste d'audit écrit par sa propre connexion
+    configurerAttente(*db);
+    diagSuivre(*db);
+    crochetsTransaction(*db);
     sqlite3_stmt *stmt;
-    const char *sql = "DELETE FROM eleves WHERE id=?;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        return false;
+    const char *mode = NULL;
+    if (sqlite3_prepare_v2(*db, "PRAGMA journal_mode = WAL;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) mode = (const char*)sqlite3_column_text(stmt, 0);
+        if (!mode || strcmp(mode, "wal") != 0) {
+            journal(LOG_AVERT, "Mode WAL indisponible", "fichier=\"%s\" mode=%s", chemin, mode ? mode : "?");
+        }
+        sqlite3_finalize(stmt);
     }
-    sqlite3_bind_int(stmt, 1, id);
+    // en WAL, NORMAL ne perd au pire que les dernières transactions sur coupure
+    sqlite3_exec(*db, "PRAGMA synchronous = NORMAL;", 0, 0, NULL);
+    return creerSchema(*db) && preparerRequetes(*db);
+}
+
+bool initDB(sqlite3 **db) {
+    return ouvrirBase(DB_NAME, db);
+}
+
+// Ouvre la transaction d'une écriture (verrou pris d'emblée) ; sans effet
+// dans une transaction de l'appelant (lots, import, bancs d'essai).
+bool ecritureDebut(sqlite3 *db, bool *ouverte) {
+    *ouverte = false;
+    if (!sqlite3_get_autocommit(db)) return true;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_DEBUT_ECRITURE);
+    if (!stmt) return false;
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error(sqlite3_errmsg(db));
-        return false;
+    if (rc != SQLITE_DONE) journal(LOG_ERREUR, "Base occupée", "erreur=\"%s\"", sqlite3_errmsg(db));
+    libererRequete(stmt);
+    *ouverte = rc == SQLITE_DONE;
+    return *ouverte;
+}
+
+// Valide (ok) ou annule la transaction ouverte par ecritureDebut.
+bool ecritureFin(sqlite3 *db, bool ouverte, bool ok) {
+    if (!ouverte) return ok;
+    sqlite3_stmt *stmt = obtenirRequete(db, ok ? STMT_VALIDER : STMT_ANNULER);
+    int rc = stmt ? sqlite3_step(stmt) : SQLITE_ERROR;
+    if (rc != SQLITE_DONE) log_error(sqlite3_errmsg(db));
+    libererRequete(stmt);
+    if (rc != SQLITE_DONE && !sqlite3_get_autocommit(db)) sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    if (rc == SQLITE_DONE) transactionConfirmer(db);      // sans WAL, wal_hook n'est pas appelé
+    return ok && rc == SQLITE_DONE;
+}
+
+/*
+ * Écritures différées jusqu'à la validation : les structures en mémoire
+ * tenues à jour par les écritures ne doivent voir une transaction qu'une
+ * fois écrite. Ce qu'elle leur réserve attend dans un EcrituresDifferees ;
+ * commit_hook marque l'attente comme validée, mais le COMMIT peut encore
+ * échouer (base occupée, erreur d'E/S). Elle n'est appliquée qu'une fois le
+ * compteur de versions du fichier avancé, c'est-à-dire la transaction
+ * écrite : dans wal_hook, juste après l'écriture, ou au passage suivant par
+ * les crochets ou par ecritureFin (base sans WAL). rollback_hook l'oublie.
+ */
+typedef struct {
+    char *elements;
+    size_t taille;              // d'un élément
+    int nb;
+    int cap;
+    int valides;                // les premiers, dont la transaction a passé commit_hook
+    unsigned version;           // versionDonnees() lors de ce commit_hook
+} EcrituresDifferees;
+
+// Compteur de versions du fichier principal ; contrairement à PRAGMA
+// data_version, il avance aussi aux validations de la connexion elle-même.
+unsigned versionDonnees(sqlite3 *db) {
+    unsigned v = 0;
+    sqlite3_file_control(db, "main", SQLITE_FCNTL_DATA_VERSION, &v);
+    return v;
+}
+
+bool differerAjouter(EcrituresDifferees *d, const void *e) {
+    if (d->nb == d->cap) {
+        int cap = d->cap ? d->cap * 2 : 64;
+        char *tmp = realloc(d->elements, d->taille * cap);
+        if (!tmp) return false;
+        d->elements = tmp;
+        d->cap = cap;
     }
+    memcpy(d->elements + d->taille * d->nb++, e, d->taille);
     return true;
 }
 
-bool exporterCSV(sqlite3 *db) {
-    FILE *file = fopen(CSV_FILENAME, "w");
-    if (!file) {
-        log_error("Erreur: Impossible d'ouvrir le fichier CSV pour écriture.");
+void differerValider(EcrituresDifferees *d, sqlite3 *db) {
+    d->valides = d->nb;
+    d->version = versionDonnees(db);
+}
+
+void differerAnnuler(EcrituresDifferees *d) {
+    d->nb = d->valides = 0;
+}
+
+// Applique dans l'ordre les éléments dont la transaction est écrite ; rend
+// leur nombre (0 tant qu'elle ne l'est pas).
+int differerAppliquer(EcrituresDifferees *d, sqlite3 *db, void (*appliquer)(const void *e, void *contexte), void *contexte) {
+    if (d->valides == 0 || versionDonnees(db) == d->version) return 0;
+    int n = d->valides;
+    for (int i = 0; i < n; i++) appliquer(d->elements + d->taille * i, contexte);
+    memmove(d->elements, d->elements + d->taille * n, d->taille * (d->nb - n));
+    d->nb -= n;
+    d->valides = 0;
+    return n;
+}
+
+void differerLiberer(EcrituresDifferees *d) {
+    free(d->elements);
+    d->elements = NULL;
+    d->nb = d->cap = d->valides = 0;
+}
+
+void fermerDB(sqlite3 *db) {
+    if (db == stmt_cache.db) {
+        finaliserRequetes();
+    }
+    diagOublier(db);
+    sqlite3_close(db);
+}
+
+/*
+ * Piste d'audit : les actions (ajout, modification, suppression, export,
+ * connexion) sont mises en file avec l'utilisateur connecté ; un thread
+ * dédié, avec sa propre connexion, les écrit dans logs par transactions
+ * groupées (tous les AUDIT_LOT événements ou toutes les AUDIT_DELAI_MS ms).
+ * Une action faite dans une transaction de la connexion principale n'entre
+ * dans la file qu'une fois la transaction écrite, et pas si elle est annulée
+ * (voir EcrituresDifferees). La file est bornée : un producteur attend
+ * qu'une place se libère plutôt que de perdre un événement, et un lot dont
+ * l'écriture échoue reste en tête de file pour un nouvel essai, après un
+ * délai croissant. auditArreter() vide tout avant de rendre la main.
+ * Pendant une sauvegarde (auditDifferer), les écritures sont retenues tant que
+ * la file n'est pas à moitié pleine : une écriture par une autre connexion
+ * ferait repartir la copie de zéro.
+ */
+#define AUDIT_FILE_TAILLE 4096
+#define AUDIT_LOT 256
+#define AUDIT_DELAI_MS 200
+#define AUDIT_ESSAIS_ARRET 5            // à l'arrêt, essais avant d'abandonner la file
+#define MAX_ACTION 128
+
+typedef struct {
+    int user_id;                        // 0 : aucun utilisateur connecté
+    struct timespec ts;
+    char action[MAX_ACTION];
+} EvenementAudit;
+
+typedef struct {
+    EvenementAudit file[AUDIT_FILE_TAILLE];
+    int debut;
+    int nb;
+    bool arret;
+    bool actif;
+    bool differe;                       // sauvegarde en cours
+    long ecrits;
+    sqlite3 *db;
+    sqlite3 *direct;                    // sans thread : écrit aussitôt par cette connexion
+    sqlite3 *ecrivain;                  // connexion principale, dont les transactions sont suivies
+    pthread_t thread_ecrivain;          // seul thread à l'utiliser
+    EcrituresDifferees differes;        // actions de sa transaction ouverte
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t evenements;          // file non vide, lot complet ou arrêt
+    pthread_cond_t place_libre;
+} Audit;
+
+Audit audit = { .mutex = PTHREAD_MUTEX_INITIALIZER, .evenements = PTHREAD_COND_INITIALIZER,
+                .place_libre = PTHREAD_COND_INITIALIZER, .differes = { .taille = sizeof(EvenementAudit) } };
+_Atomic int utilisateur_courant = 0;    // id dans users, fixé par check_login()
+
+// Horodatage UTC au format des fonctions de date SQLite, triable comme texte.
+void auditHorodatage(const struct timespec *ts, char *out, size_t taille) {
+    struct tm tm;
+    time_t t = ts->tv_sec;
+    gmtime_r(&t, &tm);
+    size_t n = strftime(out, taille, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(out + n, taille - n, ".%03ld", ts->tv_nsec / 1000000);
+}
+
+// Écrit un lot dans une seule transaction, celle de l'appelant s'il en a
+// une ouverte.
+bool auditEcrireLot(sqlite3 *bdd, const EvenementAudit *lot, int n) {
+    double t0 = diagDebut();
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_INSERT_AUDIT);
+    if (!stmt) return false;
+    bool propre = sqlite3_get_autocommit(bdd);
+    bool ok = !propre || sqlite3_exec(bdd, "BEGIN IMMEDIATE;", 0, 0, NULL) == SQLITE_OK;
+    for (int i = 0; ok && i < n; i++) {
+        char horodatage[32];
+        auditHorodatage(&lot[i].ts, horodatage, sizeof(horodatage));
+        if (lot[i].user_id > 0) sqlite3_bind_int(stmt, 1, lot[i].user_id);
+        else sqlite3_bind_null(stmt, 1);
+        sqlite3_bind_text(stmt, 2, lot[i].action, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, horodatage, -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    libererRequete(stmt);
+    ok = ok && (!propre || sqlite3_exec(bdd, "COMMIT;", 0, 0, NULL) == SQLITE_OK);
+    diagFin(DIAG_ECRIRE_AUDIT, t0, ok ? n : 0);
+    if (ok) return true;
+    journal(LOG_ERREUR, "Erreur d'écriture de l'audit", "evenements=%d erreur=\"%s\"", n, sqlite3_errmsg(bdd));
+    if (propre) sqlite3_exec(bdd, "ROLLBACK;", 0, 0, NULL);
+    return false;
+}
+
+// Attend une place si la file est pleine.
+void auditEnfiler(const EvenementAudit *e) {
+    pthread_mutex_lock(&audit.mutex);
+    while (audit.nb == AUDIT_FILE_TAILLE && !audit.arret) pthread_cond_wait(&audit.place_libre, &audit.mutex);
+    if (!audit.arret) {
+        audit.file[(audit.debut + audit.nb) % AUDIT_FILE_TAILLE] = *e;
+        audit.nb++;
+        if (audit.nb == 1 || audit.nb == AUDIT_LOT || audit.nb == AUDIT_FILE_TAILLE / 2) {
+            pthread_cond_signal(&audit.evenements);
+        }
+    }
+    pthread_mutex_unlock(&audit.mutex);
+}
+
+void auditEnfilerDiffere(const void *e, void *contexte) {
+    auditEnfiler(e);
+}
+
+void auditConfirmer(sqlite3 *db) {
+    if (db == audit.ecrivain) differerAppliquer(&audit.differes, db, auditEnfilerDiffere, NULL);
+}
+
+void *audit_thread(void *arg) {
+    static EvenementAudit lot[AUDIT_LOT];
+    int echecs = 0;
+    pthread_mutex_lock(&audit.mutex);
+    for (;;) {
+        while ((audit.nb == 0 || (audit.differe && audit.nb < AUDIT_FILE_TAILLE / 2)) && !audit.arret) {
+            pthread_cond_wait(&audit.evenements, &audit.mutex);
+        }
+        if (audit.nb == 0) break;                               // arrêt, file vide
+        if (audit.nb < AUDIT_LOT && !audit.arret) {
+            // laisse le lot se remplir, au plus AUDIT_DELAI_MS après le premier événement
+            struct timespec echeance = audit.file[audit.debut].ts;
+            echeance.tv_nsec += AUDIT_DELAI_MS * 1000000L;
+            echeance.tv_sec += echeance.tv_nsec / 1000000000L;
+            echeance.tv_nsec %= 1000000000L;
+            while (audit.nb < AUDIT_LOT && !audit.arret &&
+                   pthread_cond_timedwait(&audit.evenements, &audit.mutex, &echeance) == 0) {
+            }
+        }
+        // copié sans être retiré : la file ne se vide qu'une fois le lot écrit
+        int n = 0;
+        for (; n < AUDIT_LOT && n < audit.nb; n++) lot[n] = audit.file[(audit.debut + n) % AUDIT_FILE_TAILLE];
+        pthread_mutex_unlock(&audit.mutex);
+        bool ok = auditEcrireLot(audit.db, lot, n);
+        pthread_mutex_lock(&audit.mutex);
+        if (ok) {
+            audit.debut = (audit.debut + n) % AUDIT_FILE_TAILLE;
+            audit.nb -= n;
+            audit.ecrits += n;
+            echecs = 0;
+            pthread_cond_broadcast(&audit.place_libre);
+            continue;
+        }
+        if (audit.arret && ++echecs >= AUDIT_ESSAIS_ARRET) {
+            journal(LOG_ERREUR, "Piste d'audit abandonnée à l'arrêt", "evenements=%d", audit.nb);
+            audit.nb = 0;
+            break;
+        }
+        if (!audit.arret) echecs++;
+        // nouvel essai après 0,2 s, 0,4 s... jusqu'à 6,4 s
+        struct timespec echeance;
+        clock_gettime(CLOCK_REALTIME, &echeance);
+        echeance.tv_nsec += (long)AUDIT_DELAI_MS * (1L << (echecs < 5 ? echecs : 5)) * 1000000L;
+        echeance.tv_sec += echeance.tv_nsec / 1000000000L;
+        echeance.tv_nsec %= 1000000000L;
+        while (!audit.arret && pthread_cond_timedwait(&audit.evenements, &audit.mutex, &echeance) == 0) {
+        }
+    }
+    pthread_mutex_unlock(&audit.mutex);
+    return NULL;
+}
+
+// `ecrivain` : connexion principale (appelée depuis son thread) ; ses
+// transactions retiennent les actions faites pendant qu'elles sont ouvertes.
+bool auditDemarrer(const char *chemin, sqlite3 *ecrivain) {
+    if (audit.actif) return true;
+    if (sqlite3_open_v2(chemin, &audit.db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(audit.db));
+        sqlite3_close(audit.db);
+        audit.db = NULL;
         return false;
     }
-    fprintf(file, "ID,Nom,Age,Taille,Email,Telephone,Grade\n");
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT * FROM eleves;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        log_error(sqlite3_errmsg(db));
-        fclose(file);
+    configurerAttente(audit.db);
+    diagSuivre(audit.db);
+    audit.arret = false;
+    if (pthread_create(&audit.thread, NULL, audit_thread, NULL) != 0) {
+        diagOublier(audit.db);
+        sqlite3_close(audit.db);
+        audit.db = NULL;
         return false;
     }
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        fprintf(file, "%d,%s,%d,%.2f,%s,%s,%s\n",
-                sqlite3_column_int(stmt, 0),
-                sqlite3_column_text(stmt, 1) ? (const char*)sqlite3_column_text(stmt, 1) : "",
-                sqlite3_column_int(stmt, 2),
-                sqlite3_column_double(stmt, 3),
-                sqlite3_column_text(stmt, 4) ? (const char*)sqlite3_column_text(stmt, 4) : "",
-                sqlite3_column_text(stmt, 5) ? (const char*)sqlite3_column_text(stmt, 5) : "",
-                sqlite3_column_text(stmt, 6) ? (const char*)sqlite3_column_text(stmt, 6) : "");
-    }
-    fclose(file);
-    sqlite3_finalize(stmt);
+    audit.ecrivain = ecrivain;
+    audit.thread_ecrivain = pthread_self();
+    if (ecrivain) crochetsTransaction(ecrivain);
+    audit.actif = true;
     return true;
 }
 
-bool rechercherEleve(sqlite3 *db, const char *terme, char **resultStr) {
+// Vide la file, écrit le dernier lot puis ferme la connexion d'audit.
+void auditArreter(void) {
+    if (!audit.actif) return;
+    if (audit.ecrivain) auditConfirmer(audit.ecrivain);     // dernière validation, sans WAL
+    pthread_mutex_lock(&audit.mutex);
+    audit.arret = true;
+    pthread_cond_broadcast(&audit.evenements);
+    pthread_cond_broadcast(&audit.place_libre);
+    pthread_mutex_unlock(&audit.mutex);
+    pthread_join(audit.thread, NULL);
+    diagOublier(audit.db);
+    sqlite3_close(audit.db);
+    audit.db = NULL;
+    audit.ecrivain = NULL;
+    differerLiberer(&audit.differes);
+    audit.actif = false;
+}
+
+// Sans thread ni seconde connexion : chaque action est écrite aussitôt par
+// `bdd`, dans la transaction en cours s'il y en a une (annulée avec elle).
+// Pour la ligne de commande, dont les lots tiennent le verrou d'écriture.
+void auditDirect(sqlite3 *bdd) {
+    audit.direct = bdd;
+}
+
+void auditDifferer(bool differe) {
+    pthread_mutex_lock(&audit.mutex);
+    audit.differe = differe;
+    pthread_cond_broadcast(&audit.evenements);
+    pthread_mutex_unlock(&audit.mutex);
+}
+
+// Met une action en file ; sans pipeline démarré (outils, benchmark), rien
+// n'est enregistré. Dans une transaction de la connexion principale, elle
+// attend que celle-ci soit écrite.
+void auditer(const char *fmt, ...) {
+    if (!audit.actif && !audit.direct) return;
+    EvenementAudit e;
+    e.user_id = atomic_load(&utilisateur_courant);
+    clock_gettime(CLOCK_REALTIME, &e.ts);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(e.action, sizeof(e.action), fmt, args);
+    va_end(args);
+    if (audit.direct) {
+        // l'appelant peut encore lire l'id de la ligne qu'il vient d'insérer
+        sqlite3_int64 rowid = sqlite3_last_insert_rowid(audit.direct);
+        auditEcrireLot(audit.direct, &e, 1);
+        sqlite3_set_last_insert_rowid(audit.direct, rowid);
+        return;
+    }
+    if (audit.ecrivain && pthread_equal(pthread_self(), audit.thread_ecrivain)) {
+        auditConfirmer(audit.ecrivain);         // sans WAL, une validation peut être en attente
+        if (!sqlite3_get_autocommit(audit.ecrivain) && differerAjouter(&audit.differes, &e)) return;
+    }
+    auditEnfiler(&e);
+}
+
+
+/*
+ * Instantané en colonnes de eleves (optionnel) : âge en int32, taille en
+ * float et grade encodé par dictionnaire sur un octet, tableaux alignés sur
+ * l'ordre des ids. Construit en un seul parcours par colonnesConstruire()
+ * (au démarrage de l'interface, dans un thread), puis tenu à jour par les
+ * chemins d'écriture (ajout, modification, suppression, import) : une
+ * écriture faite dans une transaction n'y est reportée qu'une fois celle-ci
+ * écrite (voir EcrituresDifferees). Les noyaux sont des boucles simples sur
+ * des tableaux contigus : le comptage filtré se vectorise (-O3
+ * -march=native), les agrégats par grade indexent leurs accumulateurs par
+ * le code.
+ */
+#define COLONNES_MAX_GRADES 255         // code 0 : ligne supprimée
+
+typedef struct {
+    int id;
+    int32_t age;
+    float taille;
+    char grade[MAX_GRADE];
+    bool supprime;
+} EcritureColonnes;
+
+typedef struct {
+    sqlite3 *db;                        // connexion dont les écritures sont suivies
+    EcrituresDifferees attente;         // d'EcritureColonnes, transaction ouverte
+    bool abandonne;                     // plus tenu à jour : à libérer
+    int n;
+    int cap;
+    int nb_supprimes;
+    int32_t *ids;                       // croissants
+    int32_t *age;
+    float *taille;
+    uint8_t *grade;
+    int nb_grades;
+    char grades[COLONNES_MAX_GRADES + 1][MAX_GRADE];
+    double duree_construction;          // secondes
+} ColonnesEleves;
+
+typedef struct {
+    char grade[MAX_GRADE];
+    long nb;
+    int age_min;
+    int age_max;
+    double age_moyen;
+    float taille_min;
+    float taille_max;
+    double taille_moyenne;
+} StatsGrade;
+
+ColonnesEleves *colonnes = NULL;
+
+void colonnesLiberer(ColonnesEleves *c) {
+    if (!c) return;
+    differerLiberer(&c->attente);
+    free(c->ids);
+    free(c->age);
+    free(c->taille);
+    free(c->grade);
+    free(c);
+}
+
+// Redimensionne les colonnes à cap lignes (cap >= n).
+bool colonnesReserver(ColonnesEleves *c, int cap) {
+    if (cap == c->cap) return true;
+    int32_t *ids = realloc(c->ids, sizeof(int32_t) * cap);
+    if (ids) c->ids = ids;
+    int32_t *age = realloc(c->age, sizeof(int32_t) * cap);
+    if (age) c->age = age;
+    float *taille = realloc(c->taille, sizeof(float) * cap);
+    if (taille) c->taille = taille;
+    uint8_t *grade = realloc(c->grade, cap);
+    if (grade) c->grade = grade;
+    if (!ids || !age || !taille || !grade) return false;
+    c->cap = cap;
+    return true;
+}
+
+// Code du grade (1 à COLONNES_MAX_GRADES), ajouté au dictionnaire au besoin ;
+// -1 si le dictionnaire est plein : l'instantané ne peut plus représenter la
+// table (le code 0, celui des lignes supprimées, fausserait les statistiques).
+int colonnesCodeGrade(ColonnesEleves *c, const char *grade) {
+    for (int g = 1; g <= c->nb_grades; g++) {
+        if (strcmp(c->grades[g], grade) == 0) return g;
+    }
+    if (c->nb_grades == COLONNES_MAX_GRADES) return -1;
+    c->nb_grades++;
+    snprintf(c->grades[c->nb_grades], MAX_GRADE, "%s", grade);
+    return c->nb_grades;
+}
+
+// Lit toute la table par `db` dans un instantané qui ne suit encore aucune
+// connexion (voir colonnesConstruire).
+ColonnesEleves *colonnesLire(sqlite3 *db) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    ColonnesEleves *c = calloc(1, sizeof(ColonnesEleves));
+    sqlite3_stmt *stmt = NULL;
+    if (!c || sqlite3_prepare_v2(db, "SELECT id, age, taille, grade FROM eleves ORDER BY id;", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        free(c);
+        return NULL;
+    }
+    c->attente.taille = sizeof(EcritureColonnes);
+    int rc;
+    uint8_t dernier = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (c->n == c->cap && !colonnesReserver(c, c->cap ? c->cap * 2 : 4096)) break;
+        const char *grade = (const char*)sqlite3_column_text(stmt, 3);
+        if (!grade) grade = "";
+        // les grades se répètent : on essaie d'abord le dernier code vu
+        int code = dernier && strcmp(c->grades[dernier], grade) == 0 ? dernier : colonnesCodeGrade(c, grade);
+        if (code < 0) break;
+        c->ids[c->n] = sqlite3_column_int(stmt, 0);
+        c->age[c->n] = sqlite3_column_int(stmt, 1);
+        c->taille[c->n] = (float)sqlite3_column_double(stmt, 2);
+        c->grade[c->n] = dernier = (uint8_t)code;
+        c->n++;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(rc == SQLITE_ROW ? "Erreur: instantané en colonnes impossible (mémoire ou trop de grades)."
+                                   : sqlite3_errmsg(db));
+        colonnesLiberer(c);
+        return NULL;
+    }
+    colonnesReserver(c, c->n > 0 ? c->n : 1);     // rend la marge du doublement
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    c->duree_construction = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return c;
+}
+
+// Instantané tenu à jour par les écritures de `db`.
+ColonnesEleves *colonnesConstruire(sqlite3 *db) {
+    ColonnesEleves *c = colonnesLire(db);
+    if (!c) return NULL;
+    c->db = db;
+    crochetsTransaction(db);
+    return c;
+}
+
+size_t colonnesMemoire(const ColonnesEleves *c) {
+    return sizeof(ColonnesEleves) + (size_t)c->cap * (2 * sizeof(int32_t) + sizeof(float) + sizeof(uint8_t));
+}
+
+// Indice de la ligne de l'id (recherche dichotomique), -1 si absente.
+int colonnesIndice(const ColonnesEleves *c, int id) {
+    int bas = 0, haut = c->n - 1;
+    while (bas <= haut) {
+        int milieu = bas + (haut - bas) / 2;
+        if (c->ids[milieu] == id) return c->grade[milieu] ? milieu : -1;
+        if (c->ids[milieu] < id) bas = milieu + 1;
+        else haut = milieu - 1;
+    }
+    return -1;
+}
+
+// Retire les lignes supprimées quand elles dépassent le quart du tableau.
+void colonnesCompacter(ColonnesEleves *c) {
+    int out = 0;
+    for (int i = 0; i < c->n; i++) {
+        if (!c->grade[i]) continue;
+        c->ids[out] = c->ids[i];
+        c->age[out] = c->age[i];
+        c->taille[out] = c->taille[i];
+        c->grade[out] = c->grade[i];
+        out++;
+    }
+    c->n = out;
+    c->nb_supprimes = 0;
+}
+
+// Reporte une écriture validée ; marque l'instantané abandonné s'il ne
+// peut plus être tenu à jour (dictionnaire plein ou mémoire).
+void colonnesAppliquer(ColonnesEleves *c, const EcritureColonnes *e) {
+    int id = e->id;
+    if (e->supprime) {
+        int i = colonnesIndice(c, id);
+        if (i < 0) return;
+        c->grade[i] = 0;
+        if (++c->nb_supprimes > c->n / 4) colonnesCompacter(c);
+        return;
+    }
+    int code = colonnesCodeGrade(c, e->grade);
+    int i = colonnesIndice(c, id);
+    if (code < 0 || (i < 0 && c->n == c->cap && !colonnesReserver(c, c->cap ? c->cap * 2 : 4096))) {
+        c->abandonne = true;
+        return;
+    }
+    if (i < 0) {
+        // nouvel id : en fin de tableau sauf import avec ids explicites
+        i = c->n;
+        while (i > 0 && c->ids[i - 1] >= id) i--;
+        if (i < c->n && c->ids[i] == id) {
+            c->nb_supprimes--;              // id réutilisé après suppression
+        } else {
+            memmove(c->ids + i + 1, c->ids + i, sizeof(int32_t) * (c->n - i));
+            memmove(c->age + i + 1, c->age + i, sizeof(int32_t) * (c->n - i));
+            memmove(c->taille + i + 1, c->taille + i, sizeof(float) * (c->n - i));
+            memmove(c->grade + i + 1, c->grade + i, c->n - i);
+            c->n++;
+        }
+        c->ids[i] = id;
+    }
+    c->age[i] = e->age;
+    c->taille[i] = e->taille;
+    c->grade[i] = (uint8_t)code;
+}
+
+void colonnesAbandonner(void) {
+    colonnesLiberer(colonnes);
+    colonnes = NULL;
+    log_error("Erreur: instantané en colonnes abandonné.");
+}
+
+void colonnesAppliquerDiffere(const void *e, void *contexte) {
+    ColonnesEleves *c = contexte;
+    if (!c->abandonne) colonnesAppliquer(c, e);
+}
+
+void colonnesConfirmer(sqlite3 *db) {
+    ColonnesEleves *c = colonnes;
+    if (!c || c->db != db) return;
+    differerAppliquer(&c->attente, db, colonnesAppliquerDiffere, c);
+    if (c->abandonne) colonnesAbandonner();
+}
+
+// Chemins d'écriture : sans instantané sur cette connexion, rien à faire ;
+// hors transaction, l'écriture est déjà validée.
+void colonnesNoter(sqlite3 *db, const EcritureColonnes *e) {
+    ColonnesEleves *c = colonnes;
+    if (!c || c->db != db) return;
+    colonnesConfirmer(db);                  // sans WAL, une validation peut être en attente
+    if (!(c = colonnes)) return;
+    if (sqlite3_get_autocommit(db)) colonnesAppliquer(c, e);
+    else if (!differerAjouter(&c->attente, e)) c->abandonne = true;
+    if (c->abandonne) colonnesAbandonner();
+}
+
+void colonnesEcrire(sqlite3 *db, int id, int age, float taille, const char *grade) {
+    EcritureColonnes e = { id, age, taille, "", false };
+    snprintf(e.grade, sizeof(e.grade), "%s", grade ? grade : "");
+    colonnesNoter(db, &e);
+}
+
+void colonnesSupprimer(sqlite3 *db, int id) {
+    EcritureColonnes e = { .id = id, .supprime = true };
+    colonnesNoter(db, &e);
+}
+
+// Statistiques par grade en une passe : le code de grade indexe directement
+// les accumulateurs (pas de hachage). out doit contenir nb_grades entrées ;
+// renvoie le nombre de grades non vides.
+int colonnesStatsParGrade(const ColonnesEleves *c, StatsGrade *out) {
+    long compte[COLONNES_MAX_GRADES + 1] = { 0 }, somme_age[COLONNES_MAX_GRADES + 1] = { 0 };
+    double somme_taille[COLONNES_MAX_GRADES + 1] = { 0 };
+    int32_t age_min[COLONNES_MAX_GRADES + 1], age_max[COLONNES_MAX_GRADES + 1];
+    float taille_min[COLONNES_MAX_GRADES + 1], taille_max[COLONNES_MAX_GRADES + 1];
+    for (int g = 0; g <= COLONNES_MAX_GRADES; g++) {
+        age_min[g] = INT32_MAX;
+        age_max[g] = INT32_MIN;
+        taille_min[g] = FLT_MAX;
+        taille_max[g] = -FLT_MAX;
+    }
+    const int32_t *age = c->age;
+    const float *taille = c->taille;
+    const uint8_t *grade = c->grade;
+    for (int i = 0; i < c->n; i++) {
+        int g = grade[i];
+        compte[g]++;
+        somme_age[g] += age[i];
+        somme_taille[g] += taille[i];
+        age_min[g] = age[i] < age_min[g] ? age[i] : age_min[g];
+        age_max[g] = age[i] > age_max[g] ? age[i] : age_max[g];
+        taille_min[g] = taille[i] < taille_min[g] ? taille[i] : taille_min[g];
+        taille_max[g] = taille[i] > taille_max[g] ? taille[i] : taille_max[g];
+    }
+    int nb = 0;
+    for (int g = 1; g <= c->nb_grades; g++) {     // code 0 : lignes supprimées
+        if (compte[g] == 0) continue;
+        StatsGrade *s = &out[nb++];
+        snprintf(s->grade, sizeof(s->grade), "%s", c->grades[g]);
+        s->nb = compte[g];
+        s->age_min = age_min[g];
+        s->age_max = age_max[g];
+        s->age_moyen = (double)somme_age[g] / compte[g];
+        s->taille_min = taille_min[g];
+        s->taille_max = taille_max[g];
+        s->taille_moyenne = somme_taille[g] / compte[g];
+    }
+    return nb;
+}
+
+// Mêmes statistiques en SQL, sans instantané (en construction, abandonné ou
+// dictionnaire de grades plein). *out est alloué (free) ; -1 en cas d'erreur.
+int statsParGradeSQL(sqlite3 *db, StatsGrade **out) {
     sqlite3_stmt *stmt;
-    char sql[MAX_QUERY];
-    snprintf(sql, MAX_QUERY,
-             "SELECT * FROM eleves WHERE nom LIKE '%%%s%%' OR email LIKE '%%%s%%' OR grade LIKE '%%%s%%';",
-             terme, terme, terme);
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    *out = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT coalesce(grade, ''), COUNT(*), MIN(age), MAX(age), AVG(age), "
+                               "MIN(taille), MAX(taille), AVG(taille) FROM eleves GROUP BY 1 ORDER BY 1;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
         log_error(sqlite3_errmsg(db));
+        return -1;
+    }
+    int nb = 0, cap = 0, rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (nb == cap) {
+            StatsGrade *p = realloc(*out, sizeof(StatsGrade) * (cap = cap ? cap * 2 : 16));
+            if (!p) break;
+            *out = p;
+        }
+        StatsGrade *s = &(*out)[nb++];
+        snprintf(s->grade, sizeof(s->grade), "%s", (const char*)sqlite3_column_text(stmt, 0));
+        s->nb = sqlite3_column_int64(stmt, 1);
+        s->age_min = sqlite3_column_int(stmt, 2);
+        s->age_max = sqlite3_column_int(stmt, 3);
+        s->age_moyen = sqlite3_column_double(stmt, 4);
+        s->taille_min = (float)sqlite3_column_double(stmt, 5);
+        s->taille_max = (float)sqlite3_column_double(stmt, 6);
+        s->taille_moyenne = sqlite3_column_double(stmt, 7);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(rc == SQLITE_ROW ? "Erreur: mémoire insuffisante pour les statistiques." : sqlite3_errmsg(db));
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+    return nb;
+}
+
+// Histogramme des âges [age_min, age_min + nb_classes) d'un grade (NULL :
+// tous) ; quatre sous-histogrammes évitent la dépendance entre incréments.
+void colonnesHistogrammeAge(const ColonnesEleves *c, const char *grade, int age_min, int nb_classes, long *classes) {
+    long *sous = calloc((size_t)nb_classes * 4, sizeof(long));
+    if (!sous) return;
+    int code = -1;
+    for (int g = 1; grade && g <= c->nb_grades; g++) {
+        if (strcmp(c->grades[g], grade) == 0) code = g;
+    }
+    if (!grade || code > 0) {
+        for (int i = 0; i < c->n; i++) {
+            unsigned k = (unsigned)(c->age[i] - age_min);
+            bool garde = k < (unsigned)nb_classes && c->grade[i] && (!grade || c->grade[i] == code);
+            sous[(i & 3) * nb_classes + (garde ? k : 0)] += garde;
+        }
+    }
+    for (int k = 0; k < nb_classes; k++) {
+        classes[k] = sous[k] + sous[nb_classes + k] + sous[2 * nb_classes + k] + sous[3 * nb_classes + k];
+    }
+    free(sous);
+}
+
+// Nombre d'élèves (d'un grade, ou de tous si NULL) dont l'âge et la taille
+// sont dans les bornes incluses.
+long colonnesCompter(const ColonnesEleves *c, const char *grade, int age_min, int age_max,
+                     float taille_min, float taille_max) {
+    int code = 0;
+    for (int g = 1; grade && g <= c->nb_grades; g++) {
+        if (strcmp(c->grades[g], grade) == 0) code = g;
+    }
+    if (grade && code == 0) return 0;
+    long compte = 0;
+    for (int i = 0; i < c->n; i++) {
+        compte += (c->grade[i] != 0) & (!code | (c->grade[i] == code)) &
+                  (c->age[i] >= age_min) & (c->age[i] <= age_max) &
+                  (c->taille[i] >= taille_min) & (c->taille[i] <= taille_max);
+    }
+    return compte;
+}
+
+/*
+ * Index de trigrammes (optionnel) pour la recherche tolérante aux fautes de
+ * frappe. Nom et email sont pliés (minuscules, accents retirés, ponctuation
+ * remplacée par des espaces), chaque mot est encadré d'espaces puis découpé
+ * en trigrammes sur l'alphabet [ a-z0-9] : 37^3 listes d'ids indexées
+ * directement, sans hachage. Comme l'instantané en colonnes, l'index est tenu
+ * à jour par les chemins d'écriture de sa connexion, une fois leur transaction
+ * écrite ; celles des autres connexions ne sont visibles qu'à travers PRAGMA
+ * data_version, et l'index est alors relu. Une modification ajoute la nouvelle
+ * version du texte sans retirer les anciennes entrées, que le classement
+ * ignore, et l'index est reconstruit quand elles deviennent majoritaires.
+ * Une requête parcourt les listes les plus courtes d'abord, dans un budget
+ * d'entrées, puis reclasse les meilleurs candidats par similarité exacte
+ * (Dice sur les trigrammes, mot à mot) et distance d'édition.
+ */
+#define TRIGRAMMES_ALPHABET 37
+#define TRIGRAMMES_NB (TRIGRAMMES_ALPHABET * TRIGRAMMES_ALPHABET * TRIGRAMMES_ALPHABET)
+#define TRIGRAMMES_TEXTE_MAX 256        // nom et email pliés, séparés par '|'
+#define TRIGRAMMES_MOTS_MAX 16
+#define TRIGRAMMES_BUDGET 400000        // entrées de listes lues par requête
+#define TRIGRAMMES_CANDIDATS 2000       // candidats reclassés exactement
+#define TRIGRAMMES_SCORE_MIN 0.3f
+#define RECHERCHE_FLOUE_MAX 50          // résultats approchants ajoutés à une recherche
+
+typedef struct {
+    int32_t *ids;
+    int n;
+    int cap;
+} ListeTrigrammes;
+
+typedef struct {
+    uint32_t debut;                     // texte plié dans l'arène
+    uint16_t longueur;
+    uint8_t nb_trigrammes;
+    uint8_t present;
+} DocTrigrammes;
+
+typedef struct {
+    int id;
+    int longueur;                       // -1 : élève supprimé
+    char texte[TRIGRAMMES_TEXTE_MAX];   // nom et email pliés
+} EcritureTrigrammes;
+
+typedef struct {
+    sqlite3 *db;                        // connexion dont les écritures sont suivies
+    pthread_rwlock_t verrou;            // écritures (thread GTK) contre recherches (exécuteur)
+    EcrituresDifferees attente;         // d'EcritureTrigrammes, transaction ouverte
+    EcrituresDifferees rattrapage;      // écritures validées pendant une relecture
+    bool rattraper;                     // relecture en cours (voir trigrammesEchanger)
+    bool perime;                        // une écriture n'a pu être reportée : à relire
+    sqlite3_int64 data_version;         // PRAGMA data_version de db à la lecture
+    int generation;                     // avance à chaque rechargement sur place
+    ListeTrigrammes listes[TRIGRAMMES_NB];
+    DocTrigrammes *docs;                // indexés par id
+    int nb_docs;                        // plus grand id + 1
+    int cap_docs;
+    char *texte;
+    size_t taille_texte;
+    size_t cap_texte;
+    long entrees;
+    long entrees_mortes;                // anciennes versions et élèves supprimés
+    int n;
+    double duree_construction;          // secondes
+} TrigrammesEleves;
+
+typedef struct {
+    int id;
+    float score;                        // 1 : tous les mots trouvés à l'identique
+    int distance;                       // distance d'édition cumulée, départage
+} ResultatFloue;
+
+TrigrammesEleves *trigrammes = NULL;
+
+// Pliage des lettres latines U+00C0..U+00FF (second octet UTF-8 après 0xC3).
+const char *const pliage_latin1[64] = {
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", " ", "ss",
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", " ", "y",
+};
+
+// Minuscules ASCII sans accents, un seul espace entre les mots ; renvoie la longueur.
+size_t plierTexte(const char *src, char *out, size_t taille) {
+    size_t n = 0;
+    bool espace = true;
+    for (const unsigned char *c = (const unsigned char*)src; *c; c++) {
+        char lettre[2] = { 0, 0 };
+        const char *rep = " ";
+        if ((*c >= '0' && *c <= '9') || ((*c | 0x20) >= 'a' && (*c | 0x20) <= 'z')) {
+            lettre[0] = (char)(*c >= 'A' && *c <= 'Z' ? *c | 0x20 : *c);
+            rep = lettre;
+        } else if (*c == 0xC3 && c[1] >= 0x80 && c[1] <= 0xBF) {
+            rep = pliage_latin1[*++c - 0x80];
+        } else if (*c == 0xC5 && (c[1] == 0x92 || c[1] == 0x93)) {
+            rep = "oe";
+            c++;
+        } else {
+            while ((c[1] & 0xC0) == 0x80) c++;     // autre caractère : séparateur
+        }
+        for (; *rep; rep++) {
+            if (*rep == ' ') {
+                if (!espace && n + 1 < taille) out[n++] = ' ';
+                espace = true;
+            } else if (n + 1 < taille) {
+                out[n++] = *rep;
+                espace = false;
+            }
+        }
+    }
+    while (n > 0 && out[n - 1] == ' ') n--;
+    if (taille > 0) out[n] = '\0';
+    return n;
+}
+
+int codeTrigramme(char a, char b, char c) {
+    int code[3];
+    const char car[3] = { a, b, c };
+    for (int i = 0; i < 3; i++) {
+        code[i] = car[i] == ' ' ? 0 : car[i] >= 'a' ? car[i] - 'a' + 1 : car[i] - '0' + 27;
+    }
+    return (code[0] * TRIGRAMMES_ALPHABET + code[1]) * TRIGRAMMES_ALPHABET + code[2];
+}
+
+int comparerInt32(const void *a, const void *b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Trigrammes distincts et triés d'un mot plié, encadré d'espaces.
+int trigrammesMot(const char *mot, int longueur, int32_t *out) {
+    char cadre[TRIGRAMMES_TEXTE_MAX + 2];
+    if (longueur > TRIGRAMMES_TEXTE_MAX) longueur = TRIGRAMMES_TEXTE_MAX;
+    cadre[0] = ' ';
+    memcpy(cadre + 1, mot, longueur);
+    cadre[longueur + 1] = ' ';
+    for (int i = 0; i < longueur; i++) out[i] = codeTrigramme(cadre[i], cadre[i + 1], cadre[i + 2]);
+    qsort(out, longueur, sizeof(int32_t), comparerInt32);
+    int n = 0;
+    for (int i = 0; i < longueur; i++) {
+        if (n == 0 || out[n - 1] != out[i]) out[n++] = out[i];
+    }
+    return n;
+}
+
+// Découpe un texte plié en mots (séparés par ' ' ou '|') ; renvoie leur nombre.
+int decouperMots(const char *texte, int longueur, const char **mots, int *longueurs, int max) {
+    int n = 0;
+    for (int i = 0; i < longueur && n < max; ) {
+        while (i < longueur && (texte[i] == ' ' || texte[i] == '|')) i++;
+        int debut = i;
+        while (i < longueur && texte[i] != ' ' && texte[i] != '|') i++;
+        if (i > debut) {
+            mots[n] = texte + debut;
+            longueurs[n++] = i - debut;
+        }
+    }
+    return n;
+}
+
+// Trigrammes distincts de tout le texte ; out doit contenir longueur entrées.
+int trigrammesTexte(const char *texte, int longueur, int32_t *out) {
+    const char *mots[TRIGRAMMES_TEXTE_MAX];
+    int longueurs[TRIGRAMMES_TEXTE_MAX];
+    int nb_mots = decouperMots(texte, longueur, mots, longueurs, TRIGRAMMES_TEXTE_MAX);
+    int n = 0;
+    for (int m = 0; m < nb_mots; m++) n += trigrammesMot(mots[m], longueurs[m], out + n);
+    qsort(out, n, sizeof(int32_t), comparerInt32);
+    int distincts = 0;
+    for (int i = 0; i < n; i++) {
+        if (distincts == 0 || out[distincts - 1] != out[i]) out[distincts++] = out[i];
+    }
+    return distincts;
+}
+
+void trigrammesVider(TrigrammesEleves *t) {
+    for (int i = 0; i < TRIGRAMMES_NB; i++) {
+        free(t->listes[i].ids);
+        t->listes[i] = (ListeTrigrammes){ NULL, 0, 0 };
+    }
+    free(t->docs);
+    free(t->texte);
+    t->docs = NULL;
+    t->texte = NULL;
+    t->nb_docs = t->cap_docs = t->n = 0;
+    t->taille_texte = t->cap_texte = 0;
+    t->entrees = t->entrees_mortes = 0;
+}
+
+void trigrammesLiberer(TrigrammesEleves *t) {
+    if (!t) return;
+    trigrammesVider(t);
+    differerLiberer(&t->attente);
+    differerLiberer(&t->rattrapage);
+    pthread_rwlock_destroy(&t->verrou);
+    free(t);
+}
+
+// Indexe un texte déjà plié sous l'id (verrou en écriture tenu).
+bool trigrammesAjouterPlie(TrigrammesEleves *t, int id, const char *texte, int longueur) {
+    if (id < 0) return false;
+    if (id >= t->cap_docs) {
+        int cap = t->cap_docs ? t->cap_docs : 4096;
+        while (cap <= id) cap *= 2;
+        DocTrigrammes *docs = realloc(t->docs, sizeof(DocTrigrammes) * cap);
+        if (!docs) return false;
+        memset(docs + t->cap_docs, 0, sizeof(DocTrigrammes) * (cap - t->cap_docs));
+        t->docs = docs;
+        t->cap_docs = cap;
+    }
+    if (t->taille_texte + longueur > t->cap_texte) {
+        size_t cap = t->cap_texte ? t->cap_texte : 65536;
+        while (cap < t->taille_texte + longueur) cap *= 2;
+        char *texte_arene = realloc(t->texte, cap);
+        if (!texte_arene) return false;
+        t->texte = texte_arene;
+        t->cap_texte = cap;
+    }
+    int32_t codes[TRIGRAMMES_TEXTE_MAX];
+    int nb = trigrammesTexte(texte, longueur, codes);
+    for (int i = 0; i < nb; i++) {
+        ListeTrigrammes *l = &t->listes[codes[i]];
+        if (l->n == l->cap) {
+            int cap = l->cap ? l->cap * 2 : 4;
+            int32_t *ids = realloc(l->ids, sizeof(int32_t) * cap);
+            if (!ids) return false;
+            l->ids = ids;
+            l->cap = cap;
+        }
+        l->ids[l->n++] = id;
+    }
+    DocTrigrammes *d = &t->docs[id];
+    if (d->present) {
+        t->entrees_mortes += d->nb_trigrammes;
+        t->n--;
+    }
+    memcpy(t->texte + t->taille_texte, texte, longueur);
+    d->debut = (uint32_t)t->taille_texte;
+    d->longueur = (uint16_t)longueur;
+    d->nb_trigrammes = (uint8_t)(nb < 255 ? nb : 255);
+    d->present = 1;
+    t->taille_texte += longueur;
+    t->entrees += nb;
+    t->n++;
+    if (id >= t->nb_docs) t->nb_docs = id + 1;
+    return true;
+}
+
+// Texte indexé d'un élève : "nom|email" plié.
+int trigrammesPlier(const char *nom, const char *email, char *out) {
+    size_t n = plierTexte(nom ? nom : "", out, TRIGRAMMES_TEXTE_MAX / 2);
+    out[n++] = '|';
+    n += plierTexte(email ? email : "", out + n, TRIGRAMMES_TEXTE_MAX - n);
+    return (int)n;
+}
+
+// Relit toute la table par `lecture` (verrou en écriture tenu).
+bool trigrammesRemplir(TrigrammesEleves *t, sqlite3 *lecture) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    trigrammesVider(t);
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v2(lecture, "SELECT id, nom, email FROM eleves ORDER BY id;", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(lecture));
         return false;
     }
-    char *result = malloc(4096);
-    if (!result) return false;
-    strcpy(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
-    strcat(result, "| ID | Nom                  | Age | Taille | Email                     | Téléphone      | Grade  |\n");
-    strcat(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
-    char line[256];
-    bool found = false;
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        found = true;
-        snprintf(line, sizeof(line), "| %-2d | %-20s | %-3d | %-6.2f | %-25s | %-14s | %-6s |\n",
-                 sqlite3_column_int(stmt, 0),
-                 sqlite3_column_text(stmt, 1) ? (const char*)sqlite3_column_text(stmt, 1) : "",
-                 sqlite3_column_int(stmt, 2),
-                 sqlite3_column_double(stmt, 3),
-                 sqlite3_column_text(stmt, 4) ? (const char*)sqlite3_column_text(stmt, 4) : "",
-                 sqlite3_column_text(stmt, 5) ? (const char*)sqlite3_column_text(stmt, 5) : "",
-                 sqlite3_column_text(stmt, 6) ? (const char*)sqlite3_column_text(stmt, 6) : "");
-        strcat(result, line);
-    }
-    strcat(result, "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n");
+    int rc;
+    char texte[TRIGRAMMES_TEXTE_MAX];
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int n = trigrammesPlier((const char*)sqlite3_column_text(stmt, 1), (const char*)sqlite3_column_text(stmt, 2), texte);
+        if (!trigrammesAjouterPlie(t, sqlite3_column_int(stmt, 0), texte, n)) break;
+    }
     sqlite3_finalize(stmt);
-    if (!found) {
-        free(result);
-        *resultStr = NULL;
-    } else {
-        *resultStr = result;
+    if (rc != SQLITE_DONE) {
+        log_error(rc == SQLITE_ROW ? "Erreur: index de trigrammes impossible (mémoire)." : sqlite3_errmsg(lecture));
+        trigrammesVider(t);
+        return false;
     }
+    // rend la marge du doublement : la plupart des listes ne grandiront plus
+    for (int i = 0; i < TRIGRAMMES_NB; i++) {
+        ListeTrigrammes *l = &t->listes[i];
+        int32_t *ids = l->n > 0 && l->n < l->cap ? realloc(l->ids, sizeof(int32_t) * l->n) : NULL;
+        if (ids) {
+            l->ids = ids;
+            l->cap = l->n;
+        }
+    }
+    char *arene = t->taille_texte > 0 ? realloc(t->texte, t->taille_texte) : NULL;
+    if (arene) {
+        t->texte = arene;
+        t->cap_texte = t->taille_texte;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    t->duree_construction = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
     return true;
 }
 
-void on_add_student_clicked(GtkButton *button, gpointer user_data) {
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Ajouter un Élève",
-                                                    GTK_WINDOW(user_data),
-                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                    "_Ajouter", GTK_RESPONSE_OK,
-                                                    "_Annuler", GTK_RESPONSE_CANCEL,
-                                                    NULL);
-    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    GtkWidget *grid = gtk_grid_new();
-    gtk_container_add(GTK_CONTAINER(content_area), grid);
-    
-    //étiquettes et zones de saisie
-    GtkWidget *label_nom = gtk_label_new("Nom:");
-    GtkWidget *entry_nom = gtk_entry_new();
-    GtkWidget *label_age = gtk_label_new("Âge:");
-    GtkWidget *entry_age = gtk_entry_new();
-    GtkWidget *label_taille = gtk_label_new("Taille (m):");
+// Index vide : les recherches se contentent du plein texte.
+TrigrammesEleves *trigrammesNouveau(void) {
+    TrigrammesEleves *t = calloc(1, sizeof(TrigrammesEleves));
+    if (!t) {
+        log_error("Erreur: index de trigrammes impossible (mémoire).");
+        return NULL;
+    }
+    t->attente.taille = t->rattrapage.taille = sizeof(EcritureTrigrammes);
+    pthread_rwlock_init(&t->verrou, NULL);
+    return t;
+}
+
+// Lit toute la table par `lecture` dans un index qui ne suit encore aucune
+// connexion (voir trigrammesSuivre).
+TrigrammesEleves *trigrammesLire(sqlite3 *lecture) {
+    TrigrammesEleves *t = trigrammesNouveau();
+    if (t && !trigrammesRemplir(t, lecture)) {
+        trigrammesLiberer(t);
+        return NULL;
+    }
+    return t;
+}
+
+// Compteur des validations des autres connexions, vu par `db`.
+sqlite3_int64 versionExterne(sqlite3 *db) {
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_DATA_VERSION);
+    sqlite3_int64 version = stmt && sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    libererRequete(stmt);
+    return version;
+}
+
+// Tient l'index à jour par les écritures de `db`.
+void trigrammesSuivre(TrigrammesEleves *t, sqlite3 *db) {
+    t->db = db;
+    t->data_version = versionExterne(db);
+    crochetsTransaction(db);
+}
+
+TrigrammesEleves *trigrammesConstruire(sqlite3 *db) {
+    TrigrammesEleves *t = trigrammesLire(db);
+    if (t) trigrammesSuivre(t, db);
+    return t;
+}
+
+// Après une restauration ou un archivage : même objet, contenu relu, pour
+// qu'une recherche en cours dans l'exécuteur ne voie jamais un index libéré.
+// Une relecture en arrière-plan lancée avant est écartée (generation).
+void trigrammesRecharger(TrigrammesEleves *t) {
+    if (!t) return;
+    pthread_rwlock_wrlock(&t->verrou);
+    trigrammesRemplir(t, t->db);
+    pthread_rwlock_unlock(&t->verrou);
+    t->data_version = versionExterne(t->db);
+    t->perime = false;
+    t->generation++;
+}
+
+size_t trigrammesMemoire(const TrigrammesEleves *t) {
+    size_t total = sizeof(TrigrammesEleves) + sizeof(DocTrigrammes) * t->cap_docs + t->cap_texte;
+    for (int i = 0; i < TRIGRAMMES_NB; i++) total += sizeof(int32_t) * t->listes[i].cap;
+    return total;
+}
+
+// Réindexe les seules versions courantes, dans une arène neuve.
+void trigrammesCompacter(TrigrammesEleves *t) {
+    char *ancien = t->texte;
+    DocTrigrammes *docs = t->docs;
+    int nb_docs = t->nb_docs;
+    t->texte = NULL;
+    t->docs = NULL;
+    trigrammesVider(t);
+    for (int id = 0; id < nb_docs; id++) {
+        if (docs[id].present) trigrammesAjouterPlie(t, id, ancien + docs[id].debut, docs[id].longueur);
+    }
+    free(ancien);
+    free(docs);
+}
+
+// Reporte une écriture dans le contenu (verrou en écriture tenu).
+void trigrammesReporter(TrigrammesEleves *t, const EcritureTrigrammes *e) {
+    if (e->longueur >= 0) {
+        if (!trigrammesAjouterPlie(t, e->id, e->texte, e->longueur)) {
+            log_error("Erreur: index de trigrammes incomplet (mémoire).");
+            t->perime = true;
+        }
+    } else if (e->id >= 0 && e->id < t->nb_docs && t->docs[e->id].present) {
+        t->docs[e->id].present = 0;
+        t->entrees_mortes += t->docs[e->id].nb_trigrammes;
+        t->n--;
+    }
+    if (t->entrees_mortes > 4096 && t->entrees_mortes > t->entrees / 2) trigrammesCompacter(t);
+}
+
+// Reporte une écriture validée ; pendant une relecture, la garde aussi pour
+// la rejouer sur le contenu relu.
+void trigrammesAppliquer(TrigrammesEleves *t, const EcritureTrigrammes *e) {
+    pthread_rwlock_wrlock(&t->verrou);
+    trigrammesReporter(t, e);
+    pthread_rwlock_unlock(&t->verrou);
+    if (t->rattraper && !differerAjouter(&t->rattrapage, e)) t->perime = true;
+}
+
+void trigrammesAppliquerDiffere(const void *e, void *contexte) {
+    trigrammesAppliquer(contexte, e);
+}
+
+void trigrammesConfirmer(sqlite3 *db) {
+    TrigrammesEleves *t = trigrammes;
+    if (t && t->db == db) differerAppliquer(&t->attente, db, trigrammesAppliquerDiffere, t);
+}
+
+// Chemins d'écriture : sans index sur cette connexion, rien à faire ; hors
+// transaction, l'écriture est déjà validée.
+void trigrammesNoter(sqlite3 *db, const EcritureTrigrammes *e) {
+    TrigrammesEleves *t = trigrammes;
+    if (!t || t->db != db) return;
+    trigrammesConfirmer(db);                // sans WAL, une validation peut être en attente
+    if (sqlite3_get_autocommit(db)) trigrammesAppliquer(t, e);
+    else if (!differerAjouter(&t->attente, e)) t->perime = true;
+}
+
+void trigrammesEcrire(sqlite3 *db, int id, const char *nom, const char *email) {
+    EcritureTrigrammes e = { .id = id };
+    e.longueur = trigrammesPlier(nom, email, e.texte);
+    trigrammesNoter(db, &e);
+}
+
+void trigrammesSupprimer(sqlite3 *db, int id) {
+    EcritureTrigrammes e = { .id = id, .longueur = -1 };
+    trigrammesNoter(db, &e);
+}
+
+// Installe dans t le contenu relu dans neuf, après y avoir rejoué les
+// écritures validées pendant la lecture (rejouer une écriture déjà lue ne
+// change pas le résultat). t reste le même objet : une recherche en cours
+// finit sur l'ancien contenu, que neuf reçoit et qui est à libérer.
+void trigrammesEchanger(TrigrammesEleves *t, TrigrammesEleves *neuf) {
+    for (int i = 0; i < t->rattrapage.nb; i++) {
+        trigrammesReporter(neuf, (const EcritureTrigrammes*)(t->rattrapage.elements + sizeof(EcritureTrigrammes) * i));
+    }
+    if (neuf->perime) t->perime = true;
+    differerAnnuler(&t->rattrapage);
+    t->rattraper = false;
+#define ECHANGER(type, champ) do { type x = t->champ; t->champ = neuf->champ; neuf->champ = x; } while (0)
+    pthread_rwlock_wrlock(&t->verrou);
+    for (int i = 0; i < TRIGRAMMES_NB; i++) ECHANGER(ListeTrigrammes, listes[i]);
+    ECHANGER(DocTrigrammes *, docs);
+    ECHANGER(int, nb_docs);
+    ECHANGER(int, cap_docs);
+    ECHANGER(char *, texte);
+    ECHANGER(size_t, taille_texte);
+    ECHANGER(size_t, cap_texte);
+    ECHANGER(long, entrees);
+    ECHANGER(long, entrees_mortes);
+    ECHANGER(int, n);
+    ECHANGER(double, duree_construction);
+    pthread_rwlock_unlock(&t->verrou);
+#undef ECHANGER
+}
+
+int distanceEdition(const char *a, int la, const char *b, int lb) {
+    int ligne[TRIGRAMMES_TEXTE_MAX + 1];
+    if (lb > TRIGRAMMES_TEXTE_MAX) lb = TRIGRAMMES_TEXTE_MAX;
+    for (int j = 0; j <= lb; j++) ligne[j] = j;
+    for (int i = 1; i <= la; i++) {
+        int diagonale = ligne[0];
+        ligne[0] = i;
+        for (int j = 1; j <= lb; j++) {
+            int haut = ligne[j];
+            int cout = diagonale + (a[i - 1] != b[j - 1]);
+            if (haut + 1 < cout) cout = haut + 1;
+            if (ligne[j - 1] + 1 < cout) cout = ligne[j - 1] + 1;
+            ligne[j] = cout;
+            diagonale = haut;
+        }
+    }
+    return ligne[lb];
+}
+
+// Taille de l'intersection de deux ensembles triés.
+int intersectionTriee(const int32_t *a, int na, const int32_t *b, int nb) {
+    int i = 0, j = 0, communs = 0;
+    while (i < na && j < nb) {
+        if (a[i] == b[j]) {
+            communs++;
+            i++;
+            j++;
+        } else if (a[i] < b[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return communs;
+}
+
+int comparerResultatsFloue(const void *a, const void *b) {
+    const ResultatFloue *x = a, *y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    if (x->distance != y->distance) return x->distance - y->distance;
+    return x->id - y->id;
+}
+
+// Les k élèves les plus proches du terme, du meilleur au moins bon ;
+// renvoie leur nombre (0 si aucun ou sans index).
+int trigrammesChercher(TrigrammesEleves *t, const char *terme, int k, ResultatFloue *out) {
+    char q[TRIGRAMMES_TEXTE_MAX];
+    int nq = (int)plierTexte(terme, q, sizeof(q));
+    const char *mots_q[TRIGRAMMES_MOTS_MAX];
+    int long_q[TRIGRAMMES_MOTS_MAX];
+    int nb_mots_q = decouperMots(q, nq, mots_q, long_q, TRIGRAMMES_MOTS_MAX);
+    if (!t || k <= 0 || nb_mots_q == 0) return 0;
+    int32_t tri_q[TRIGRAMMES_MOTS_MAX][TRIGRAMMES_TEXTE_MAX];
+    int nb_tri_q[TRIGRAMMES_MOTS_MAX];
+    for (int m = 0; m < nb_mots_q; m++) nb_tri_q[m] = trigrammesMot(mots_q[m], long_q[m], tri_q[m]);
+    int32_t codes[TRIGRAMMES_TEXTE_MAX];
+    int nc = trigrammesTexte(q, nq, codes);
+
+    pthread_rwlock_rdlock(&t->verrou);
+    // listes les plus courtes d'abord : les trigrammes rares discriminent
+    for (int i = 1; i < nc; i++) {
+        int32_t c = codes[i];
+        int j = i;
+        while (j > 0 && t->listes[codes[j - 1]].n > t->listes[c].n) {
+            codes[j] = codes[j - 1];
+            j--;
+        }
+        codes[j] = c;
+    }
+    long budget = TRIGRAMMES_BUDGET < t->nb_docs ? TRIGRAMMES_BUDGET : t->nb_docs;
+    uint8_t *compte = calloc(t->nb_docs ? t->nb_docs : 1, 1);
+    int32_t *touches = malloc(sizeof(int32_t) * (budget ? budget : 1));
+    ResultatFloue *res = malloc(sizeof(ResultatFloue) * TRIGRAMMES_CANDIDATS);
+    int nb_res = 0;
+    if (compte && touches && res) {
+        long lus = 0;
+        int nb_touches = 0;
+        for (int i = 0; i < nc && lus < TRIGRAMMES_BUDGET; i++) {
+            const ListeTrigrammes *l = &t->listes[codes[i]];
+            long fin = l->n < TRIGRAMMES_BUDGET - lus ? l->n : TRIGRAMMES_BUDGET - lus;
+            for (long j = 0; j < fin; j++) {
+                int32_t id = l->ids[j];
+                if (compte[id] == 0) {
+                    if (nb_touches == budget) continue;
+                    touches[nb_touches++] = id;
+                }
+                if (compte[id] < 255) compte[id]++;
+            }
+            lus += fin;
+        }
+        // seuil de trigrammes communs gardant au plus TRIGRAMMES_CANDIDATS candidats
+        int histo[256] = { 0 };
+        for (int i = 0; i < nb_touches; i++) histo[compte[touches[i]]]++;
+        int seuil = 255, cumul = 0;
+        while (seuil > 1 && cumul + histo[seuil] <= TRIGRAMMES_CANDIDATS) cumul += histo[seuil--];
+        int place_seuil = TRIGRAMMES_CANDIDATS - cumul;
+
+        for (int i = 0; i < nb_touches; i++) {
+            int32_t id = touches[i];
+            if (compte[id] < seuil || (compte[id] == seuil && place_seuil-- <= 0)) continue;
+            const DocTrigrammes *d = &t->docs[id];
+            if (!d->present) continue;
+            const char *mots_d[TRIGRAMMES_MOTS_MAX];
+            int long_d[TRIGRAMMES_MOTS_MAX];
+            int nb_mots_d = decouperMots(t->texte + d->debut, d->longueur, mots_d, long_d, TRIGRAMMES_MOTS_MAX);
+            int32_t tri_d[TRIGRAMMES_MOTS_MAX][TRIGRAMMES_TEXTE_MAX];
+            int nb_tri_d[TRIGRAMMES_MOTS_MAX];
+            for (int m = 0; m < nb_mots_d; m++) nb_tri_d[m] = trigrammesMot(mots_d[m], long_d[m], tri_d[m]);
+            // chaque mot saisi contre le mot le plus proche de l'élève
+            float score = 0;
+            int distance = 0;
+            for (int mq = 0; mq < nb_mots_q; mq++) {
+                float meilleur = 0;
+                int choisi = -1;
+                for (int md = 0; md < nb_mots_d; md++) {
+                    int communs = intersectionTriee(tri_q[mq], nb_tri_q[mq], tri_d[md], nb_tri_d[md]);
+                    float dice = 2.0f * communs / (nb_tri_q[mq] + nb_tri_d[md]);
+                    if (dice > meilleur) {
+                        meilleur = dice;
+                        choisi = md;
+                    }
+                }
+                score += meilleur;
+                distance += choisi < 0 ? long_q[mq] : distanceEdition(mots_q[mq], long_q[mq], mots_d[choisi], long_d[choisi]);
+            }
+            score /= nb_mots_q;
+            if (score < TRIGRAMMES_SCORE_MIN) continue;
+            res[nb_res++] = (ResultatFloue){ id, score, distance };
+        }
+        for (int i = 0; i < nb_touches; i++) compte[touches[i]] = 0;
+    }
+    pthread_rwlock_unlock(&t->verrou);
+    qsort(res, nb_res, sizeof(ResultatFloue), comparerResultatsFloue);
+    if (nb_res > k) nb_res = k;
+    if (nb_res > 0) memcpy(out, res, sizeof(ResultatFloue) * nb_res);
+    free(compte);
+    free(touches);
+    free(res);
+    return nb_res;
+}
+
+/*
+ * Sauvegarde à chaud par l'API sqlite3_backup : quelques pages par étape,
+ * depuis la boucle de l'interface. La source est la connexion principale, si
+ * bien que les écritures faites par elle pendant la copie sont reportées dans
+ * la sauvegarde sans la relancer (la piste d'audit est différée, voir
+ * auditDifferer). Le nombre de pages par étape s'adapte pour qu'une étape
+ * tienne dans SAUVEGARDE_BUDGET_MS. La copie va dans un fichier temporaire
+ * sans journal ni fsync ; sauvegardePublier() le synchronise puis le renomme,
+ * depuis un thread car c'est la seule étape longue.
+ * Base occupée : l'étape suivante attend 50 ms, puis le double à chaque refus,
+ * et la copie est abandonnée après SAUVEGARDE_ESSAIS_OCCUPEE refus de suite.
+ * Une écriture par une autre connexion (autre poste, ligne de commande) fait
+ * reprendre la copie du début ; au-delà de SAUVEGARDE_REPRISES_MAX reprises,
+ * elle est abandonnée jusqu'au créneau suivant.
+ * Instantanés planifiés : eleves.db.sauv.1 (le plus récent) .. .N.
+ */
+#define SAUVEGARDE_PREFIXE DB_NAME ".sauv"
+#define SAUVEGARDE_NB_ARCHIVES 5
+#define SAUVEGARDE_INTERVALLE_S 3600
+#define SAUVEGARDE_BUDGET_MS 10
+#define SAUVEGARDE_PAGES_MIN 16
+#define SAUVEGARDE_PAGES_MAX 65536
+#define SAUVEGARDE_PAGES_DEPART 256
+#define SAUVEGARDE_ATTENTE_MS 50
+#define SAUVEGARDE_ESSAIS_OCCUPEE 8     // 50 ms .. 6,4 s
+#define SAUVEGARDE_REPRISES_MAX 5
+
+typedef struct {
+    sqlite3 *dest;
+    sqlite3 *src;               // restauration : la sauvegarde relue
+    sqlite3_backup *bk;
+    char chemin[256];
+    char temporaire[264];
+    bool restauration;
+    int version;                // restauration : version du schéma de la sauvegarde
+    int pages_par_etape;
+    int restantes;
+    int total;
+    int copiees;                // pages copiées depuis le début (ou la dernière reprise)
+    int occupee;                // refus consécutifs, base occupée
+    int attente_ms;             // avant l'étape suivante, 0 : tout de suite
+    int reprises;
+    long etapes;
+    double duree_max;           // plus longue étape, en secondes
+    int rc;                     // SQLITE_OK tant que la copie avance, SQLITE_DONE à la fin
+} Sauvegarde;
+
+Sauvegarde *sauvegardeOuvrir(sqlite3 *src, const char *chemin) {
+    Sauvegarde *s = calloc(1, sizeof(Sauvegarde));
+    if (!s) return NULL;
+    snprintf(s->chemin, sizeof(s->chemin), "%s", chemin);
+    snprintf(s->temporaire, sizeof(s->temporaire), "%s.tmp", chemin);
+    remove(s->temporaire);
+    if (sqlite3_open(s->temporaire, &s->dest) != SQLITE_OK ||
+        sqlite3_exec(s->dest, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;", 0, 0, NULL) != SQLITE_OK ||
+        !(s->bk = sqlite3_backup_init(s->dest, "main", src, "main"))) {
+        journal(LOG_ERREUR, "Erreur d'ouverture de la sauvegarde", "fichier=\"%s\" erreur=\"%s\"",
+                chemin, sqlite3_errmsg(s->dest));
+        sqlite3_close(s->dest);
+        remove(s->temporaire);
+        free(s);
+        return NULL;
+    }
+    s->pages_par_etape = SAUVEGARDE_PAGES_DEPART;
+    auditDifferer(true);
+    return s;
+}
+
+// Copie une tranche ; false quand la copie est finie ou a échoué (voir s->rc).
+// Sinon, l'étape suivante est à faire après s->attente_ms.
+bool sauvegardeEtape(Sauvegarde *s) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int demandees = s->pages_par_etape;
+    int rc = sqlite3_backup_step(s->bk, demandees);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double duree = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if (duree > s->duree_max) s->duree_max = duree;
+    s->etapes++;
+    if (duree * 1e3 > SAUVEGARDE_BUDGET_MS) {
+        if (s->pages_par_etape > SAUVEGARDE_PAGES_MIN) s->pages_par_etape /= 2;
+    } else if (duree * 2e3 < SAUVEGARDE_BUDGET_MS && s->pages_par_etape < SAUVEGARDE_PAGES_MAX) {
+        s->pages_par_etape *= 2;
+    }
+    s->restantes = sqlite3_backup_remaining(s->bk);
+    s->total = sqlite3_backup_pagecount(s->bk);
+    if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        if (++s->occupee >= SAUVEGARDE_ESSAIS_OCCUPEE) {
+            s->rc = rc;
+            return false;
+        }
+        s->attente_ms = SAUVEGARDE_ATTENTE_MS << (s->occupee - 1);
+        return true;
+    }
+    s->occupee = 0;
+    s->attente_ms = 0;
+    // une étape avance de `demandees` pages, sauf reprise du début
+    int copiees = s->total - s->restantes;
+    if (rc == SQLITE_OK && s->copiees > 0 && copiees < s->copiees + demandees && ++s->reprises > SAUVEGARDE_REPRISES_MAX) {
+        rc = SQLITE_BUSY;
+    }
+    s->copiees = copiees;
+    s->rc = rc;
+    return rc == SQLITE_OK;
+}
+
+double sauvegardeProgression(const Sauvegarde *s) {
+    return s->total > 0 ? 1.0 - (double)s->restantes / s->total : 0.0;
+}
+
+// Ferme la copie (terminée ou abandonnée) ; true si le fichier temporaire est
+// complet et peut être publié, sinon il est supprimé.
+bool sauvegardeTerminer(Sauvegarde *s) {
+    int rc = sqlite3_backup_finish(s->bk);
+    bool ok = s->rc == SQLITE_DONE && rc == SQLITE_OK;
+    sqlite3_close(s->dest);
+    auditDifferer(false);
+    if (!ok) {
+        if (s->rc == SQLITE_OK) journal(LOG_AVERT, "Sauvegarde interrompue", "fichier=\"%s\"", s->chemin);
+        else journal(LOG_ERREUR, "Échec de la sauvegarde", "fichier=\"%s\" erreur=\"%s\" reprises=%d refus=%d",
+                     s->chemin, sqlite3_errstr(s->rc), s->reprises, s->occupee);
+        remove(s->temporaire);
+    }
+    return ok;
+}
+
+// eleves.db.sauv.1 -> .2 -> ... -> .N (la plus ancienne est écrasée)
+void sauvegardeRotation(const char *prefixe, int nb) {
+    char ancien[256], nouveau[256];
+    for (int i = nb - 1; i >= 1; i--) {
+        snprintf(ancien, sizeof(ancien), "%s.%d", prefixe, i);
+        snprintf(nouveau, sizeof(nouveau), "%s.%d", prefixe, i + 1);
+        rename(ancien, nouveau);
+    }
+}
+
+// Rend le fichier temporaire durable puis le met en place d'un seul rename().
+bool sauvegardePublier(const char *temporaire, const char *chemin) {
+    int fd = open(temporaire, O_RDONLY | O_CLOEXEC);
+    bool ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    ok = ok && rename(temporaire, chemin) == 0;
+    if (ok) {
+        journal(LOG_INFO, "Sauvegarde écrite", "fichier=\"%s\"", chemin);
+    } else {
+        journal(LOG_ERREUR, "Échec de la sauvegarde", "fichier=\"%s\" erreur=\"écriture\"", chemin);
+        remove(temporaire);
+    }
+    return ok;
+}
+
+// Restauration : la même copie par étapes dans l'autre sens, vers une
+// connexion à part sur le fichier de la base, qui garde la base verrouillée
+// en écriture jusqu'à la dernière étape ; une copie abandonnée n'a rien
+// changé. Entre-temps, les écritures de la connexion principale trouvent la
+// base occupée.
+Sauvegarde *restaurationOuvrir(sqlite3 *db, const char *chemin) {
+    Sauvegarde *s = calloc(1, sizeof(Sauvegarde));
+    if (!s) return NULL;
+    snprintf(s->chemin, sizeof(s->chemin), "%s", chemin);
+    s->restauration = true;
+    s->version = -1;
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_open_v2(chemin, &s->src, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(s->src, "SELECT 1 FROM eleves LIMIT 1;", -1, &stmt, NULL) == SQLITE_OK) {
+        s->version = versionSchema(s->src);
+    }
+    sqlite3_finalize(stmt);
+    const char *base = sqlite3_db_filename(db, "main");
+    if (s->version < 0 || s->version > migrations[NB_MIGRATIONS - 1].version) {
+        journal(LOG_ERREUR, "Sauvegarde illisible", "fichier=\"%s\" version=%d", chemin, s->version);
+    } else if (!base || !*base || sqlite3_open_v2(base, &s->dest, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK ||
+               !(s->bk = sqlite3_backup_init(s->dest, "main", s->src, "main"))) {
+        journal(LOG_ERREUR, "Échec de la restauration", "fichier=\"%s\" erreur=\"%s\"", chemin,
+                s->dest ? sqlite3_errmsg(s->dest) : "base en mémoire");
+    } else {
+        s->pages_par_etape = SAUVEGARDE_PAGES_DEPART;
+        auditDifferer(true);
+        return s;
+    }
+    sqlite3_close(s->dest);
+    sqlite3_close(s->src);
+    free(s);
+    return NULL;
+}
+
+// Ferme la copie (terminée ou abandonnée) ; si elle est complète, met le
+// schéma à jour (sauvegarde plus ancienne) et reconstruit ce qui est tiré de
+// la table. s reste à libérer.
+bool restaurationTerminer(sqlite3 *db, Sauvegarde *s) {
+    int rc = sqlite3_backup_finish(s->bk);
+    if (s->rc == SQLITE_DONE && rc != SQLITE_OK) s->rc = rc;
+    sqlite3_close(s->dest);
+    sqlite3_close(s->src);
+    auditDifferer(false);
+    if (s->rc == SQLITE_OK) {
+        journal(LOG_AVERT, "Restauration interrompue", "fichier=\"%s\"", s->chemin);
+        return false;
+    }
+    if (s->rc != SQLITE_DONE) {
+        journal(LOG_ERREUR, "Échec de la restauration", "fichier=\"%s\" erreur=\"%s\"", s->chemin, sqlite3_errstr(s->rc));
+        return false;
+    }
+    if (!creerSchema(db)) return false;
+    if (colonnes) {
+        colonnesLiberer(colonnes);
+        colonnes = colonnesConstruire(db);
+    }
+    trigrammesRecharger(trigrammes);
+    cacheResultatsInvalider();      // la copie ne passe pas par commit_hook
+    journal(LOG_INFO, "Base restaurée", "fichier=\"%s\" version=%d", s->chemin, s->version);
+    auditer("restauration fichier=%s", s->chemin);
+    return true;
+}
+
+// Restauration d'un trait, hors de l'interface : attend entre les étapes.
+bool restaurerSauvegarde(sqlite3 *db, const char *chemin) {
+    Sauvegarde *s = restaurationOuvrir(db, chemin);
+    if (!s) return false;
+    while (sauvegardeEtape(s)) {
+        if (s->attente_ms) sqlite3_sleep(s->attente_ms);
+    }
+    bool ok = restaurationTerminer(db, s);
+    free(s);
+    return ok;
+}
+
+// Copie une ligne de `SELECT * FROM eleves` dans une Personne.
+void lireEleve(sqlite3_stmt *stmt, Personne *p) {
+    const char *txt;
+    p->id = sqlite3_column_int(stmt, 0);
+    txt = (const char*)sqlite3_column_text(stmt, 1);
+    snprintf(p->nom, sizeof(p->nom), "%s", txt ? txt : "");
+    p->age = sqlite3_column_int(stmt, 2);
+    p->taille = (float)sqlite3_column_double(stmt, 3);
+    txt = (const char*)sqlite3_column_text(stmt, 4);
+    snprintf(p->email, sizeof(p->email), "%s", txt ? txt : "");
+    txt = (const char*)sqlite3_column_text(stmt, 5);
+    snprintf(p->telephone, sizeof(p->telephone), "%s", txt ? txt : "");
+    txt = (const char*)sqlite3_column_text(stmt, 6);
+    snprintf(p->grade, sizeof(p->grade), "%s", txt ? txt : "");
+    p->version = sqlite3_column_count(stmt) > 7 ? sqlite3_column_int(stmt, 7) : 0;
+}
+
+bool ajouterEleve(sqlite3 *db, const Personne *e) {
+    double t0 = diagDebut();
+    bool ouverte;
+    if (!ecritureDebut(db, &ouverte)) return false;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_INSERT_ELEVE);
+    if (!stmt) return ecritureFin(db, ouverte, false);
+    sqlite3_bind_text(stmt, 1, e->nom, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, e->age);
+    sqlite3_bind_double(stmt, 3, e->taille);
+    sqlite3_bind_text(stmt, 4, e->email, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, e->telephone, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, e->grade, -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "Erreur d'insertion: %s", sqlite3_errmsg(db));
+        log_error(buffer);
+    }
+    libererRequete(stmt);
+    bool ok = ecritureFin(db, ouverte, rc == SQLITE_DONE);
+    diagFin(DIAG_AJOUTER, t0, ok);
+    if (!ok) return false;
+    colonnesEcrire(db, (int)sqlite3_last_insert_rowid(db), e->age, e->taille, e->grade);
+    trigrammesEcrire(db, (int)sqlite3_last_insert_rowid(db), e->nom, e->email);
+    auditer("ajout eleve=%lld", (long long)sqlite3_last_insert_rowid(db));
+    return true;
+}
+
+/*
+ * Rendu des élèves : une même boucle lit les lignes d'une requête sur eleves
+ * et les confie à un format (tableau ASCII, CSV, JSON Lines, TSV) qui écrit
+ * dans une Sortie : tampon en mémoire à croissance géométrique, ou FILE*
+ * pour diffuser en flux à mémoire bornée.
+ */
+typedef struct {
+    FILE *fp;           // non NULL : écriture directe dans le fichier
+    char *buf;
+    size_t len;
+    size_t cap;
+    bool erreur;
+} Sortie;
+
+void sortieEcrire(Sortie *s, const char *data, size_t n) {
+    if (s->erreur) return;
+    if (s->fp) {
+        if (fwrite(data, 1, n, s->fp) != n) s->erreur = true;
+        return;
+    }
+    if (s->len + n + 1 > s->cap) {
+        size_t cap = s->cap ? s->cap : 4096;
+        while (s->len + n + 1 > cap) cap *= 2;
+        char *p = realloc(s->buf, cap);
+        if (!p) {
+            s->erreur = true;
+            return;
+        }
+        s->buf = p;
+        s->cap = cap;
+    }
+    memcpy(s->buf + s->len, data, n);
+    s->len += n;
+    s->buf[s->len] = '\0';
+}
+
+void sortieTexte(Sortie *s, const char *txt) {
+    sortieEcrire(s, txt, strlen(txt));
+}
+
+void sortiePrintf(Sortie *s, const char *fmt, ...) {
+    char ligne[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(ligne, sizeof(ligne), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(ligne)) {
+        sortieEcrire(s, ligne, n);
+        return;
+    }
+    char *grande = malloc(n + 1);
+    if (!grande) {
+        s->erreur = true;
+        return;
+    }
+    va_start(ap, fmt);
+    vsnprintf(grande, n + 1, fmt, ap);
+    va_end(ap);
+    sortieEcrire(s, grande, n);
+    free(grande);
+}
+
+// Vue sur une ligne de `SELECT * FROM eleves`, sans copie ni troncature ;
+// valable jusqu'au prochain sqlite3_step.
+typedef struct {
+    int id;
+    const char *nom;
+    int age;
+    double taille;
+    const char *email;
+    const char *telephone;
+    const char *grade;
+} LigneEleve;
+
+const char *colonneTexte(sqlite3_stmt *stmt, int col) {
+    const char *txt = (const char*)sqlite3_column_text(stmt, col);
+    return txt ? txt : "";
+}
+
+void lireLigneEleve(sqlite3_stmt *stmt, LigneEleve *l) {
+    l->id = sqlite3_column_int(stmt, 0);
+    l->nom = colonneTexte(stmt, 1);
+    l->age = sqlite3_column_int(stmt, 2);
+    l->taille = sqlite3_column_double(stmt, 3);
+    l->email = colonneTexte(stmt, 4);
+    l->telephone = colonneTexte(stmt, 5);
+    l->grade = colonneTexte(stmt, 6);
+}
+
+/*
+ * Lots d'élèves compacts pour les traitements en masse (exécuteur, pages
+ * du modèle, caches) : les chaînes sont copiées bout à bout dans l'arène du
+ * lot et référencées par (début, longueur), les grades sont internés. Un lot
+ * se vide ou se libère d'un coup ; lotVersPersonne() convertit une ligne
+ * pour le code qui attend une Personne.
+ */
+#define LOT_MAX_GRADES 64
+
+typedef struct {
+    char *octets;
+    size_t taille;
+    size_t cap;
+} Arene;
+
+typedef struct {
+    uint32_t debut;             // décalage dans l'arène
+    uint32_t longueur;
+} RefChaine;
+
+typedef struct {
+    int id;
+    int age;
+    float taille;
+    RefChaine nom;
+    RefChaine email;
+    RefChaine telephone;
+    RefChaine grade;            // internée : même référence pour un même grade
+} EleveCompact;
+
+typedef struct {
+    Arene arene;
+    EleveCompact *lignes;
+    int n;
+    int cap;
+    RefChaine grades[LOT_MAX_GRADES];
+    int nb_grades;
+    long allocations;           // appels à malloc/realloc depuis la création
+} LotEleves;
+
+// Copie n octets (plus un '\0') dans l'arène ; capacité doublée au besoin.
+bool areneCopier(LotEleves *lot, const char *s, size_t n, RefChaine *ref) {
+    Arene *a = &lot->arene;
+    if (a->taille + n + 1 > a->cap) {
+        size_t cap = a->cap ? a->cap : 4096;
+        while (cap < a->taille + n + 1) cap *= 2;
+        char *octets = realloc(a->octets, cap);
+        if (!octets) return false;
+        a->octets = octets;
+        a->cap = cap;
+        lot->allocations++;
+    }
+    memcpy(a->octets + a->taille, s, n);
+    a->octets[a->taille + n] = '\0';
+    ref->debut = (uint32_t)a->taille;
+    ref->longueur = (uint32_t)n;
+    a->taille += n + 1;
+    return true;
+}
+
+const char *lotChaine(const LotEleves *lot, RefChaine ref) {
+    return lot->arene.octets ? lot->arene.octets + ref.debut : "";
+}
+
+bool lotInterner(LotEleves *lot, const char *s, size_t n, RefChaine *ref) {
+    for (int g = 0; g < lot->nb_grades; g++) {
+        if (lot->grades[g].longueur == n && memcmp(lotChaine(lot, lot->grades[g]), s, n) == 0) {
+            *ref = lot->grades[g];
+            return true;
+        }
+    }
+    if (!areneCopier(lot, s, n, ref)) return false;
+    if (lot->nb_grades < LOT_MAX_GRADES) lot->grades[lot->nb_grades++] = *ref;
+    return true;
+}
+
+// Réutilise le lot sans rendre sa mémoire (pages rechargées, lots successifs).
+void lotVider(LotEleves *lot) {
+    lot->n = 0;
+    lot->nb_grades = 0;
+    lot->arene.taille = 0;
+}
+
+void lotLiberer(LotEleves *lot) {
+    free(lot->lignes);
+    free(lot->arene.octets);
+    memset(lot, 0, sizeof(*lot));
+}
+
+// Prépare la place de `lignes` lignes et `octets` de chaînes en deux allocations.
+bool lotReserver(LotEleves *lot, int lignes, size_t octets) {
+    if (lignes > lot->cap) {
+        EleveCompact *l = realloc(lot->lignes, sizeof(EleveCompact) * lignes);
+        if (!l) return false;
+        lot->lignes = l;
+        lot->cap = lignes;
+        lot->allocations++;
+    }
+    if (octets > lot->arene.cap) {
+        char *o = realloc(lot->arene.octets, octets);
+        if (!o) return false;
+        lot->arene.octets = o;
+        lot->arene.cap = octets;
+        lot->allocations++;
+    }
+    return true;
+}
+
+EleveCompact *lotNouvelleLigne(LotEleves *lot) {
+    if (lot->n == lot->cap) {
+        int cap = lot->cap ? lot->cap * 2 : 64;
+        EleveCompact *lignes = realloc(lot->lignes, sizeof(EleveCompact) * cap);
+        if (!lignes) return NULL;
+        lot->lignes = lignes;
+        lot->cap = cap;
+        lot->allocations++;
+    }
+    return &lot->lignes[lot->n];
+}
+
+bool lotAjouterChamps(LotEleves *lot, int id, int age, float taille, const char *nom, size_t l_nom,
+                      const char *email, size_t l_email, const char *tel, size_t l_tel,
+                      const char *grade, size_t l_grade) {
+    EleveCompact *e = lotNouvelleLigne(lot);
+    if (!e || !areneCopier(lot, nom, l_nom, &e->nom) || !areneCopier(lot, email, l_email, &e->email) ||
+        !areneCopier(lot, tel, l_tel, &e->telephone) || !lotInterner(lot, grade, l_grade, &e->grade)) {
+        return false;
+    }
+    e->id = id;
+    e->age = age;
+    e->taille = taille;
+    lot->n++;
+    return true;
+}
+
+// Ajoute la ligne courante d'un `SELECT * FROM eleves`, sans troncature.
+bool lotAjouterLigne(LotEleves *lot, sqlite3_stmt *stmt) {
+    return lotAjouterChamps(lot, sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 2),
+                            (float)sqlite3_column_double(stmt, 3),
+                            colonneTexte(stmt, 1), sqlite3_column_bytes(stmt, 1),
+                            colonneTexte(stmt, 4), sqlite3_column_bytes(stmt, 4),
+                            colonneTexte(stmt, 5), sqlite3_column_bytes(stmt, 5),
+                            colonneTexte(stmt, 6), sqlite3_column_bytes(stmt, 6));
+}
+
+bool lotAjouterPersonne(LotEleves *lot, const Personne *p) {
+    return lotAjouterChamps(lot, p->id, p->age, p->taille, p->nom, strlen(p->nom), p->email, strlen(p->email),
+                            p->telephone, strlen(p->telephone), p->grade, strlen(p->grade));
+}
+
+bool lotCopierLigne(LotEleves *lot, const LotEleves *src, int i) {
+    const EleveCompact *e = &src->lignes[i];
+    return lotAjouterChamps(lot, e->id, e->age, e->taille, lotChaine(src, e->nom), e->nom.longueur,
+                            lotChaine(src, e->email), e->email.longueur, lotChaine(src, e->telephone), e->telephone.longueur,
+                            lotChaine(src, e->grade), e->grade.longueur);
+}
+
+// Conversion pour l'ancien format (tronqué aux tailles de Personne).
+void lotVersPersonne(const LotEleves *lot, int i, Personne *p) {
+    const EleveCompact *e = &lot->lignes[i];
+    p->id = e->id;
+    p->age = e->age;
+    p->taille = e->taille;
+    snprintf(p->nom, sizeof(p->nom), "%s", lotChaine(lot, e->nom));
+    snprintf(p->email, sizeof(p->email), "%s", lotChaine(lot, e->email));
+    snprintf(p->telephone, sizeof(p->telephone), "%s", lotChaine(lot, e->telephone));
+    snprintf(p->grade, sizeof(p->grade), "%s", lotChaine(lot, e->grade));
+    p->version = 0;                     // non conservée dans les lots
+}
+
+// Copie `src` dans un champ de Personne ; refuse au lieu de tronquer.
+bool copierChamp(char *dst, size_t taille, const char *src) {
+    size_t n = strlen(src);
+    if (n >= taille) return false;
+    memcpy(dst, src, n + 1);
+    return true;
+}
+
+// Octets occupés par le lot (lignes, arène et structure).
+size_t lotMemoire(const LotEleves *lot) {
+    return sizeof(LotEleves) + (size_t)lot->cap * sizeof(EleveCompact) + lot->arene.cap;
+}
+
+// Copie d'un lot entier en deux memcpy (lignes et arène) ; `dst` est vidé.
+bool lotCopier(LotEleves *dst, const LotEleves *src) {
+    lotVider(dst);
+    if (!lotReserver(dst, src->n, src->arene.taille)) return false;
+    if (src->n) memcpy(dst->lignes, src->lignes, sizeof(EleveCompact) * src->n);
+    if (src->arene.taille) memcpy(dst->arene.octets, src->arene.octets, src->arene.taille);
+    memcpy(dst->grades, src->grades, sizeof(RefChaine) * src->nb_grades);
+    dst->n = src->n;
+    dst->nb_grades = src->nb_grades;
+    dst->arene.taille = src->arene.taille;
+    return true;
+}
+
+/*
+ * Réserve de lots : un lot rendu garde sa mémoire et resservira au lieu
+ * d'être libéré (exécuteur : un lot par envoi au thread GTK, rendu après
+ * livraison). Les éléments sont opaques (lot ou structure qui l'embarque) ;
+ * au-delà de RESERVE_LOTS_MAX, reserveRendre() refuse et l'appelant libère.
+ */
+#define RESERVE_LOTS_MAX 8
+
+typedef struct {
+    pthread_mutex_t mutex;
+    void *libres[RESERVE_LOTS_MAX];
+    int n;
+} ReserveLots;
+
+// Un élément rendu, ou NULL si la réserve est vide.
+void *reservePrendre(ReserveLots *r) {
+    pthread_mutex_lock(&r->mutex);
+    void *lot = r->n > 0 ? r->libres[--r->n] : NULL;
+    pthread_mutex_unlock(&r->mutex);
+    return lot;
+}
+
+bool reserveRendre(ReserveLots *r, void *lot) {
+    pthread_mutex_lock(&r->mutex);
+    bool garde = r->n < RESERVE_LOTS_MAX;
+    if (garde) r->libres[r->n++] = lot;
+    pthread_mutex_unlock(&r->mutex);
+    return garde;
+}
+
+void reserveVider(ReserveLots *r, void (*liberer)(void *lot)) {
+    void *lot;
+    while ((lot = reservePrendre(r))) liberer(lot);
+}
+
+/*
+ * Cache des résultats de liste et de recherche, partagé entre threads : une
+ * entrée par requête normalisée (type et paramètres), qui garde les lignes
+ * dans un lot compact et jusqu'à deux valeurs associées (compte, nombre
+ * d'approchants...). Une entrée n'est valable que pour la connexion qui l'a
+ * remplie, et tant que :
+ *  - PRAGMA data_version de cette connexion n'a pas changé (écritures des
+ *    autres connexions, y compris d'autres processus) ;
+ *  - la connexion n'a elle-même rien modifié (data_version ne compte pas
+ *    ses propres écritures) ;
+ *  - la génération n'a pas changé : elle est incrémentée à chaque validation
+ *    ou annulation d'une connexion ouverte par ouvrirBase (commit_hook,
+ *    rollback_hook), après une restauration et à chaque changement de
+ *    partitions.
+ * Rien n'est gardé pendant une transaction de la connexion : ses lignes non
+ * validées pourraient disparaître à l'annulation. L'état est relevé avant la requête : une écriture pendant le remplissage
+ * rend l'entrée aussitôt périmée. Mémoire bornée par `plafond`, avec
+ * éviction de l'entrée la moins récemment utilisée ; un résultat de plus du
+ * quart du plafond n'est pas gardé.
+ */
+#define CACHE_RESULTATS_ENTREES 64
+#define CACHE_RESULTATS_OCTETS (8 * 1024 * 1024)
+#define CACHE_CLE_MAX (MAX_QUERY + 32)
+
+typedef struct {
+    sqlite3 *bdd;
+    sqlite3_int64 version;      // PRAGMA data_version
+    sqlite3_int64 modifications;    // sqlite3_total_changes64 de la connexion
+    long generation;
+} EtatCache;
+
+typedef struct {
+    char *cle;                  // NULL : emplacement libre
+    uint32_t hachage;
+    EtatCache etat;
+    unsigned usage;
+    size_t octets;
+    sqlite3_int64 valeurs[2];
+    LotEleves lot;
+} EntreeCache;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    EntreeCache entrees[CACHE_RESULTATS_ENTREES];
+    unsigned horloge;
+    size_t octets;
+    size_t plafond;
+    atomic_long generation;
+    long succes, echecs, perimees, evictions;
+} CacheResultats;
+
+CacheResultats cache_resultats = { .mutex = PTHREAD_MUTEX_INITIALIZER, .plafond = CACHE_RESULTATS_OCTETS };
+
+void cacheResultatsInvalider(void) {
+    atomic_fetch_add(&cache_resultats.generation, 1);
+}
+
+// Clé "type:paramètres", paramètres en minuscules (ASCII), blancs réduits à
+// une espace et retirés aux extrémités. Renvoie false si elle est trop longue.
+bool cacheResultatsCle(char *out, size_t taille, const char *type, const char *param) {
+    int len = snprintf(out, taille, "%s:", type);
+    if (len < 0 || (size_t)len >= taille) return false;
+    bool blanc = false;
+    for (const unsigned char *c = (const unsigned char*)param; *c; c++) {
+        if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+            blanc = true;
+            continue;
+        }
+        if ((size_t)len + 2 >= taille) return false;
+        if (blanc && out[len - 1] != ':') out[len++] = ' ';
+        blanc = false;
+        out[len++] = (char)(*c >= 'A' && *c <= 'Z' ? *c | 0x20 : *c);
+    }
+    out[len] = '\0';
+    return true;
+}
+
+// État courant de `bdd`, à relever avant d'exécuter la requête à garder ;
+// false si le résultat ne peut pas être gardé (transaction ouverte).
+bool cacheResultatsEtat(sqlite3 *bdd, EtatCache *etat) {
+    if (!sqlite3_get_autocommit(bdd)) return false;
+    etat->bdd = bdd;
+    etat->generation = atomic_load(&cache_resultats.generation);
+    etat->modifications = sqlite3_total_changes64(bdd);
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_DATA_VERSION);
+    if (!stmt) return false;
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    etat->version = sqlite3_column_int64(stmt, 0);
+    libererRequete(stmt);
+    return ok;
+}
+
+uint32_t cacheHachage(const char *cle) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char*)cle; *c; c++) h = (h ^ *c) * 16777619u;
+    return h;
+}
+
+// Libère une entrée (mutex tenu).
+void cacheRetirer(EntreeCache *e) {
+    cache_resultats.octets -= e->octets;
+    free(e->cle);
+    lotLiberer(&e->lot);
+    memset(e, 0, sizeof(*e));
+}
+
+EntreeCache *cacheTrouver(const char *cle, uint32_t h) {
+    for (int i = 0; i < CACHE_RESULTATS_ENTREES; i++) {
+        EntreeCache *e = &cache_resultats.entrees[i];
+        if (e->cle && e->hachage == h && strcmp(e->cle, cle) == 0) return e;
+    }
+    return NULL;
+}
+
+// Copie dans `out` le résultat gardé pour `cle` s'il est encore valable dans
+// `etat` ; `valeurs` (deux, peut être NULL) reçoit les valeurs associées.
+bool cacheResultatsLire(const EtatCache *etat, const char *cle, LotEleves *out, sqlite3_int64 *valeurs) {
+    uint32_t h = cacheHachage(cle);
+    bool ok = false;
+    pthread_mutex_lock(&cache_resultats.mutex);
+    EntreeCache *e = cacheTrouver(cle, h);
+    if (e && (e->etat.bdd != etat->bdd || e->etat.version != etat->version ||
+              e->etat.modifications != etat->modifications || e->etat.generation != atomic_load(&cache_resultats.generation))) {
+        cacheRetirer(e);
+        cache_resultats.perimees++;
+    } else if (e && lotCopier(out, &e->lot)) {
+        e->usage = ++cache_resultats.horloge;
+        if (valeurs) memcpy(valeurs, e->valeurs, sizeof(e->valeurs));
+        ok = true;
+    }
+    if (ok) cache_resultats.succes++;
+    else cache_resultats.echecs++;
+    pthread_mutex_unlock(&cache_resultats.mutex);
+    diagCacheCompter(DIAG_CACHE_RESULTATS, ok);
+    return ok;
+}
+
+// Garde une copie de `lot` pour `cle`, relevé dans l'état `etat`.
+void cacheResultatsAjouter(const EtatCache *etat, const char *cle, const LotEleves *lot, const sqlite3_int64 *valeurs) {
+    if (etat->generation != atomic_load(&cache_resultats.generation)) return;      // déjà périmé
+    LotEleves copie = { 0 };
+    char *dup = strdup(cle);
+    if (!dup || !lotCopier(&copie, lot)) {
+        free(dup);
+        lotLiberer(&copie);
+        return;
+    }
+    size_t octets = lotMemoire(&copie) + strlen(cle) + 1;
+    uint32_t h = cacheHachage(cle);
+    pthread_mutex_lock(&cache_resultats.mutex);
+    EntreeCache *e = octets <= cache_resultats.plafond / 4 ? cacheTrouver(cle, h) : NULL;
+    if (e) cacheRetirer(e);
+    while (octets <= cache_resultats.plafond / 4) {
+        EntreeCache *victime = NULL;
+        e = NULL;
+        for (int i = 0; i < CACHE_RESULTATS_ENTREES && !e; i++) {
+            EntreeCache *c = &cache_resultats.entrees[i];
+            if (!c->cle) e = c;
+            else if (!victime || c->usage < victime->usage) victime = c;
+        }
+        if (e && cache_resultats.octets + octets <= cache_resultats.plafond) break;
+        e = NULL;
+        if (!victime) break;
+        cacheRetirer(victime);
+        cache_resultats.evictions++;
+    }
+    if (e) {
+        *e = (EntreeCache){ dup, h, *etat, ++cache_resultats.horloge, octets, { 0, 0 }, copie };
+        if (valeurs) memcpy(e->valeurs, valeurs, sizeof(e->valeurs));
+        cache_resultats.octets += octets;
+        dup = NULL;
+    }
+    pthread_mutex_unlock(&cache_resultats.mutex);
+    if (dup) {                  // trop gros pour le cache
+        free(dup);
+        lotLiberer(&copie);
+    }
+}
+
+// Vide le cache ; `plafond` > 0 le remplace.
+void cacheResultatsVider(size_t plafond) {
+    pthread_mutex_lock(&cache_resultats.mutex);
+    for (int i = 0; i < CACHE_RESULTATS_ENTREES; i++) {
+        if (cache_resultats.entrees[i].cle) cacheRetirer(&cache_resultats.entrees[i]);
+    }
+    if (plafond) cache_resultats.plafond = plafond;
+    pthread_mutex_unlock(&cache_resultats.mutex);
+}
+
+typedef struct {
+    void (*entete)(Sortie *s);
+    void (*ligne)(Sortie *s, const LigneEleve *l);
+    void (*pied)(Sortie *s);
+} FormatRendu;
+
+#define TABLE_SEPARATEUR "+----+----------------------+-----+--------+---------------------------+----------------+--------+\n"
+
+void tableEntete(Sortie *s) {
+    sortieTexte(s, TABLE_SEPARATEUR);
+    sortieTexte(s, "| ID | Nom                  | Age | Taille | Email                     | Téléphone      | Grade  |\n");
+    sortieTexte(s, TABLE_SEPARATEUR);
+}
+
+void tableLigne(Sortie *s, const LigneEleve *l) {
+    sortiePrintf(s, "| %-2d | %-20s | %-3d | %-6.2f | %-25s | %-14s | %-6s |\n",
+                 l->id, l->nom, l->age, l->taille, l->email, l->telephone, l->grade);
+}
+
+void tablePied(Sortie *s) {
+    sortieTexte(s, TABLE_SEPARATEUR);
+}
+
+// Champ CSV selon la RFC 4180 : guillemets si nécessaire, guillemets doublés
+void csvChampSortie(Sortie *s, const char *champ) {
+    if (!strpbrk(champ, ",\"\r\n")) {
+        sortieTexte(s, champ);
+        return;
+    }
+    sortieEcrire(s, "\"", 1);
+    for (const char *debut = champ, *q; ; debut = q + 1) {
+        q = strchr(debut, '"');
+        if (!q) {
+            sortieTexte(s, debut);
+            break;
+        }
+        sortieEcrire(s, debut, q - debut + 1);
+        sortieEcrire(s, "\"", 1);
+    }
+    sortieEcrire(s, "\"", 1);
+}
+
+void csvEntete(Sortie *s) {
+    sortieTexte(s, "ID,Nom,Age,Taille,Email,Telephone,Grade\n");
+}
+
+void csvLigne(Sortie *s, const LigneEleve *l) {
+    sortiePrintf(s, "%d,", l->id);
+    csvChampSortie(s, l->nom);
+    sortiePrintf(s, ",%d,%.2f,", l->age, l->taille);
+    csvChampSortie(s, l->email);
+    sortieEcrire(s, ",", 1);
+    csvChampSortie(s, l->telephone);
+    sortieEcrire(s, ",", 1);
+    csvChampSortie(s, l->grade);
+    sortieEcrire(s, "\n", 1);
+}
+
+void jsonChaine(Sortie *s, const char *txt) {
+    sortieEcrire(s, "\"", 1);
+    const char *debut = txt;
+    for (const unsigned char *c = (const unsigned char*)txt; *c; c++) {
+        if (*c >= 0x20 && *c != '"' && *c != '\\') continue;
+        sortieEcrire(s, debut, (const char*)c - debut);
+        switch (*c) {
+            case '"':  sortieTexte(s, "\\\""); break;
+            case '\\': sortieTexte(s, "\\\\"); break;
+            case '\n': sortieTexte(s, "\\n"); break;
+            case '\r': sortieTexte(s, "\\r"); break;
+            case '\t': sortieTexte(s, "\\t"); break;
+            default:   sortiePrintf(s, "\\u%04x", *c); break;
+        }
+        debut = (const char*)c + 1;
+    }
+    sortieTexte(s, debut);
+    sortieEcrire(s, "\"", 1);
+}
+
+void jsonlLigne(Sortie *s, const LigneEleve *l) {
+    sortiePrintf(s, "{\"id\":%d,\"nom\":", l->id);
+    jsonChaine(s, l->nom);
+    sortiePrintf(s, ",\"age\":%d,\"taille\":%.2f,\"email\":", l->age, l->taille);
+    jsonChaine(s, l->email);
+    sortieTexte(s, ",\"telephone\":");
+    jsonChaine(s, l->telephone);
+    sortieTexte(s, ",\"grade\":");
+    jsonChaine(s, l->grade);
+    sortieTexte(s, "}\n");
+}
+
+// Champ TSV : tabulations, retours et antislashs échappés
+void tsvChamp(Sortie *s, const char *txt) {
+    const char *debut = txt;
+    for (const char *c = txt; *c; c++) {
+        const char *echap = *c == '\t' ? "\\t" : *c == '\n' ? "\\n" : *c == '\r' ? "\\r" : *c == '\\' ? "\\\\" : NULL;
+        if (!echap) continue;
+        sortieEcrire(s, debut, c - debut);
+        sortieTexte(s, echap);
+        debut = c + 1;
+    }
+    sortieTexte(s, debut);
+}
+
+void tsvEntete(Sortie *s) {
+    sortieTexte(s, "id\tnom\tage\ttaille\temail\ttelephone\tgrade\n");
+}
+
+void tsvLigne(Sortie *s, const LigneEleve *l) {
+    sortiePrintf(s, "%d\t", l->id);
+    tsvChamp(s, l->nom);
+    sortiePrintf(s, "\t%d\t%.2f\t", l->age, l->taille);
+    tsvChamp(s, l->email);
+    sortieEcrire(s, "\t", 1);
+    tsvChamp(s, l->telephone);
+    sortieEcrire(s, "\t", 1);
+    tsvChamp(s, l->grade);
+    sortieEcrire(s, "\n", 1);
+}
+
+const FormatRendu format_table = { tableEntete, tableLigne, tablePied };
+const FormatRendu format_csv = { csvEntete, csvLigne, NULL };
+const FormatRendu format_jsonl = { NULL, jsonlLigne, NULL };
+const FormatRendu format_tsv = { tsvEntete, tsvLigne, NULL };
+
+// Rapports de diagnostics (voir Diagnostics) : texte pour la fenêtre,
+// JSON pour DIAG_FICHIER.
+typedef struct {
+    long succes;
+    long echecs;
+} DiagTaux;
+
+// Borne haute, en ms, de la classe contenant le centile p.
+double diagCentile(const DiagMesure *m, double p) {
+    long rang = (long)(p * m->appels + 0.999999), cumul = 0;
+    for (int c = 0; c < DIAG_CLASSES; c++) {
+        cumul += m->classes[c];
+        if (cumul >= rang && cumul > 0) return (1L << c) / 1e3;
+    }
+    return m->max_ms;
+}
+
+int comparerDiagRequetes(const void *a, const void *b) {
+    const DiagRequete *x = *(DiagRequete *const*)a, *y = *(DiagRequete *const*)b;
+    return (x->mesure.total_ms < y->mesure.total_ms) - (x->mesure.total_ms > y->mesure.total_ms);
+}
+
+// Cache de pages SQLite de chaque connexion suivie, relevé hors de diag.mutex.
+int diagCachesSQLite(DiagTaux *out) {
+    sqlite3 *connexions[DIAG_CONNEXIONS_MAX];
+    pthread_mutex_lock(&diag.branchement);
+    pthread_mutex_lock(&diag.mutex);
+    int n = diag.nb_connexions;
+    memcpy(connexions, diag.connexions, sizeof(sqlite3*) * n);
+    pthread_mutex_unlock(&diag.mutex);
+    for (int i = 0; i < n; i++) {
+        int courant, max;
+        sqlite3_db_status(connexions[i], SQLITE_DBSTATUS_CACHE_HIT, &courant, &max, 0);
+        out[i].succes = courant;
+        sqlite3_db_status(connexions[i], SQLITE_DBSTATUS_CACHE_MISS, &courant, &max, 0);
+        out[i].echecs = courant;
+    }
+    pthread_mutex_unlock(&diag.branchement);
+    return n;
+}
+
+// Requêtes suivies, par temps total décroissant (mutex tenu).
+int diagRequetesTriees(DiagRequete **out) {
+    int n = 0;
+    for (int i = 0; i < DIAG_REQUETES_MAX * 2; i++) {
+        if (diag.requetes[i].sql) out[n++] = &diag.requetes[i];
+    }
+    qsort(out, n, sizeof(DiagRequete*), comparerDiagRequetes);
+    return n;
+}
+
+void diagDate(time_t t, char *out, size_t taille) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(out, taille, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+void diagLigneMesure(Sortie *s, const char *nom, const DiagMesure *m) {
+    sortiePrintf(s, "  %-24s %8ld %9ld %10.1f %8.3f %8.3f %8.1f\n", nom, m->appels, m->lignes,
+                 m->total_ms, diagCentile(m, 0.50), diagCentile(m, 0.99), m->max_ms);
+}
+
+void diagRapportTexte(Sortie *s) {
+    DiagTaux sqlite_caches[DIAG_CONNEXIONS_MAX];
+    int nb_connexions = diagCachesSQLite(sqlite_caches);
+    DiagRequete *requetes[DIAG_REQUETES_MAX];
+    char date[32];
+    pthread_mutex_lock(&diag.mutex);
+    diagDate(diag.depuis, date, sizeof(date));
+    sortiePrintf(s, "Instrumentation %s depuis %s, requête lente au-delà de %.1f ms\n\n",
+                 diagActif() ? "active" : "en pause", diag.depuis ? date : "-",
+                 atomic_load(&diag.seuil_lent_us) / 1e3);
+    sortiePrintf(s, "FONCTIONS%-18s %8s %9s %10s %8s %8s %8s\n", "", "appels", "lignes", "total ms", "p50 ms", "p99 ms", "max ms");
+    for (int f = 0; f < DIAG_NB_FONCTIONS; f++) {
+        if (diag.fonctions[f].appels) diagLigneMesure(s, diag_fonctions[f], &diag.fonctions[f]);
+    }
+    int n = diagRequetesTriees(requetes);
+    sortiePrintf(s, "\nREQUÊTES (%d textes, par temps total)\n", n);
+    for (int i = 0; i < n; i++) {
+        const DiagRequete *r = requetes[i];
+        char debut[64];
+        snprintf(debut, sizeof(debut), "#%d", i + 1);
+        diagLigneMesure(s, debut, &r->mesure);
+        sortiePrintf(s, "      %s\n", r->sql);
+        if (r->balayages || r->tris) sortiePrintf(s, "      balayages %ld, tris %ld\n", r->balayages, r->tris);
+        if (r->plan) sortiePrintf(s, "      plan : %s\n", r->plan);
+    }
+    if (diag.autres.appels) diagLigneMesure(s, "(autres)", &diag.autres);
+    sortieTexte(s, "\nCACHES\n");
+    for (int c = 0; c < DIAG_NB_CACHES; c++) {
+        long succes = atomic_load(&diag.caches[c][0]), echecs = atomic_load(&diag.caches[c][1]);
+        sortiePrintf(s, "  %-24s succès %9ld, échecs %9ld (%.1f %%)\n", diag_caches[c], succes, echecs,
+                     succes + echecs ? 100.0 * succes / (succes + echecs) : 0.0);
+    }
+    for (int i = 0; i < nb_connexions; i++) {
+        long total = sqlite_caches[i].succes + sqlite_caches[i].echecs;
+        sortiePrintf(s, "  pages SQLite, connexion %-2d succès %9ld, échecs %9ld (%.1f %%)\n", i + 1,
+                     sqlite_caches[i].succes, sqlite_caches[i].echecs,
+                     total ? 100.0 * sqlite_caches[i].succes / total : 0.0);
+    }
+    sortiePrintf(s, "\nREQUÊTES LENTES (%ld au total, %d dernières)\n", diag.nb_lentes,
+                 diag.nb_lentes < DIAG_LENTES_MAX ? (int)diag.nb_lentes : DIAG_LENTES_MAX);
+    for (long i = diag.nb_lentes - 1; i >= 0 && i >= diag.nb_lentes - DIAG_LENTES_MAX; i--) {
+        const DiagLente *l = &diag.lentes[i % DIAG_LENTES_MAX];
+        diagDate(l->quand, date, sizeof(date));
+        sortiePrintf(s, "  %s %9.1f ms  %s\n      plan : %s\n", date, l->duree_ms, l->sql, l->plan);
+    }
+    pthread_mutex_unlock(&diag.mutex);
+}
+
+void diagMesureJSON(Sortie *s, const DiagMesure *m) {
+    sortiePrintf(s, "\"appels\":%ld,\"lignes\":%ld,\"total_ms\":%.3f,\"max_ms\":%.3f,\"p50_ms\":%.3f,\"p95_ms\":%.3f,"
+                    "\"p99_ms\":%.3f,\"classes_us\":[", m->appels, m->lignes, m->total_ms, m->max_ms,
+                 diagCentile(m, 0.50), diagCentile(m, 0.95), diagCentile(m, 0.99));
+    for (int c = 0; c < DIAG_CLASSES; c++) sortiePrintf(s, "%s%ld", c ? "," : "", m->classes[c]);
+    sortieTexte(s, "]");
+}
+
+void diagRapportJSON(Sortie *s) {
+    DiagTaux sqlite_caches[DIAG_CONNEXIONS_MAX];
+    int nb_connexions = diagCachesSQLite(sqlite_caches);
+    DiagRequete *requetes[DIAG_REQUETES_MAX];
+    char date[32];
+    pthread_mutex_lock(&diag.mutex);
+    diagDate(diag.depuis, date, sizeof(date));
+    sortiePrintf(s, "{\n  \"depuis\": \"%s\",\n  \"actif\": %s,\n  \"seuil_lent_ms\": %.1f,\n  \"fonctions\": [",
+                 diag.depuis ? date : "", diagActif() ? "true" : "false", atomic_load(&diag.seuil_lent_us) / 1e3);
+    bool premier = true;
+    for (int f = 0; f < DIAG_NB_FONCTIONS; f++) {
+        if (!diag.fonctions[f].appels) continue;
+        sortiePrintf(s, "%s\n    {\"nom\":\"%s\",", premier ? "" : ",", diag_fonctions[f]);
+        diagMesureJSON(s, &diag.fonctions[f]);
+        sortieTexte(s, "}");
+        premier = false;
+    }
+    sortieTexte(s, "\n  ],\n  \"requetes\": [");
+    int n = diagRequetesTriees(requetes);
+    for (int i = 0; i < n; i++) {
+        const DiagRequete *r = requetes[i];
+        sortieTexte(s, i ? ",\n    {\"sql\":" : "\n    {\"sql\":");
+        jsonChaine(s, r->sql);
+        sortieTexte(s, ",");
+        diagMesureJSON(s, &r->mesure);
+        sortiePrintf(s, ",\"balayages\":%ld,\"tris\":%ld,\"plan\":", r->balayages, r->tris);
+        if (r->plan) jsonChaine(s, r->plan);
+        else sortieTexte(s, "null");
+        sortieTexte(s, "}");
+    }
+    sortieTexte(s, "\n  ],\n  \"autres\": {");
+    diagMesureJSON(s, &diag.autres);
+    sortieTexte(s, "},\n  \"caches\": [");
+    for (int c = 0; c < DIAG_NB_CACHES; c++) {
+        sortiePrintf(s, "%s\n    {\"nom\":\"%s\",\"succes\":%ld,\"echecs\":%ld}", c ? "," : "", diag_caches[c],
+                     atomic_load(&diag.caches[c][0]), atomic_load(&diag.caches[c][1]));
+    }
+    for (int i = 0; i < nb_connexions; i++) {
+        sortiePrintf(s, ",\n    {\"nom\":\"pages SQLite %d\",\"succes\":%ld,\"echecs\":%ld}", i + 1,
+                     sqlite_caches[i].succes, sqlite_caches[i].echecs);
+    }
+    sortieTexte(s, "\n  ],\n  \"lentes\": [");
+    for (long i = diag.nb_lentes - 1; i >= 0 && i >= diag.nb_lentes - DIAG_LENTES_MAX; i--) {
+        const DiagLente *l = &diag.lentes[i % DIAG_LENTES_MAX];
+        diagDate(l->quand, date, sizeof(date));
+        sortiePrintf(s, "%s\n    {\"quand\":\"%s\",\"duree_ms\":%.3f,\"sql\":", i == diag.nb_lentes - 1 ? "" : ",",
+                     date, l->duree_ms);
+        jsonChaine(s, l->sql);
+        sortieTexte(s, ",\"plan\":");
+        jsonChaine(s, l->plan);
+        sortieTexte(s, "}");
+    }
+    sortieTexte(s, "\n  ]\n}\n");
+    pthread_mutex_unlock(&diag.mutex);
+}
+
+bool diagExporter(const char *chemin) {
+    FILE *fp = fopen(chemin, "w");
+    if (!fp) {
+        journal(LOG_ERREUR, "Export des diagnostics impossible", "fichier=\"%s\"", chemin);
+        return false;
+    }
+    Sortie s = { fp, NULL, 0, 0, false };
+    diagRapportJSON(&s);
+    return fclose(fp) == 0 && !s.erreur;
+}
+
+// Rend toutes les lignes de `stmt` ; renvoie le nombre de lignes, ou -1 si
+// la requête ou l'écriture échoue.
+long rendreEleves(sqlite3_stmt *stmt, const FormatRendu *f, Sortie *s) {
+    long n = 0;
+    int rc;
+    LigneEleve l;
+    if (f->entete) f->entete(s);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        lireLigneEleve(stmt, &l);
+        f->ligne(s, &l);
+        n++;
+    }
+    if (f->pied) f->pied(s);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        return -1;
+    }
+    return s->erreur ? -1 : n;
+}
+
+// Rend les lignes d'un lot (par exemple lu dans le cache de résultats).
+long rendreLot(const LotEleves *lot, const FormatRendu *f, Sortie *s) {
+    if (f->entete) f->entete(s);
+    for (int i = 0; i < lot->n; i++) {
+        const EleveCompact *e = &lot->lignes[i];
+        LigneEleve l = { e->id, lotChaine(lot, e->nom), e->age, e->taille, lotChaine(lot, e->email),
+                         lotChaine(lot, e->telephone), lotChaine(lot, e->grade) };
+        f->ligne(s, &l);
+    }
+    if (f->pied) f->pied(s);
+    return s->erreur ? -1 : lot->n;
+}
+
+/*
+ * Partitions par année scolaire. La base courante reçoit toutes les
+ * écritures ; archiverAnnee() y prend les élèves sortis (dernière note ou
+ * présence dans l'année AAAA) et les déplace, avec leurs notes et présences,
+ * vers eleves-AAAA.db dans le même dossier. Les archives ne sont ouvertes
+ * qu'en lecture seule, au premier accès si `paresseux`. Les requêtes de
+ * l'année courante ne lisent que la base courante ; la recherche, l'export
+ * et la liste de toutes les années passent par une Fusion : un thread et une
+ * connexion par partition, flux fusionnés par clé croissante (id, ou rang
+ * FTS pour la recherche, calculé par partition).
+ */
+#define PARTITION_MAX 64
+#define PARTITION_FORMAT "eleves-%04d.db"
+#define PARTITION_LOTS_EN_VOL 4
+
+typedef struct {
+    char chemin[512];
+    int annee;                  // 0 : base courante
+    sqlite3 *db;                // archives : ouverte par le routeur, en lecture seule
+    sqlite3_int64 id_min;
+    sqlite3_int64 id_max;
+} Partition;
+
+typedef struct {
+    Partition parts[PARTITION_MAX];     // parts[0] : base courante
+    int n;
+    char dossier[256];
+} Partitions;
+
+Partitions partitions;
+
+int comparerPartitions(const void *a, const void *b) {
+    const Partition *x = a, *y = b;
+    return y->annee - x->annee;                 // plus récente d'abord
+}
+
+bool partitionOuvrirArchive(Partition *p) {
+    if (p->db) return true;
+    if (sqlite3_open_v2(p->chemin, &p->db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        journal(LOG_ERREUR, "Erreur d'ouverture de l'archive", "fichier=\"%s\" erreur=\"%s\"", p->chemin, sqlite3_errmsg(p->db));
+        sqlite3_close(p->db);
+        p->db = NULL;
+        return false;
+    }
+    diagSuivre(p->db);
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(p->db, "SELECT MIN(id), MAX(id) FROM eleves;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            p->id_min = sqlite3_column_int64(stmt, 0);
+            p->id_max = sqlite3_column_int64(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return true;
+}
+
+// Recense les archives du dossier ; la base courante est `courante`.
+bool partitionsOuvrir(sqlite3 *courante, const char *dossier, bool paresseux) {
+    memset(&partitions, 0, sizeof(partitions));
+    snprintf(partitions.dossier, sizeof(partitions.dossier), "%s", dossier);
+    const char *nom = sqlite3_db_filename(courante, "main");
+    snprintf(partitions.parts[0].chemin, sizeof(partitions.parts[0].chemin), "%s", nom ? nom : "");
+    partitions.parts[0].db = courante;
+    partitions.n = 1;
+    DIR *d = opendir(dossier);
+    if (!d) return true;
+    struct dirent *ent;
+    while ((ent = readdir(d)) && partitions.n < PARTITION_MAX) {
+        int annee, fin = 0;
+        char attendu[64];
+        if (sscanf(ent->d_name, "eleves-%d.db%n", &annee, &fin) != 1 || ent->d_name[fin] != '\0') continue;
+        snprintf(attendu, sizeof(attendu), PARTITION_FORMAT, annee);
+        if (strcmp(attendu, ent->d_name) != 0) continue;
+        Partition *p = &partitions.parts[partitions.n++];
+        snprintf(p->chemin, sizeof(p->chemin), "%s/%s", dossier, ent->d_name);
+        p->annee = annee;
+    }
+    closedir(d);
+    qsort(partitions.parts + 1, partitions.n - 1, sizeof(Partition), comparerPartitions);
+    for (int i = 1; !paresseux && i < partitions.n; i++) partitionOuvrirArchive(&partitions.parts[i]);
+    cacheResultatsInvalider();
+    return true;
+}
+
+void partitionsFermer(void) {
+    for (int i = 1; i < partitions.n; i++) {
+        diagOublier(partitions.parts[i].db);
+        sqlite3_close(partitions.parts[i].db);
+    }
+    partitions.n = 0;
+    cacheResultatsInvalider();
+}
+
+// Routeur : lit l'élève `id` dans l'archive qui le contient. Renvoie l'année
+// de l'archive (0 si l'élève n'est dans aucune) ; `lot` peut être NULL.
+int partitionLireEleve(int id, LotEleves *lot) {
+    for (int i = 1; i < partitions.n; i++) {
+        Partition *p = &partitions.parts[i];
+        if (!partitionOuvrirArchive(p) || id < p->id_min || id > p->id_max) continue;
+        sqlite3_stmt *stmt = obtenirRequete(p->db, STMT_ELEVE_PAR_ID);
+        if (!stmt) continue;
+        sqlite3_bind_int(stmt, 1, id);
+        bool trouve = sqlite3_step(stmt) == SQLITE_ROW && (!lot || lotAjouterLigne(lot, stmt));
+        libererRequete(stmt);
+        if (trouve) return p->annee;
+    }
+    return 0;
+}
+
+// Tableau JSON des ids pour STMT_ELEVES_PAR_IDS ; `out` doit pouvoir
+// contenir 12 octets par id.
+void idsJSON(const int *ids, int n, char *out) {
+    char *p = out;
+    *p++ = '[';
+    for (int i = 0; i < n; i++) p += sprintf(p, i ? ",%d" : "%d", ids[i]);
+    *p++ = ']';
+    *p = '\0';
+}
+
+int lotIndiceId(const LotEleves *lot, int id) {
+    for (int i = 0; i < lot->n; i++) {
+        if (lot->lignes[i].id == id) return i;
+    }
+    return -1;
+}
+
+bool lireElevesParIdsDans(sqlite3 *bdd, const char *json, LotEleves *lot) {
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_ELEVES_PAR_IDS);
+    if (!stmt) return false;
+    sqlite3_bind_text(stmt, 1, json, -1, SQLITE_STATIC);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && lotAjouterLigne(lot, stmt)) {
+    }
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) log_error(sqlite3_errmsg(bdd));
+    libererRequete(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Ajoute à `lot` les élèves `ids` (au plus MODELE_TAILLE_PAGE), par ordre
+// d'id : une requête sur `bdd`, puis une par archive pour ceux qui n'y sont
+// pas. Les ids introuvables (supprimés) sont omis.
+bool lireElevesParIds(sqlite3 *bdd, const int *ids, int n, LotEleves *lot) {
+    char json[12 * MODELE_TAILLE_PAGE + 3];
+    int manquants[MODELE_TAILLE_PAGE];
+    if (n > MODELE_TAILLE_PAGE) n = MODELE_TAILLE_PAGE;
+    int debut = lot->n;
+    idsJSON(ids, n, json);
+    if (!lireElevesParIdsDans(bdd, json, lot)) return false;
+    for (int i = 1; i < partitions.n && lot->n - debut < n; i++) {
+        Partition *p = &partitions.parts[i];
+        if (!partitionOuvrirArchive(p)) continue;
+        int nb = 0;
+        for (int k = 0; k < n; k++) {
+            if (ids[k] < p->id_min || ids[k] > p->id_max) continue;
+            bool lu = false;
+            for (int j = debut; j < lot->n && !lu; j++) lu = lot->lignes[j].id == ids[k];
+            if (!lu) manquants[nb++] = ids[k];
+        }
+        if (nb == 0) continue;
+        idsJSON(manquants, nb, json);
+        if (!lireElevesParIdsDans(p->db, json, lot)) return false;
+    }
+    return true;
+}
+
+// Déplace vers eleves-AAAA.db les élèves dont la dernière note ou présence
+// est dans l'année scolaire `annee` (qui doit être terminée).
+bool archiverAnnee(sqlite3 *db, int annee, long *deplaces) {
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    int courante = tm.tm_mon + 1 >= 9 ? tm.tm_year + 1900 : tm.tm_year + 1899;
+    if (annee >= courante || partitions.n == 0 || partitions.n == PARTITION_MAX) {
+        log_error("Erreur: seule une année scolaire terminée peut être archivée.");
+        return false;
+    }
+    char chemin[512];
+    snprintf(chemin, sizeof(chemin), "%s/" PARTITION_FORMAT, partitions.dossier, annee);
+    sqlite3 *archive;
+    bool ok = sqlite3_open(chemin, &archive) == SQLITE_OK && creerSchema(archive);
+    sqlite3_close(archive);
+    if (!ok) return false;
+
+    char *sql = sqlite3_mprintf(
+        "ATTACH %Q AS archive;"
+        "CREATE TEMP TABLE archivage (id INTEGER PRIMARY KEY);"
+        "BEGIN IMMEDIATE;"
+        "INSERT INTO temp.archivage SELECT eleve_id FROM "
+            "(SELECT eleve_id, date FROM main.notes UNION ALL SELECT eleve_id, date FROM main.presences) "
+            "WHERE eleve_id IN (SELECT id FROM main.eleves) "
+            "GROUP BY eleve_id HAVING MAX(date) >= '%04d-09-01' AND MAX(date) < '%04d-09-01';"
+        // les triggers de l'archive tiennent son index plein texte et ses agrégats
+        "INSERT INTO archive.eleves SELECT * FROM main.eleves WHERE id IN temp.archivage;"
+        "INSERT INTO archive.notes SELECT * FROM main.notes WHERE eleve_id IN temp.archivage;"
+        "INSERT INTO archive.presences SELECT * FROM main.presences WHERE eleve_id IN temp.archivage;"
+        "INSERT OR REPLACE INTO archive.presences_bitmaps SELECT * FROM main.presences_bitmaps WHERE eleve_id IN temp.archivage;"
+        "DELETE FROM main.presences_bitmaps WHERE eleve_id IN temp.archivage;"
+        "DELETE FROM main.presences WHERE eleve_id IN temp.archivage;"
+        "DELETE FROM main.notes WHERE eleve_id IN temp.archivage;"
+        "DELETE FROM main.eleves WHERE id IN temp.archivage;",
+        chemin, annee, annee + 1);
+    char *errMsg = NULL;
+    ok = sql && sqlite3_exec(db, sql, 0, 0, &errMsg) == SQLITE_OK;
+    *deplaces = ok ? sqlite3_changes(db) : 0;
+    ok = ok && sqlite3_exec(db, "COMMIT;", 0, 0, &errMsg) == SQLITE_OK;
+    if (!ok) {
+        journal(LOG_ERREUR, "Erreur d'archivage", "annee=%d erreur=\"%s\"", annee, errMsg ? errMsg : sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    }
+    sqlite3_free(errMsg);
+    sqlite3_free(sql);
+    sqlite3_exec(db, "DROP TABLE IF EXISTS temp.archivage; DETACH archive;", 0, 0, NULL);
+    if (!ok) return false;
+    if (colonnes) {
+        colonnesLiberer(colonnes);
+        colonnes = colonnesConstruire(db);
+    }
+    trigrammesRecharger(trigrammes);
+    bool connue = false;
+    for (int i = 1; i < partitions.n; i++) {
+        if (partitions.parts[i].annee != annee) continue;
+        connue = true;
+        diagOublier(partitions.parts[i].db);
+        sqlite3_close(partitions.parts[i].db);      // plages d'ids à relire
+        partitions.parts[i].db = NULL;
+    }
+    if (!connue) {
+        Partition *p = &partitions.parts[partitions.n++];
+        memset(p, 0, sizeof(*p));
+        snprintf(p->chemin, sizeof(p->chemin), "%s", chemin);
+        p->annee = annee;
+        qsort(partitions.parts + 1, partitions.n - 1, sizeof(Partition), comparerPartitions);
+    }
+    cacheResultatsInvalider();
+    journal(LOG_INFO, "Année archivée", "annee=%d eleves=%ld fichier=\"%s\"", annee, *deplaces, chemin);
+    auditer("archivage annee=%d eleves=%ld", annee, *deplaces);
+    return true;
+}
+
+// Lot lu par un thread de partition, avec la clé de fusion de chaque ligne.
+typedef struct {
+    LotEleves lot;
+    double cle[EXEC_LOT_LIGNES];
+} LotPartition;
+
+typedef struct {
+    char chemin[512];
+    StmtId requete;             // dernière colonne : clé de fusion
+    const char *expr;           // paramètre de recherche, NULL sinon
+    int limite;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    LotPartition *file[PARTITION_LOTS_EN_VOL];
+    int nb;
+    bool fini;
+    bool ok;
+    bool arret;
+    LotPartition *courant;      // côté consommateur
+    int pos;
+} FluxPartition;
+
+typedef struct {
+    FluxPartition flux[PARTITION_MAX];
+    int n;
+} Fusion;
+
+void fluxPousser(FluxPartition *f, LotPartition *lp) {
+    pthread_mutex_lock(&f->mutex);
+    while (f->nb == PARTITION_LOTS_EN_VOL && !f->arret) pthread_cond_wait(&f->cond, &f->mutex);
+    if (f->arret) {
+        lotLiberer(&lp->lot);
+        free(lp);
+    } else {
+        f->file[f->nb++] = lp;
+        pthread_cond_broadcast(&f->cond);
+    }
+    pthread_mutex_unlock(&f->mutex);
+}
+
+void *partition_thread(void *arg) {
+    FluxPartition *f = arg;
+    sqlite3 *bdd = NULL;
+    sqlite3_stmt *stmt = NULL;
+    int rc = SQLITE_ERROR;
+    if (sqlite3_open_v2(f->chemin, &bdd, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+        (stmt = obtenirRequete(bdd, f->requete))) {
+        configurerAttente(bdd);
+        diagSuivre(bdd);
+        if (f->expr) {
+            sqlite3_bind_text(stmt, 1, f->expr, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, f->limite);
+        }
+        int cle = sqlite3_column_count(stmt) - 1;
+        LotPartition *lp = NULL;
+        while (!f->arret && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (!lp && !(lp = calloc(1, sizeof(LotPartition)))) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            lp->cle[lp->lot.n] = sqlite3_column_double(stmt, cle);
+            if (!lotAjouterLigne(&lp->lot, stmt)) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            if (lp->lot.n == EXEC_LOT_LIGNES) {
+                fluxPousser(f, lp);
+                lp = NULL;
+            }
+        }
+        if (lp && lp->lot.n > 0 && rc == SQLITE_DONE) {
+            fluxPousser(f, lp);
+        } else if (lp) {
+            lotLiberer(&lp->lot);
+            free(lp);
+        }
+    }
+    if (rc != SQLITE_DONE && !f->arret) {
+        journal(LOG_ERREUR, "Erreur de lecture de partition", "fichier=\"%s\" erreur=\"%s\"", f->chemin, sqlite3_errmsg(bdd));
+    }
+    libererRequete(stmt);
+    diagOublier(bdd);
+    sqlite3_close(bdd);
+    pthread_mutex_lock(&f->mutex);
+    f->fini = true;
+    f->ok = rc == SQLITE_DONE;
+    pthread_cond_broadcast(&f->cond);
+    pthread_mutex_unlock(&f->mutex);
+    return NULL;
+}
+
+// Lance un thread par partition sur la requête `requete` (ordonnée par sa
+// dernière colonne) ; `expr` et `limite` sont liés en ?1 et ?2 si expr.
+Fusion *fusionOuvrir(StmtId requete, const char *expr, int limite) {
+    Fusion *fu = calloc(1, sizeof(Fusion));
+    if (!fu) return NULL;
+    for (int i = 0; i < partitions.n; i++) {
+        FluxPartition *f = &fu->flux[fu->n];
+        snprintf(f->chemin, sizeof(f->chemin), "%s", partitions.parts[i].chemin);
+        f->requete = requete;
+        f->expr = expr;
+        f->limite = limite;
+        pthread_mutex_init(&f->mutex, NULL);
+        pthread_cond_init(&f->cond, NULL);
+        if (pthread_create(&f->thread, NULL, partition_thread, f) != 0) {
+            pthread_mutex_destroy(&f->mutex);
+            pthread_cond_destroy(&f->cond);
+            break;
+        }
+        fu->n++;
+    }
+    return fu;
+}
+
+// Ligne suivante dans l'ordre des clés : (*lot, *i) reste valide jusqu'à
+// l'appel suivant. false à la fin de tous les flux.
+bool fusionSuivante(Fusion *fu, const LotEleves **lot, int *i) {
+    FluxPartition *min = NULL;
+    for (int k = 0; k < fu->n; k++) {
+        FluxPartition *f = &fu->flux[k];
+        if (f->courant && f->pos == f->courant->lot.n) {
+            lotLiberer(&f->courant->lot);
+            free(f->courant);
+            f->courant = NULL;
+        }
+        if (!f->courant) {
+            pthread_mutex_lock(&f->mutex);
+            while (f->nb == 0 && !f->fini) pthread_cond_wait(&f->cond, &f->mutex);
+            if (f->nb > 0) {
+                f->courant = f->file[0];
+                memmove(f->file, f->file + 1, sizeof(f->file[0]) * --f->nb);
+                f->pos = 0;
+                pthread_cond_broadcast(&f->cond);
+            }
+            pthread_mutex_unlock(&f->mutex);
+        }
+        if (f->courant && (!min || f->courant->cle[f->pos] < min->courant->cle[min->pos])) min = f;
+    }
+    if (!min) return false;
+    *lot = &min->courant->lot;
+    *i = min->pos++;
+    return true;
+}
+
+// Arrête les threads (fin anticipée possible) ; true si chaque partition a
+// été lue jusqu'au bout.
+bool fusionFermer(Fusion *fu) {
+    bool ok = true;
+    for (int k = 0; k < fu->n; k++) {
+        FluxPartition *f = &fu->flux[k];
+        pthread_mutex_lock(&f->mutex);
+        f->arret = !f->fini;
+        ok = ok && !f->arret;
+        pthread_cond_broadcast(&f->cond);
+        pthread_mutex_unlock(&f->mutex);
+        pthread_join(f->thread, NULL);
+        ok = ok && f->ok;
+        for (int j = 0; j < f->nb; j++) {
+            lotLiberer(&f->file[j]->lot);
+            free(f->file[j]);
+        }
+        if (f->courant) {
+            lotLiberer(&f->courant->lot);
+            free(f->courant);
+        }
+        pthread_mutex_destroy(&f->mutex);
+        pthread_cond_destroy(&f->cond);
+    }
+    free(fu);
+    return ok;
+}
+
+// Export de toutes les partitions, fusionnées par id.
+long rendreElevesPartitions(const FormatRendu *f, Sortie *s) {
+    Fusion *fu = fusionOuvrir(STMT_LISTE_PARTITION, NULL, 0);
+    if (!fu) return -1;
+    long n = 0;
+    const LotEleves *lot;
+    int i;
+    if (f->entete) f->entete(s);
+    while (fusionSuivante(fu, &lot, &i)) {
+        const EleveCompact *e = &lot->lignes[i];
+        LigneEleve l = { e->id, lotChaine(lot, e->nom), e->age, e->taille,
+                         lotChaine(lot, e->email), lotChaine(lot, e->telephone), lotChaine(lot, e->grade) };
+        f->ligne(s, &l);
+        n++;
+    }
+    if (f->pied) f->pied(s);
+    bool ok = fusionFermer(fu);
+    return ok && !s->erreur ? n : -1;
+}
+
+// Écrit tous les élèves dans `chemin` au format donné.
+bool exporterEleves(sqlite3 *db, const char *chemin, const FormatRendu *f) {
+    double t0 = diagDebut();
+    FILE *file = fopen(chemin, "w");
+    if (!file) {
+        log_error("Erreur: Impossible d'ouvrir le fichier d'export pour écriture.");
+        return false;
+    }
+    Sortie s = { file, NULL, 0, 0, false };
+    long n = -1;
+    if (partitions.n > 1) {
+        n = rendreElevesPartitions(f, &s);      // archives comprises, par id
+    } else {
+        sqlite3_stmt *stmt = obtenirRequete(db, STMT_SELECT_ELEVES);
+        if (stmt) n = rendreEleves(stmt, f, &s);
+        libererRequete(stmt);
+    }
+    if (fclose(file) != 0) n = -1;
+    diagFin(DIAG_EXPORTER, t0, n > 0 ? n : 0);
+    return n >= 0;
+}
+
+char* listerElevesStr(sqlite3 *db) {
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_SELECT_ELEVES);
+    if (!stmt) return NULL;
+    Sortie s = { NULL, NULL, 0, 0, false };
+    long n = rendreEleves(stmt, &format_table, &s);
+    libererRequete(stmt);
+    if (n < 0) {
+        free(s.buf);
+        return NULL;
+    }
+    return s.buf;
+}
+
+typedef enum { MODIF_OK, MODIF_ABSENT, MODIF_CONFLIT, MODIF_ERREUR } ResultatModif;
+
+// Modifie l'élève `id` s'il est encore à la version e->version (lue avec
+// lui), ou sans condition si elle vaut 0 ; sa version est alors incrémentée.
+ResultatModif modifierEleveVersion(sqlite3 *db, int id, const Personne *e) {
+    // Une seule requête : absence ou conflit se lisent dans sqlite3_changes()
+    double t0 = diagDebut();
+    bool ouverte;
+    if (!ecritureDebut(db, &ouverte)) return MODIF_ERREUR;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_UPDATE_ELEVE);
+    if (!stmt) {
+        ecritureFin(db, ouverte, false);
+        return MODIF_ERREUR;
+    }
+    sqlite3_bind_text(stmt, 1, e->nom, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, e->age);
+    sqlite3_bind_double(stmt, 3, e->taille);
+    sqlite3_bind_text(stmt, 4, e->email, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, e->telephone, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, e->grade, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 7, id);
+    sqlite3_bind_int(stmt, 8, e->version);
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) log_error(sqlite3_errmsg(db));
+    libererRequete(stmt);
+    int modifies = rc == SQLITE_DONE ? sqlite3_changes(db) : 0;
+    ResultatModif res = rc != SQLITE_DONE ? MODIF_ERREUR : modifies ? MODIF_OK : MODIF_ABSENT;
+    int actuelle = 0;
+    if (res == MODIF_ABSENT && e->version != 0 && (stmt = obtenirRequete(db, STMT_VERSION_ELEVE))) {
+        // dans la même transaction : l'élève existe-t-il à une autre version ?
+        sqlite3_bind_int(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            actuelle = sqlite3_column_int(stmt, 0);
+            res = MODIF_CONFLIT;
+        }
+        libererRequete(stmt);
+    }
+    if (!ecritureFin(db, ouverte, res == MODIF_OK) && res == MODIF_OK) res = MODIF_ERREUR;
+    diagFin(DIAG_MODIFIER, t0, res == MODIF_OK ? modifies : 0);
+    if (res == MODIF_CONFLIT) {
+        journal(LOG_INFO, "Modification concurrente refusée", "eleve=%d version_lue=%d version=%d", id, e->version, actuelle);
+    }
+    if (res != MODIF_OK) return res;
+    colonnesEcrire(db, id, e->age, e->taille, e->grade);
+    trigrammesEcrire(db, id, e->nom, e->email);
+    auditer("modification eleve=%d", id);
+    return MODIF_OK;
+}
+
+bool modifierEleve(sqlite3 *db, int id, const Personne *e) {
+    return modifierEleveVersion(db, id, e) == MODIF_OK;
+}
+
+bool supprimerEleve(sqlite3 *db, int id) {
+    double t0 = diagDebut();
+    bool ouverte;
+    if (!ecritureDebut(db, &ouverte)) return false;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_DELETE_ELEVE);
+    if (!stmt) return ecritureFin(db, ouverte, false);
+    sqlite3_bind_int(stmt, 1, id);
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) log_error(sqlite3_errmsg(db));
+    libererRequete(stmt);
+    int supprimes = rc == SQLITE_DONE ? sqlite3_changes(db) : 0;
+    bool ok = ecritureFin(db, ouverte, supprimes > 0);
+    diagFin(DIAG_SUPPRIMER, t0, ok ? supprimes : 0);
+    if (!ok) return false;
+    colonnesSupprimer(db, id);
+    trigrammesSupprimer(db, id);
+    auditer("suppression eleve=%d", id);
+    return true;
+}
+
+bool exporterCSV(sqlite3 *db) {
+    if (!exporterEleves(db, CSV_FILENAME, &format_csv)) return false;
+    auditer("export fichier=%s", CSV_FILENAME);
+    return true;
+}
+
+/*
+ * Export parallèle de toutes les tables, pour les analyses en aval. Chaque
+ * table de chaque partition est découpée en tranches de clés (rowid, ou
+ * première colonne de la clé primaire d'une table WITHOUT ROWID) ; des
+ * travailleurs, chacun avec ses propres connexions en lecture seule, lisent,
+ * encodent puis compressent les tranches dans le désordre, et le thread
+ * appelant les écrit dans l'ordre. Un fichier par table : <table>.<format>,
+ * ou <table>-AAAA.<format> pour une archive. Une tranche compressée est un
+ * membre gzip (une trame zstd) complet : le fichier, concaténation des
+ * tranches, se décompresse d'un bloc avec les outils habituels.
+ *
+ * Cohérence : l'appelant tient le verrou d'écriture de la base courante
+ * (BEGIN IMMEDIATE) le temps que chaque travailleur ouvre sa transaction de
+ * lecture ; toutes les tranches voient donc le même état. La table users
+ * (empreintes des mots de passe) n'est jamais exportée.
+ *
+ * Format « colonnes » (.col), entiers en petit-boutiste :
+ *   en-tête  "CPCOL1\n\0", u32 nb_colonnes, puis par colonne u16 longueur + nom ;
+ *   blocs    u32 octets du bloc (hors ce champ), u32 lignes, puis par colonne
+ *            u8 type[lignes] (0 NULL, 1 entier, 2 réel, 3 texte, 4 blob),
+ *            u32 octets, et les valeurs non NULL : i64, f64, ou u32 + octets.
+ */
+#define EXPORT_TRANCHE_CLES 16384
+#define EXPORT_TRANCHES_PAR_TABLE 4096      // borne pour les clés très clairsemées
+#define EXPORT_TRAVAILLEURS_MAX 32
+#define EXPORT_EN_VOL_PAR_TRAVAILLEUR 2     // tranches encodées en attente d'écriture
+#define EXPORT_COLONNES_MAX 64
+#define EXPORT_NIVEAU_GZIP 1
+#define EXPORT_NIVEAU_ZSTD 3
+#define EXPORT_TABLES_EXCLUES "'users', 'parametres', 'sessions'"
+
+typedef enum { EXPORT_CSV, EXPORT_JSONL, EXPORT_COLONNES, EXPORT_NB_FORMATS } FormatExport;
+typedef enum { COMPRESSION_AUCUNE, COMPRESSION_GZIP, COMPRESSION_ZSTD, EXPORT_NB_COMPRESSIONS } CompressionExport;
+
+const char *format_export_noms[EXPORT_NB_FORMATS] = { "csv", "jsonl", "colonnes" };
+const char *format_export_extensions[EXPORT_NB_FORMATS] = { "csv", "jsonl", "col" };
+const char *compression_extensions[EXPORT_NB_COMPRESSIONS] = { "", ".gz", ".zst" };
+
+typedef struct {
+    FormatExport format;
+    CompressionExport compression;
+    int travailleurs;                   // 0 : un par processeur
+    bool (*annule)(void *data);         // consulté entre deux tranches
+    void *data;
+} OptionsExport;
+
+typedef struct {
+    int fichiers;
+    long lignes;
+    size_t octets_encodes;              // avant compression
+    size_t octets_ecrits;
+    int travailleurs;
+    double secondes;
+} BilanExport;
+
+typedef enum { TRANCHE_A_FAIRE, TRANCHE_PRETE, TRANCHE_ERREUR } EtatTranche;
+
+typedef struct {
+    int source;                         // indice dans ExportParallele.sources
+    char table[64];
+    char cle[72];                       // expression SQL de découpage ; vide : table lue d'un bloc
+    sqlite3_int64 debut;
+    sqlite3_int64 fin;
+    bool premiere;                      // ouvre le fichier de la table (avec l'en-tête)
+    bool derniere;                      // le ferme
+    EtatTranche etat;
+    Sortie sortie;
+    long lignes;
+    size_t octets_encodes;
+} TrancheExport;
+
+typedef struct {
+    char chemin[512];
+    int annee;                          // 0 : base courante
+} SourceExport;
+
+typedef struct {
+    const OptionsExport *options;
+    SourceExport sources[PARTITION_MAX];
+    int nb_sources;
+    TrancheExport *tranches;
+    int nb;
+    int cap;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int suivante;                       // prochaine tranche à prendre
+    int ecrites;                        // tranches déjà écrites
+    int fenetre;                        // avance maximale des travailleurs sur l'écriture
+    int prets;                          // travailleurs dont la lecture est ouverte
+    bool arret;
+} ExportParallele;
+
+// Analyse "csv", "jsonl" ou "colonnes", suivi de ".gz" ou ".zst".
+bool lireFormatExport(const char *nom, OptionsExport *o) {
+    for (int f = 0; f < EXPORT_NB_FORMATS; f++) {
+        size_t n = strlen(format_export_noms[f]);
+        if (strncmp(nom, format_export_noms[f], n) != 0) continue;
+        for (int c = 0; c < EXPORT_NB_COMPRESSIONS; c++) {
+            if (strcmp(nom + n, compression_extensions[c]) != 0) continue;
+            o->format = f;
+            o->compression = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+void sortieU16(Sortie *s, uint16_t v) {
+    unsigned char b[2] = { v, v >> 8 };
+    sortieEcrire(s, (const char*)b, 2);
+}
+
+void sortieU32(Sortie *s, uint32_t v) {
+    unsigned char b[4] = { v, v >> 8, v >> 16, v >> 24 };
+    sortieEcrire(s, (const char*)b, 4);
+}
+
+void sortieU64(Sortie *s, uint64_t v) {
+    sortieU32(s, (uint32_t)v);
+    sortieU32(s, (uint32_t)(v >> 32));
+}
+
+void sortieHex(Sortie *s, const unsigned char *p, int n) {
+    static const char chiffres[] = "0123456789abcdef";
+    char tampon[256];
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        tampon[k++] = chiffres[p[i] >> 4];
+        tampon[k++] = chiffres[p[i] & 15];
+        if (k == sizeof(tampon)) {
+            sortieEcrire(s, tampon, k);
+            k = 0;
+        }
+    }
+    sortieEcrire(s, tampon, k);
+}
+
+// Valeurs : NULL vide (CSV) ou null (JSON), blobs en hexadécimal.
+void exportValeurCSV(Sortie *s, sqlite3_stmt *stmt, int i) {
+    switch (sqlite3_column_type(stmt, i)) {
+        case SQLITE_NULL: break;
+        case SQLITE_BLOB: sortieHex(s, sqlite3_column_blob(stmt, i), sqlite3_column_bytes(stmt, i)); break;
+        default:          csvChampSortie(s, (const char*)sqlite3_column_text(stmt, i)); break;
+    }
+}
+
+void exportValeurJSON(Sortie *s, sqlite3_stmt *stmt, int i) {
+    switch (sqlite3_column_type(stmt, i)) {
+        case SQLITE_NULL:
+            sortieTexte(s, "null");
+            break;
+        case SQLITE_INTEGER:
+            sortiePrintf(s, "%lld", (long long)sqlite3_column_int64(stmt, i));
+            break;
+        case SQLITE_FLOAT: {
+            double v = sqlite3_column_double(stmt, i);
+            if (isfinite(v)) sortieTexte(s, (const char*)sqlite3_column_text(stmt, i));
+            else sortieTexte(s, "null");
+            break;
+        }
+        case SQLITE_TEXT:
+            jsonChaine(s, (const char*)sqlite3_column_text(stmt, i));
+            break;
+        default:
+            sortieEcrire(s, "\"", 1);
+            sortieHex(s, sqlite3_column_blob(stmt, i), sqlite3_column_bytes(stmt, i));
+            sortieEcrire(s, "\"", 1);
+            break;
+    }
+}
+
+void exportEnteteCSV(Sortie *s, sqlite3_stmt *stmt) {
+    for (int i = 0; i < sqlite3_column_count(stmt); i++) {
+        if (i > 0) sortieEcrire(s, ",", 1);
+        csvChampSortie(s, sqlite3_column_name(stmt, i));
+    }
+    sortieEcrire(s, "\r\n", 2);
+}
+
+void exportEnteteColonnes(Sortie *s, sqlite3_stmt *stmt) {
+    sortieEcrire(s, "CPCOL1\n", 8);
+    sortieU32(s, sqlite3_column_count(stmt));
+    for (int i = 0; i < sqlite3_column_count(stmt); i++) {
+        const char *nom = sqlite3_column_name(stmt, i);
+        sortieU16(s, strlen(nom));
+        sortieTexte(s, nom);
+    }
+}
+
+// Lignes d'une tranche : renvoie leur nombre, -1 en cas d'erreur.
+long exportLignesCSV(sqlite3_stmt *stmt, Sortie *s) {
+    long n = 0;
+    int nb = sqlite3_column_count(stmt);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < nb; i++) {
+            if (i > 0) sortieEcrire(s, ",", 1);
+            exportValeurCSV(s, stmt, i);
+        }
+        sortieEcrire(s, "\r\n", 2);
+        n++;
+    }
+    return n;
+}
+
+long exportLignesJSON(sqlite3_stmt *stmt, Sortie *s) {
+    int nb = sqlite3_column_count(stmt);
+    Sortie cles = { NULL, NULL, 0, 0, false };     // "{"nom": puis ,"nom": bout à bout
+    size_t fins[EXPORT_COLONNES_MAX];
+    for (int i = 0; i < nb; i++) {
+        sortieEcrire(&cles, i == 0 ? "{" : ",", 1);
+        jsonChaine(&cles, sqlite3_column_name(stmt, i));
+        sortieEcrire(&cles, ":", 1);
+        fins[i] = cles.len;
+    }
+    long n = 0;
+    while (!cles.erreur && sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < nb; i++) {
+            size_t debut = i == 0 ? 0 : fins[i - 1];
+            sortieEcrire(s, cles.buf + debut, fins[i] - debut);
+            exportValeurJSON(s, stmt, i);
+        }
+        sortieEcrire(s, "}\n", 2);
+        n++;
+    }
+    if (cles.erreur) s->erreur = true;
+    free(cles.buf);
+    return n;
+}
+
+long exportLignesColonnes(sqlite3_stmt *stmt, Sortie *s) {
+    int nb = sqlite3_column_count(stmt);
+    Sortie types[EXPORT_COLONNES_MAX], valeurs[EXPORT_COLONNES_MAX];
+    memset(types, 0, sizeof(Sortie) * nb);
+    memset(valeurs, 0, sizeof(Sortie) * nb);
+    long n = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < nb; i++) {
+            int type = sqlite3_column_type(stmt, i);
+            char code = type == SQLITE_INTEGER ? 1 : type == SQLITE_FLOAT ? 2 : type == SQLITE_TEXT ? 3 : type == SQLITE_BLOB ? 4 : 0;
+            sortieEcrire(&types[i], &code, 1);
+            if (code == 1) {
+                sortieU64(&valeurs[i], (uint64_t)sqlite3_column_int64(stmt, i));
+            } else if (code == 2) {
+                double v = sqlite3_column_double(stmt, i);
+                uint64_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                sortieU64(&valeurs[i], bits);
+            } else if (code != 0) {
+                const void *p = code == 3 ? (const void*)sqlite3_column_text(stmt, i) : sqlite3_column_blob(stmt, i);
+                int octets = sqlite3_column_bytes(stmt, i);
+                sortieU32(&valeurs[i], octets);
+                sortieEcrire(&valeurs[i], p, octets);
+            }
+        }
+        n++;
+    }
+    if (n > 0) {
+        size_t taille = 4;
+        for (int i = 0; i < nb; i++) taille += types[i].len + 4 + valeurs[i].len;
+        sortieU32(s, taille);
+        sortieU32(s, n);
+        for (int i = 0; i < nb; i++) {
+            sortieEcrire(s, types[i].buf, types[i].len);
+            sortieU32(s, valeurs[i].len);
+            sortieEcrire(s, valeurs[i].buf, valeurs[i].len);
+        }
+    }
+    for (int i = 0; i < nb; i++) {
+        if (types[i].erreur || valeurs[i].erreur) s->erreur = true;
+        free(types[i].buf);
+        free(valeurs[i].buf);
+    }
+    return n;
+}
+
+// Compresse `src` en un membre gzip (ou une trame zstd) complet dans `dst`.
+bool exportCompresser(CompressionExport c, const Sortie *src, Sortie *dst) {
+    if (c == COMPRESSION_GZIP) {
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if (deflateInit2(&z, EXPORT_NIVEAU_GZIP, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+        size_t borne = deflateBound(&z, src->len);
+        dst->buf = malloc(borne);
+        dst->cap = borne;
+        z.next_in = (Bytef*)src->buf;
+        z.avail_in = src->len;
+        z.next_out = (Bytef*)dst->buf;
+        z.avail_out = borne;
+        int rc = dst->buf ? deflate(&z, Z_FINISH) : Z_MEM_ERROR;
+        dst->len = z.total_out;
+        deflateEnd(&z);
+        return rc == Z_STREAM_END;
+    }
+#ifdef CPRONOTE_ZSTD
+    if (c == COMPRESSION_ZSTD) {
+        size_t borne = ZSTD_compressBound(src->len);
+        if (!(dst->buf = malloc(borne))) return false;
+        dst->cap = borne;
+        size_t n = ZSTD_compress(dst->buf, borne, src->buf, src->len, EXPORT_NIVEAU_ZSTD);
+        if (ZSTD_isError(n)) return false;
+        dst->len = n;
+        return true;
+    }
+#endif
+    return false;
+}
+
+// Lit, encode et compresse une tranche sur la connexion `bdd` du travailleur.
+bool exportEncoderTranche(const OptionsExport *o, sqlite3 *bdd, TrancheExport *tr) {
+    char *sql = tr->cle[0]
+        ? sqlite3_mprintf("SELECT * FROM \"%w\" WHERE %s BETWEEN ?1 AND ?2 ORDER BY %s;", tr->table, tr->cle, tr->cle)
+        : sqlite3_mprintf("SELECT * FROM \"%w\";", tr->table);
+    sqlite3_stmt *stmt = NULL;
+    int rc = sql ? sqlite3_prepare_v2(bdd, sql, -1, &stmt, NULL) : SQLITE_NOMEM;
+    sqlite3_free(sql);
+    if (rc != SQLITE_OK || sqlite3_column_count(stmt) > EXPORT_COLONNES_MAX) {
+        journal(LOG_ERREUR, "Erreur d'export", "table=%s erreur=\"%s\"", tr->table,
+                rc == SQLITE_OK ? "trop de colonnes" : sqlite3_errmsg(bdd));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    if (tr->cle[0]) {
+        sqlite3_bind_int64(stmt, 1, tr->debut);
+        sqlite3_bind_int64(stmt, 2, tr->fin);
+    }
+    Sortie brute = { NULL, NULL, 0, 0, false };
+    if (tr->premiere && o->format == EXPORT_CSV) exportEnteteCSV(&brute, stmt);
+    if (tr->premiere && o->format == EXPORT_COLONNES) exportEnteteColonnes(&brute, stmt);
+    tr->lignes = o->format == EXPORT_CSV   ? exportLignesCSV(stmt, &brute)
+               : o->format == EXPORT_JSONL ? exportLignesJSON(stmt, &brute)
+                                           : exportLignesColonnes(stmt, &brute);
+    rc = sqlite3_reset(stmt);
+    if (rc != SQLITE_OK) {
+        journal(LOG_ERREUR, "Erreur d'export", "table=%s erreur=\"%s\"", tr->table, sqlite3_errmsg(bdd));
+    }
+    sqlite3_finalize(stmt);
+    bool ok = rc == SQLITE_OK && !brute.erreur;
+    tr->octets_encodes = brute.len;
+    if (!ok || o->compression == COMPRESSION_AUCUNE) {
+        tr->sortie = brute;
+        return ok;
+    }
+    ok = exportCompresser(o->compression, &brute, &tr->sortie);
+    free(brute.buf);
+    if (!ok) journal(LOG_ERREUR, "Erreur de compression", "table=%s", tr->table);
+    return ok;
+}
+
+TrancheExport *exportNouvelleTranche(ExportParallele *ex) {
+    if (ex->nb == ex->cap) {
+        int cap = ex->cap ? ex->cap * 2 : 64;
+        TrancheExport *t = realloc(ex->tranches, sizeof(TrancheExport) * cap);
+        if (!t) return NULL;
+        ex->tranches = t;
+        ex->cap = cap;
+    }
+    TrancheExport *tr = &ex->tranches[ex->nb++];
+    memset(tr, 0, sizeof(*tr));
+    return tr;
+}
+
+// Découpe en tranches les tables exportables de `bdd` (source `source`).
+bool exportPlanifier(ExportParallele *ex, sqlite3 *bdd, int source) {
+    sqlite3_stmt *tables, *cle;
+    if (sqlite3_prepare_v2(bdd, "SELECT name, wr FROM pragma_table_list "
+                                "WHERE schema = 'main' AND type = 'table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\' "
+                                "AND name NOT IN (" EXPORT_TABLES_EXCLUES ") ORDER BY name;", -1, &tables, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(bdd));
+        return false;
+    }
+    if (sqlite3_prepare_v2(bdd, "SELECT name FROM pragma_table_info(?1) WHERE pk = 1;", -1, &cle, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(bdd));
+        sqlite3_finalize(tables);
+        return false;
+    }
+    bool ok = true;
+    while (ok && sqlite3_step(tables) == SQLITE_ROW) {
+        const char *table = (const char*)sqlite3_column_text(tables, 0);
+        if (strlen(table) >= sizeof(((TrancheExport*)0)->table)) {
+            journal(LOG_AVERT, "Table non exportée", "table=%s raison=\"nom trop long\"", table);
+            continue;
+        }
+        char expr[sizeof(((TrancheExport*)0)->cle)] = "rowid";
+        if (sqlite3_column_int(tables, 1)) {            // WITHOUT ROWID
+            sqlite3_bind_text(cle, 1, table, -1, SQLITE_STATIC);
+            expr[0] = '\0';
+            if (sqlite3_step(cle) == SQLITE_ROW) {
+                sqlite3_snprintf(sizeof(expr), expr, "\"%w\"", (const char*)sqlite3_column_text(cle, 0));
+            }
+            sqlite3_reset(cle);
+        }
+        // bornes de la clé ; une clé non entière se lit d'un bloc
+        sqlite3_int64 min = 1, max = 0;
+        if (expr[0]) {
+            char *sql = sqlite3_mprintf("SELECT MIN(%s), MAX(%s), typeof(MIN(%s)) = 'integer' AND typeof(MAX(%s)) = 'integer' FROM \"%w\";",
+                                        expr, expr, expr, expr, table);
+            sqlite3_stmt *bornes = NULL;
+            ok = sql && sqlite3_prepare_v2(bdd, sql, -1, &bornes, NULL) == SQLITE_OK && sqlite3_step(bornes) == SQLITE_ROW;
+            if (ok && sqlite3_column_type(bornes, 0) != SQLITE_NULL) {
+                if (sqlite3_column_int(bornes, 2)) {
+                    min = sqlite3_column_int64(bornes, 0);
+                    max = sqlite3_column_int64(bornes, 1);
+                } else {
+                    expr[0] = '\0';
+                }
+            }
+            if (!ok) log_error(sqlite3_errmsg(bdd));
+            sqlite3_finalize(bornes);
+            sqlite3_free(sql);
+        }
+        // tranche vide d'une table vide : elle porte au moins l'en-tête
+        uint64_t etendue = max >= min ? (uint64_t)max - (uint64_t)min + 1 : 1;
+        uint64_t nb = (etendue + EXPORT_TRANCHE_CLES - 1) / EXPORT_TRANCHE_CLES;
+        if (nb > EXPORT_TRANCHES_PAR_TABLE) nb = EXPORT_TRANCHES_PAR_TABLE;
+        uint64_t pas = (etendue + nb - 1) / nb;
+        for (uint64_t k = 0; ok && k < nb; k++) {
+            TrancheExport *tr = exportNouvelleTranche(ex);
+            if (!(ok = tr != NULL)) break;
+            tr->source = source;
+            snprintf(tr->table, sizeof(tr->table), "%s", table);
+            snprintf(tr->cle, sizeof(tr->cle), "%s", expr);
+            tr->debut = (sqlite3_int64)((uint64_t)min + k * pas);
+            tr->fin = k + 1 == nb ? max : (sqlite3_int64)((uint64_t)tr->debut + pas - 1);
+            tr->premiere = k == 0;
+            tr->derniere = k + 1 == nb;
+        }
+    }
+    sqlite3_finalize(tables);
+    sqlite3_finalize(cle);
+    return ok;
+}
+
+typedef struct {
+    ExportParallele *ex;
+    pthread_t thread;
+    sqlite3 *bdd[PARTITION_MAX];        // une connexion par source, ouverte au besoin
+} TravailleurExport;
+
+// Connexion en lecture seule du travailleur sur la source `i`, transaction
+// de lecture ouverte (instantané pris à la première lecture).
+sqlite3 *exportConnexion(TravailleurExport *t, int i) {
+    if (t->bdd[i]) return t->bdd[i];
+    sqlite3 *bdd = NULL;
+    if (sqlite3_open_v2(t->ex->sources[i].chemin, &bdd, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        (configurerAttente(bdd),
+         sqlite3_exec(bdd, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", 0, 0, NULL) != SQLITE_OK)) {
+        journal(LOG_ERREUR, "Erreur d'ouverture pour l'export", "fichier=\"%s\" erreur=\"%s\"",
+                t->ex->sources[i].chemin, sqlite3_errmsg(bdd));
+        sqlite3_close(bdd);
+        return NULL;
+    }
+    diagSuivre(bdd);
+    return t->bdd[i] = bdd;
+}
+
+void *export_thread(void *arg) {
+    TravailleurExport *t = arg;
+    ExportParallele *ex = t->ex;
+    bool ok = exportConnexion(t, 0) != NULL;
+    pthread_mutex_lock(&ex->mutex);
+    ex->prets++;
+    ex->arret = ex->arret || !ok;
+    pthread_cond_broadcast(&ex->cond);
+    for (;;) {
+        while (!ex->arret && ex->suivante < ex->nb && ex->suivante >= ex->ecrites + ex->fenetre) {
+            pthread_cond_wait(&ex->cond, &ex->mutex);
+        }
+        if (ex->arret || ex->suivante == ex->nb) break;
+        TrancheExport *tr = &ex->tranches[ex->suivante++];
+        pthread_mutex_unlock(&ex->mutex);
+        sqlite3 *bdd = exportConnexion(t, tr->source);
+        ok = bdd && exportEncoderTranche(ex->options, bdd, tr);
+        pthread_mutex_lock(&ex->mutex);
+        tr->etat = ok ? TRANCHE_PRETE : TRANCHE_ERREUR;
+        ex->arret = ex->arret || !ok;
+        pthread_cond_broadcast(&ex->cond);
+    }
+    pthread_mutex_unlock(&ex->mutex);
+    for (int i = 0; i < ex->nb_sources; i++) {
+        if (!t->bdd[i]) continue;
+        sqlite3_exec(t->bdd[i], "COMMIT;", 0, 0, NULL);
+        diagOublier(t->bdd[i]);
+        sqlite3_close(t->bdd[i]);
+    }
+    return NULL;
+}
+
+// Exporte toutes les tables (archives comprises) dans `dossier`, créé au
+// besoin. `bilan` peut être NULL.
+bool exporterTables(sqlite3 *db, const char *dossier, const OptionsExport *o, BilanExport *bilan) {
+    double t0 = diagDebut(), debut = diagHorloge();
+    BilanExport b = { 0 };
+#ifndef CPRONOTE_ZSTD
+    if (o->compression == COMPRESSION_ZSTD) {
+        journal(LOG_ERREUR, "Export zstd indisponible", "raison=\"compiler avec -DCPRONOTE_ZSTD -lzstd\"");
+        return false;
+    }
+#endif
+    const char *courante = sqlite3_db_filename(db, "main");
+    if (!courante || !courante[0]) {
+        log_error("Erreur: l'export parallèle demande une base sur disque.");
+        return false;
+    }
+    if (mkdir(dossier, 0755) != 0 && errno != EEXIST) {
+        journal(LOG_ERREUR, "Erreur de création du dossier d'export", "dossier=\"%s\" erreur=\"%s\"", dossier, strerror(errno));
+        return false;
+    }
+    ExportParallele ex;
+    memset(&ex, 0, sizeof(ex));
+    ex.options = o;
+    snprintf(ex.sources[0].chemin, sizeof(ex.sources[0].chemin), "%s", courante);
+    ex.nb_sources = 1;
+    for (int i = 1; i < partitions.n && ex.nb_sources < PARTITION_MAX; i++, ex.nb_sources++) {
+        snprintf(ex.sources[i].chemin, sizeof(ex.sources[i].chemin), "%s", partitions.parts[i].chemin);
+        ex.sources[i].annee = partitions.parts[i].annee;
+    }
+
+    // Verrou d'écriture : le plan et les lectures voient le même état
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        return false;
+    }
+    bool ok = exportPlanifier(&ex, db, 0);
+    for (int i = 1; ok && i < ex.nb_sources; i++) {
+        sqlite3 *archive = NULL;
+        ok = sqlite3_open_v2(ex.sources[i].chemin, &archive, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+             exportPlanifier(&ex, archive, i);
+        if (!ok) journal(LOG_ERREUR, "Erreur de lecture de partition", "fichier=\"%s\" erreur=\"%s\"", ex.sources[i].chemin, sqlite3_errmsg(archive));
+        sqlite3_close(archive);
+    }
+    int nb_travailleurs = o->travailleurs > 0 ? o->travailleurs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_travailleurs < 1) nb_travailleurs = 1;
+    if (nb_travailleurs > EXPORT_TRAVAILLEURS_MAX) nb_travailleurs = EXPORT_TRAVAILLEURS_MAX;
+    ex.fenetre = nb_travailleurs * EXPORT_EN_VOL_PAR_TRAVAILLEUR;
+    pthread_mutex_init(&ex.mutex, NULL);
+    pthread_cond_init(&ex.cond, NULL);
+    TravailleurExport *travailleurs = calloc(nb_travailleurs, sizeof(TravailleurExport));
+    int lances = 0;
+    for (; ok && travailleurs && lances < nb_travailleurs; lances++) {
+        travailleurs[lances].ex = &ex;
+        if (pthread_create(&travailleurs[lances].thread, NULL, export_thread, &travailleurs[lances]) != 0) break;
+    }
+    ok = ok && lances > 0;
+    pthread_mutex_lock(&ex.mutex);
+    while (ex.prets < lances) pthread_cond_wait(&ex.cond, &ex.mutex);
+    pthread_mutex_unlock(&ex.mutex);
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);     // rien d'écrit ; COMMIT attendrait la fin des lecteurs
+
+    // Écriture dans l'ordre des tranches
+    FILE *fp = NULL;
+    char chemin[1024] = "";
+    for (int i = 0; ok && i < ex.nb; i++) {
+        TrancheExport *tr = &ex.tranches[i];
+        pthread_mutex_lock(&ex.mutex);
+        while (tr->etat == TRANCHE_A_FAIRE && !ex.arret) pthread_cond_wait(&ex.cond, &ex.mutex);
+        ok = tr->etat == TRANCHE_PRETE;
+        pthread_mutex_unlock(&ex.mutex);
+        if (!ok || (o->annule && o->annule(o->data))) {
+            ok = false;
+            break;
+        }
+        if (tr->premiere) {
+            const SourceExport *src = &ex.sources[tr->source];
+            char annee[16] = "";
+            if (src->annee) snprintf(annee, sizeof(annee), "-%04d", src->annee);
+            snprintf(chemin, sizeof(chemin), "%s/%s%s.%s%s", dossier, tr->table, annee,
+                     format_export_extensions[o->format], compression_extensions[o->compression]);
+            if (!(fp = fopen(chemin, "wb"))) {
+                journal(LOG_ERREUR, "Erreur d'ouverture du fichier d'export", "fichier=\"%s\" erreur=\"%s\"", chemin, strerror(errno));
+                ok = false;
+                break;
+            }
+            b.fichiers++;
+        }
+        ok = fwrite(tr->sortie.buf, 1, tr->sortie.len, fp) == tr->sortie.len;
+        b.lignes += tr->lignes;
+        b.octets_encodes += tr->octets_encodes;
+        b.octets_ecrits += tr->sortie.len;
+        free(tr->sortie.buf);
+        tr->sortie.buf = NULL;
+        if (tr->derniere) {
+            ok = fclose(fp) == 0 && ok;
+            fp = NULL;
+        }
+        if (!ok) journal(LOG_ERREUR, "Erreur d'écriture de l'export", "fichier=\"%s\"", chemin);
+        pthread_mutex_lock(&ex.mutex);
+        ex.ecrites = i + 1;
+        pthread_cond_broadcast(&ex.cond);
+        pthread_mutex_unlock(&ex.mutex);
+    }
+    if (fp) fclose(fp);
+    pthread_mutex_lock(&ex.mutex);
+    ex.arret = true;
+    pthread_cond_broadcast(&ex.cond);
+    pthread_mutex_unlock(&ex.mutex);
+    for (int i = 0; i < lances; i++) pthread_join(travailleurs[i].thread, NULL);
+    for (int i = 0; i < ex.nb; i++) free(ex.tranches[i].sortie.buf);
+    free(ex.tranches);
+    free(travailleurs);
+    pthread_mutex_destroy(&ex.mutex);
+    pthread_cond_destroy(&ex.cond);
+
+    b.travailleurs = lances;
+    b.secondes = diagHorloge() - debut;
+    if (bilan) *bilan = b;
+    diagFin(DIAG_EXPORTER_TABLES, t0, b.lignes);
+    if (!ok) return false;
+    journal(LOG_INFO, "Export des tables", "dossier=\"%s\" format=%s%s fichiers=%d lignes=%ld octets=%zu travailleurs=%d duree_ms=%.0f",
+            dossier, format_export_noms[o->format], compression_extensions[o->compression], b.fichiers, b.lignes,
+            b.octets_ecrits, b.travailleurs, b.secondes * 1e3);
+    auditer("export tables dossier=%s format=%s%s", dossier, format_export_noms[o->format], compression_extensions[o->compression]);
+    return true;
+}
+
+// Lecture pour la visionneuse d'audit : actions d'un utilisateur (ou de
+// tous si user_id vaut 0) entre debut inclus et fin exclue, horodatages
+// au format 'AAAA-MM-JJ HH:MM:SS' (UTC). Renvoie le nombre de lignes ou -1.
+typedef struct {
+    int id;
+    int user_id;
+    char username[MAX_NOM];
+    char action[MAX_ACTION];
+    char timestamp[32];
+} LigneAudit;
+
+int lireAudit(sqlite3 *db, int user_id, const char *debut, const char *fin, int max, LigneAudit **res) {
+    *res = NULL;
+    double t0 = diagDebut();
+    sqlite3_stmt *stmt = obtenirRequete(db, user_id > 0 ? STMT_AUDIT_UTILISATEUR : STMT_AUDIT_PERIODE);
+    if (!stmt) return -1;
+    int col = 1;
+    if (user_id > 0) sqlite3_bind_int(stmt, col++, user_id);
+    sqlite3_bind_text(stmt, col++, debut, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, col++, fin, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, col, max);
+    int n = 0, cap = 0, rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            LigneAudit *tmp = realloc(*res, sizeof(LigneAudit) * cap);
+            if (!tmp) break;
+            *res = tmp;
+        }
+        LigneAudit *l = &(*res)[n++];
+        l->id = sqlite3_column_int(stmt, 0);
+        l->user_id = sqlite3_column_int(stmt, 1);
+        snprintf(l->username, sizeof(l->username), "%s", colonneTexte(stmt, 2));
+        snprintf(l->action, sizeof(l->action), "%s", colonneTexte(stmt, 3));
+        snprintf(l->timestamp, sizeof(l->timestamp), "%s", colonneTexte(stmt, 4));
+    }
+    libererRequete(stmt);
+    diagFin(DIAG_LIRE_AUDIT, t0, n);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(db));
+        free(*res);
+        *res = NULL;
+        return -1;
+    }
+    return n;
+}
+
+/*
+ * Moyennes et classements : lus dans notes_agregats (somme, nombre, min, max
+ * par élève, matière et trimestre), que les triggers de la migration 4
+ * tiennent à jour à chaque écriture dans notes.
+ */
+typedef struct {
+    int eleve_id;
+    char nom[MAX_NOM];
+    double moyenne;
+    int nb_notes;
+    double note_min;
+    double note_max;
+    int rang;
+} MoyenneEleve;
+
+typedef struct {
+    char matiere[MAX_MATIERE];
+    double moyenne;             // moyenne des moyennes des élèves
+    double note_min;
+    double note_max;
+    int nb_notes;
+    int nb_eleves;
+} MoyenneMatiere;
+
+bool ajouterNote(sqlite3 *db, int eleve_id, const char *matiere, double note,
+                 const char *commentaire, const char *date) {
+    bool ouverte;
+    if (!ecritureDebut(db, &ouverte)) return false;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_INSERT_NOTE);
+    if (!stmt) return ecritureFin(db, ouverte, false);
+    sqlite3_bind_int(stmt, 1, eleve_id);
+    sqlite3_bind_text(stmt, 2, matiere, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(stmt, 3, note);
+    sqlite3_bind_text(stmt, 4, commentaire, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, date, -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) log_error(sqlite3_errmsg(db));
+    libererRequete(stmt);
+    return ecritureFin(db, ouverte, rc == SQLITE_DONE);
+}
+
+// Moyennes et rangs de toute une classe (eleves.grade) pour un trimestre
+// ("2024-T1"). Sans matière, la moyenne est la moyenne générale (moyenne
+// des moyennes par matière). Renvoie le nombre d'élèves, -1 en cas
+// d'erreur ; *resultats est à libérer par l'appelant.
+int moyennesClasse(sqlite3 *db, const char *grade, const char *trimestre,
+                   const char *matiere, MoyenneEleve **resultats) {
+    *resultats = NULL;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_MOYENNES_CLASSE);
+    if (!stmt) return -1;
+    sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, trimestre, -1, SQLITE_TRANSIENT);
+    if (matiere) sqlite3_bind_text(stmt, 3, matiere, -1, SQLITE_TRANSIENT);
+    int n = 0, cap = 0, rc;
+    MoyenneEleve *res = NULL;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            MoyenneEleve *p = realloc(res, cap * sizeof(*res));
+            if (!p) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            res = p;
+        }
+        MoyenneEleve *m = &res[n++];
+        m->eleve_id = sqlite3_column_int(stmt, 0);
+        snprintf(m->nom, sizeof(m->nom), "%s", colonneTexte(stmt, 1));
+        m->moyenne = sqlite3_column_double(stmt, 2);
+        m->nb_notes = sqlite3_column_int(stmt, 3);
+        m->note_min = sqlite3_column_double(stmt, 4);
+        m->note_max = sqlite3_column_double(stmt, 5);
+        m->rang = sqlite3_column_int(stmt, 6);
+    }
+    libererRequete(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(db));
+        free(res);
+        return -1;
+    }
+    *resultats = res;
+    return n;
+}
+
+// Moyenne de la classe, min et max par matière pour un trimestre.
+int moyennesMatieresClasse(sqlite3 *db, const char *grade, const char *trimestre,
+                           MoyenneMatiere **resultats) {
+    *resultats = NULL;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_MOYENNES_MATIERES);
+    if (!stmt) return -1;
+    sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, trimestre, -1, SQLITE_TRANSIENT);
+    int n = 0, cap = 0, rc;
+    MoyenneMatiere *res = NULL;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            MoyenneMatiere *p = realloc(res, cap * sizeof(*res));
+            if (!p) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            res = p;
+        }
+        MoyenneMatiere *m = &res[n++];
+        snprintf(m->matiere, sizeof(m->matiere), "%s", colonneTexte(stmt, 0));
+        m->moyenne = sqlite3_column_double(stmt, 1);
+        m->note_min = sqlite3_column_double(stmt, 2);
+        m->note_max = sqlite3_column_double(stmt, 3);
+        m->nb_notes = sqlite3_column_int(stmt, 4);
+        m->nb_eleves = sqlite3_column_int(stmt, 5);
+    }
+    libererRequete(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(db));
+        free(res);
+        return -1;
+    }
+    *resultats = res;
+    return n;
+}
+
+// Compare notes_agregats à un recalcul complet depuis notes. Renvoie le
+// nombre de groupes divergents (0 si cohérent), -1 en cas d'erreur.
+long verifierAgregatsNotes(sqlite3 *db) {
+    const char *sql =
+        "WITH r AS (" SQL_AGREGAT_RECALCUL ") "
+        "SELECT (SELECT COUNT(*) FROM r LEFT JOIN notes_agregats a USING (eleve_id, matiere, trimestre) "
+                "WHERE a.nb IS NULL OR a.nb != r.nb OR abs(a.somme - r.somme) > 1e-6 "
+                "OR a.note_min != r.note_min OR a.note_max != r.note_max) + "
+               "(SELECT COUNT(*) FROM notes_agregats a LEFT JOIN r USING (eleve_id, matiere, trimestre) "
+                "WHERE r.nb IS NULL);";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        return -1;
+    }
+    long ecarts = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) ecarts = sqlite3_column_int64(stmt, 0);
+    else log_error(sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    if (ecarts > 0) {
+        journal(LOG_AVERT, "Agrégats de notes incohérents", "groupes=%ld", ecarts);
+    }
+    return ecarts;
+}
+
+bool reconstruireAgregatsNotes(sqlite3 *db) {
+    char *errMsg = NULL;
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE; DELETE FROM notes_agregats; "
+                         "INSERT INTO notes_agregats " SQL_AGREGAT_RECALCUL "; COMMIT;", 0, 0, &errMsg) != SQLITE_OK) {
+        log_error(errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Présences compactes : pour chaque élève et chaque année scolaire, trois
+ * bitmaps d'un bit par jour à partir du 1er septembre (jour saisi, absent,
+ * en retard), stockés en BLOB dans presences_bitmaps. La table presences
+ * reste le format d'import/export ; enregistrerPresence() écrit les deux,
+ * reconstruireBitmapsPresences() recalcule les bitmaps après un import.
+ * Les requêtes (taux d'absence, séries, palmarès) comptent les bits mot par
+ * mot avec popcount.
+ */
+typedef struct {
+    int n;
+    int *eleve_ids;
+    uint64_t *jours;            // n * PRESENCE_MOTS mots ; élève i à i * PRESENCE_MOTS
+    uint64_t *absent;
+    uint64_t *retard;
+} PresencesClasse;
+
+typedef struct {
+    int eleve_id;
+    int absences;
+    int saisies;
+} AbsentRang;
+
+// Numéro de jour civil (algorithme de H. Hinnant), pour des différences de dates.
+long jourCivil(int a, int m, int j) {
+    a -= m <= 2;
+    long ere = (a >= 0 ? a : a - 399) / 400;
+    long ade = a - ere * 400;
+    long jda = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + j - 1;
+    long jde = ade * 365 + ade / 4 - ade / 100 + jda;
+    return ere * 146097 + jde - 719468;
+}
+
+// Inverse de jourCivil : écrit la date 'AAAA-MM-JJ' du jour civil donné.
+void dateCivile(long jour, char *out, size_t taille) {
+    long z = jour + 719468;
+    long ere = (z >= 0 ? z : z - 146096) / 146097;
+    long jde = z - ere * 146097;
+    long ade = (jde - jde / 1460 + jde / 36524 - jde / 146096) / 365;
+    long jda = jde - (365 * ade + ade / 4 - ade / 100);
+    long mp = (5 * jda + 2) / 153;
+    int j = (int)(jda - (153 * mp + 2) / 5 + 1);
+    int m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    snprintf(out, taille, "%04ld-%02d-%02d", ade + ere * 400 + (m <= 2), m, j);
+}
+
+int joursDansMois(int a, int m) {
+    static const int jours[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool bissextile = (a % 4 == 0 && a % 100 != 0) || a % 400 == 0;
+    return m == 2 && bissextile ? 29 : jours[m - 1];
+}
+
+// Jour de l'année scolaire (0 = 1er septembre) d'une date 'AAAA-MM-JJ' ;
+// renvoie -1 si la date est invalide (2024-02-30, 2023-02-29...).
+int jourScolaire(const char *date, int *annee) {
+    int a, m, j;
+    if (!date || sscanf(date, "%4d-%2d-%2d", &a, &m, &j) != 3 || m < 1 || m > 12 || j < 1 ||
+        j > joursDansMois(a, m)) {
+        return -1;
+    }
+    *annee = m >= 9 ? a : a - 1;
+    return (int)(jourCivil(a, m, j) - jourCivil(*annee, 9, 1));
+}
+
+void bitmapLire(const void *blob, int octets, uint64_t *mots) {
+    const unsigned char *b = blob;
+    memset(mots, 0, PRESENCE_MOTS * sizeof(uint64_t));
+    for (int i = 0; i < octets && i < PRESENCE_MOTS * 8; i++) {
+        mots[i / 8] |= (uint64_t)b[i] << (8 * (i % 8));
+    }
+}
+
+// Octets petit-boutistes : le fichier reste lisible d'une machine à l'autre.
+void bitmapEcrire(const uint64_t *mots, unsigned char *blob) {
+    for (int i = 0; i < PRESENCE_MOTS * 8; i++) {
+        blob[i] = (unsigned char)(mots[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+bool bitmapsSauver(sqlite3 *db, int eleve_id, int annee,
+                   const uint64_t *jours, const uint64_t *absent, const uint64_t *retard) {
+    unsigned char b_jours[PRESENCE_MOTS * 8], b_absent[PRESENCE_MOTS * 8], b_retard[PRESENCE_MOTS * 8];
+    bitmapEcrire(jours, b_jours);
+    bitmapEcrire(absent, b_absent);
+    bitmapEcrire(retard, b_retard);
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_SAUVER_BITMAPS);
+    if (!stmt) return false;
+    sqlite3_bind_int(stmt, 1, eleve_id);
+    sqlite3_bind_int(stmt, 2, annee);
+    sqlite3_bind_blob(stmt, 3, b_jours, sizeof(b_jours), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(stmt, 4, b_absent, sizeof(b_absent), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(stmt, 5, b_retard, sizeof(b_retard), SQLITE_TRANSIENT);
+    int rc = sqlite3_step(stmt);
+    libererRequete(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+// Enregistre le statut ('present', 'absent', 'retard') d'un élève pour un
+// jour, en remplaçant une éventuelle saisie du même jour.
+bool enregistrerPresence(sqlite3 *db, int eleve_id, const char *date, const char *status) {
+    double t0 = diagDebut();
+    int annee;
+    int jour = jourScolaire(date, &annee);
+    if (jour < 0 || jour >= PRESENCE_JOURS) {
+        log_error("Erreur: date de présence invalide.");
+        return false;
+    }
+    bool ouverte;
+    if (!ecritureDebut(db, &ouverte)) return false;
+    if (sqlite3_exec(db, "SAVEPOINT presence;", 0, 0, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        return ecritureFin(db, ouverte, false);
+    }
+    bool ok = false;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_REMPLACER_PRESENCE);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, eleve_id);
+        sqlite3_bind_text(stmt, 2, date, -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        libererRequete(stmt);
+    }
+    stmt = ok ? obtenirRequete(db, STMT_INSERT_PRESENCE) : NULL;
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, eleve_id);
+        sqlite3_bind_text(stmt, 2, date, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, status, -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        libererRequete(stmt);
+    } else {
+        ok = false;
+    }
+
+    uint64_t jours[PRESENCE_MOTS] = { 0 }, absent[PRESENCE_MOTS] = { 0 }, retard[PRESENCE_MOTS] = { 0 };
+    stmt = ok ? obtenirRequete(db, STMT_LIRE_BITMAPS) : NULL;
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, eleve_id);
+        sqlite3_bind_int(stmt, 2, annee);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            bitmapLire(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), jours);
+            bitmapLire(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1), absent);
+            bitmapLire(sqlite3_column_blob(stmt, 2), sqlite3_column_bytes(stmt, 2), retard);
+        }
+        libererRequete(stmt);
+        uint64_t bit = (uint64_t)1 << (jour % 64);
+        jours[jour / 64] |= bit;
+        absent[jour / 64] &= ~bit;
+        retard[jour / 64] &= ~bit;
+        if (strcmp(status, "absent") == 0) absent[jour / 64] |= bit;
+        if (strcmp(status, "retard") == 0) retard[jour / 64] |= bit;
+        ok = bitmapsSauver(db, eleve_id, annee, jours, absent, retard);
+    }
+    if (!ok) {
+        log_error(sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK TO presence;", 0, 0, NULL);
+    }
+    sqlite3_exec(db, "RELEASE presence;", 0, 0, NULL);
+    ok = ecritureFin(db, ouverte, ok);
+    diagFin(DIAG_PRESENCE, t0, ok);
+    return ok;
+}
+
+// Recalcule tous les bitmaps depuis presences, en un seul parcours trié
+// par élève et par date. Utilisable dans une transaction (savepoint).
+bool reconstruireBitmapsPresences(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_exec(db, "SAVEPOINT bitmaps; DELETE FROM presences_bitmaps;", 0, 0, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT eleve_id, date, status FROM presences ORDER BY eleve_id, date;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK TO bitmaps; RELEASE bitmaps;", 0, 0, NULL);
+        return false;
+    }
+    uint64_t jours[PRESENCE_MOTS], absent[PRESENCE_MOTS], retard[PRESENCE_MOTS];
+    int eleve_courant = -1, annee_courante = -1;
+    bool ok = true;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && ok) {
+        int eleve_id = sqlite3_column_int(stmt, 0);
+        int annee;
+        int jour = jourScolaire((const char*)sqlite3_column_text(stmt, 1), &annee);
+        if (jour < 0 || jour >= PRESENCE_JOURS) continue;
+        if (eleve_id != eleve_courant || annee != annee_courante) {
+            if (eleve_courant >= 0) {
+                ok = bitmapsSauver(db, eleve_courant, annee_courante, jours, absent, retard);
+            }
+            // le tri par (élève, date) rend chaque (élève, année) contigu
+            memset(jours, 0, sizeof(jours));
+            memset(absent, 0, sizeof(absent));
+            memset(retard, 0, sizeof(retard));
+            eleve_courant = eleve_id;
+            annee_courante = annee;
+        }
+        const char *status = (const char*)sqlite3_column_text(stmt, 2);
+        uint64_t bit = (uint64_t)1 << (jour % 64);
+        jours[jour / 64] |= bit;
+        absent[jour / 64] &= ~bit;
+        retard[jour / 64] &= ~bit;
+        if (status && strcmp(status, "absent") == 0) absent[jour / 64] |= bit;
+        if (status && strcmp(status, "retard") == 0) retard[jour / 64] |= bit;
+    }
+    if (ok && eleve_courant >= 0) {
+        ok = bitmapsSauver(db, eleve_courant, annee_courante, jours, absent, retard);
+    }
+    sqlite3_finalize(stmt);
+    if (!ok || (rc != SQLITE_DONE && rc != SQLITE_ROW)) {
+        log_error(sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK TO bitmaps; RELEASE bitmaps;", 0, 0, NULL);
+        return false;
+    }
+    return sqlite3_exec(db, "RELEASE bitmaps;", 0, 0, NULL) == SQLITE_OK;
+}
+
+void libererPresencesClasse(PresencesClasse *pc) {
+    free(pc->eleve_ids);
+    free(pc->jours);
+    free(pc->absent);
+    free(pc->retard);
+    memset(pc, 0, sizeof(*pc));
+}
+
+// Charge les bitmaps d'une classe (eleves.grade) pour une année scolaire.
+// Les élèves sans saisie ont des bitmaps vides.
+bool chargerPresencesClasse(sqlite3 *db, const char *grade, int annee, PresencesClasse *pc) {
+    double t0 = diagDebut();
+    memset(pc, 0, sizeof(*pc));
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_BITMAPS_CLASSE);
+    if (!stmt) return false;
+    sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, annee);
+    int cap = 0, rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (pc->n == cap) {
+            cap = cap ? cap * 2 : 64;
+            int *ids = realloc(pc->eleve_ids, cap * sizeof(int));
+            uint64_t *j = realloc(pc->jours, cap * PRESENCE_MOTS * sizeof(uint64_t));
+            uint64_t *a = realloc(pc->absent, cap * PRESENCE_MOTS * sizeof(uint64_t));
+            uint64_t *r = realloc(pc->retard, cap * PRESENCE_MOTS * sizeof(uint64_t));
+            if (ids) pc->eleve_ids = ids;
+            if (j) pc->jours = j;
+            if (a) pc->absent = a;
+            if (r) pc->retard = r;
+            if (!ids || !j || !a || !r) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+        }
+        int i = pc->n++;
+        pc->eleve_ids[i] = sqlite3_column_int(stmt, 0);
+        bitmapLire(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1), &pc->jours[i * PRESENCE_MOTS]);
+        bitmapLire(sqlite3_column_blob(stmt, 2), sqlite3_column_bytes(stmt, 2), &pc->absent[i * PRESENCE_MOTS]);
+        bitmapLire(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3), &pc->retard[i * PRESENCE_MOTS]);
+    }
+    libererRequete(stmt);
+    diagFin(DIAG_PRESENCES_CLASSE, t0, pc->n);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(db));
+        libererPresencesClasse(pc);
+        return false;
+    }
+    return true;
+}
+
+// Nombre de bits à 1 de `mots` dans les jours [debut, fin).
+int compterBits(const uint64_t *mots, int debut, int fin) {
+    int total = 0;
+    for (int m = debut / 64; m * 64 < fin; m++) {
+        uint64_t masque = ~(uint64_t)0;
+        if (m * 64 < debut) masque &= ~(uint64_t)0 << (debut % 64);
+        if ((m + 1) * 64 > fin) masque &= ~(~(uint64_t)0 << (fin % 64));
+        total += __builtin_popcountll(mots[m] & masque);
+    }
+    return total;
+}
+
+// Taux d'absence de la classe sur [debut, fin) : absences / jours saisis.
+double tauxAbsenceClasse(const PresencesClasse *pc, int debut, int fin, long *absences, long *saisies) {
+    long a = 0, s = 0;
+    for (int i = 0; i < pc->n; i++) {
+        a += compterBits(&pc->absent[i * PRESENCE_MOTS], debut, fin);
+        s += compterBits(&pc->jours[i * PRESENCE_MOTS], debut, fin);
+    }
+    if (absences) *absences = a;
+    if (saisies) *saisies = s;
+    return s ? (double)a / s : 0.0;
+}
+
+// Plus longue série d'absences consécutives de l'élève i sur [debut, fin),
+// comptée en jours saisis : un jour sans saisie (week-end) ne la rompt pas.
+int plusLongueSerieAbsences(const PresencesClasse *pc, int i, int debut, int fin) {
+    const uint64_t *jours = &pc->jours[i * PRESENCE_MOTS];
+    const uint64_t *absent = &pc->absent[i * PRESENCE_MOTS];
+    int serie = 0, meilleure = 0;
+    for (int m = debut / 64; m * 64 < fin; m++) {
+        uint64_t masque = ~(uint64_t)0;
+        if (m * 64 < debut) masque &= ~(uint64_t)0 << (debut % 64);
+        if ((m + 1) * 64 > fin) masque &= ~(~(uint64_t)0 << (fin % 64));
+        uint64_t saisis = jours[m] & masque;
+        if (saisis && (saisis & ~absent[m]) == 0) {
+            serie += __builtin_popcountll(saisis);    // mot entièrement absent
+            if (serie > meilleure) meilleure = serie;
+            continue;
+        }
+        while (saisis) {
+            uint64_t bit = saisis & -saisis;
+            serie = (absent[m] & bit) ? serie + 1 : 0;
+            if (serie > meilleure) meilleure = serie;
+            saisis &= saisis - 1;
+        }
+    }
+    return meilleure;
+}
+
+int comparerAbsents(const void *a, const void *b) {
+    const AbsentRang *x = a, *y = b;
+    if (x->absences != y->absences) return y->absences - x->absences;
+    return x->eleve_id - y->eleve_id;
+}
+
+// Les k élèves les plus absents sur [debut, fin) ; renvoie le nombre écrit.
+int topAbsents(const PresencesClasse *pc, int debut, int fin, int k, AbsentRang *out) {
+    AbsentRang *tous = malloc((pc->n ? pc->n : 1) * sizeof(AbsentRang));
+    if (!tous) return 0;
+    for (int i = 0; i < pc->n; i++) {
+        tous[i].eleve_id = pc->eleve_ids[i];
+        tous[i].absences = compterBits(&pc->absent[i * PRESENCE_MOTS], debut, fin);
+        tous[i].saisies = compterBits(&pc->jours[i * PRESENCE_MOTS], debut, fin);
+    }
+    qsort(tous, pc->n, sizeof(AbsentRang), comparerAbsents);
+    int n = k < pc->n ? k : pc->n;
+    memcpy(out, tous, n * sizeof(AbsentRang));
+    free(tous);
+    return n;
+}
+
+// Compare, élève par élève, les comptes tirés des bitmaps à ceux de la
+// table presences pour une classe et une année. Renvoie le nombre d'élèves
+// divergents, -1 en cas d'erreur.
+int verifierBitmapsPresences(sqlite3 *db, const char *grade, int annee) {
+    PresencesClasse pc;
+    if (!chargerPresencesClasse(db, grade, annee, &pc)) return -1;
+    char debut[24], fin[24];
+    snprintf(debut, sizeof(debut), "%04d-09-01", annee);
+    snprintf(fin, sizeof(fin), "%04d-09-01", annee + 1);
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db,
+            "SELECT COUNT(DISTINCT date), COUNT(DISTINCT CASE WHEN status = 'absent' THEN date END), "
+                   "COUNT(DISTINCT CASE WHEN status = 'retard' THEN date END) "
+            "FROM presences WHERE eleve_id = ? AND date >= ? AND date < ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(db));
+        libererPresencesClasse(&pc);
+        return -1;
+    }
+    int ecarts = 0;
+    for (int i = 0; i < pc.n; i++) {
+        sqlite3_bind_int(stmt, 1, pc.eleve_ids[i]);
+        sqlite3_bind_text(stmt, 2, debut, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, fin, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW &&
+            (sqlite3_column_int(stmt, 0) != compterBits(&pc.jours[i * PRESENCE_MOTS], 0, PRESENCE_JOURS) ||
+             sqlite3_column_int(stmt, 1) != compterBits(&pc.absent[i * PRESENCE_MOTS], 0, PRESENCE_JOURS) ||
+             sqlite3_column_int(stmt, 2) != compterBits(&pc.retard[i * PRESENCE_MOTS], 0, PRESENCE_JOURS))) {
+            ecarts++;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    libererPresencesClasse(&pc);
+    return ecarts;
+}
+
+/*
+ * Bulletins de fin de trimestre : un fichier HTML par élève et un fichier
+ * commun (bulletins.html), plus les mêmes en PDF dans la version GTK, dessinés
+ * avec cairo. Les données sont lues d'un bloc, dans une seule transaction, par
+ * trois requêtes triées par élève (élèves avec leurs bitmaps de présences,
+ * moyennes par matière avec celle de la classe, appréciations) et fusionnées
+ * en un passage. Le rendu est réparti entre des threads travailleurs ; le
+ * thread appelant écrit les fichiers communs dans l'ordre des élèves. Ni date
+ * de génération ni format dépendant de la locale : à données égales, les
+ * fichiers sont identiques octet pour octet, quel que soit le nombre de
+ * travailleurs.
+ */
+#define BULLETIN_TRAVAILLEURS_MAX 32
+#define BULLETIN_EN_VOL_PAR_TRAVAILLEUR 4   // bulletins rendus en attente d'écriture
+#define BULLETIN_PAGE_LARGEUR 595.0         // A4, en points
+#define BULLETIN_PAGE_HAUTEUR 842.0
+#define BULLETIN_MARGE 50.0
+
+typedef struct {
+    const char *grade;                      // NULL : toutes les classes
+    int travailleurs;                       // 0 : un par processeur
+    bool pdf;                               // en plus du HTML (version GTK)
+    void (*progres)(int faits, int total, void *data);     // appelé par le thread appelant
+    bool (*annule)(void *data);
+    void *data;
+} OptionsBulletins;
+
+typedef struct {
+    int eleves;
+    int fichiers;
+    size_t octets;                          // HTML écrit, fichiers communs compris
+    int travailleurs;
+    double secondes_lecture;
+    double secondes;
+} BilanBulletins;
+
+typedef struct {
+    uint32_t matiere;                       // décalage dans Bulletins.textes
+    double moyenne;
+    double moyenne_classe;
+    double note_min;
+    double note_max;
+    int nb_notes;
+} MatiereBulletin;
+
+typedef struct {
+    uint32_t matiere;
+    uint32_t texte;
+} AppreciationBulletin;
+
+typedef struct {
+    int id;
+    uint32_t nom;
+    uint32_t grade;
+    int absences;
+    int retards;
+    int saisies;                            // jours saisis dans le trimestre
+    int premiere_matiere;
+    int nb_matieres;
+    int premiere_appreciation;
+    int nb_appreciations;
+    double moyenne;                         // moyenne des matières, < 0 sans note
+    EtatTranche etat;
+    Sortie html;                            // section rendue, pour le fichier commun
+} BulletinEleve;
+
+typedef struct {
+    const OptionsBulletins *options;
+    const char *dossier;
+    char trimestre[16];
+    char titre[64];
+    char date[40];                          // début du trimestre (métadonnées PDF)
+    Arene textes;
+    BulletinEleve *eleves;
+    int nb;
+    int cap;
+    MatiereBulletin *matieres;
+    int nb_matieres;
+    int cap_matieres;
+    AppreciationBulletin *appreciations;
+    int nb_appreciations;
+    int cap_appreciations;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int suivant;                            // prochain bulletin à rendre
+    int ecrits;                             // bulletins déjà dans les fichiers communs
+    int fenetre;
+    bool arret;
+} Bulletins;
+
+// Année de rentrée, jours scolaires [debut, fin) et dates limites (fin
+// exclue, 24 octets chacune) du trimestre "AAAA-Tn", découpé comme SQL_TRIMESTRE.
+bool bornesTrimestre(const char *trimestre, int *annee, int *debut, int *fin, char *date_debut, char *date_fin) {
+    static const int mois[4] = { 9, 1, 4, 9 };      // premier mois de T1, T2, T3, puis rentrée suivante
+    int a, t;
+    char reste;
+    if (sscanf(trimestre, "%4d-T%1d%c", &a, &t, &reste) != 2 || t < 1 || t > 3) return false;
+    int a_debut = t == 1 ? a : a + 1, a_fin = a + 1;
+    *annee = a;
+    *debut = (int)(jourCivil(a_debut, mois[t - 1], 1) - jourCivil(a, 9, 1));
+    *fin = (int)(jourCivil(a_fin, mois[t], 1) - jourCivil(a, 9, 1));
+    snprintf(date_debut, 24, "%04d-%02d-01", a_debut % 10000, mois[t - 1]);
+    snprintf(date_fin, 24, "%04d-%02d-01", a_fin % 10000, mois[t]);
+    return true;
+}
+
+// Trimestre de la date du jour, au format de SQL_TRIMESTRE.
+void trimestreCourant(char *out, size_t taille) {
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    int a = tm.tm_year + 1900, m = tm.tm_mon + 1;
+    snprintf(out, taille, "%04d-T%d", (m >= 9 ? a : a - 1) % 10000, m >= 9 ? 1 : m <= 3 ? 2 : 3);
+}
+
+// Note sur 20 avec une virgule et deux décimales, sans passer par la locale.
+void noteTexte(double note, char *out, size_t taille) {
+    long centiemes = (long)(note * 100 + (note < 0 ? -0.5 : 0.5));
+    snprintf(out, taille, "%s%ld,%02ld", centiemes < 0 ? "-" : "", labs(centiemes) / 100, labs(centiemes) % 100);
+}
+
+bool bulletinsTexte(Bulletins *b, const char *s, uint32_t *ref) {
+    size_t n = strlen(s);
+    Arene *a = &b->textes;
+    if (a->taille + n + 1 > a->cap) {
+        size_t cap = a->cap ? a->cap : 65536;
+        while (cap < a->taille + n + 1) cap *= 2;
+        char *octets = realloc(a->octets, cap);
+        if (!octets) return false;
+        a->octets = octets;
+        a->cap = cap;
+    }
+    memcpy(a->octets + a->taille, s, n + 1);
+    *ref = (uint32_t)a->taille;
+    a->taille += n + 1;
+    return true;
+}
+
+const char *bulletinsChaine(const Bulletins *b, uint32_t ref) {
+    return b->textes.octets + ref;
+}
+
+// Place pour un élément de plus dans un tableau à croissance géométrique.
+bool bulletinsReserver(void **tab, int *cap, int n, size_t taille) {
+    if (n < *cap) return true;
+    int nouvelle = *cap ? *cap * 2 : 256;
+    void *p = realloc(*tab, taille * nouvelle);
+    if (!p) return false;
+    *tab = p;
+    *cap = nouvelle;
+    return true;
+}
+
+// Indice de l'élève `id`, en avançant `k` (les trois requêtes sont triées par élève).
+int bulletinsIndice(const Bulletins *b, int *k, int id) {
+    while (*k < b->nb && b->eleves[*k].id < id) (*k)++;
+    return *k < b->nb && b->eleves[*k].id == id ? *k : -1;
+}
+
+bool bulletinsLire(Bulletins *b, sqlite3 *db, int annee, int debut, int fin,
+                   const char *date_debut, const char *date_fin) {
+    const char *grade = b->options->grade;
+    bool transaction = sqlite3_get_autocommit(db) && sqlite3_exec(db, "BEGIN;", 0, 0, NULL) == SQLITE_OK;
+    bool ok = true;
+    int rc = SQLITE_DONE;
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_BULLETIN_ELEVES);
+    if (!stmt) ok = false;
+    else {
+        if (grade) sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, annee);
+        uint64_t jours[PRESENCE_MOTS], absent[PRESENCE_MOTS], retard[PRESENCE_MOTS];
+        while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            ok = bulletinsReserver((void**)&b->eleves, &b->cap, b->nb, sizeof(BulletinEleve));
+            if (!ok) break;
+            BulletinEleve *e = &b->eleves[b->nb];
+            memset(e, 0, sizeof(*e));
+            e->id = sqlite3_column_int(stmt, 0);
+            ok = bulletinsTexte(b, colonneTexte(stmt, 1), &e->nom) && bulletinsTexte(b, colonneTexte(stmt, 2), &e->grade);
+            bitmapLire(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3), jours);
+            bitmapLire(sqlite3_column_blob(stmt, 4), sqlite3_column_bytes(stmt, 4), absent);
+            bitmapLire(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5), retard);
+            e->saisies = compterBits(jours, debut, fin);
+            e->absences = compterBits(absent, debut, fin);
+            e->retards = compterBits(retard, debut, fin);
+            e->moyenne = -1;
+            b->nb++;
+        }
+        ok = ok && rc == SQLITE_DONE;
+        libererRequete(stmt);
+    }
+
+    stmt = ok ? obtenirRequete(db, STMT_BULLETIN_MATIERES) : NULL;
+    if (stmt) {
+        if (grade) sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, b->trimestre, -1, SQLITE_TRANSIENT);
+        int k = 0;
+        while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int i = bulletinsIndice(b, &k, sqlite3_column_int(stmt, 0));
+            if (i < 0) continue;
+            ok = bulletinsReserver((void**)&b->matieres, &b->cap_matieres, b->nb_matieres, sizeof(MatiereBulletin));
+            if (!ok) break;
+            MatiereBulletin *m = &b->matieres[b->nb_matieres];
+            ok = bulletinsTexte(b, colonneTexte(stmt, 1), &m->matiere);
+            m->moyenne = sqlite3_column_double(stmt, 2);
+            m->nb_notes = sqlite3_column_int(stmt, 3);
+            m->note_min = sqlite3_column_double(stmt, 4);
+            m->note_max = sqlite3_column_double(stmt, 5);
+            m->moyenne_classe = sqlite3_column_double(stmt, 6);
+            BulletinEleve *e = &b->eleves[i];
+            if (e->nb_matieres++ == 0) e->premiere_matiere = b->nb_matieres;
+            b->nb_matieres++;
+        }
+        ok = ok && rc == SQLITE_DONE;
+        libererRequete(stmt);
+    } else {
+        ok = false;
+    }
+
+    stmt = ok ? obtenirRequete(db, STMT_BULLETIN_APPRECIATIONS) : NULL;
+    if (stmt) {
+        if (grade) sqlite3_bind_text(stmt, 1, grade, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, date_debut, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, date_fin, -1, SQLITE_TRANSIENT);
+        int k = 0;
+        while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int i = bulletinsIndice(b, &k, sqlite3_column_int(stmt, 0));
+            if (i < 0) continue;
+            ok = bulletinsReserver((void**)&b->appreciations, &b->cap_appreciations, b->nb_appreciations,
+                                   sizeof(AppreciationBulletin));
+            if (!ok) break;
+            AppreciationBulletin *ap = &b->appreciations[b->nb_appreciations];
+            ok = bulletinsTexte(b, colonneTexte(stmt, 1), &ap->matiere) && bulletinsTexte(b, colonneTexte(stmt, 2), &ap->texte);
+            BulletinEleve *e = &b->eleves[i];
+            if (e->nb_appreciations++ == 0) e->premiere_appreciation = b->nb_appreciations;
+            b->nb_appreciations++;
+        }
+        ok = ok && rc == SQLITE_DONE;
+        libererRequete(stmt);
+    } else {
+        ok = false;
+    }
+    if (!ok) log_error(rc == SQLITE_DONE || rc == SQLITE_ROW ? "Mémoire insuffisante" : sqlite3_errmsg(db));
+    if (transaction) sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+
+    for (int i = 0; ok && i < b->nb; i++) {
+        BulletinEleve *e = &b->eleves[i];
+        double somme = 0;
+        for (int j = 0; j < e->nb_matieres; j++) somme += b->matieres[e->premiere_matiere + j].moyenne;
+        if (e->nb_matieres) e->moyenne = somme / e->nb_matieres;
+    }
+    return ok;
+}
+
+void htmlTexte(Sortie *s, const char *txt) {
+    const char *debut = txt;
+    for (const char *c = txt; *c; c++) {
+        const char *entite = *c == '&' ? "&amp;" : *c == '<' ? "&lt;" : *c == '>' ? "&gt;" :
+                             *c == '"' ? "&quot;" : *c == '\'' ? "&#39;" : NULL;
+        if (!entite) continue;
+        sortieEcrire(s, debut, c - debut);
+        sortieTexte(s, entite);
+        debut = c + 1;
+    }
+    sortieTexte(s, debut);
+}
+
+const char *bulletinMatiere(const Bulletins *b, uint32_t ref) {
+    const char *m = bulletinsChaine(b, ref);
+    return m[0] ? m : "(sans matière)";
+}
+
+void bulletinsEnteteHTML(Sortie *s, const char *titre) {
+    sortieTexte(s, "<!DOCTYPE html>\n<html lang=\"fr\">\n<head>\n<meta charset=\"utf-8\">\n<title>Bulletins – ");
+    htmlTexte(s, titre);
+    sortieTexte(s, "</title>\n<style>\n"
+                   "body { font-family: sans-serif; margin: 2em; }\n"
+                   "section { page-break-after: always; }\n"
+                   "table { border-collapse: collapse; width: 100%; }\n"
+                   "th, td { border: 1px solid #999; padding: 0.2em 0.5em; text-align: left; }\n"
+                   "td.n { text-align: right; }\n"
+                   "</style>\n</head>\n<body>\n");
+}
+
+void bulletinsPiedHTML(Sortie *s) {
+    sortieTexte(s, "</body>\n</html>\n");
+}
+
+void bulletinRendreHTML(const Bulletins *b, const BulletinEleve *e, Sortie *s) {
+    char moy[24], classe[24], min[24], max[24];
+    sortiePrintf(s, "<section class=\"bulletin\" id=\"eleve-%d\">\n<h1>Bulletin – ", e->id);
+    htmlTexte(s, b->titre);
+    sortieTexte(s, "</h1>\n<p>Élève : <strong>");
+    htmlTexte(s, bulletinsChaine(b, e->nom));
+    sortieTexte(s, "</strong> – classe ");
+    htmlTexte(s, bulletinsChaine(b, e->grade));
+    sortiePrintf(s, " – n° %d</p>\n<table>\n<thead><tr><th>Matière</th><th>Moyenne</th><th>Classe</th>"
+                    "<th>Min</th><th>Max</th><th>Notes</th></tr></thead>\n<tbody>\n", e->id);
+    for (int j = 0; j < e->nb_matieres; j++) {
+        const MatiereBulletin *m = &b->matieres[e->premiere_matiere + j];
+        noteTexte(m->moyenne, moy, sizeof(moy));
+        noteTexte(m->moyenne_classe, classe, sizeof(classe));
+        noteTexte(m->note_min, min, sizeof(min));
+        noteTexte(m->note_max, max, sizeof(max));
+        sortieTexte(s, "<tr><td>");
+        htmlTexte(s, bulletinMatiere(b, m->matiere));
+        sortiePrintf(s, "</td><td class=\"n\">%s</td><td class=\"n\">%s</td><td class=\"n\">%s</td>"
+                        "<td class=\"n\">%s</td><td class=\"n\">%d</td></tr>\n", moy, classe, min, max, m->nb_notes);
+    }
+    if (e->nb_matieres == 0) sortieTexte(s, "<tr><td colspan=\"6\">Aucune note ce trimestre.</td></tr>\n");
+    sortieTexte(s, "</tbody>\n");
+    if (e->moyenne >= 0) {
+        noteTexte(e->moyenne, moy, sizeof(moy));
+        sortiePrintf(s, "<tfoot><tr><th>Moyenne générale</th><td class=\"n\">%s</td><td colspan=\"4\"></td></tr></tfoot>\n", moy);
+    }
+    sortieTexte(s, "</table>\n<h2>Appréciations</h2>\n");
+    if (e->nb_appreciations == 0) sortieTexte(s, "<p>Aucune appréciation.</p>\n");
+    else sortieTexte(s, "<ul>\n");
+    for (int j = 0; j < e->nb_appreciations; j++) {
+        const AppreciationBulletin *ap = &b->appreciations[e->premiere_appreciation + j];
+        sortieTexte(s, "<li><strong>");
+        htmlTexte(s, bulletinMatiere(b, ap->matiere));
+        sortieTexte(s, "</strong> : ");
+        htmlTexte(s, bulletinsChaine(b, ap->texte));
+        sortieTexte(s, "</li>\n");
+    }
+    if (e->nb_appreciations) sortieTexte(s, "</ul>\n");
+    sortiePrintf(s, "<h2>Assiduité</h2>\n<p>%d absence%s, %d retard%s sur %d jour%s saisi%s.</p>\n</section>\n",
+                 e->absences, e->absences > 1 ? "s" : "", e->retards, e->retards > 1 ? "s" : "",
+                 e->saisies, e->saisies > 1 ? "s" : "", e->saisies > 1 ? "s" : "");
+}
+
+#ifndef CPRONOTE_HEADLESS
+// Passe à la ligne suivante (`pas` points plus bas), sur une nouvelle page
+// au besoin ; l'état graphique (police, taille) est conservé.
+double pdfLigne(cairo_t *cr, double y, double pas) {
+    y += pas;
+    if (y > BULLETIN_PAGE_HAUTEUR - BULLETIN_MARGE) {
+        cairo_show_page(cr);
+        y = BULLETIN_MARGE + pas;
+    }
+    return y;
+}
+
+void pdfTexte(cairo_t *cr, double x, double y, const char *txt) {
+    cairo_move_to(cr, x, y);
+    cairo_show_text(cr, txt);
+}
+
+// Texte renvoyé à la ligne au mot près dans la largeur de la page ; renvoie
+// l'ordonnée de la dernière ligne écrite.
+double pdfParagraphe(cairo_t *cr, double x, double y, double pas, const char *txt) {
+    char ligne[1024] = "", essai[1024];
+    const char *p = txt;
+    while (*p) {
+        const char *mot = p;
+        while (*p && *p != ' ') p++;
+        snprintf(essai, sizeof(essai), "%s%s%.*s", ligne, ligne[0] ? " " : "", (int)(p - mot), mot);
+        cairo_text_extents_t ext;
+        cairo_text_extents(cr, essai, &ext);
+        if (ligne[0] && x + ext.x_advance > BULLETIN_PAGE_LARGEUR - BULLETIN_MARGE) {
+            pdfTexte(cr, x, y, ligne);
+            y = pdfLigne(cr, y, pas);
+            snprintf(ligne, sizeof(ligne), "%.*s", (int)(p - mot), mot);
+        } else {
+            memcpy(ligne, essai, sizeof(ligne));
+        }
+        while (*p == ' ') p++;
+    }
+    if (ligne[0]) pdfTexte(cr, x, y, ligne);
+    return y;
+}
+
+// Dessine le bulletin à partir du haut de la page courante (sans la terminer).
+void bulletinDessiner(cairo_t *cr, const Bulletins *b, const BulletinEleve *e) {
+    static const double colonnes[6] = { BULLETIN_MARGE, 260, 320, 380, 440, 500 };
+    static const char *entetes[6] = { "Matière", "Moyenne", "Classe", "Min", "Max", "Notes" };
+    char texte[512], moy[24], classe[24], min[24], max[24], nb[16];
+    double y = BULLETIN_MARGE + 16;
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 16);
+    snprintf(texte, sizeof(texte), "Bulletin – %s", b->titre);
+    pdfTexte(cr, BULLETIN_MARGE, y, texte);
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 11);
+    y += 26;
+    snprintf(texte, sizeof(texte), "Élève : %s – classe %s – n° %d", bulletinsChaine(b, e->nom),
+             bulletinsChaine(b, e->grade), e->id);
+    pdfTexte(cr, BULLETIN_MARGE, y, texte);
+
+    y += 28;
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 10);
+    for (int c = 0; c < 6; c++) pdfTexte(cr, colonnes[c], y, entetes[c]);
+    cairo_set_line_width(cr, 0.5);
+    cairo_move_to(cr, BULLETIN_MARGE, y + 4);
+    cairo_line_to(cr, BULLETIN_PAGE_LARGEUR - BULLETIN_MARGE, y + 4);
+    cairo_stroke(cr);
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    for (int j = 0; j < e->nb_matieres; j++) {
+        const MatiereBulletin *m = &b->matieres[e->premiere_matiere + j];
+        noteTexte(m->moyenne, moy, sizeof(moy));
+        noteTexte(m->moyenne_classe, classe, sizeof(classe));
+        noteTexte(m->note_min, min, sizeof(min));
+        noteTexte(m->note_max, max, sizeof(max));
+        snprintf(nb, sizeof(nb), "%d", m->nb_notes);
+        const char *valeurs[6] = { bulletinMatiere(b, m->matiere), moy, classe, min, max, nb };
+        y = pdfLigne(cr, y, 16);
+        for (int c = 0; c < 6; c++) pdfTexte(cr, colonnes[c], y, valeurs[c]);
+    }
+    if (e->nb_matieres == 0) {
+        y = pdfLigne(cr, y, 16);
+        pdfTexte(cr, BULLETIN_MARGE, y, "Aucune note ce trimestre.");
+    }
+    if (e->moyenne >= 0) {
+        noteTexte(e->moyenne, moy, sizeof(moy));
+        y = pdfLigne(cr, y, 20);
+        cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+        pdfTexte(cr, colonnes[0], y, "Moyenne générale");
+        pdfTexte(cr, colonnes[1], y, moy);
+    }
+
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 12);
+    y = pdfLigne(cr, y, 30);
+    pdfTexte(cr, BULLETIN_MARGE, y, "Appréciations");
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 10);
+    for (int j = 0; j < e->nb_appreciations; j++) {
+        const AppreciationBulletin *ap = &b->appreciations[e->premiere_appreciation + j];
+        snprintf(texte, sizeof(texte), "%s : %s", bulletinMatiere(b, ap->matiere), bulletinsChaine(b, ap->texte));
+        y = pdfParagraphe(cr, BULLETIN_MARGE, pdfLigne(cr, y, 16), 14, texte);
+    }
+    if (e->nb_appreciations == 0) pdfTexte(cr, BULLETIN_MARGE, y = pdfLigne(cr, y, 16), "Aucune appréciation.");
+
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 12);
+    y = pdfLigne(cr, y, 30);
+    pdfTexte(cr, BULLETIN_MARGE, y, "Assiduité");
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 10);
+    snprintf(texte, sizeof(texte), "%d absence%s, %d retard%s sur %d jour%s saisi%s.",
+             e->absences, e->absences > 1 ? "s" : "", e->retards, e->retards > 1 ? "s" : "",
+             e->saisies, e->saisies > 1 ? "s" : "", e->saisies > 1 ? "s" : "");
+    pdfTexte(cr, BULLETIN_MARGE, pdfLigne(cr, y, 16), texte);
+}
+
+// Surface PDF A4 ; la date de création est fixée au début du trimestre
+// (cairo mettrait sinon l'heure de génération).
+cairo_surface_t *bulletinsSurfacePDF(const Bulletins *b, const char *chemin) {
+    cairo_surface_t *surface = cairo_pdf_surface_create(chemin, BULLETIN_PAGE_LARGEUR, BULLETIN_PAGE_HAUTEUR);
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 16, 0)
+    cairo_pdf_surface_set_metadata(surface, CAIRO_PDF_METADATA_TITLE, b->titre);
+    cairo_pdf_surface_set_metadata(surface, CAIRO_PDF_METADATA_CREATE_DATE, b->date);
+#endif
+    return surface;
+}
+
+bool bulletinsFermerPDF(cairo_t *cr, cairo_surface_t *surface) {
+    cairo_destroy(cr);
+    cairo_surface_finish(surface);
+    bool ok = cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS;
+    cairo_surface_destroy(surface);
+    return ok;
+}
+#endif
+
+// Rend le bulletin de `e` et écrit ses fichiers (thread travailleur).
+bool bulletinProduire(Bulletins *b, BulletinEleve *e) {
+    char chemin[1024];
+    bulletinRendreHTML(b, e, &e->html);
+    snprintf(chemin, sizeof(chemin), "%s/bulletin-%d.html", b->dossier, e->id);
+    FILE *fp = fopen(chemin, "wb");
+    Sortie s = { fp, NULL, 0, 0, fp == NULL };
+    if (fp) {
+        bulletinsEnteteHTML(&s, b->titre);
+        sortieEcrire(&s, e->html.buf, e->html.len);
+        bulletinsPiedHTML(&s);
+        s.erreur = fclose(fp) != 0 || s.erreur;
+    }
+    bool ok = !s.erreur && !e->html.erreur;
+#ifndef CPRONOTE_HEADLESS
+    if (ok && b->options->pdf) {
+        snprintf(chemin, sizeof(chemin), "%s/bulletin-%d.pdf", b->dossier, e->id);
+        cairo_surface_t *surface = bulletinsSurfacePDF(b, chemin);
+        cairo_t *cr = cairo_create(surface);
+        bulletinDessiner(cr, b, e);
+        cairo_show_page(cr);
+        ok = bulletinsFermerPDF(cr, surface);
+    }
+#endif
+    if (!ok) journal(LOG_ERREUR, "Erreur d'écriture du bulletin", "fichier=\"%s\"", chemin);
+    return ok;
+}
+
+void *bulletin_thread(void *arg) {
+    Bulletins *b = arg;
+    pthread_mutex_lock(&b->mutex);
+    for (;;) {
+        while (!b->arret && b->suivant < b->nb && b->suivant >= b->ecrits + b->fenetre) {
+            pthread_cond_wait(&b->cond, &b->mutex);
+        }
+        if (b->arret || b->suivant == b->nb) break;
+        BulletinEleve *e = &b->eleves[b->suivant++];
+        pthread_mutex_unlock(&b->mutex);
+        bool ok = bulletinProduire(b, e);
+        pthread_mutex_lock(&b->mutex);
+        e->etat = ok ? TRANCHE_PRETE : TRANCHE_ERREUR;
+        b->arret = b->arret || !ok;
+        pthread_cond_broadcast(&b->cond);
+    }
+    pthread_mutex_unlock(&b->mutex);
+    return NULL;
+}
+
+// Avancement sur stderr, pour la ligne de commande.
+void progresBulletinsConsole(int faits, int total, void *data) {
+    if (faits % 100 == 0 || faits == total) fprintf(stderr, "\r%d / %d bulletins%s", faits, total, faits == total ? "\n" : "");
+}
+
+// Bulletins du trimestre "AAAA-Tn" dans `dossier`, créé au besoin. `bilan`
+// peut être NULL.
+bool genererBulletins(sqlite3 *db, const char *trimestre, const char *dossier, const OptionsBulletins *o,
+                      BilanBulletins *bilan) {
+    double t0 = diagDebut(), debut_s = diagHorloge();
+    BilanBulletins bb = { 0 };
+    int annee, debut, fin;
+    char date_debut[24], date_fin[24];
+    if (!bornesTrimestre(trimestre, &annee, &debut, &fin, date_debut, date_fin)) {
+        journal(LOG_ERREUR, "Trimestre invalide", "trimestre=\"%s\" attendu=\"AAAA-T1|T2|T3\"", trimestre);
+        return false;
+    }
+#ifdef CPRONOTE_HEADLESS
+    if (o->pdf) {
+        journal(LOG_ERREUR, "Bulletins PDF indisponibles", "raison=\"version sans GTK ni cairo\"");
+        return false;
+    }
+#endif
+    if (mkdir(dossier, 0755) != 0 && errno != EEXIST) {
+        journal(LOG_ERREUR, "Erreur de création du dossier des bulletins", "dossier=\"%s\" erreur=\"%s\"", dossier, strerror(errno));
+        return false;
+    }
+    Bulletins b;
+    memset(&b, 0, sizeof(b));
+    b.options = o;
+    b.dossier = dossier;
+    snprintf(b.trimestre, sizeof(b.trimestre), "%s", trimestre);
+    snprintf(b.titre, sizeof(b.titre), "trimestre %c, %d-%d", strchr(trimestre, 'T')[1], annee, annee + 1);
+    snprintf(b.date, sizeof(b.date), "%sT00:00:00", date_debut);
+    bool ok = bulletinsLire(&b, db, annee, debut, fin, date_debut, date_fin);
+    bb.secondes_lecture = diagHorloge() - debut_s;
+    bb.eleves = b.nb;
+
+    // Fichiers communs, écrits dans l'ordre des élèves
+    char chemin[1024];
+    snprintf(chemin, sizeof(chemin), "%s/bulletins.html", dossier);
+    FILE *fp = ok ? fopen(chemin, "wb") : NULL;
+    Sortie commun = { fp, NULL, 0, 0, false };
+    if (ok && !fp) {
+        journal(LOG_ERREUR, "Erreur d'ouverture du fichier des bulletins", "fichier=\"%s\" erreur=\"%s\"", chemin, strerror(errno));
+        ok = false;
+    }
+    if (ok) bulletinsEnteteHTML(&commun, b.titre);
+#ifndef CPRONOTE_HEADLESS
+    cairo_surface_t *surface = NULL;
+    cairo_t *cr = NULL;
+    if (ok && o->pdf) {
+        snprintf(chemin, sizeof(chemin), "%s/bulletins.pdf", dossier);
+        surface = bulletinsSurfacePDF(&b, chemin);
+        cr = cairo_create(surface);
+    }
+#endif
+
+    int nb_travailleurs = o->travailleurs > 0 ? o->travailleurs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_travailleurs < 1) nb_travailleurs = 1;
+    if (nb_travailleurs > BULLETIN_TRAVAILLEURS_MAX) nb_travailleurs = BULLETIN_TRAVAILLEURS_MAX;
+    b.fenetre = nb_travailleurs * BULLETIN_EN_VOL_PAR_TRAVAILLEUR;
+    pthread_mutex_init(&b.mutex, NULL);
+    pthread_cond_init(&b.cond, NULL);
+    pthread_t threads[BULLETIN_TRAVAILLEURS_MAX];
+    int lances = 0;
+    for (; ok && lances < nb_travailleurs; lances++) {
+        if (pthread_create(&threads[lances], NULL, bulletin_thread, &b) != 0) break;
+    }
+    ok = ok && lances > 0;
+    for (int i = 0; ok && i < b.nb; i++) {
+        BulletinEleve *e = &b.eleves[i];
+        pthread_mutex_lock(&b.mutex);
+        while (e->etat == TRANCHE_A_FAIRE && !b.arret) pthread_cond_wait(&b.cond, &b.mutex);
+        ok = e->etat == TRANCHE_PRETE;
+        pthread_mutex_unlock(&b.mutex);
+        if (!ok || (o->annule && o->annule(o->data))) {
+            ok = false;
+            break;
+        }
+        sortieEcrire(&commun, e->html.buf, e->html.len);
+        bb.octets += e->html.len;
+#ifndef CPRONOTE_HEADLESS
+        if (cr) {
+            bulletinDessiner(cr, &b, e);
+            cairo_show_page(cr);
+        }
+#endif
+        free(e->html.buf);
+        e->html.buf = NULL;
+        bb.fichiers += o->pdf ? 2 : 1;
+        if (o->progres) o->progres(i + 1, b.nb, o->data);
+        pthread_mutex_lock(&b.mutex);
+        b.ecrits = i + 1;
+        pthread_cond_broadcast(&b.cond);
+        pthread_mutex_unlock(&b.mutex);
+    }
+    pthread_mutex_lock(&b.mutex);
+    b.arret = true;
+    pthread_cond_broadcast(&b.cond);
+    pthread_mutex_unlock(&b.mutex);
+    for (int i = 0; i < lances; i++) pthread_join(threads[i], NULL);
+
+    if (fp) {
+        bulletinsPiedHTML(&commun);
+        ok = fclose(fp) == 0 && !commun.erreur && ok;
+        bb.fichiers++;
+    }
+#ifndef CPRONOTE_HEADLESS
+    if (cr) {
+        ok = bulletinsFermerPDF(cr, surface) && ok;
+        bb.fichiers++;
+    }
+#endif
+    for (int i = 0; i < b.nb; i++) free(b.eleves[i].html.buf);
+    free(b.eleves);
+    free(b.matieres);
+    free(b.appreciations);
+    free(b.textes.octets);
+    pthread_mutex_destroy(&b.mutex);
+    pthread_cond_destroy(&b.cond);
+
+    bb.travailleurs = lances;
+    bb.secondes = diagHorloge() - debut_s;
+    if (bilan) *bilan = bb;
+    diagFin(DIAG_BULLETINS, t0, bb.eleves);
+    if (!ok) return false;
+    journal(LOG_INFO, "Bulletins générés", "trimestre=%s dossier=\"%s\" eleves=%d fichiers=%d travailleurs=%d "
+            "lecture_ms=%.0f duree_ms=%.0f", trimestre, dossier, bb.eleves, bb.fichiers, bb.travailleurs,
+            bb.secondes_lecture * 1e3, bb.secondes * 1e3);
+    auditer("bulletins trimestre=%s dossier=%s", trimestre, dossier);
+    return true;
+}
+
+/*
+ * Import CSV en flux : relit le format produit par exporterCSV
+ * (ID,Nom,Age,Taille,Email,Telephone,Grade) à travers un tampon de taille
+ * fixe, gère les champs entre guillemets (RFC 4180), insère via une requête
+ * réutilisée et valide une transaction toutes les `lot` lignes. Les lignes
+ * invalides partent dans un fichier de rejets au lieu d'interrompre l'import.
+ */
+typedef struct {
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    FILE *in;
+    FILE *rejets;
+    char tampon[CSV_BUFFER_SIZE];
+    size_t tampon_len;
+    size_t tampon_pos;
+    bool fin_fichier;
+    char *enreg;                    // champs de l'enregistrement courant, séparés par '\0'
+    size_t enreg_len;
+    size_t enreg_cap;
+    size_t champs[CSV_MAX_CHAMPS];  // décalage de chaque champ dans `enreg`
+    int nb_champs;
+    bool trop_de_champs;
+    int lot;
+    int dans_lot;
+    bool externe;               // transaction de l'appelant : ni BEGIN ni COMMIT
+    bool echec;                 // BEGIN ou COMMIT refusé : import arrêté
+    long ligne;
+    long importees;             // validées, plus celles du lot en cours
+    long validees;
+    long rejetees;
+    long octets_lus;
+    long taille_fichier;
+} ImportCSV;
+
+int csvLireCaractere(ImportCSV *imp) {
+    if (imp->tampon_pos == imp->tampon_len) {
+        if (imp->fin_fichier) return EOF;
+        imp->tampon_len = fread(imp->tampon, 1, sizeof(imp->tampon), imp->in);
+        imp->tampon_pos = 0;
+        imp->octets_lus += imp->tampon_len;
+        if (imp->tampon_len == 0) {
+            imp->fin_fichier = true;
+            return EOF;
+        }
+    }
+    return (unsigned char)imp->tampon[imp->tampon_pos++];
+}
+
+bool csvAjouterOctet(ImportCSV *imp, char c) {
+    if (imp->enreg_len == imp->enreg_cap) {
+        size_t cap = imp->enreg_cap ? imp->enreg_cap * 2 : 256;
+        char *p = realloc(imp->enreg, cap);
+        if (!p) return false;
+        imp->enreg = p;
+        imp->enreg_cap = cap;
+    }
+    imp->enreg[imp->enreg_len++] = c;
+    return true;
+}
+
+void csvTerminerChamp(ImportCSV *imp) {
+    csvAjouterOctet(imp, '\0');
+    if (imp->nb_champs + 1 < CSV_MAX_CHAMPS) {
+        imp->champs[++imp->nb_champs] = imp->enreg_len;
+    } else {
+        imp->trop_de_champs = true;
+    }
+}
+
+// Lit un enregistrement complet ; renvoie false en fin de fichier.
+bool csvLireEnregistrement(ImportCSV *imp) {
+    imp->enreg_len = 0;
+    imp->nb_champs = 0;
+    imp->champs[0] = 0;
+    imp->trop_de_champs = false;
+    bool entre_guillemets = false;
+    bool vide = true;
+    int c;
+    while ((c = csvLireCaractere(imp)) != EOF) {
+        vide = false;
+        if (entre_guillemets) {
+            if (c == '"') {
+                int suivant = csvLireCaractere(imp);
+                if (suivant == '"') {
+                    csvAjouterOctet(imp, '"');
+                    continue;
+                }
+                entre_guillemets = false;
+                if (suivant == EOF) break;
+                c = suivant;
+            } else {
+                csvAjouterOctet(imp, (char)c);
+                continue;
+            }
+        }
+        if (c == '"') {
+            entre_guillemets = true;
+        } else if (c == ',') {
+            csvTerminerChamp(imp);
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            csvAjouterOctet(imp, (char)c);
+        }
+    }
+    if (vide) return false;
+    csvTerminerChamp(imp);
+    imp->ligne++;
+    return true;
+}
+
+const char *csvChamp(ImportCSV *imp, int i) {
+    return imp->enreg + imp->champs[i];
+}
+
+void importRejeter(ImportCSV *imp, const char *raison) {
+    imp->rejetees++;
+    if (!imp->rejets) return;
+    Sortie s = { imp->rejets, NULL, 0, 0, false };
+    sortiePrintf(&s, "%ld,", imp->ligne);
+    csvChampSortie(&s, raison);
+    for (int i = 0; i < imp->nb_champs; i++) {
+        sortieEcrire(&s, ",", 1);
+        csvChampSortie(&s, csvChamp(imp, i));
+    }
+    sortieEcrire(&s, "\n", 1);
+}
+
+bool csvEntier(const char *s, long *val) {
+    char *fin;
+    *val = strtol(s, &fin, 10);
+    return *s && *fin == '\0';
+}
+
+bool csvReel(const char *s, double *val) {
+    char *fin;
+    *val = strtod(s, &fin);
+    return *s && *fin == '\0';
+}
+
+void importerLigne(ImportCSV *imp) {
+    if (imp->nb_champs != CSV_NB_COLONNES || imp->trop_de_champs) {
+        importRejeter(imp, "nombre de colonnes invalide");
+        return;
+    }
+    const char *id = csvChamp(imp, 0);
+    const char *nom = csvChamp(imp, 1);
+    long id_val = 0, age = 0;
+    double taille = 0;
+    if (*id && (!csvEntier(id, &id_val) || id_val <= 0)) {
+        importRejeter(imp, "ID invalide");
+        return;
+    }
+    if (!*nom) {
+        importRejeter(imp, "nom manquant");
+        return;
+    }
+    if (*csvChamp(imp, 2) && !csvEntier(csvChamp(imp, 2), &age)) {
+        importRejeter(imp, "âge invalide");
+        return;
+    }
+    if (*csvChamp(imp, 3) && !csvReel(csvChamp(imp, 3), &taille)) {
+        importRejeter(imp, "taille invalide");
+        return;
+    }
+    sqlite3_stmt *stmt = imp->stmt;
+    if (*id) sqlite3_bind_int64(stmt, 1, id_val);
+    else sqlite3_bind_null(stmt, 1);
+    sqlite3_bind_text(stmt, 2, nom, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, (int)age);
+    sqlite3_bind_double(stmt, 4, taille);
+    sqlite3_bind_text(stmt, 5, csvChamp(imp, 4), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 6, csvChamp(imp, 5), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 7, csvChamp(imp, 6), -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        importRejeter(imp, sqlite3_errmsg(imp->db));
+        return;
+    }
+    colonnesEcrire(imp->db, (int)sqlite3_last_insert_rowid(imp->db), (int)age, (float)taille, csvChamp(imp, 6));
+    trigrammesEcrire(imp->db, (int)sqlite3_last_insert_rowid(imp->db), nom, csvChamp(imp, 4));
+    imp->importees++;
+}
+
+// Valide le lot en cours. Si COMMIT échoue, le lot est annulé et ses lignes
+// ne sont plus comptées comme importées ; l'import s'arrête là.
+bool importValiderLot(ImportCSV *imp) {
+    if (imp->dans_lot == 0) return !imp->echec;
+    imp->dans_lot = 0;
+    if (!imp->externe && sqlite3_exec(imp->db, "COMMIT;", 0, 0, NULL) != SQLITE_OK) {
+        journal(LOG_ERREUR, "Erreur de validation de l'import", "ligne=%ld lot=%ld erreur=\"%s\"",
+                imp->ligne, imp->importees - imp->validees, sqlite3_errmsg(imp->db));
+        if (!sqlite3_get_autocommit(imp->db)) sqlite3_exec(imp->db, "ROLLBACK;", 0, 0, NULL);
+        imp->importees = imp->validees;
+        imp->echec = true;
+        return false;
+    }
+    imp->validees = imp->importees;
+    return true;
+}
+
+ImportCSV *importOuvrir(sqlite3 *db, const char *chemin, const char *chemin_rejets, int lot) {
+    ImportCSV *imp = calloc(1, sizeof(ImportCSV));
+    if (!imp) return NULL;
+    imp->in = fopen(chemin, "rb");
+    if (!imp->in) {
+        log_error("Erreur: Impossible d'ouvrir le fichier CSV pour lecture.");
+        free(imp);
+        return NULL;
+    }
+    if (fseek(imp->in, 0, SEEK_END) == 0) {
+        imp->taille_fichier = ftell(imp->in);
+        rewind(imp->in);
+    }
+    imp->db = db;
+    imp->externe = !sqlite3_get_autocommit(db);
+    imp->lot = lot > 0 ? lot : IMPORT_LOT_DEFAUT;
+    imp->stmt = obtenirRequete(db, STMT_IMPORT_ELEVE);
+    if (!imp->stmt) {
+        fclose(imp->in);
+        free(imp);
+        return NULL;
+    }
+    if (chemin_rejets) {
+        imp->rejets = fopen(chemin_rejets, "w");
+        if (imp->rejets) fprintf(imp->rejets, "Ligne,Raison,ID,Nom,Age,Taille,Email,Telephone,Grade\n");
+    }
+    return imp;
+}
+
+bool importEtapeLignes(ImportCSV *imp, int max_lignes) {
+    for (int i = 0; i < max_lignes; i++) {
+        if (!csvLireEnregistrement(imp)) {
+            importValiderLot(imp);
+            return false;
+        }
+        if (imp->nb_champs == 1 && *csvChamp(imp, 0) == '\0') {
+            continue;   // ligne vide
+        }
+        if (imp->ligne == 1 && strcmp(csvChamp(imp, 0), "ID") == 0) {
+            continue;   // en-tête
+        }
+        if (imp->dans_lot == 0 && !imp->externe && sqlite3_exec(imp->db, "BEGIN IMMEDIATE;", 0, 0, NULL) != SQLITE_OK) {
+            log_error(sqlite3_errmsg(imp->db));
+            imp->echec = true;
+            return false;
+        }
+        importerLigne(imp);
+        if (++imp->dans_lot >= imp->lot && !importValiderLot(imp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Traite au plus `max_lignes` enregistrements ; renvoie false une fois le
+// fichier épuisé ou sur erreur (imp->echec). Permet d'entrecouper l'import
+// avec la boucle GTK.
+bool importEtape(ImportCSV *imp, int max_lignes) {
+    double t0 = diagDebut();
+    long avant = imp->importees + imp->rejetees;
+    bool suite = importEtapeLignes(imp, max_lignes);
+    diagFin(DIAG_IMPORTER, t0, imp->importees + imp->rejetees - avant);
+    return suite;
+}
+
+double importProgression(const ImportCSV *imp) {
+    if (imp->taille_fichier <= 0) return 0.0;
+    double lus = (double)(imp->octets_lus - (long)(imp->tampon_len - imp->tampon_pos));
+    return lus / imp->taille_fichier;
+}
+
+void importFermer(ImportCSV *imp) {
+    if (!imp) return;
+    importValiderLot(imp);
+    libererRequete(imp->stmt);
+    fclose(imp->in);
+    if (imp->rejets) fclose(imp->rejets);
+    free(imp->enreg);
+    free(imp);
+}
+
+bool importerCSV(sqlite3 *db, const char *chemin, long *importees, long *rejetees) {
+    ImportCSV *imp = importOuvrir(db, chemin, CSV_REJETS_FILENAME, IMPORT_LOT_DEFAUT);
+    if (!imp) return false;
+    while (importEtape(imp, IMPORT_LOT_DEFAUT)) {
+    }
+    importValiderLot(imp);
+    bool ok = !imp->echec;
+    if (importees) *importees = imp->importees;
+    if (rejetees) *rejetees = imp->rejetees;
+    importFermer(imp);
+    return ok;
+}
+
+// Transforme un terme saisi en requête FTS5 : chaque mot devient un préfixe
+// entre guillemets ("dup"* "3a"*), les mots étant combinés par ET.
+// Renvoie false si le terme ne contient aucun mot.
+bool construireRequeteFTS(const char *terme, char *out, size_t taille) {
+    size_t len = 0;
+    bool mot = false;
+    out[0] = '\0';
+    for (const unsigned char *c = (const unsigned char*)terme; ; c++) {
+        bool car_mot = *c && (*c >= 0x80 || (*c >= '0' && *c <= '9') ||
+                              ((*c | 0x20) >= 'a' && (*c | 0x20) <= 'z'));
+        if (car_mot && !mot) {
+            if (len + 4 >= taille) return false;
+            if (len) out[len++] = ' ';
+            out[len++] = '"';
+            mot = true;
+        } else if (!car_mot && mot) {
+            if (len + 3 >= taille) return false;
+            out[len++] = '"';
+            out[len++] = '*';
+            mot = false;
+        }
+        if (!*c) break;
+        if (car_mot) {
+            if (len + 3 >= taille) return false;
+            out[len++] = (char)*c;
+        }
+    }
+    out[len] = '\0';
+    return len > 0;
+}
+
+// Rend les élèves trouvés pour `terme` ; renvoie leur nombre (0 si le
+// terme ne contient aucun mot, sans rien écrire), -1 en cas d'erreur.
+long rechercherEleveRendu(sqlite3 *db, const char *terme, const FormatRendu *f, Sortie *s) {
+    char expr[MAX_QUERY];
+    if (!construireRequeteFTS(terme, expr, sizeof(expr))) {
+        return 0;
+    }
+    double t0 = diagDebut();
+    char cle[CACHE_CLE_MAX];
+    EtatCache etat;
+    LotEleves lot = { 0 };
+    bool gardable = cacheResultatsCle(cle, sizeof(cle), "recherche-complete", expr) && cacheResultatsEtat(db, &etat);
+    if (!gardable || !cacheResultatsLire(&etat, cle, &lot, NULL)) {
+        sqlite3_stmt *stmt = obtenirRequete(db, STMT_RECHERCHE_ELEVES);
+        if (!stmt) return -1;
+        sqlite3_bind_text(stmt, 1, expr, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, -1);
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (!lotAjouterLigne(&lot, stmt)) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+        }
+        if (rc != SQLITE_DONE) log_error(rc == SQLITE_NOMEM ? "Mémoire insuffisante" : sqlite3_errmsg(db));
+        libererRequete(stmt);
+        if (rc != SQLITE_DONE) {
+            lotLiberer(&lot);
+            return -1;
+        }
+        if (gardable) cacheResultatsAjouter(&etat, cle, &lot, NULL);
+    }
+    long n = rendreLot(&lot, f, s);
+    lotLiberer(&lot);
+    diagFin(DIAG_RECHERCHER, t0, n > 0 ? n : 0);
+    return n;
+}
+
+bool rechercherEleve(sqlite3 *db, const char *terme, char **resultStr) {
+    *resultStr = NULL;
+    Sortie s = { NULL, NULL, 0, 0, false };
+    long n = rechercherEleveRendu(db, terme, &format_table, &s);
+    if (n <= 0) {
+        free(s.buf);
+        return n == 0;
+    }
+    *resultStr = s.buf;
+    return true;
+}
+
+/*
+ * Identifiants : users.password_hash vaut
+ * "$pbkdf2-sha256$<itérations>$<sel>$<empreinte>", PBKDF2-HMAC-SHA256
+ * (RFC 8018) avec un sel de 16 octets propre à l'utilisateur, sel et
+ * empreinte en hexadécimal. Le nombre d'itérations est étalonné au premier
+ * besoin pour qu'une vérification dure IDENTIFIANTS_CIBLE_MS sur ce poste,
+ * puis enregistré dans parametres (clé pbkdf2_iterations ; supprimer la
+ * ligne fait réétalonner). Un mot de passe stocké en clair (utilisateur créé
+ * à la main) ou avec moins d'itérations est réécrit à la connexion réussie
+ * suivante. Les comparaisons se font à temps constant.
+ *
+ * Une connexion réussie ouvre une session en mémoire : son jeton, HMAC de
+ * l'utilisateur et du mot de passe sous une clé tirée au démarrage, permet
+ * de se reconnecter pendant SESSION_DUREE_S sans refaire la dérivation, tant
+ * que le mot de passe stocké n'a pas changé. Un mauvais mot de passe donne
+ * un autre jeton et repasse par la dérivation.
+ *
+ * Ces sessions meurent avec le processus : la ligne de commande, lancée une
+ * fois par commande, ouvre plutôt une session en base (commande `session`).
+ * Son jeton aléatoire, passé dans CPRONOTE_SESSION, vaut pour
+ * SESSION_COMMANDES_DUREE_S ; la table sessions n'en garde que le HMAC sous
+ * l'empreinte stockée du mot de passe, qui le révoque en changeant.
+ */
+#define PBKDF2_PREFIXE "$pbkdf2-sha256$"
+#define PBKDF2_SEL 16
+#define PBKDF2_ITERATIONS_MIN 100000
+#define IDENTIFIANTS_CIBLE_MS 100
+#define IDENTIFIANT_MAX 256             // password_hash lu ou écrit
+#define SESSIONS_MAX 16
+#define SESSION_DUREE_S 1800
+#define SESSION_COMMANDES_DUREE_S (8 * 3600)
+
+typedef struct {
+    uint32_t h[8];
+    uint8_t bloc[64];
+    size_t n;                           // octets en attente dans bloc
+    uint64_t total;
+} Sha256;
+
+const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTD32(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+void sha256Bloc(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTD32(w[i - 15], 7) ^ ROTD32(w[i - 15], 18) ^ w[i - 15] >> 3;
+        uint32_t s1 = ROTD32(w[i - 2], 17) ^ ROTD32(w[i - 2], 19) ^ w[i - 2] >> 10;
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROTD32(e, 6) ^ ROTD32(e, 11) ^ ROTD32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROTD32(a, 2) ^ ROTD32(a, 13) ^ ROTD32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void sha256Init(Sha256 *c) {
+    static const uint32_t iv[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(c->h, iv, sizeof(iv));
+    c->n = 0;
+    c->total = 0;
+}
+
+void sha256Ajouter(Sha256 *c, const void *data, size_t len) {
+    const uint8_t *p = data;
+    c->total += len;
+    while (len > 0) {
+        size_t n = 64 - c->n < len ? 64 - c->n : len;
+        memcpy(c->bloc + c->n, p, n);
+        c->n += n;
+        p += n;
+        len -= n;
+        if (c->n == 64) {
+            sha256Bloc(c->h, c->bloc);
+            c->n = 0;
+        }
+    }
+}
+
+void sha256Octets(const uint32_t h[8], uint8_t out[32]) {
+    for (int i = 0; i < 8; i++) {
+        out[4 * i] = (uint8_t)(h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+void sha256Fin(Sha256 *c, uint8_t out[32]) {
+    uint64_t bits = c->total * 8;
+    uint8_t bourrage[72] = { 0x80 };
+    size_t n = (c->n < 56 ? 56 : 120) - c->n;
+    for (int i = 0; i < 8; i++) bourrage[n + i] = (uint8_t)(bits >> (56 - 8 * i));
+    sha256Ajouter(c, bourrage, n + 8);
+    sha256Octets(c->h, out);
+}
+
+// HMAC-SHA256 : états après les blocs ipad et opad, réutilisables pour
+// chaque message signé avec la même clé.
+typedef struct {
+    Sha256 interne;
+    Sha256 externe;
+} HmacSha256;
+
+void hmacInit(HmacSha256 *h, const void *cle, size_t len) {
+    uint8_t bloc[64] = { 0 }, pad[64];
+    if (len > 64) {
+        Sha256 c;
+        sha256Init(&c);
+        sha256Ajouter(&c, cle, len);
+        sha256Fin(&c, bloc);
+    } else {
+        memcpy(bloc, cle, len);
+    }
+    for (int i = 0; i < 64; i++) pad[i] = bloc[i] ^ 0x36;
+    sha256Init(&h->interne);
+    sha256Ajouter(&h->interne, pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = bloc[i] ^ 0x5c;
+    sha256Init(&h->externe);
+    sha256Ajouter(&h->externe, pad, 64);
+}
+
+// `c` : état interne auquel le message a déjà été ajouté.
+void hmacFin(const HmacSha256 *h, Sha256 *c, uint8_t out[32]) {
+    uint8_t interne[32];
+    sha256Fin(c, interne);
+    Sha256 e = h->externe;
+    sha256Ajouter(&e, interne, 32);
+    sha256Fin(&e, out);
+}
+
+void hmacSha256(const void *cle, size_t len_cle, const void *msg, size_t len, uint8_t out[32]) {
+    HmacSha256 h;
+    hmacInit(&h, cle, len_cle);
+    Sha256 c = h.interne;
+    sha256Ajouter(&c, msg, len);
+    hmacFin(&h, &c, out);
+}
+
+// PBKDF2-HMAC-SHA256 réduit à un bloc de sortie (32 octets). Chaque
+// itération signe 32 octets : un seul bloc SHA-256 par état, rempli une fois
+// pour toutes sauf les 32 premiers octets, sans repasser par sha256Ajouter.
+void pbkdf2Sha256(const char *mot_de_passe, const uint8_t *sel, size_t len_sel, long iterations, uint8_t out[32]) {
+    double t0 = diagDebut();
+    HmacSha256 h;
+    hmacInit(&h, mot_de_passe, strlen(mot_de_passe));
+    Sha256 c = h.interne;
+    sha256Ajouter(&c, sel, len_sel);
+    sha256Ajouter(&c, "\0\0\0\1", 4);
+    uint8_t u[64] = { 0 };
+    hmacFin(&h, &c, u);
+    memcpy(out, u, 32);
+    u[32] = 0x80;                       // bourrage : (64 + 32) octets = 0x300 bits
+    u[62] = 0x03;
+    for (long i = 1; i < iterations; i++) {
+        uint32_t s[8];
+        memcpy(s, h.interne.h, sizeof(s));
+        sha256Bloc(s, u);
+        sha256Octets(s, u);
+        memcpy(s, h.externe.h, sizeof(s));
+        sha256Bloc(s, u);
+        sha256Octets(s, u);
+        for (int j = 0; j < 32; j++) out[j] ^= u[j];
+    }
+    diagFin(DIAG_DERIVATION, t0, iterations);
+}
+
+bool egalTempsConstant(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+void versHexa(const uint8_t *p, size_t n, char *out) {
+    static const char chiffres[] = "0123456789abcdef";
+    for (size_t i = 0; i < n; i++) {
+        out[2 * i] = chiffres[p[i] >> 4];
+        out[2 * i + 1] = chiffres[p[i] & 15];
+    }
+    out[2 * n] = '\0';
+}
+
+// Lit exactement 2n chiffres hexadécimaux ; renvoie la suite du texte.
+const char *depuisHexa(const char *s, uint8_t *out, size_t n) {
+    for (size_t i = 0; i < 2 * n; i++) {
+        char c = s[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) return NULL;
+        out[i / 2] = (uint8_t)(i % 2 ? out[i / 2] | v : v << 4);
+    }
+    return s + 2 * n;
+}
+
+bool octetsAleatoires(uint8_t *out, size_t n) {
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    size_t lus = 0;
+    while (fd >= 0 && lus < n) {
+        ssize_t r = read(fd, out + lus, n - lus);
+        if (r <= 0 && errno != EINTR) break;
+        if (r > 0) lus += (size_t)r;
+    }
+    if (fd >= 0) close(fd);
+    if (lus < n) journal(LOG_ERREUR, "Source aléatoire indisponible", "fichier=/dev/urandom");
+    return lus == n;
+}
+
+// Nombre d'itérations donnant `cible_ms` par dérivation sur ce poste, par
+// pas de 1000, au moins PBKDF2_ITERATIONS_MIN.
+long etalonnerIterations(double cible_ms) {
+    const uint8_t sel[PBKDF2_SEL] = { 0 };
+    uint8_t out[32];
+    long essai = 4096;
+    double duree;
+    for (;;) {
+        double t0 = diagHorloge();
+        pbkdf2Sha256("etalonnage", sel, sizeof(sel), essai, out);
+        duree = diagHorloge() - t0;
+        if (duree >= 0.02 || essai >= (1L << 26)) break;
+        essai *= 2;
+    }
+    long n = (long)(cible_ms / 1e3 / duree * essai);
+    n = (n + 999) / 1000 * 1000;
+    return n < PBKDF2_ITERATIONS_MIN ? PBKDF2_ITERATIONS_MIN : n;
+}
+
+long iterations_etalonnees;
+pthread_once_t etalonnage_fait = PTHREAD_ONCE_INIT;
+
+void etalonnerUneFois(void) {
+    iterations_etalonnees = etalonnerIterations(IDENTIFIANTS_CIBLE_MS);
+}
+
+// Itérations en vigueur pour la base : celles de parametres, sinon
+// l'étalonnage de ce poste (une fois par processus), enregistré.
+long identifiantsIterations(sqlite3 *bdd) {
+    long n = 0;
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_PARAMETRE_LIRE);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, "pbkdf2_iterations", -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) n = sqlite3_column_int64(stmt, 0);
+        libererRequete(stmt);
+    }
+    if (n > 0) return n;
+    pthread_once(&etalonnage_fait, etalonnerUneFois);
+    n = iterations_etalonnees;
+    if ((stmt = obtenirRequete(bdd, STMT_PARAMETRE_ECRIRE))) {
+        sqlite3_bind_text(stmt, 1, "pbkdf2_iterations", -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, n);
+        if (sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(bdd) > 0) {
+            journal(LOG_INFO, "Dérivation des mots de passe étalonnée", "iterations=%ld cible_ms=%d", n, IDENTIFIANTS_CIBLE_MS);
+        }
+        libererRequete(stmt);
+    }
+    return n;
+}
+
+// Empreinte à stocker pour `mot_de_passe` (IDENTIFIANT_MAX octets), sel neuf.
+bool hacherMotDePasse(const char *mot_de_passe, long iterations, char *out) {
+    uint8_t sel[PBKDF2_SEL], empreinte[32];
+    if (!octetsAleatoires(sel, sizeof(sel))) return false;
+    pbkdf2Sha256(mot_de_passe, sel, sizeof(sel), iterations, empreinte);
+    char sel_hexa[2 * PBKDF2_SEL + 1], empreinte_hexa[65];
+    versHexa(sel, sizeof(sel), sel_hexa);
+    versHexa(empreinte, sizeof(empreinte), empreinte_hexa);
+    snprintf(out, IDENTIFIANT_MAX, PBKDF2_PREFIXE "%ld$%s$%s", iterations, sel_hexa, empreinte_hexa);
+    return true;
+}
+
+/*
+ * Sessions vérifiées : jeton -> utilisateur, empreinte stockée au moment de
+ * la vérification (un changement de mot de passe invalide la session).
+ */
+typedef struct {
+    uint8_t jeton[32];
+    uint8_t stocke[32];                 // SHA-256 de password_hash
+    int user_id;
+    double expiration;                  // 0 : place libre
+} SessionConnexion;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    uint8_t cle[32];
+    bool cle_prete;
+    SessionConnexion entrees[SESSIONS_MAX];
+} Sessions;
+
+Sessions sessions = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+void sessionsEmpreinte(const char *stocke, uint8_t out[32]) {
+    Sha256 c;
+    sha256Init(&c);
+    sha256Ajouter(&c, stocke, strlen(stocke));
+    sha256Fin(&c, out);
+}
+
+// Jeton de (utilisateur, mot de passe) ; appelé sous le verrou.
+void sessionsJeton(const char *username, const char *password, uint8_t out[32]) {
+    if (!sessions.cle_prete) {
+        sessions.cle_prete = octetsAleatoires(sessions.cle, sizeof(sessions.cle));
+    }
+    HmacSha256 h;
+    hmacInit(&h, sessions.cle, sizeof(sessions.cle));
+    Sha256 c = h.interne;
+    sha256Ajouter(&c, username, strlen(username) + 1);
+    sha256Ajouter(&c, password, strlen(password));
+    hmacFin(&h, &c, out);
+}
+
+// Vrai si une session en cours couvre (utilisateur, mot de passe) pour
+// l'empreinte stockée `stocke` ; la prolonge.
+bool sessionsVerifier(const char *username, const char *password, const char *stocke, int user_id) {
+    uint8_t jeton[32], empreinte[32];
+    sessionsEmpreinte(stocke, empreinte);
+    double maintenant = diagHorloge();
+    bool trouve = false;
+    pthread_mutex_lock(&sessions.mutex);
+    sessionsJeton(username, password, jeton);
+    for (int i = 0; sessions.cle_prete && i < SESSIONS_MAX; i++) {
+        SessionConnexion *s = &sessions.entrees[i];
+        bool valide = egalTempsConstant(s->jeton, jeton, 32) & egalTempsConstant(s->stocke, empreinte, 32) &
+                      (s->user_id == user_id) & (s->expiration > maintenant);
+        if (valide) {
+            s->expiration = maintenant + SESSION_DUREE_S;
+            trouve = true;
+        }
+    }
+    pthread_mutex_unlock(&sessions.mutex);
+    diagCacheCompter(DIAG_CACHE_SESSIONS, trouve);
+    return trouve;
+}
+
+void sessionsOuvrir(const char *username, const char *password, const char *stocke, int user_id) {
+    double maintenant = diagHorloge();
+    pthread_mutex_lock(&sessions.mutex);
+    SessionConnexion *place = &sessions.entrees[0];
+    for (int i = 0; i < SESSIONS_MAX; i++) {
+        SessionConnexion *s = &sessions.entrees[i];
+        if (s->user_id == user_id || s->expiration <= maintenant) {
+            place = s;
+            break;
+        }
+        if (s->expiration < place->expiration) place = s;      // la plus proche de la fin
+    }
+    sessionsJeton(username, password, place->jeton);
+    sessionsEmpreinte(stocke, place->stocke);
+    place->user_id = user_id;
+    place->expiration = sessions.cle_prete ? maintenant + SESSION_DUREE_S : 0;
+    pthread_mutex_unlock(&sessions.mutex);
+}
+
+// Ferme toutes les sessions : la prochaine connexion refait la dérivation.
+void sessionsVider(void) {
+    pthread_mutex_lock(&sessions.mutex);
+    memset(sessions.entrees, 0, sizeof(sessions.entrees));
+    pthread_mutex_unlock(&sessions.mutex);
+}
+
+// Découpe une empreinte "$pbkdf2-sha256$..." ; faux si elle n'en est pas une.
+bool lireEmpreinte(const char *stocke, long *n, uint8_t sel[PBKDF2_SEL], uint8_t attendue[32]) {
+    if (strncmp(stocke, PBKDF2_PREFIXE, strlen(PBKDF2_PREFIXE)) != 0) return false;
+    char *fin;
+    *n = strtol(stocke + strlen(PBKDF2_PREFIXE), &fin, 10);
+    const char *p = *n > 0 && *fin == '$' ? depuisHexa(fin + 1, sel, PBKDF2_SEL) : NULL;
+    p = p && *p == '$' ? depuisHexa(p + 1, attendue, 32) : NULL;
+    return p && *p == '\0';
+}
+
+// Vérifie `password` contre l'empreinte stockée ; *a_rehacher si elle est en
+// clair ou moins coûteuse que `iterations`.
+bool verifierMotDePasse(const char *stocke, const char *password, long iterations, bool *a_rehacher) {
+    uint8_t sel[PBKDF2_SEL], attendue[32], calculee[32];
+    long n = 0;
+    if (!lireEmpreinte(stocke, &n, sel, attendue)) {
+        // en clair (ou illisible) : comparaison de HMAC, à temps constant
+        // quelle que soit la longueur
+        hmacSha256("clair", 5, stocke, strlen(stocke), attendue);
+        hmacSha256("clair", 5, password, strlen(password), calculee);
+        *a_rehacher = true;
+        return stocke[0] != '\0' && egalTempsConstant(attendue, calculee, 32);
+    }
+    pbkdf2Sha256(password, sel, sizeof(sel), n, calculee);
+    *a_rehacher = n < iterations;
+    return egalTempsConstant(attendue, calculee, 32);
+}
+
+// Réécrit l'empreinte de l'utilisateur `id` si elle vaut encore `ancienne`
+// (pas d'écrasement d'un changement fait entre-temps par un autre poste).
+// `stocke` reçoit celle en vigueur.
+void rehacherMotDePasse(sqlite3 *bdd, int id, const char *password, long iterations, char *stocke) {
+    char nouvelle[IDENTIFIANT_MAX];
+    if (!hacherMotDePasse(password, iterations, nouvelle)) return;
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_MOT_DE_PASSE);
+    if (!stmt) return;
+    sqlite3_bind_text(stmt, 1, nouvelle, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, id);
+    sqlite3_bind_text(stmt, 3, stocke, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    bool ecrit = rc == SQLITE_DONE && sqlite3_changes(bdd) > 0;
+    if (rc != SQLITE_DONE) log_error(sqlite3_errmsg(bdd));
+    libererRequete(stmt);
+    if (!ecrit) return;
+    journal(LOG_INFO, "Mot de passe réécrit", "utilisateur=%d iterations=%ld", id, iterations);
+    snprintf(stocke, IDENTIFIANT_MAX, "%s", nouvelle);
+}
+
+// Migration : hache les mots de passe encore stockés en clair.
+bool hacherMotsDePasseClairs(sqlite3 *bdd) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(bdd, "SELECT id, password_hash FROM users WHERE password_hash <> '' AND "
+                                "substr(password_hash, 1, 15) <> '" PBKDF2_PREFIXE "';", -1, &stmt, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(bdd));
+        return false;
+    }
+    typedef struct { int id; char stocke[IDENTIFIANT_MAX]; } Clair;
+    Clair *clairs = NULL;
+    int n = 0, cap = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (n == cap) {
+            Clair *p = realloc(clairs, sizeof(Clair) * (cap = cap ? cap * 2 : 16));
+            if (!p) break;
+            clairs = p;
+        }
+        clairs[n].id = sqlite3_column_int(stmt, 0);
+        snprintf(clairs[n].stocke, IDENTIFIANT_MAX, "%s", (const char*)sqlite3_column_text(stmt, 1));
+        n++;
+    }
+    sqlite3_finalize(stmt);
+    long iterations = n ? identifiantsIterations(bdd) : 0;
+    for (int i = 0; i < n; i++) {
+        char mot_de_passe[IDENTIFIANT_MAX];
+        memcpy(mot_de_passe, clairs[i].stocke, sizeof(mot_de_passe));
+        rehacherMotDePasse(bdd, clairs[i].id, mot_de_passe, iterations, clairs[i].stocke);
+    }
+    if (clairs) memset(clairs, 0, sizeof(Clair) * n);
+    free(clairs);
+    if (n) journal(LOG_INFO, "Mots de passe en clair hachés", "utilisateurs=%d", n);
+    return true;
+}
+
+// Lit l'utilisateur `username` ; faux s'il n'existe pas.
+bool lireIdentifiant(sqlite3 *bdd, const char *username, int *id, char stocke[IDENTIFIANT_MAX]) {
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_LOGIN);
+    if (!stmt) return false;
+    sqlite3_bind_text(stmt, 1, username, -1, SQLITE_TRANSIENT);
+    bool trouve = sqlite3_step(stmt) == SQLITE_ROW;
+    if (trouve) {
+        const unsigned char *stored_hash = sqlite3_column_text(stmt, 1);
+        snprintf(stocke, IDENTIFIANT_MAX, "%s", stored_hash ? (const char*)stored_hash : "");
+        *id = sqlite3_column_int(stmt, 0);
+    }
+    libererRequete(stmt);
+    return trouve;
+}
+
+// Coût du leurre d'un nom inconnu : celui de la plupart des empreintes
+// stockées, que paie la vérification d'un nom existant (et non le coût
+// courant, qu'elles n'ont qu'après réécriture).
+long coutLeurre(sqlite3 *bdd, long iterations) {
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_COUT_EMPREINTES);
+    if (!stmt) return iterations;
+    long n = sqlite3_step(stmt) == SQLITE_ROW ? (long)sqlite3_column_int64(stmt, 0) : 0;
+    libererRequete(stmt);
+    return n > 0 ? n : iterations;
+}
+
+// Connexion par `bdd` : l'interface la fait sur la connexion de l'exécuteur,
+// la dérivation (IDENTIFIANTS_CIBLE_MS) ne devant pas bloquer la boucle GTK.
+bool verifierConnexion(sqlite3 *bdd, const char *username, const char *password) {
+    double t0 = diagDebut();
+    char stocke[IDENTIFIANT_MAX] = "";
+    int id = 0;
+    bool trouve = lireIdentifiant(bdd, username, &id, stocke);
+    bool ok = trouve && sessionsVerifier(username, password, stocke, id);
+    if (!ok) {
+        long iterations = identifiantsIterations(bdd);
+        bool a_rehacher = false;
+        if (trouve) {
+            ok = verifierMotDePasse(stocke, password, iterations, &a_rehacher);
+        } else {
+            // même durée qu'un utilisateur existant : pas de sondage des noms
+            uint8_t sel[PBKDF2_SEL] = { 0 }, leurre[32];
+            pbkdf2Sha256(password, sel, sizeof(sel), coutLeurre(bdd, iterations), leurre);
+        }
+        if (ok && a_rehacher) rehacherMotDePasse(bdd, id, password, iterations, stocke);
+        if (ok) sessionsOuvrir(username, password, stocke, id);
+    }
+    diagFin(DIAG_CONNEXION, t0, ok);
+    if (ok) {
+        atomic_store(&utilisateur_courant, id);
+        auditer("connexion utilisateur=%s", username);
+    } else {
+        auditer("connexion refusee utilisateur=%s", username);
+    }
+    return ok;
+}
+
+bool check_login(const char *username, const char *password) {
+    return verifierConnexion(db, username, password);
+}
+
+// Empreinte en base d'un jeton : HMAC sous le password_hash en vigueur.
+void sessionCommandesEmpreinte(const char *stocke, const uint8_t jeton[32], uint8_t out[32]) {
+    hmacSha256(stocke, strlen(stocke), jeton, 32, out);
+}
+
+// Ouvre une session en base pour `username`, déjà authentifié par mot de
+// passe ; `jeton_hexa` (65 octets) reçoit le jeton à passer dans
+// CPRONOTE_SESSION. Les sessions expirées sont purgées au passage.
+bool sessionCommandesOuvrir(sqlite3 *bdd, const char *username, char *jeton_hexa, long *expiration) {
+    char stocke[IDENTIFIANT_MAX];
+    uint8_t jeton[32], empreinte[32];
+    int id = 0;
+    if (!lireIdentifiant(bdd, username, &id, stocke) || !octetsAleatoires(jeton, sizeof(jeton))) return false;
+    sqlite3_int64 maintenant = time(NULL);
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_SESSIONS_PURGER);
+    if (!stmt) return false;
+    sqlite3_bind_int64(stmt, 1, maintenant);
+    int rc = sqlite3_step(stmt);
+    libererRequete(stmt);
+    if (rc == SQLITE_DONE) stmt = obtenirRequete(bdd, STMT_SESSION_CREER);
+    if (rc != SQLITE_DONE || !stmt) {
+        log_error(sqlite3_errmsg(bdd));
+        return false;
+    }
+    sessionCommandesEmpreinte(stocke, jeton, empreinte);
+    *expiration = (long)(maintenant + SESSION_COMMANDES_DUREE_S);
+    sqlite3_bind_blob(stmt, 1, empreinte, sizeof(empreinte), SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, id);
+    sqlite3_bind_int64(stmt, 3, *expiration);
+    rc = sqlite3_step(stmt);
+    libererRequete(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error(sqlite3_errmsg(bdd));
+        return false;
+    }
+    versHexa(jeton, sizeof(jeton), jeton_hexa);
+    memset(jeton, 0, sizeof(jeton));
+    auditer("session ouverte utilisateur=%s", username);
+    return true;
+}
+
+// Connexion par jeton de session (CPRONOTE_SESSION) : un HMAC et une
+// lecture au lieu de la dérivation. Jeton inconnu, expiré ou émis avant un
+// changement de mot de passe : refusé.
+bool check_session(const char *username, const char *jeton_hexa) {
+    double t0 = diagDebut();
+    char stocke[IDENTIFIANT_MAX] = "";
+    uint8_t jeton[32], empreinte[32];
+    int id = 0;
+    const char *fin = depuisHexa(jeton_hexa, jeton, sizeof(jeton));
+    bool ok = fin && *fin == '\0' && lireIdentifiant(db, username, &id, stocke) && stocke[0] != '\0';
+    sqlite3_stmt *stmt = ok ? obtenirRequete(db, STMT_SESSION_LIRE) : NULL;
+    if (stmt) {
+        sessionCommandesEmpreinte(stocke, jeton, empreinte);
+        sqlite3_bind_blob(stmt, 1, empreinte, sizeof(empreinte), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)time(NULL));
+        ok = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == id;
+        libererRequete(stmt);
+    } else {
+        ok = false;
+    }
+    diagFin(DIAG_CONNEXION, t0, ok);
+    if (ok) {
+        atomic_store(&utilisateur_courant, id);
+        auditer("connexion session utilisateur=%s", username);
+    } else {
+        auditer("connexion refusee utilisateur=%s", username);
+    }
+    return ok;
+}
+
+/*
+ * Suivi des changements de eleves : sqlite3_update_hook note chaque ligne
+ * insérée, modifiée ou supprimée par la connexion ; les changements d'une
+ * transaction ne sont publiés qu'une fois celle-ci écrite (voir
+ * EcrituresDifferees) et oubliés si elle est annulée. Le notificateur est
+ * appelé à chaque publication ; prendreChangements() rend la liste
+ * fusionnée par id.
+ */
+typedef enum { CHANGEMENT_INSERTION, CHANGEMENT_MODIFICATION, CHANGEMENT_SUPPRESSION } TypeChangement;
+
+typedef struct {
+    sqlite3_int64 id;
+    TypeChangement type;
+    long ordre;                 // pour garder l'ordre des changements d'un même id
+} ChangementEleve;
+
+typedef struct {
+    sqlite3 *db;
+    EcrituresDifferees en_cours;    // de ChangementEleve, transaction ouverte
+    ChangementEleve *publies;
+    int nb_publies;
+    int cap_publies;
+    long ordre;
+    void (*notifier)(void);
+} SuiviChangements;
+
+SuiviChangements suivi = { .en_cours = { .taille = sizeof(ChangementEleve) } };
+
+bool changementsAjouter(ChangementEleve **tab, int *nb, int *cap, const ChangementEleve *ch, int n) {
+    if (*nb + n > *cap) {
+        int nouvelle = *cap ? *cap : 64;
+        while (nouvelle < *nb + n) nouvelle *= 2;
+        ChangementEleve *tmp = realloc(*tab, sizeof(ChangementEleve) * nouvelle);
+        if (!tmp) return false;
+        *tab = tmp;
+        *cap = nouvelle;
+    }
+    memcpy(*tab + *nb, ch, sizeof(ChangementEleve) * n);
+    *nb += n;
+    return true;
+}
+
+void suivi_update_hook(void *data, int op, const char *base, const char *table, sqlite3_int64 rowid) {
+    if (strcmp(table, "eleves") != 0 || strcmp(base, "main") != 0) return;     // pas les archives attachées
+    ChangementEleve ch = { rowid, op == SQLITE_INSERT ? CHANGEMENT_INSERTION :
+                                  op == SQLITE_DELETE ? CHANGEMENT_SUPPRESSION : CHANGEMENT_MODIFICATION,
+                           suivi.ordre++ };
+    differerAjouter(&suivi.en_cours, &ch);
+}
+
+void suiviPublierUn(const void *e, void *contexte) {
+    changementsAjouter(&suivi.publies, &suivi.nb_publies, &suivi.cap_publies, e, 1);
+}
+
+void suiviConfirmer(sqlite3 *db) {
+    if (db != suivi.db) return;
+    if (differerAppliquer(&suivi.en_cours, db, suiviPublierUn, NULL) > 0 && suivi.notifier) suivi.notifier();
+}
+
+void suivreChangements(sqlite3 *db, void (*notifier)(void)) {
+    suivi.db = db;
+    suivi.notifier = notifier;
+    sqlite3_update_hook(db, suivi_update_hook, NULL);
+    crochetsTransaction(db);
+}
+
+/*
+ * Crochets de transaction, posés sur la connexion principale par ouvrirBase
+ * (data : la connexion). Le cache de résultats est invalidé à toute
+ * validation ou annulation ; les écritures différées sont marquées validées,
+ * confirmées ou oubliées. wal_hook remplace le point de contrôle automatique,
+ * refait ici au même seuil.
+ */
+#define WAL_POINT_CONTROLE_PAGES 1000
+
+// Applique ce que les transactions déjà écrites ont réservé.
+void transactionConfirmer(sqlite3 *db) {
+    suiviConfirmer(db);
+    auditConfirmer(db);
+    colonnesConfirmer(db);
+    trigrammesConfirmer(db);
+}
+
+int transaction_commit_hook(void *data) {
+    sqlite3 *db = data;
+    cacheResultatsInvalider();
+    transactionConfirmer(db);       // validation précédente écrite sans WAL
+    if (db == suivi.db) differerValider(&suivi.en_cours, db);
+    if (db == audit.ecrivain) differerValider(&audit.differes, db);
+    if (colonnes && db == colonnes->db) differerValider(&colonnes->attente, db);
+    if (trigrammes && db == trigrammes->db) differerValider(&trigrammes->attente, db);
+    return 0;                       // 0 : la validation continue
+}
+
+void transaction_rollback_hook(void *data) {
+    sqlite3 *db = data;
+    cacheResultatsInvalider();
+    transactionConfirmer(db);
+    if (db == suivi.db) differerAnnuler(&suivi.en_cours);
+    if (db == audit.ecrivain) differerAnnuler(&audit.differes);
+    if (colonnes && db == colonnes->db) differerAnnuler(&colonnes->attente);
+    if (trigrammes && db == trigrammes->db) differerAnnuler(&trigrammes->attente);
+}
+
+int transaction_wal_hook(void *data, sqlite3 *db, const char *base, int pages) {
+    transactionConfirmer(db);
+    if (pages >= WAL_POINT_CONTROLE_PAGES) sqlite3_wal_checkpoint(db, base);
+    return SQLITE_OK;
+}
+
+void crochetsTransaction(sqlite3 *db) {
+    sqlite3_commit_hook(db, transaction_commit_hook, db);
+    sqlite3_rollback_hook(db, transaction_rollback_hook, db);
+    sqlite3_wal_hook(db, transaction_wal_hook, NULL);
+}
+
+int comparerChangements(const void *a, const void *b) {
+    const ChangementEleve *x = a, *y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return (x->ordre > y->ordre) - (x->ordre < y->ordre);
+}
+
+// Un changement net par id, trié par id : insertion puis suppression
+// s'annulent, suppression puis réinsertion devient une modification.
+int fusionnerChangements(ChangementEleve *ch, int n) {
+    qsort(ch, n, sizeof(ChangementEleve), comparerChangements);
+    int out = 0;
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j + 1 < n && ch[j + 1].id == ch[i].id) j++;
+        TypeChangement premier = ch[i].type, dernier = ch[j].type;
+        ch[out] = ch[i];
+        if (dernier == CHANGEMENT_SUPPRESSION) {
+            ch[out].type = CHANGEMENT_SUPPRESSION;
+            if (premier != CHANGEMENT_INSERTION) out++;
+        } else {
+            ch[out++].type = premier == CHANGEMENT_INSERTION ? CHANGEMENT_INSERTION : CHANGEMENT_MODIFICATION;
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+// Rend (et oublie) les changements validés depuis le dernier appel ; la
+// liste est à libérer par free().
+int prendreChangements(ChangementEleve **out) {
+    if (suivi.db) suiviConfirmer(suivi.db);     // sans WAL, dernière validation pas encore confirmée
+    *out = suivi.publies;
+    int n = fusionnerChangements(suivi.publies, suivi.nb_publies);
+    suivi.publies = NULL;
+    suivi.nb_publies = 0;
+    suivi.cap_publies = 0;
+    return n;
+}
+
+/*
+ * Ligne de commande, pour les scripts et les tâches planifiées :
+ *
+ *   C-Pronote [--json] [--utilisateur nom] commande arguments...
+ *   C-Pronote [--json] [--utilisateur nom] -     (commandes lues sur stdin)
+ *
+ * Mêmes fonctions d'accès que l'interface, sans gtk_init ni index en
+ * mémoire : les requêtes ne sont préparées qu'au premier usage et la piste
+ * d'audit est écrite par la connexion elle-même. Le mot de passe vient de
+ * CPRONOTE_MOT_DE_PASSE (en argument, il serait visible dans ps),
+ * l'utilisateur de --utilisateur ou CPRONOTE_UTILISATEUR. Chaque lancement
+ * paierait la dérivation du mot de passe (IDENTIFIANTS_CIBLE_MS) : un script
+ * ouvre plutôt une session une fois,
+ *
+ *   export CPRONOTE_SESSION=$(C-Pronote session)
+ *
+ * et ses commandes suivantes se connectent par ce jeton, le mot de passe
+ * n'étant repris que s'il est refusé (expiré, mot de passe changé). Lues sur stdin, les
+ * commandes (une par ligne, arguments séparés par des tabulations, ou des
+ * espaces s'il n'y a aucune tabulation) forment une seule transaction : la
+ * première en erreur annule tout. Sortie en TSV (avec en-tête) ou en JSON
+ * Lines ; le code de sortie est un CodeCommande.
+ */
+#define COMMANDE_MAX_ARGS 16
+
+typedef enum {
+    CMD_OK = 0,
+    CMD_ERREUR = 1,             // base, fichier ou mémoire (détails dans log.txt)
+    CMD_USAGE = 2,
+    CMD_REFUS = 3,              // authentification
+    CMD_ABSENT = 4,             // élève inconnu
+    CMD_CONFLIT = 5,            // version dépassée (modifié entre-temps)
+} CodeCommande;
+
+typedef struct {
+    sqlite3 *db;
+    FILE *out;
+    bool json;
+    const char *utilisateur;
+    bool par_session;           // connecté par CPRONOTE_SESSION
+} Commandes;
+
+typedef struct {
+    const char *nom;
+    int min_args;               // sans compter le nom de la commande
+    int max_args;
+    const char *usage;
+    CodeCommande (*executer)(Commandes *c, int argc, char **argv);
+} Commande;
+
+// Résultat d'une commande d'écriture : une ligne de valeurs en TSV, un objet
+// en JSON. `cles` et `valeurs` comptent `n` entiers.
+void commandeResultat(Commandes *c, const char **cles, const long *valeurs, int n) {
+    for (int i = 0; i < n; i++) {
+        if (c->json) fprintf(c->out, "%s\"%s\":%ld", i ? "," : "{", cles[i], valeurs[i]);
+        else fprintf(c->out, "%s%ld", i ? "\t" : "", valeurs[i]);
+    }
+    fputs(c->json ? "}\n" : "\n", c->out);
+}
+
+bool commandeEntier(const char *texte, long min, long *val) {
+    return csvEntier(texte, val) && *val >= min && *val <= INT_MAX;
+}
+
+// Version actuelle de l'élève `id`, 0 s'il n'existe pas, -1 en cas d'erreur.
+int commandeVersion(sqlite3 *db, int id) {
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_VERSION_ELEVE);
+    if (!stmt) return -1;
+    sqlite3_bind_int(stmt, 1, id);
+    int rc = sqlite3_step(stmt);
+    int version = rc == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    libererRequete(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE ? version : -1;
+}
+
+// add nom age taille email telephone grade
+CodeCommande cmdAjouter(Commandes *c, int argc, char **argv) {
+    Personne p = { 0 };
+    long age;
+    double taille;
+    if (!argv[1][0] || !commandeEntier(argv[2], 0, &age) || !csvReel(argv[3], &taille)) {
+        fprintf(stderr, "Erreur: nom manquant, âge ou taille invalide\n");
+        return CMD_USAGE;
+    }
+    snprintf(p.nom, sizeof(p.nom), "%s", argv[1]);
+    p.age = (int)age;
+    p.taille = (float)taille;
+    snprintf(p.email, sizeof(p.email), "%s", argv[4]);
+    snprintf(p.telephone, sizeof(p.telephone), "%s", argv[5]);
+    snprintf(p.grade, sizeof(p.grade), "%s", argv[6]);
+    if (!ajouterEleve(c->db, &p)) return CMD_ERREUR;
+    const char *cles[] = { "id" };
+    long valeurs[] = { (long)sqlite3_last_insert_rowid(c->db) };
+    commandeResultat(c, cles, valeurs, 1);
+    return CMD_OK;
+}
+
+// list : tous les élèves, archives comprises
+CodeCommande cmdLister(Commandes *c, int argc, char **argv) {
+    Sortie s = { c->out, NULL, 0, 0, false };
+    const FormatRendu *f = c->json ? &format_jsonl : &format_tsv;
+    long n = -1;
+    if (partitions.n > 1) {
+        n = rendreElevesPartitions(f, &s);
+    } else {
+        sqlite3_stmt *stmt = obtenirRequete(c->db, STMT_SELECT_ELEVES);
+        if (stmt) n = rendreEleves(stmt, f, &s);
+        libererRequete(stmt);
+    }
+    return n >= 0 ? CMD_OK : CMD_ERREUR;
+}
+
+// search terme... : les mots sont recherchés ensemble, comme dans l'interface
+CodeCommande cmdRechercher(Commandes *c, int argc, char **argv) {
+    char terme[MAX_QUERY] = "";
+    size_t len = 0;
+    for (int i = 1; i < argc && len < sizeof(terme); i++) {
+        len += snprintf(terme + len, sizeof(terme) - len, "%s%s", i > 1 ? " " : "", argv[i]);
+    }
+    Sortie s = { c->out, NULL, 0, 0, false };
+    return rechercherEleveRendu(c->db, terme, c->json ? &format_jsonl : &format_tsv, &s) >= 0 ? CMD_OK : CMD_ERREUR;
+}
+
+// update id champ=valeur... (nom, age, taille, email, telephone, grade ;
+// version=N refuse la modification si l'élève n'est plus à la version N)
+CodeCommande cmdModifier(Commandes *c, int argc, char **argv) {
+    long id;
+    if (!commandeEntier(argv[1], 1, &id)) {
+        fprintf(stderr, "Erreur: id invalide '%s'\n", argv[1]);
+        return CMD_USAGE;
+    }
+    Personne p;
+    sqlite3_stmt *stmt = obtenirRequete(c->db, STMT_ELEVE_PAR_ID);
+    if (!stmt) return CMD_ERREUR;
+    sqlite3_bind_int(stmt, 1, (int)id);
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) lireEleve(stmt, &p);
+    libererRequete(stmt);
+    if (rc == SQLITE_DONE) {
+        fprintf(stderr, "Erreur: aucun élève %ld\n", id);
+        return CMD_ABSENT;
+    }
+    if (rc != SQLITE_ROW) return CMD_ERREUR;
+    for (int i = 2; i < argc; i++) {
+        const char *valeur = strchr(argv[i], '=');
+        long entier = 0;
+        double reel = 0;
+        size_t n = valeur ? (size_t)(valeur - argv[i]) : 0;
+        bool ok = valeur != NULL;
+        if (!valeur) {
+        } else if (n == 3 && strncmp(argv[i], "nom", n) == 0) {
+            ok = valeur[1] != '\0';
+            snprintf(p.nom, sizeof(p.nom), "%s", valeur + 1);
+        } else if (n == 3 && strncmp(argv[i], "age", n) == 0) {
+            ok = commandeEntier(valeur + 1, 0, &entier);
+            p.age = (int)entier;
+        } else if (n == 6 && strncmp(argv[i], "taille", n) == 0) {
+            ok = csvReel(valeur + 1, &reel);
+            p.taille = (float)reel;
+        } else if (n == 5 && strncmp(argv[i], "email", n) == 0) {
+            snprintf(p.email, sizeof(p.email), "%s", valeur + 1);
+        } else if (n == 9 && strncmp(argv[i], "telephone", n) == 0) {
+            snprintf(p.telephone, sizeof(p.telephone), "%s", valeur + 1);
+        } else if (n == 5 && strncmp(argv[i], "grade", n) == 0) {
+            snprintf(p.grade, sizeof(p.grade), "%s", valeur + 1);
+        } else if (n == 7 && strncmp(argv[i], "version", n) == 0) {
+            ok = commandeEntier(valeur + 1, 1, &entier);
+            p.version = (int)entier;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "Erreur: champ invalide '%s' (nom, age, taille, email, telephone, grade, version)\n", argv[i]);
+            return CMD_USAGE;
+        }
+    }
+    ResultatModif res = modifierEleveVersion(c->db, (int)id, &p);
+    if (res == MODIF_CONFLIT) fprintf(stderr, "Erreur: élève %ld modifié entre-temps (version %d dépassée)\n", id, p.version);
+    if (res == MODIF_ABSENT) fprintf(stderr, "Erreur: aucun élève %ld\n", id);
+    if (res != MODIF_OK) return res == MODIF_CONFLIT ? CMD_CONFLIT : res == MODIF_ABSENT ? CMD_ABSENT : CMD_ERREUR;
+    const char *cles[] = { "id", "version" };
+    long valeurs[] = { id, commandeVersion(c->db, (int)id) };
+    commandeResultat(c, cles, valeurs, 2);
+    return CMD_OK;
+}
+
+// delete id
+CodeCommande cmdSupprimer(Commandes *c, int argc, char **argv) {
+    long id;
+    if (!commandeEntier(argv[1], 1, &id)) {
+        fprintf(stderr, "Erreur: id invalide '%s'\n", argv[1]);
+        return CMD_USAGE;
+    }
+    if (!supprimerEleve(c->db, (int)id)) {
+        if (commandeVersion(c->db, (int)id) != 0) return CMD_ERREUR;
+        fprintf(stderr, "Erreur: aucun élève %ld\n", id);
+        return CMD_ABSENT;
+    }
+    const char *cles[] = { "id" };
+    long valeurs[] = { id };
+    commandeResultat(c, cles, valeurs, 1);
+    return CMD_OK;
+}
+
+// export [fichier] : CSV relu par import, eleves.csv par défaut
+CodeCommande cmdExporter(Commandes *c, int argc, char **argv) {
+    const char *chemin = argc > 1 ? argv[1] : CSV_FILENAME;
+    bool ok = argc > 1 ? exporterEleves(c->db, chemin, &format_csv) : exporterCSV(c->db);
+    if (!ok) return CMD_ERREUR;
+    if (argc > 1) auditer("export fichier=%s", chemin);
+    if (c->json) {
+        Sortie s = { c->out, NULL, 0, 0, false };
+        sortieTexte(&s, "{\"fichier\":");
+        jsonChaine(&s, chemin);
+        sortieTexte(&s, "}\n");
+    } else {
+        fprintf(c->out, "%s\n", chemin);
+    }
+    return CMD_OK;
+}
+
+// import fichier : lignes rejetées dans eleves_rejets.csv
+CodeCommande cmdImporter(Commandes *c, int argc, char **argv) {
+    long importees = 0, rejetees = 0;
+    if (!importerCSV(c->db, argv[1], &importees, &rejetees)) return CMD_ERREUR;
+    auditer("import fichier=%s lignes=%ld", argv[1], importees);
+    const char *cles[] = { "importees", "rejetees" };
+    long valeurs[] = { importees, rejetees };
+    commandeResultat(c, cles, valeurs, 2);
+    return CMD_OK;
+}
+
+// session : jeton pour CPRONOTE_SESSION, ouvert seulement par mot de passe
+// (un jeton ne se prolonge pas lui-même)
+CodeCommande cmdSession(Commandes *c, int argc, char **argv) {
+    if (c->par_session) {
+        fprintf(stderr, "Erreur: une session s'ouvre avec CPRONOTE_MOT_DE_PASSE\n");
+        return CMD_REFUS;
+    }
+    char jeton[65];
+    long expiration;
+    if (!sessionCommandesOuvrir(c->db, c->utilisateur, jeton, &expiration)) return CMD_ERREUR;
+    if (c->json) fprintf(c->out, "{\"session\":\"%s\",\"expiration\":%ld}\n", jeton, expiration);
+    else fprintf(c->out, "%s\n", jeton);
+    return CMD_OK;
+}
+
+const Commande commandes[] = {
+    { "add",    6, 6,                 "add nom age taille email telephone grade", cmdAjouter },
+    { "list",   0, 0,                 "list",                                     cmdLister },
+    { "search", 1, COMMANDE_MAX_ARGS, "search terme...",                          cmdRechercher },
+    { "update", 2, COMMANDE_MAX_ARGS, "update id champ=valeur...",                cmdModifier },
+    { "delete", 1, 1,                 "delete id",                                cmdSupprimer },
+    { "export", 0, 1,                 "export [fichier]",                         cmdExporter },
+    { "import", 1, 1,                 "import fichier",                           cmdImporter },
+    { "session", 0, 0,                "session",                                  cmdSession },
+};
+#define NB_COMMANDES ((int)(sizeof(commandes) / sizeof(commandes[0])))
+
+const Commande *trouverCommande(const char *nom) {
+    for (int i = 0; i < NB_COMMANDES; i++) {
+        if (strcmp(commandes[i].nom, nom) == 0) return &commandes[i];
+    }
+    return NULL;
+}
+
+CodeCommande executerCommande(Commandes *c, int argc, char **argv) {
+    const Commande *cmd = trouverCommande(argv[0]);
+    if (!cmd) {
+        fprintf(stderr, "Erreur: commande inconnue '%s'\n", argv[0]);
+        return CMD_USAGE;
+    }
+    if (argc - 1 < cmd->min_args || argc - 1 > cmd->max_args) {
+        fprintf(stderr, "Usage: %s\n", cmd->usage);
+        return CMD_USAGE;
+    }
+    return cmd->executer(c, argc, argv);
+}
+
+// Découpe `ligne` en place : aux tabulations s'il y en a, sinon aux espaces.
+int decouperCommande(char *ligne, char **argv, int max) {
+    const char *separateurs = strchr(ligne, '\t') ? "\t" : " ";
+    int argc = 0;
+    ligne[strcspn(ligne, "\r\n")] = '\0';
+    for (char *p = ligne; argc < max; ) {
+        if (*separateurs == ' ') p += strspn(p, " ");
+        if (!*p && (*separateurs == ' ' || argc == 0)) break;
+        argv[argc++] = p;
+        p += strcspn(p, separateurs);
+        if (!*p) break;
+        *p++ = '\0';
+    }
+    return argc;
+}
+
+// Commandes lues dans `in` jusqu'à la fin, dans une seule transaction. Les
+// résultats sont gardés en mémoire et n'atteignent la sortie qu'une fois la
+// transaction validée : un lot annulé n'affiche pas d'ids qui n'existent pas.
+CodeCommande executerLot(Commandes *c, FILE *in) {
+    FILE *sortie = c->out;
+    char *resultats = NULL;
+    size_t taille_resultats = 0;
+    c->out = open_memstream(&resultats, &taille_resultats);
+    if (!c->out) {
+        c->out = sortie;
+        log_error("Erreur: mémoire insuffisante pour les résultats du lot.");
+        return CMD_ERREUR;
+    }
+    if (sqlite3_exec(c->db, "BEGIN IMMEDIATE;", 0, 0, NULL) != SQLITE_OK) {
+        journal(LOG_ERREUR, "Base occupée", "erreur=\"%s\"", sqlite3_errmsg(c->db));
+        fclose(c->out);
+        c->out = sortie;
+        free(resultats);
+        return CMD_ERREUR;
+    }
+    char *ligne = NULL, *argv[COMMANDE_MAX_ARGS + 2];
+    size_t taille = 0;
+    long numero = 0, executees = 0;
+    CodeCommande code = CMD_OK;
+    while (code == CMD_OK && getline(&ligne, &taille, in) != -1) {
+        numero++;
+        int argc = decouperCommande(ligne, argv, COMMANDE_MAX_ARGS + 2);
+        if (argc == 0 || argv[0][0] == '#') continue;
+        code = executerCommande(c, argc, argv);
+        if (code != CMD_OK) fprintf(stderr, "Erreur: ligne %ld (%s), lot annulé\n", numero, argv[0]);
+        executees++;
+    }
+    free(ligne);
+    if (fclose(c->out) != 0 && code == CMD_OK) {
+        log_error("Erreur: mémoire insuffisante pour les résultats du lot.");
+        code = CMD_ERREUR;
+    }
+    c->out = sortie;
+    if (code == CMD_OK && sqlite3_exec(c->db, "COMMIT;", 0, 0, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(c->db));
+        code = CMD_ERREUR;
+    }
+    if (code != CMD_OK) sqlite3_exec(c->db, "ROLLBACK;", 0, 0, NULL);
+    else if (taille_resultats > 0) fwrite(resultats, 1, taille_resultats, sortie);
+    free(resultats);
+    journal(code == CMD_OK ? LOG_INFO : LOG_AVERT, "Lot de commandes", "commandes=%ld code=%d", executees, (int)code);
+    return code;
+}
+
+void usageCommandes(void) {
+    fprintf(stderr, "Usage: C-Pronote [--json] [--utilisateur nom] commande arguments...\n"
+                    "       C-Pronote [--json] [--utilisateur nom] -   (une commande par ligne sur stdin)\n"
+                    "Mot de passe dans CPRONOTE_MOT_DE_PASSE, ou jeton de `session` dans "
+                    "CPRONOTE_SESSION. Commandes :\n");
+    for (int i = 0; i < NB_COMMANDES; i++) fprintf(stderr, "  %s\n", commandes[i].usage);
+}
+
+// Vrai si `argv` demande la ligne de commande plutôt que l'interface.
+bool estLigneDeCommande(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) continue;
+        if (strcmp(argv[i], "--utilisateur") == 0) {
+            i++;
+            continue;
+        }
+        return strcmp(argv[i], "-") == 0 || trouverCommande(argv[i]) != NULL;
+    }
+    return false;
+}
+
+// Ouvre `base`, authentifie (par `jeton`, puis par `mot_de_passe`, l'un ou
+// l'autre pouvant manquer) puis exécute la commande `argv` (argc > 0) ou,
+// sans elle, le lot lu dans `in`.
+CodeCommande lancerCommandes(Commandes *c, const char *base, const char *utilisateur, const char *mot_de_passe,
+                             const char *jeton, FILE *in, int argc, char **argv) {
+    stmt_cache.a_la_demande = true;
+    if (!ouvrirBase(base, &c->db)) {
+        fprintf(stderr, "Erreur: Impossible d'initialiser la base de données\n");
+        fermerDB(c->db);
+        stmt_cache.a_la_demande = false;
+        return CMD_ERREUR;
+    }
+    db = c->db;                 // check_login lit la connexion globale
+    auditDirect(c->db);
+    CodeCommande code;
+    c->utilisateur = utilisateur;
+    c->par_session = jeton && check_session(utilisateur, jeton);
+    if (!c->par_session && !(mot_de_passe && check_login(utilisateur, mot_de_passe))) {
+        fprintf(stderr, "Erreur: identifiants invalides\n");
+        code = CMD_REFUS;
+    } else {
+        partitionsOuvrir(c->db, ".", true);
+        code = argc > 0 ? executerCommande(c, argc, argv) : executerLot(c, in);
+        partitionsFermer();
+    }
+    if (fflush(c->out) != 0 && code == CMD_OK) code = CMD_ERREUR;
+    auditDirect(NULL);
+    cacheResultatsVider(0);
+    fermerDB(c->db);
+    db = NULL;
+    c->db = NULL;
+    stmt_cache.a_la_demande = false;
+    atomic_store(&utilisateur_courant, 0);
+    return code;
+}
+
+int mainCommandes(int argc, char *argv[]) {
+    Commandes c = { NULL, stdout, false, NULL, false };
+    const char *utilisateur = getenv("CPRONOTE_UTILISATEUR");
+    const char *mot_de_passe = getenv("CPRONOTE_MOT_DE_PASSE");
+    const char *jeton = getenv("CPRONOTE_SESSION");
+    int i = 1;
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) c.json = true;
+        else if (strcmp(argv[i], "--utilisateur") == 0 && i + 1 < argc) utilisateur = argv[++i];
+        else break;
+    }
+    bool lot = i < argc && strcmp(argv[i], "-") == 0;
+    if (i == argc || (!lot && !trouverCommande(argv[i]))) {
+        usageCommandes();
+        return CMD_USAGE;
+    }
+    if (jeton && !jeton[0]) jeton = NULL;
+    if (!utilisateur || (!mot_de_passe && !jeton)) {
+        fprintf(stderr, "Erreur: utilisateur (--utilisateur ou CPRONOTE_UTILISATEUR) et "
+                        "CPRONOTE_MOT_DE_PASSE ou CPRONOTE_SESSION requis\n");
+        return CMD_REFUS;
+    }
+    return lancerCommandes(&c, DB_NAME, utilisateur, mot_de_passe, jeton, stdin, lot ? 0 : argc - i, argv + i);
+}
+
+#ifndef CPRONOTE_HEADLESS
+/*
+ * Exécuteur de requêtes : un thread dédié, avec sa propre connexion SQLite,
+ * exécute les requêtes longues (liste, recherche, export) hors de la boucle
+ * GTK. Les lignes remontent par lots via g_idle_add ; une requête peut être
+ * annulée à tout moment (drapeau + sqlite3_interrupt).
+ */
+typedef enum { REQ_LISTE, REQ_RECHERCHE, REQ_EXPORT, REQ_EXPORT_TABLES, REQ_BULLETINS, REQ_CLES, REQ_CONNEXION } TypeRequete;
+
+typedef struct Requete Requete;
+typedef void (*RequeteLotFunc)(Requete *req, const LotEleves *lot);
+typedef void (*RequeteFinFunc)(Requete *req, bool ok);
+
+struct Requete {
+    TypeRequete type;
+    char *param;
+    char *secret;               // REQ_CONNEXION : mot de passe, effacé à la libération
+    gint annulee;
+    gint refs;
+    long lignes;
+    long approchants;           // dont résultats de la recherche floue
+    gint faits;                 // avancement des bulletins, lu par la barre de progression
+    gint total;
+    sqlite3_int64 *cles;        // REQ_CLES : dernier id avant chaque page
+    int nb_cles;
+    sqlite3_int64 max_id;
+    RequeteLotFunc sur_lot;     // appelés dans le thread GTK
+    RequeteFinFunc sur_fin;
+    gpointer data;
+};
+
+typedef struct {
+    Requete *req;
+    LotEleves lot;
+} LotLignes;
+
+typedef struct {
+    GThread *thread;
+    GAsyncQueue *file;
+    sqlite3 *db;
+    GMutex verrou;
+    GCond place_libre;
+    Requete *courante;
+    int lots_en_vol;
+    ReserveLots reserve;        // LotLignes livrés, réutilisés par les envois suivants
+} Executeur;
+
+Executeur executeur = { .reserve = { .mutex = PTHREAD_MUTEX_INITIALIZER } };
+Requete fin_executeur;
+
+Requete *requeteRef(Requete *req) {
+    g_atomic_int_inc(&req->refs);
+    return req;
+}
+
+void requeteUnref(Requete *req) {
+    if (g_atomic_int_dec_and_test(&req->refs)) {
+        g_free(req->param);
+        if (req->secret) memset(req->secret, 0, strlen(req->secret));
+        g_free(req->secret);
+        g_free(req->cles);
+        g_free(req);
+    }
+}
+
+void requeteAnnuler(Requete *req) {
+    g_atomic_int_set(&req->annulee, 1);
+    g_mutex_lock(&executeur.verrou);
+    if (executeur.courante == req) {
+        sqlite3_interrupt(executeur.db);
+    }
+    g_cond_broadcast(&executeur.place_libre);
+    g_mutex_unlock(&executeur.verrou);
+}
+
+void executeurLibererLot(void *data) {
+    LotLignes *lot = data;
+    lotLiberer(&lot->lot);
+    g_free(lot);
+}
+
+// Lot livré ou abandonné : vidé et gardé pour un prochain envoi.
+void executeurRendreLot(LotLignes *lot) {
+    lotVider(&lot->lot);
+    lot->req = NULL;
+    if (!reserveRendre(&executeur.reserve, lot)) executeurLibererLot(lot);
+}
+
+gboolean executeur_livrer_lot(gpointer user_data) {
+    LotLignes *lot = user_data;
+    Requete *req = lot->req;
+    if (!g_atomic_int_get(&req->annulee) && req->sur_lot) {
+        req->sur_lot(req, &lot->lot);
+    }
+    g_mutex_lock(&executeur.verrou);
+    executeur.lots_en_vol--;
+    g_cond_signal(&executeur.place_libre);
+    g_mutex_unlock(&executeur.verrou);
+    requeteUnref(req);
+    executeurRendreLot(lot);
+    return G_SOURCE_REMOVE;
+}
+
+typedef struct {
+    Requete *req;
+    bool ok;
+} FinRequete;
+
+gboolean executeur_livrer_fin(gpointer user_data) {
+    FinRequete *fin = user_data;
+    if (fin->req->sur_fin) {
+        fin->req->sur_fin(fin->req, fin->ok && !g_atomic_int_get(&fin->req->annulee));
+    }
+    requeteUnref(fin->req);
+    g_free(fin);
+    return G_SOURCE_REMOVE;
+}
+
+// Envoie un lot au thread GTK en limitant le nombre de lots en attente,
+// pour que la boucle principale ne reçoive jamais plus qu'elle ne dessine.
+void executeurEnvoyerLot(LotLignes *lot) {
+    g_mutex_lock(&executeur.verrou);
+    while (executeur.lots_en_vol >= EXEC_LOTS_EN_VOL && !g_atomic_int_get(&lot->req->annulee)) {
+        g_cond_wait(&executeur.place_libre, &executeur.verrou);
+    }
+    executeur.lots_en_vol++;
+    g_mutex_unlock(&executeur.verrou);
+    requeteRef(lot->req);
+    g_idle_add(executeur_livrer_lot, lot);
+}
+
+// Lot vide pour `req`, pris dans la réserve (mémoire déjà allouée) ou
+// créé ; NULL si la mémoire manque.
+LotLignes *executeurNouveauLot(Requete *req) {
+    LotLignes *lot = reservePrendre(&executeur.reserve);
+    if (!lot) {
+        lot = g_try_new0(LotLignes, 1);
+        if (!lot) return NULL;
+        if (!lotReserver(&lot->lot, EXEC_LOT_LIGNES, EXEC_LOT_OCTETS)) {
+            executeurLibererLot(lot);
+            return NULL;
+        }
+    }
+    lot->req = req;
+    return lot;
+}
+
+// Envoie le dernier lot d'une requête s'il n'est pas vide ; `lot` peut être
+// NULL (mémoire manquante en cours de route).
+void executeurDernierLot(LotLignes *lot) {
+    if (!lot) return;
+    if (lot->lot.n > 0 && !g_atomic_int_get(&lot->req->annulee)) {
+        executeurEnvoyerLot(lot);
+    } else {
+        executeurRendreLot(lot);
+    }
+}
+
+// Garde dans `*copie` la dernière ligne de `lot` pour le cache de résultats ;
+// la copie est abandonnée (NULL) si elle dépasse le quart du plafond.
+void copieCache(LotEleves **copie, const LotEleves *lot) {
+    if (*copie && (!lotCopierLigne(*copie, lot, lot->n - 1) || lotMemoire(*copie) > cache_resultats.plafond / 4)) {
+        lotLiberer(*copie);
+        *copie = NULL;
+    }
+}
+
+// Complète une recherche par les élèves approchants de l'index de trigrammes
+// (année courante) qui ne sont pas déjà parmi les vus.
+bool executerRechercheFloue(sqlite3 *bdd, Requete *req, const int *vus, int nb_vus, LotEleves **copie) {
+    ResultatFloue res[RECHERCHE_FLOUE_MAX];
+    int n = trigrammesChercher(trigrammes, req->param, RECHERCHE_FLOUE_MAX, res);
+    if (n == 0) return true;
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_ELEVE_PAR_ID);
+    if (!stmt) return false;
+    LotLignes *lot = executeurNouveauLot(req);
+    bool ok = lot != NULL;
+    for (int i = 0; i < n && ok && !g_atomic_int_get(&req->annulee) && req->lignes < RECHERCHE_MAX_RESULTATS; i++) {
+        bool deja = false;
+        for (int j = 0; j < nb_vus && !deja; j++) deja = vus[j] == res[i].id;
+        if (deja) continue;
+        sqlite3_bind_int(stmt, 1, res[i].id);
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            ok = lotAjouterLigne(&lot->lot, stmt);
+            if (ok) copieCache(copie, &lot->lot);
+            req->lignes++;
+            req->approchants++;
+        } else {
+            ok = rc == SQLITE_DONE;         // supprimé depuis la recherche
+        }
+        sqlite3_reset(stmt);
+    }
+    executeurDernierLot(lot);
+    libererRequete(stmt);
+    return ok && !g_atomic_int_get(&req->annulee);
+}
+
+// Avec des archives : toutes les partitions en parallèle (voir Fusion).
+bool executerSelectionPartitions(Requete *req, const char *expr, LotEleves **copie) {
+    Fusion *fu = fusionOuvrir(expr ? STMT_RECHERCHE_PARTITION : STMT_LISTE_PARTITION, expr, RECHERCHE_MAX_RESULTATS);
+    if (!fu) return false;
+    LotLignes *lot = executeurNouveauLot(req);
+    const LotEleves *src;
+    int i;
+    bool ok = lot != NULL;
+    int vus[RECHERCHE_MAX_RESULTATS];
+    while (ok && !g_atomic_int_get(&req->annulee) && (!expr || req->lignes < RECHERCHE_MAX_RESULTATS) &&
+           fusionSuivante(fu, &src, &i)) {
+        if (!lotCopierLigne(&lot->lot, src, i)) {
+            ok = false;
+            break;
+        }
+        copieCache(copie, &lot->lot);
+        if (expr) vus[req->lignes] = src->lignes[i].id;
+        req->lignes++;
+        if (lot->lot.n == EXEC_LOT_LIGNES) {
+            executeurEnvoyerLot(lot);
+            lot = executeurNouveauLot(req);
+            ok = lot != NULL;
+        }
+    }
+    bool complet = fusionFermer(fu);
+    executeurDernierLot(lot);
+    if (ok && expr && !executerRechercheFloue(executeur.db, req, vus, (int)req->lignes, copie)) ok = false;
+    // une recherche arrêtée à RECHERCHE_MAX_RESULTATS n'est pas une erreur
+    return ok && !g_atomic_int_get(&req->annulee) && (complet || (expr && req->lignes >= RECHERCHE_MAX_RESULTATS));
+}
+
+bool executerSelectionBase(sqlite3 *bdd, Requete *req, const char *expr, LotEleves **copie) {
+    sqlite3_stmt *stmt = obtenirRequete(bdd, expr ? STMT_RECHERCHE_ELEVES : STMT_SELECT_ELEVES);
+    if (!stmt) return false;
+    if (expr) {
+        sqlite3_bind_text(stmt, 1, expr, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, RECHERCHE_MAX_RESULTATS);
+    }
+    LotLignes *lot = executeurNouveauLot(req);
+    int rc = lot ? SQLITE_DONE : SQLITE_NOMEM;
+    int vus[RECHERCHE_MAX_RESULTATS];
+    while (lot && !g_atomic_int_get(&req->annulee) && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!lotAjouterLigne(&lot->lot, stmt)) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        copieCache(copie, &lot->lot);
+        if (expr && req->lignes < RECHERCHE_MAX_RESULTATS) {
+            vus[req->lignes] = sqlite3_column_int(stmt, 0);
+        }
+        req->lignes++;
+        if (lot->lot.n == EXEC_LOT_LIGNES) {
+            executeurEnvoyerLot(lot);
+            lot = executeurNouveauLot(req);
+            if (!lot) rc = SQLITE_NOMEM;
+        }
+    }
+    executeurDernierLot(lot);
+    libererRequete(stmt);
+    if (expr && rc == SQLITE_DONE && !executerRechercheFloue(bdd, req, vus, (int)req->lignes, copie)) {
+        return false;
+    }
+    return !g_atomic_int_get(&req->annulee) && rc == SQLITE_DONE;
+}
+
+// Renvoie au thread GTK, par lots, un résultat lu dans le cache.
+bool executerDepuisCache(Requete *req, const LotEleves *res, const sqlite3_int64 *valeurs) {
+    LotLignes *lot = executeurNouveauLot(req);
+    for (int i = 0; lot && i < res->n && !g_atomic_int_get(&req->annulee); i++) {
+        if (!lotCopierLigne(&lot->lot, res, i)) break;
+        req->lignes++;
+        if (lot->lot.n == EXEC_LOT_LIGNES) {
+            executeurEnvoyerLot(lot);
+            lot = executeurNouveauLot(req);
+        }
+    }
+    req->approchants = valeurs[0];
+    executeurDernierLot(lot);
+    return !g_atomic_int_get(&req->annulee) && req->lignes == res->n;
+}
+
+// Liste ou recherche : servie par le cache de résultats si l'état de la base
+// n'a pas changé, sinon exécutée (archives comprises) puis gardée.
+bool executerSelection(sqlite3 *bdd, Requete *req) {
+    char expr[MAX_QUERY];
+    if (req->type == REQ_RECHERCHE && !construireRequeteFTS(req->param, expr, sizeof(expr))) {
+        return true;            // aucun mot : aucun résultat
+    }
+    const char *terme = req->type == REQ_RECHERCHE ? expr : NULL;
+    char cle[CACHE_CLE_MAX];
+    EtatCache etat;
+    LotEleves res = { 0 };
+    sqlite3_int64 valeurs[2] = { 0, 0 };
+    LotEleves *copie = cacheResultatsCle(cle, sizeof(cle), terme ? "recherche" : "liste", terme ? terme : "") &&
+                       cacheResultatsEtat(bdd, &etat) ? &res : NULL;
+    if (copie && cacheResultatsLire(&etat, cle, &res, valeurs)) {
+        bool ok = executerDepuisCache(req, &res, valeurs);
+        lotLiberer(&res);
+        return ok;
+    }
+    bool ok = partitions.n > 1 ? executerSelectionPartitions(req, terme, &copie)
+                               : executerSelectionBase(bdd, req, terme, &copie);
+    if (ok && copie) {
+        valeurs[0] = req->approchants;
+        cacheResultatsAjouter(&etat, cle, copie, valeurs);
+    }
+    lotLiberer(&res);
+    return ok;
+}
+
+// Table entière pour EleveModel : nombre d'élèves et clé de chaque page (le
+// dernier id avant elle), en un parcours de la clé primaire.
+bool executerClesPages(sqlite3 *bdd, Requete *req) {
+    sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_IDS_ELEVES);
+    int cap = 1024;
+    req->cles = g_try_new(sqlite3_int64, cap);
+    if (!stmt || !req->cles) {
+        libererRequete(stmt);
+        return false;
+    }
+    req->cles[req->nb_cles++] = 0;
+    sqlite3_bind_int64(stmt, 1, 0);
+    int rc = SQLITE_DONE;
+    while (!g_atomic_int_get(&req->annulee) && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        req->max_id = sqlite3_column_int64(stmt, 0);
+        if (++req->lignes % MODELE_TAILLE_PAGE != 0) continue;
+        if (req->nb_cles == cap) {
+            sqlite3_int64 *cles = g_try_renew(sqlite3_int64, req->cles, cap * 2);
+            if (!cles) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            req->cles = cles;
+            cap *= 2;
+        }
+        req->cles[req->nb_cles++] = req->max_id;
+    }
+    libererRequete(stmt);
+    return !g_atomic_int_get(&req->annulee) && rc == SQLITE_DONE;
+}
+
+bool requeteAnnulee(void *data) {
+    return g_atomic_int_get(&((Requete*)data)->annulee);
+}
+
+// Paramètre "<format>:<dossier>", par exemple "jsonl.gz:/tmp/export".
+bool executerExportTables(sqlite3 *bdd, Requete *req) {
+    const char *dossier = strchr(req->param, ':');
+    char format[32];
+    OptionsExport o = { 0 };
+    if (!dossier || dossier - req->param >= (int)sizeof(format)) return false;
+    snprintf(format, sizeof(format), "%.*s", (int)(dossier - req->param), req->param);
+    if (!lireFormatExport(format, &o)) return false;
+    o.annule = requeteAnnulee;
+    o.data = req;
+    BilanExport b;
+    bool ok = exporterTables(bdd, dossier + 1, &o, &b);
+    req->lignes = b.lignes;
+    return ok;
+}
+
+void bulletinsProgres(int faits, int total, void *data) {
+    Requete *req = data;
+    g_atomic_int_set(&req->total, total);
+    g_atomic_int_set(&req->faits, faits);
+}
+
+// Paramètre "<trimestre>:<classe>:<html|pdf>:<dossier>", classe vide pour toutes.
+bool executerBulletins(sqlite3 *bdd, Requete *req) {
+    char trimestre[16], grade[64];
+    const char *classe = strchr(req->param, ':');
+    const char *format = classe ? strchr(classe + 1, ':') : NULL;
+    const char *dossier = format ? strchr(format + 1, ':') : NULL;
+    if (!dossier || classe - req->param >= (int)sizeof(trimestre) || format - classe > (int)sizeof(grade)) return false;
+    snprintf(trimestre, sizeof(trimestre), "%.*s", (int)(classe - req->param), req->param);
+    snprintf(grade, sizeof(grade), "%.*s", (int)(format - classe - 1), classe + 1);
+    OptionsBulletins o = { 0 };
+    o.grade = grade[0] ? grade : NULL;
+    o.pdf = strncmp(format + 1, "pdf:", 4) == 0;
+    o.progres = bulletinsProgres;
+    o.annule = requeteAnnulee;
+    o.data = req;
+    BilanBulletins b;
+    bool ok = genererBulletins(bdd, trimestre, dossier + 1, &o, &b);
+    req->lignes = b.eleves;
+    return ok;
+}
+
+gpointer executeur_thread(gpointer unused) {
+    for (;;) {
+        Requete *req = g_async_queue_pop(executeur.file);
+        if (req == &fin_executeur) break;
+        g_mutex_lock(&executeur.verrou);
+        executeur.courante = req;
+        g_mutex_unlock(&executeur.verrou);
+
+        bool ok = false;
+        if (!g_atomic_int_get(&req->annulee)) {
+            double t0 = diagDebut();
+            if (req->type == REQ_EXPORT) {
+                ok = exporterCSV(executeur.db);
+            } else if (req->type == REQ_EXPORT_TABLES) {
+                ok = executerExportTables(executeur.db, req);
+            } else if (req->type == REQ_BULLETINS) {
+                ok = executerBulletins(executeur.db, req);
+            } else if (req->type == REQ_CLES) {
+                ok = executerClesPages(executeur.db, req);
+                diagFin(DIAG_EXECUTEUR, t0, req->lignes);
+            } else if (req->type == REQ_CONNEXION) {
+                ok = verifierConnexion(executeur.db, req->param, req->secret);
+            } else {
+                ok = executerSelection(executeur.db, req);
+                diagFin(DIAG_EXECUTEUR, t0, req->lignes);
+            }
+        }
+
+        g_mutex_lock(&executeur.verrou);
+        executeur.courante = NULL;
+        g_mutex_unlock(&executeur.verrou);
+        FinRequete *fin = g_new0(FinRequete, 1);
+        fin->req = req;         // la référence de la file passe au callback de fin
+        fin->ok = ok;
+        g_idle_add(executeur_livrer_fin, fin);
+    }
+    return NULL;
+}
+
+bool executeurDemarrer(void) {
+    if (sqlite3_open_v2(DB_NAME, &executeur.db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
+        log_error(sqlite3_errmsg(executeur.db));
+        return false;
+    }
+    configurerAttente(executeur.db);
+    diagSuivre(executeur.db);
+    g_mutex_init(&executeur.verrou);
+    g_cond_init(&executeur.place_libre);
+    executeur.file = g_async_queue_new();
+    executeur.thread = g_thread_new("executeur", executeur_thread, NULL);
+    return true;
+}
+
+void executeurArreter(void) {
+    if (!executeur.thread) return;
+    g_mutex_lock(&executeur.verrou);
+    if (executeur.courante) {
+        g_atomic_int_set(&executeur.courante->annulee, 1);
+        sqlite3_interrupt(executeur.db);
+    }
+    g_cond_broadcast(&executeur.place_libre);
+    g_mutex_unlock(&executeur.verrou);
+    g_async_queue_push(executeur.file, &fin_executeur);
+    g_thread_join(executeur.thread);
+    executeur.thread = NULL;
+    g_async_queue_unref(executeur.file);
+    reserveVider(&executeur.reserve, executeurLibererLot);
+    diagOublier(executeur.db);
+    sqlite3_close(executeur.db);
+}
+
+// Soumet une requête ; l'appelant reçoit une référence à libérer avec
+// requeteUnref (typiquement à la destruction de sa fenêtre).
+Requete *executeurSoumettreSecret(TypeRequete type, const char *param, const char *secret,
+                                  RequeteLotFunc sur_lot, RequeteFinFunc sur_fin, gpointer data) {
+    Requete *req = g_new0(Requete, 1);
+    req->type = type;
+    req->param = g_strdup(param);
+    req->secret = g_strdup(secret);
+    req->sur_lot = sur_lot;
+    req->sur_fin = sur_fin;
+    req->data = data;
+    req->refs = 2;              // une pour l'appelant, une pour la file
+    g_async_queue_push(executeur.file, req);
+    return req;
+}
+
+Requete *executeurSoumettre(TypeRequete type, const char *param,
+                            RequeteLotFunc sur_lot, RequeteFinFunc sur_fin, gpointer data) {
+    return executeurSoumettreSecret(type, param, NULL, sur_lot, sur_fin, data);
+}
+
+/*
+ * EleveModel : GtkTreeModel paresseux adossé directement à la table eleves.
+ * Les lignes sont lues à la demande par pages de MODELE_TAILLE_PAGE, avec une
+ * pagination par clé sur `id` (WHERE id > dernier_id), et seules les
+ * MODELE_NB_PAGES dernières pages utilisées restent en mémoire (LRU).
+ * Deux modes : toute la table, ou une liste d'ids (résultats de recherche)
+ * alimentée au fil de l'eau. Pour toute la table, le nombre de lignes et la
+ * clé de chaque page viennent de l'exécuteur (REQ_CLES) ; le modèle reste
+ * vide jusque-là.
+ */
+enum { COL_ID, COL_NOM, COL_AGE, COL_TAILLE, COL_EMAIL, COL_TELEPHONE, COL_GRADE, NUM_COLS };
+
+typedef struct {
+    int numero;                 // -1 : emplacement libre
+    unsigned usage;
+    LotEleves lot;              // mémoire réutilisée d'un chargement à l'autre
+} PageEleves;
+
+// Repère de pagination : `rang` élèves ont un id <= `id` (rang -1 : inconnu).
+// Exact au calcul des clés, où il marque le début d'une page, il le reste
+// après des écritures : son rang suit les insertions et suppressions d'ids
+// inférieurs, et la page est alors lue depuis le repère le plus proche en
+// sautant les quelques lignes d'écart.
+typedef struct {
+    sqlite3_int64 id;
+    int rang;
+} ClePage;
+
+typedef struct EleveModel EleveModel;
+typedef void (*ModeleChargeFunc)(EleveModel *m, Requete *req, bool ok, gpointer data);
+
+struct EleveModel {
+    GObject parent;
+    sqlite3 *db;
+    gint stamp;
+    int nb_lignes;
+    bool par_ids;
+    int *ids;                   // mode liste d'ids
+    int ids_cap;
+    ClePage *cles;              // cles[p] : repère sous la page p
+    int nb_cles;
+    PageEleves pages[MODELE_NB_PAGES];
+    LotEleves lus;              // mode liste d'ids : page lue dans l'ordre des ids
+    unsigned horloge;
+    sqlite3_int64 max_id;       // plus grand id connu (table entière)
+    Requete *req;               // calcul des clés en cours dans l'exécuteur
+    bool perimees;              // changements reçus pendant ce calcul
+    int essais;
+    ModeleChargeFunc sur_charge;
+    gpointer donnees_charge;
+};
+
+typedef struct {
+    GObjectClass parent_class;
+} EleveModelClass;
+
+GType eleve_model_get_type(void);
+#define ELEVE_TYPE_MODEL (eleve_model_get_type())
+#define ELEVE_MODEL(o) (G_TYPE_CHECK_INSTANCE_CAST((o), ELEVE_TYPE_MODEL, EleveModel))
+
+static void eleve_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(EleveModel, eleve_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, eleve_model_tree_model_init))
+
+GSList *modeles_ouverts = NULL;     // modèles à tenir à jour (suivi des changements)
+bool changements_prevus = false;
+
+static void eleve_model_init(EleveModel *m) {
+    m->stamp = g_random_int();
+    for (int i = 0; i < MODELE_NB_PAGES; i++) m->pages[i].numero = -1;
+    modeles_ouverts = g_slist_prepend(modeles_ouverts, m);
+}
+
+static void eleve_model_finalize(GObject *object) {
+    EleveModel *m = ELEVE_MODEL(object);
+    modeles_ouverts = g_slist_remove(modeles_ouverts, m);
+    if (m->req) {
+        requeteAnnuler(m->req);
+        m->req->data = NULL;
+        requeteUnref(m->req);
+    }
+    for (int i = 0; i < MODELE_NB_PAGES; i++) lotLiberer(&m->pages[i].lot);
+    lotLiberer(&m->lus);
+    g_free(m->ids);
+    g_free(m->cles);
+    G_OBJECT_CLASS(eleve_model_parent_class)->finalize(object);
+}
+
+static void eleve_model_class_init(EleveModelClass *klass) {
+    G_OBJECT_CLASS(klass)->finalize = eleve_model_finalize;
+}
+
+// Repère connu le plus proche sous le début de la page `numero` (les rangs
+// croissent avec p) ; renvoie le nombre de lignes à sauter après lui.
+int eleveModelCle(EleveModel *m, int numero, sqlite3_int64 *cle) {
+    int debut = numero * MODELE_TAILLE_PAGE;
+    int q = numero < m->nb_cles ? numero : m->nb_cles - 1;
+    while (q > 0 && (m->cles[q].rang < 0 || m->cles[q].rang > debut)) q--;
+    for (int r = q + 1; r < m->nb_cles && (m->cles[r].rang < 0 || m->cles[r].rang <= debut); r++) {
+        if (m->cles[r].rang >= 0) q = r;
+    }
+    *cle = m->cles[q].id;
+    return debut - m->cles[q].rang;
+}
+
+void eleveModelChargerPage(EleveModel *m, PageEleves *page, int numero) {
+    page->numero = numero;
+    lotVider(&page->lot);
+    int debut = numero * MODELE_TAILLE_PAGE;
+    if (m->par_ids) {
+        // lus par id (base courante puis archives), remis dans l'ordre de la recherche
+        int n = m->nb_lignes - debut < MODELE_TAILLE_PAGE ? m->nb_lignes - debut : MODELE_TAILLE_PAGE;
+        lotVider(&m->lus);
+        if (n <= 0 || !lireElevesParIds(m->db, m->ids + debut, n, &m->lus)) return;
+        for (int i = 0; i < n; i++) {
+            int j = lotIndiceId(&m->lus, m->ids[debut + i]);
+            bool ok = j >= 0 ? lotCopierLigne(&page->lot, &m->lus, j)
+                             // supprimé depuis la recherche
+                             : lotAjouterChamps(&page->lot, m->ids[debut + i], 0, 0, "", 0, "", 0, "", 0, "", 0);
+            if (!ok) break;
+        }
+        return;
+    }
+    // table entière : page gardée dans le cache de résultats, par clé
+    sqlite3_int64 cle, avant = -1;
+    int saut = eleveModelCle(m, numero, &cle);
+    char cle_cache[64];
+    snprintf(cle_cache, sizeof(cle_cache), "page:%lld+%d", (long long)cle, saut);
+    EtatCache etat;
+    bool gardable = cacheResultatsEtat(m->db, &etat);
+    if (!gardable || !cacheResultatsLire(&etat, cle_cache, &page->lot, NULL)) {
+        sqlite3_stmt *stmt = obtenirRequete(m->db, STMT_PAGE_ELEVES);
+        if (!stmt) return;
+        sqlite3_bind_int64(stmt, 1, cle);
+        sqlite3_bind_int(stmt, 2, saut + MODELE_TAILLE_PAGE);
+        int rc;
+        for (int k = 0; (rc = sqlite3_step(stmt)) == SQLITE_ROW; k++) {
+            if (k < saut) avant = sqlite3_column_int64(stmt, 0);
+            else if (!lotAjouterLigne(&page->lot, stmt)) break;
+        }
+        libererRequete(stmt);
+        if (gardable && rc == SQLITE_DONE) cacheResultatsAjouter(&etat, cle_cache, &page->lot, NULL);
+    }
+    // entre une validation et son application, les repères gardés restent
+    // ceux de l'état d'avant (voir eleveModelRangs)
+    if (changements_prevus) return;
+    if (avant >= 0 && page->lot.n > 0 && numero < m->nb_cles) {
+        m->cles[numero] = (ClePage){ avant, numero * MODELE_TAILLE_PAGE };
+    }
+    if (page->lot.n == MODELE_TAILLE_PAGE && numero + 1 < m->nb_cles) {
+        m->cles[numero + 1] = (ClePage){ page->lot.lignes[page->lot.n - 1].id, (numero + 1) * MODELE_TAILLE_PAGE };
+    }
+}
+
+// Ligne `index` et le lot qui porte ses chaînes ; NULL hors limites.
+const EleveCompact *eleveModelLigne(EleveModel *m, int index, const LotEleves **lot) {
+    int numero = index / MODELE_TAILLE_PAGE;
+    PageEleves *victime = &m->pages[0];
+    for (int i = 0; i < MODELE_NB_PAGES; i++) {
+        PageEleves *page = &m->pages[i];
+        if (page->numero == numero) {
+            page->usage = ++m->horloge;
+            victime = page;
+            diagCacheCompter(DIAG_CACHE_PAGES, true);
+            goto trouvee;
+        }
+        if (page->numero < 0 || page->usage < victime->usage) {
+            victime = page;
+        }
+    }
+    diagCacheCompter(DIAG_CACHE_PAGES, false);
+    double t0 = diagDebut();
+    eleveModelChargerPage(m, victime, numero);
+    diagFin(DIAG_PAGE, t0, victime->lot.n);
+    victime->usage = ++m->horloge;
+trouvee:
+    index -= numero * MODELE_TAILLE_PAGE;
+    *lot = &victime->lot;
+    return index < victime->lot.n ? &victime->lot.lignes[index] : NULL;
+}
+
+void eleveModelVider(EleveModel *m) {
+    for (int i = 0; i < MODELE_NB_PAGES; i++) m->pages[i].numero = -1;
+}
+
+void eleve_model_cles_fin(Requete *req, bool ok);
+
+void eleveModelLancer(EleveModel *m) {
+    m->perimees = false;
+    m->req = executeurSoumettre(REQ_CLES, NULL, NULL, eleve_model_cles_fin, m);
+}
+
+// Table entière : lance le calcul des clés ; sur_charge est appelé à son
+// retour (annulé, en erreur ou posé), le modèle encore vide ou rempli.
+void eleveModelCharger(EleveModel *m, ModeleChargeFunc sur_charge, gpointer data) {
+    if (m->req) {
+        requeteAnnuler(m->req);
+        m->req->data = NULL;
+        requeteUnref(m->req);
+    }
+    m->sur_charge = sur_charge;
+    m->donnees_charge = data;
+    m->essais = 0;
+    eleveModelLancer(m);
+}
+
+void eleveModelAnnuler(EleveModel *m) {
+    if (m->req) requeteAnnuler(m->req);
+}
+
+// Des changements appliqués pendant le parcours ont pu y être vus ou non :
+// il est relancé, au plus MODELE_CHARGEMENTS fois. Les lignes apparaissent
+// sans signal par ligne, la vue relit le modèle (voir sur_charge).
+void eleve_model_cles_fin(Requete *req, bool ok) {
+    EleveModel *m = req->data;
+    if (!m) return;                 // modèle détruit entre-temps
+    m->req = NULL;
+    if (ok && m->perimees && ++m->essais < MODELE_CHARGEMENTS) {
+        requeteUnref(req);
+        eleveModelLancer(m);
+        return;
+    }
+    if (ok) {
+        eleveModelVider(m);
+        m->nb_lignes = (int)req->lignes;
+        m->max_id = req->max_id;
+        m->nb_cles = req->nb_cles;
+        m->cles = g_renew(ClePage, m->cles, m->nb_cles);
+        for (int p = 0; p < m->nb_cles; p++) m->cles[p] = (ClePage){ req->cles[p], p * MODELE_TAILLE_PAGE };
+    }
+    if (m->sur_charge) m->sur_charge(m, req, ok, m->donnees_charge);
+    requeteUnref(req);
+}
+
+// Modèle sur toute la table, vide jusqu'à eleveModelCharger.
+GtkTreeModel *eleveModelNouveau(sqlite3 *db) {
+    EleveModel *m = g_object_new(ELEVE_TYPE_MODEL, NULL);
+    m->db = db;
+    m->nb_cles = 1;
+    m->cles = g_new(ClePage, 1);
+    m->cles[0] = (ClePage){ 0, 0 };
+    return GTK_TREE_MODEL(m);
+}
+
+// Modèle sur une liste d'ids, vide au départ (voir eleveModelAjouterIds).
+GtkTreeModel *eleveModelNouveauParIds(sqlite3 *db) {
+    EleveModel *m = g_object_new(ELEVE_TYPE_MODEL, NULL);
+    m->db = db;
+    m->par_ids = true;
+    return GTK_TREE_MODEL(m);
+}
+
+void eleveModelAjouterIds(GtkTreeModel *model, const int *ids, int n) {
+    EleveModel *m = ELEVE_MODEL(model);
+    g_return_if_fail(m->par_ids);
+    if (m->nb_lignes + n > m->ids_cap) {
+        m->ids_cap = MAX(m->ids_cap * 2, m->nb_lignes + n);
+        m->ids = g_renew(int, m->ids, m->ids_cap);
+    }
+    // la dernière page peut être incomplète : on l'invalide
+    int derniere = m->nb_lignes / MODELE_TAILLE_PAGE;
+    for (int i = 0; i < MODELE_NB_PAGES; i++) {
+        if (m->pages[i].numero == derniere) m->pages[i].numero = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        m->ids[m->nb_lignes] = ids[i];
+        GtkTreeIter iter = { m->stamp, GINT_TO_POINTER(m->nb_lignes), NULL, NULL };
+        GtkTreePath *path = gtk_tree_path_new_from_indices(m->nb_lignes, -1);
+        m->nb_lignes++;
+        gtk_tree_model_row_inserted(model, path, &iter);
+        gtk_tree_path_free(path);
+    }
+}
+
+// Position d'un id dans le mode liste d'ids, -1 s'il n'y figure pas.
+int eleveModelIndexId(EleveModel *m, sqlite3_int64 id) {
+    for (int i = 0; i < m->nb_lignes; i++) {
+        if (m->ids[i] == id) return i;
+    }
+    return -1;
+}
+
+void eleveModelSignaler(EleveModel *m, int index, TypeChangement type) {
+    GtkTreeIter iter = { m->stamp, GINT_TO_POINTER(index), NULL, NULL };
+    GtkTreePath *path = gtk_tree_path_new_from_indices(index, -1);
+    if (type == CHANGEMENT_INSERTION) gtk_tree_model_row_inserted(GTK_TREE_MODEL(m), path, &iter);
+    else if (type == CHANGEMENT_MODIFICATION) gtk_tree_model_row_changed(GTK_TREE_MODEL(m), path, &iter);
+    else gtk_tree_model_row_deleted(GTK_TREE_MODEL(m), path);
+    gtk_tree_path_free(path);
+}
+
+// Recherche : les lignes modifiées sont relues, les supprimées retirées ;
+// un nouvel élève n'y apparaît qu'en relançant la recherche.
+void eleveModelAppliquerIds(EleveModel *m, const ChangementEleve *ch, int n) {
+    eleveModelVider(m);
+    for (int i = 0; i < n; i++) {
+        if (ch[i].type == CHANGEMENT_INSERTION) continue;
+        int index = eleveModelIndexId(m, ch[i].id);
+        if (index < 0) continue;
+        if (ch[i].type == CHANGEMENT_SUPPRESSION) {
+            memmove(m->ids + index, m->ids + index + 1, sizeof(int) * (m->nb_lignes - index - 1));
+            m->nb_lignes--;
+        }
+        eleveModelSignaler(m, index, ch[i].type);
+    }
+}
+
+// Table entière : rang[i] reçoit le nombre d'ids < ch[i].id dans la table
+// (état validé). Les repères connus sont ceux d'avant les changements : sous
+// le repère p, il y a ses `rang` élèves, plus les insertions et moins les
+// suppressions d'ids inférieurs. Le parcours de la clé primaire repart donc
+// du repère connu le plus proche sous chaque changement, et ne lit que les
+// pages touchées au lieu de tout depuis l'id 0.
+void eleveModelRangs(EleveModel *m, const ChangementEleve *ch, int n, int *rang) {
+    sqlite3_stmt *stmt = obtenirRequete(m->db, STMT_IDS_ELEVES);
+    int p = 0, q = 1, j = 0, net = 0, compte = 0;
+    sqlite3_int64 borne = -1;           // compte : ids de l'état validé <= borne
+    sqlite3_int64 suivant = -1;         // id lu mais pas encore compté ; -1 : à lire
+    for (int i = 0; i < n; i++) {
+        for (; q < m->nb_cles && (m->cles[q].rang < 0 || m->cles[q].id < ch[i].id); q++) {
+            if (m->cles[q].rang >= 0) p = q;
+        }
+        if (m->cles[p].id > borne) {
+            for (; j < i && ch[j].id <= m->cles[p].id; j++) {
+                net += ch[j].type == CHANGEMENT_INSERTION ? 1 : ch[j].type == CHANGEMENT_SUPPRESSION ? -1 : 0;
+            }
+            compte = m->cles[p].rang + net;
+            borne = m->cles[p].id;
+            suivant = -1;
+            if (stmt) {
+                sqlite3_reset(stmt);
+                sqlite3_bind_int64(stmt, 1, borne);
+            }
+        }
+        while (stmt) {
+            if (suivant < 0) suivant = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : INT64_MAX;
+            if (suivant >= ch[i].id) break;
+            compte++;
+            borne = suivant;
+            suivant = -1;
+        }
+        rang[i] = compte;
+    }
+    libererRequete(stmt);
+}
+
+void eleveModelAppliquerTable(EleveModel *m, const ChangementEleve *ch, int n) {
+    if (m->req) {
+        m->perimees = true;         // pas encore de lignes : voir eleve_model_cles_fin
+        return;
+    }
+    int nb_ins = 0, nb_sup = 0;
+    bool ajouts_en_fin = true;
+    for (int i = 0; i < n; i++) {
+        if (ch[i].type == CHANGEMENT_INSERTION) nb_ins++;
+        if (ch[i].type == CHANGEMENT_SUPPRESSION) nb_sup++;
+        if (ch[i].type != CHANGEMENT_INSERTION || ch[i].id <= m->max_id) ajouts_en_fin = false;
+    }
+    int nb_final = m->nb_lignes + nb_ins - nb_sup;
+    int *rang = NULL;
+    if (!ajouts_en_fin) {
+        // avant de décaler les repères, dont part le calcul des rangs
+        rang = g_new(int, n);
+        eleveModelRangs(m, ch, n, rang);
+    }
+    // chaque repère compte désormais les insertions et suppressions d'ids
+    // inférieurs ou égaux au sien
+    int net = 0;
+    for (int p = 1, i = 0; p < m->nb_cles; p++) {
+        if (m->cles[p].rang < 0) continue;
+        for (; i < n && ch[i].id <= m->cles[p].id; i++) {
+            net += ch[i].type == CHANGEMENT_INSERTION ? 1 : ch[i].type == CHANGEMENT_SUPPRESSION ? -1 : 0;
+        }
+        m->cles[p].rang += net;
+    }
+    if (nb_final / MODELE_TAILLE_PAGE + 1 > m->nb_cles) {
+        int nb = nb_final / MODELE_TAILLE_PAGE + 1;
+        m->cles = g_renew(ClePage, m->cles, nb);
+        for (int p = m->nb_cles; p < nb; p++) m->cles[p] = (ClePage){ 0, -1 };
+        m->nb_cles = nb;
+    }
+    eleveModelVider(m);
+
+    if (ajouts_en_fin) {
+        // cas courant (ajout depuis l'interface, import) : pas de parcours
+        for (int i = 0; i < n; i++) eleveModelSignaler(m, m->nb_lignes++, CHANGEMENT_INSERTION);
+        m->max_id = ch[n - 1].id;
+        return;
+    }
+    // suppressions par id décroissant : rang dans l'état courant du modèle
+    int sup_avant = nb_sup, ins_avant = nb_ins;
+    for (int i = n - 1; i >= 0; i--) {
+        if (ch[i].type == CHANGEMENT_INSERTION) ins_avant--;
+        if (ch[i].type != CHANGEMENT_SUPPRESSION) continue;
+        sup_avant--;
+        m->nb_lignes--;
+        eleveModelSignaler(m, rang[i] + sup_avant - ins_avant, CHANGEMENT_SUPPRESSION);
+    }
+    for (int i = 0; i < n; i++) {
+        if (ch[i].type == CHANGEMENT_INSERTION) {
+            m->nb_lignes++;
+            eleveModelSignaler(m, rang[i], CHANGEMENT_INSERTION);
+            if (ch[i].id > m->max_id) m->max_id = ch[i].id;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (ch[i].type == CHANGEMENT_MODIFICATION) eleveModelSignaler(m, rang[i], CHANGEMENT_MODIFICATION);
+    }
+    eleveModelVider(m);
+    g_free(rang);
+}
+
+// Changements triés par id (voir prendreChangements).
+void eleveModelAppliquer(GtkTreeModel *model, const ChangementEleve *ch, int n) {
+    EleveModel *m = ELEVE_MODEL(model);
+    if (n == 0) return;
+    if (m->par_ids) eleveModelAppliquerIds(m, ch, n);
+    else eleveModelAppliquerTable(m, ch, n);
+}
+
+// Après une restauration, le contenu a changé sans passer par le suivi :
+// toutes les lignes sont retirées, puis les clés recalculées (une recherche
+// reste vide jusqu'à être relancée).
+void eleveModelRecharger(EleveModel *m) {
+    eleveModelVider(m);
+    while (m->nb_lignes > 0) eleveModelSignaler(m, --m->nb_lignes, CHANGEMENT_SUPPRESSION);
+    if (m->par_ids) return;
+    m->nb_cles = 1;
+    eleveModelCharger(m, m->sur_charge, m->donnees_charge);
+}
+
+// Une seule application par itération de la boucle GTK, quel que soit le
+// nombre de transactions validées entre-temps.
+gboolean changements_idle(gpointer user_data) {
+    changements_prevus = false;
+    ChangementEleve *ch;
+    int n = prendreChangements(&ch);
+    for (GSList *l = modeles_ouverts; l; l = l->next) eleveModelAppliquer(l->data, ch, n);
+    free(ch);
+    return G_SOURCE_REMOVE;
+}
+
+void changements_notifier(void) {
+    if (changements_prevus) return;
+    changements_prevus = true;
+    g_idle_add(changements_idle, NULL);
+}
+
+static GtkTreeModelFlags eleve_model_get_flags(GtkTreeModel *model) {
+    return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint eleve_model_get_n_columns(GtkTreeModel *model) {
+    return NUM_COLS;
+}
+
+static GType eleve_model_get_column_type(GtkTreeModel *model, gint col) {
+    switch (col) {
+        case COL_ID:
+        case COL_AGE:    return G_TYPE_INT;
+        case COL_TAILLE: return G_TYPE_DOUBLE;
+        default:         return G_TYPE_STRING;
+    }
+}
+
+static gboolean eleve_model_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path) {
+    EleveModel *m = ELEVE_MODEL(model);
+    if (gtk_tree_path_get_depth(path) != 1) return FALSE;
+    int index = gtk_tree_path_get_indices(path)[0];
+    if (index < 0 || index >= m->nb_lignes) return FALSE;
+    iter->stamp = m->stamp;
+    iter->user_data = GINT_TO_POINTER(index);
+    return TRUE;
+}
+
+static GtkTreePath *eleve_model_get_path(GtkTreeModel *model, GtkTreeIter *iter) {
+    return gtk_tree_path_new_from_indices(GPOINTER_TO_INT(iter->user_data), -1);
+}
+
+static void eleve_model_get_value(GtkTreeModel *model, GtkTreeIter *iter, gint col, GValue *value) {
+    EleveModel *m = ELEVE_MODEL(model);
+    const LotEleves *lot;
+    const EleveCompact *e = eleveModelLigne(m, GPOINTER_TO_INT(iter->user_data), &lot);
+    g_value_init(value, eleve_model_get_column_type(model, col));
+    if (!e) return;
+    switch (col) {
+        case COL_ID:        g_value_set_int(value, e->id); break;
+        case COL_NOM:       g_value_set_string(value, lotChaine(lot, e->nom)); break;
+        case COL_AGE:       g_value_set_int(value, e->age); break;
+        case COL_TAILLE:    g_value_set_double(value, e->taille); break;
+        case COL_EMAIL:     g_value_set_string(value, lotChaine(lot, e->email)); break;
+        case COL_TELEPHONE: g_value_set_string(value, lotChaine(lot, e->telephone)); break;
+        case COL_GRADE:     g_value_set_string(value, lotChaine(lot, e->grade)); break;
+    }
+}
+
+static gboolean eleve_model_iter_next(GtkTreeModel *model, GtkTreeIter *iter) {
+    int index = GPOINTER_TO_INT(iter->user_data) + 1;
+    if (index >= ELEVE_MODEL(model)->nb_lignes) return FALSE;
+    iter->user_data = GINT_TO_POINTER(index);
+    return TRUE;
+}
+
+static gboolean eleve_model_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n) {
+    EleveModel *m = ELEVE_MODEL(model);
+    if (parent || n < 0 || n >= m->nb_lignes) return FALSE;
+    iter->stamp = m->stamp;
+    iter->user_data = GINT_TO_POINTER(n);
+    return TRUE;
+}
+
+static gboolean eleve_model_iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent) {
+    return eleve_model_iter_nth_child(model, iter, parent, 0);
+}
+
+static gboolean eleve_model_iter_has_child(GtkTreeModel *model, GtkTreeIter *iter) {
+    return FALSE;
+}
+
+static gint eleve_model_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter) {
+    return iter ? 0 : ELEVE_MODEL(model)->nb_lignes;
+}
+
+static gboolean eleve_model_iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child) {
+    return FALSE;
+}
+
+static void eleve_model_tree_model_init(GtkTreeModelIface *iface) {
+    iface->get_flags = eleve_model_get_flags;
+    iface->get_n_columns = eleve_model_get_n_columns;
+    iface->get_column_type = eleve_model_get_column_type;
+    iface->get_iter = eleve_model_get_iter;
+    iface->get_path = eleve_model_get_path;
+    iface->get_value = eleve_model_get_value;
+    iface->iter_next = eleve_model_iter_next;
+    iface->iter_children = eleve_model_iter_children;
+    iface->iter_has_child = eleve_model_iter_has_child;
+    iface->iter_n_children = eleve_model_iter_n_children;
+    iface->iter_nth_child = eleve_model_iter_nth_child;
+    iface->iter_parent = eleve_model_iter_parent;
+}
+
+/* Fenêtre de résultats sur un EleveModel : un TreeView, une ligne d'état et
+ * un bouton pour annuler la requête de l'exécuteur qui alimente le modèle
+ * (ids d'une recherche ou d'une liste, clés de pages de la table). */
+typedef struct {
+    Requete *req;
+    GtkTreeModel *model;
+    GtkWidget *treeview;
+    GtkWidget *etat;
+    GtkWidget *btn_annuler;
+} FenetreResultats;
+
+void resultats_sur_lot(Requete *req, const LotEleves *lot);
+void resultats_sur_fin(Requete *req, bool ok);
+void trigrammesVerifier(void);
+
+// (Re)lance la recherche : l'éventuelle requête en cours est annulée et
+// remplacée, avec un modèle neuf.
+void resultatsRechercher(FenetreResultats *fr, const char *terme) {
+    if (fr->req) {
+        requeteAnnuler(fr->req);
+        fr->req->data = NULL;
+        requeteUnref(fr->req);
+    }
+    GtkTreeModel *ancien = fr->model;
+    fr->model = eleveModelNouveauParIds(db);
+    gtk_tree_view_set_model(GTK_TREE_VIEW(fr->treeview), fr->model);
+    g_object_unref(ancien);
+    gtk_label_set_text(GTK_LABEL(fr->etat), "Chargement...");
+    gtk_widget_set_sensitive(fr->btn_annuler, TRUE);
+    trigrammesVerifier();
+    fr->req = executeurSoumettre(REQ_RECHERCHE, terme, resultats_sur_lot, resultats_sur_fin, fr);
+}
+
+// Recherche à la frappe : GtkSearchEntry regroupe déjà les frappes rapprochées
+void on_results_search_changed(GtkSearchEntry *entry, gpointer user_data) {
+    resultatsRechercher(user_data, gtk_entry_get_text(GTK_ENTRY(entry)));
+}
+
+void on_results_cancel_clicked(GtkButton *button, gpointer user_data) {
+    FenetreResultats *fr = user_data;
+    if (fr->req) requeteAnnuler(fr->req);
+    else eleveModelAnnuler(ELEVE_MODEL(fr->model));
+}
+
+void on_results_destroy(GtkWidget *widget, gpointer user_data) {
+    FenetreResultats *fr = user_data;
+    if (fr->req) {
+        requeteAnnuler(fr->req);
+        fr->req->data = NULL;
+        requeteUnref(fr->req);
+    }
+    ELEVE_MODEL(fr->model)->sur_charge = NULL;
+    g_object_unref(fr->model);
+    g_free(fr);
+}
+
+void resultats_sur_lot(Requete *req, const LotEleves *lot) {
+    FenetreResultats *fr = req->data;
+    if (!fr) return;
+    int ids[EXEC_LOT_LIGNES];
+    for (int i = 0; i < lot->n; i++) ids[i] = lot->lignes[i].id;
+    eleveModelAjouterIds(fr->model, ids, lot->n);
+    char texte[64];
+    snprintf(texte, sizeof(texte), "Chargement... %ld élèves", req->lignes);
+    gtk_label_set_text(GTK_LABEL(fr->etat), texte);
+}
+
+// Ligne d'état en fin de requête, qu'elle ait rempli le modèle ou non.
+void resultatsTerminer(FenetreResultats *fr, Requete *req, bool ok) {
+    char texte[64];
+    if (g_atomic_int_get(&req->annulee)) {
+        snprintf(texte, sizeof(texte), "Annulé après %ld élèves", req->lignes);
+    } else if (!ok) {
+        snprintf(texte, sizeof(texte), "Erreur lors de la requête");
+    } else if (req->lignes == 0) {
+        snprintf(texte, sizeof(texte), "Aucun élève trouvé");
+    } else if (req->type == REQ_RECHERCHE && req->lignes >= RECHERCHE_MAX_RESULTATS) {
+        snprintf(texte, sizeof(texte), "%ld meilleurs résultats", req->lignes);
+    } else if (req->approchants > 0) {
+        snprintf(texte, sizeof(texte), "%ld élèves, dont %ld approchants", req->lignes, req->approchants);
+    } else {
+        snprintf(texte, sizeof(texte), "%ld élèves", req->lignes);
+    }
+    gtk_label_set_text(GTK_LABEL(fr->etat), texte);
+    gtk_widget_set_sensitive(fr->btn_annuler, FALSE);
+}
+
+void resultats_sur_fin(Requete *req, bool ok) {
+    FenetreResultats *fr = req->data;
+    if (!fr) return;
+    resultatsTerminer(fr, req, ok);
+}
+
+// Table entière : les lignes sont posées d'un coup, la vue relit le modèle
+// plutôt que de recevoir un signal par ligne.
+void resultats_sur_charge(EleveModel *m, Requete *req, bool ok, gpointer data) {
+    FenetreResultats *fr = data;
+    if (ok) {
+        gtk_tree_view_set_model(GTK_TREE_VIEW(fr->treeview), NULL);
+        gtk_tree_view_set_model(GTK_TREE_VIEW(fr->treeview), fr->model);
+    }
+    resultatsTerminer(fr, req, ok);
+}
+
+// Crée la fenêtre et ses colonnes (indices COL_*) sur `model`, dont elle prend
+// la référence. Avec un terme, lance la recherche sur l'exécuteur.
+void ouvrirFenetreResultats(const char *titre, int largeur, GtkTreeModel *model,
+                            const char **titres, const int *colonnes, int nb_colonnes,
+                            const char *terme) {
+    FenetreResultats *fr = g_new0(FenetreResultats, 1);
+    fr->model = model;
+
+    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), titre);
+    gtk_window_set_default_size(GTK_WINDOW(window), largeur, 400);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(window), vbox);
+    GtkWidget *search_entry = NULL;
+    if (terme) {
+        search_entry = gtk_search_entry_new();
+        gtk_entry_set_text(GTK_ENTRY(search_entry), terme);
+        gtk_box_pack_start(GTK_BOX(vbox), search_entry, FALSE, FALSE, 0);
+    }
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_box_pack_start(GTK_BOX(vbox), scrolled_window, TRUE, TRUE, 0);
+
+    GtkWidget *treeview = gtk_tree_view_new_with_model(model);
+    fr->treeview = treeview;
+    gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(treeview), TRUE);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), treeview);
+    for (int i = 0; i < nb_colonnes; i++) {
+        GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+        GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(titres[i], renderer, "text", colonnes[i], NULL);
+        // Hauteur fixe : le TreeView ne lit que les lignes visibles
+        gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+        gtk_tree_view_column_set_fixed_width(column, colonnes[i] == COL_ID || colonnes[i] == COL_AGE ? 60 : 150);
+        gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    }
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(treeview), TRUE);
+
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+    fr->etat = gtk_label_new("Chargement...");
+    gtk_box_pack_start(GTK_BOX(hbox), fr->etat, TRUE, TRUE, 0);
+    fr->btn_annuler = gtk_button_new_with_label("Annuler");
+    g_signal_connect(fr->btn_annuler, "clicked", G_CALLBACK(on_results_cancel_clicked), fr);
+    gtk_box_pack_start(GTK_BOX(hbox), fr->btn_annuler, FALSE, FALSE, 0);
+
+    g_signal_connect(window, "destroy", G_CALLBACK(on_results_destroy), fr);
+    gtk_widget_show_all(window);
+    if (terme) {
+        trigrammesVerifier();
+        fr->req = executeurSoumettre(REQ_RECHERCHE, terme, resultats_sur_lot, resultats_sur_fin, fr);
+        g_signal_connect(search_entry, "search-changed", G_CALLBACK(on_results_search_changed), fr);
+    } else if (ELEVE_MODEL(model)->par_ids) {
+        fr->req = executeurSoumettre(REQ_LISTE, NULL, resultats_sur_lot, resultats_sur_fin, fr);
+    } else {
+        eleveModelCharger(ELEVE_MODEL(model), resultats_sur_charge, fr);
+    }
+}
+
+void on_add_student_clicked(GtkButton *button, gpointer user_data) {
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Ajouter un Élève",
+                                                    GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                    "_Ajouter", GTK_RESPONSE_OK,
+                                                    "_Annuler", GTK_RESPONSE_CANCEL,
+                                                    NULL);
+    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget *grid = gtk_grid_new();
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+    
+    //étiquettes et zones de saisie
+    GtkWidget *label_nom = gtk_label_new("Nom:");
+    GtkWidget *entry_nom = gtk_entry_new();
+    GtkWidget *label_age = gtk_label_new("Âge:");
+    GtkWidget *entry_age = gtk_entry_new();
+    GtkWidget *label_taille = gtk_label_new("Taille (m):");
     GtkWidget *entry_taille = gtk_entry_new();
     GtkWidget *label_email = gtk_label_new("Email:");
     GtkWidget *entry_email = gtk_entry_new();
@@ -332,398 +8876,3354 @@ void on_add_student_clicked(GtkButton *button, gpointer user_data) {
     GtkWidget *label_grade = gtk_label_new("Grade:");
     GtkWidget *entry_grade = gtk_entry_new();
     
-    // placement dans la grille
-    gtk_grid_attach(GTK_GRID(grid), label_nom, 0, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_nom, 1, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_age, 0, 1, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_age, 1, 1, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_taille, 0, 2, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_taille, 1, 2, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_email, 0, 3, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_email, 1, 3, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_telephone, 0, 4, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_telephone, 1, 4, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_grade, 0, 5, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_grade, 1, 5, 1, 1);
+    // placement dans la grille
+    gtk_grid_attach(GTK_GRID(grid), label_nom, 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_nom, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_age, 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_age, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_taille, 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_taille, 1, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_email, 0, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_email, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_telephone, 0, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_telephone, 1, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_grade, 0, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_grade, 1, 5, 1, 1);
+    
+    // Limite en caractères ; copierChamp vérifie ensuite les octets (UTF-8).
+    gtk_entry_set_max_length(GTK_ENTRY(entry_nom), MAX_NOM - 1);
+    gtk_entry_set_max_length(GTK_ENTRY(entry_email), MAX_EMAIL - 1);
+    gtk_entry_set_max_length(GTK_ENTRY(entry_telephone), MAX_TELEPHONE - 1);
+    gtk_entry_set_max_length(GTK_ENTRY(entry_grade), MAX_GRADE - 1);
+    
+    gtk_widget_show_all(dialog);
+    Personne p;
+    int result;
+    while ((result = gtk_dialog_run(GTK_DIALOG(dialog))) == GTK_RESPONSE_OK) {
+        const char *trop_long = NULL;
+        if (!copierChamp(p.nom, sizeof(p.nom), gtk_entry_get_text(GTK_ENTRY(entry_nom)))) trop_long = "Nom";
+        else if (!copierChamp(p.email, sizeof(p.email), gtk_entry_get_text(GTK_ENTRY(entry_email)))) trop_long = "Email";
+        else if (!copierChamp(p.telephone, sizeof(p.telephone), gtk_entry_get_text(GTK_ENTRY(entry_telephone)))) trop_long = "Téléphone";
+        else if (!copierChamp(p.grade, sizeof(p.grade), gtk_entry_get_text(GTK_ENTRY(entry_grade)))) trop_long = "Grade";
+        if (!trop_long) break;
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(dialog),
+                                                    GTK_DIALOG_MODAL,
+                                                    GTK_MESSAGE_ERROR,
+                                                    GTK_BUTTONS_OK,
+                                                    "Champ « %s » trop long.", trop_long);
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+    }
+    if(result == GTK_RESPONSE_OK) {
+        p.age = atoi(gtk_entry_get_text(GTK_ENTRY(entry_age)));
+        p.taille = atof(gtk_entry_get_text(GTK_ENTRY(entry_taille)));
+        if (ajouterEleve(db, &p)) {
+            GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                       GTK_DIALOG_MODAL,
+                                                       GTK_MESSAGE_INFO,
+                                                       GTK_BUTTONS_OK,
+                                                       "Élève ajouté avec succès !");
+            gtk_dialog_run(GTK_DIALOG(info));
+            gtk_widget_destroy(info);
+        } else {
+            GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                        GTK_DIALOG_MODAL,
+                                                        GTK_MESSAGE_ERROR,
+                                                        GTK_BUTTONS_OK,
+                                                        "Erreur lors de l'ajout de l'élève.");
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+        }
+    }
+    gtk_widget_destroy(dialog);
+}
+
+void on_list_students_clicked(GtkWidget *widget, gpointer data) {
+    const char *titres[] = { "ID", "Nom", "Age" };
+    const int colonnes[] = { COL_ID, COL_NOM, COL_AGE };
+    ouvrirFenetreResultats("Liste des étudiants", 600, eleveModelNouveau(db), titres, colonnes, 3, NULL);
+}
+
+
+// Toutes les années : les ids arrivent de l'exécuteur, fusionnés par id.
+void on_list_all_students_clicked(GtkWidget *widget, gpointer data) {
+    const char *titres[] = { "ID", "Nom", "Age" };
+    const int colonnes[] = { COL_ID, COL_NOM, COL_AGE };
+    ouvrirFenetreResultats("Élèves de toutes les années", 600, eleveModelNouveauParIds(db), titres, colonnes, 3, NULL);
+}
+
+void on_delete_student_clicked(GtkButton *button, gpointer user_data) {
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Supprimer un Élève",
+                                                    GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                    "_Supprimer", GTK_RESPONSE_OK,
+                                                    "_Annuler", GTK_RESPONSE_CANCEL,
+                                                    NULL);
+    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget *entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "Entrez l'ID de l'élève");
+    gtk_container_add(GTK_CONTAINER(content_area), entry);
+    gtk_widget_show_all(dialog);
+    int response = gtk_dialog_run(GTK_DIALOG(dialog));
+    if(response == GTK_RESPONSE_OK) {
+        int id = atoi(gtk_entry_get_text(GTK_ENTRY(entry)));
+        if (supprimerEleve(db, id)) {
+            GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                       GTK_DIALOG_MODAL,
+                                                       GTK_MESSAGE_INFO,
+                                                       GTK_BUTTONS_OK,
+                                                       "Élève supprimé avec succès !");
+            gtk_dialog_run(GTK_DIALOG(info));
+            gtk_widget_destroy(info);
+        } else {
+            int annee = partitionLireEleve(id, NULL);
+            GtkWidget *error = annee
+                ? gtk_message_dialog_new(GTK_WINDOW(user_data), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                         "Erreur: cet élève est archivé (%d-%d), en lecture seule.", annee, annee + 1)
+                : gtk_message_dialog_new(GTK_WINDOW(user_data), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                         "Erreur: Aucun élève trouvé avec cet ID.");
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+        }
+    }
+    gtk_widget_destroy(dialog);
+}
+
+void on_search_student_clicked(GtkButton *button, gpointer user_data) {
+    // Boîte de dialogue pour saisir le terme de recherche
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Rechercher un Élève",
+                                                    GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                    "_Rechercher", GTK_RESPONSE_OK,
+                                                    "_Annuler", GTK_RESPONSE_CANCEL,
+                                                    NULL);
+    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget *entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "Entrez un terme de recherche");
+    gtk_container_add(GTK_CONTAINER(content_area), entry);
+    gtk_widget_show_all(dialog);
+    
+    int response = gtk_dialog_run(GTK_DIALOG(dialog));
+    if (response == GTK_RESPONSE_OK) {
+        const char *terme = gtk_entry_get_text(GTK_ENTRY(entry));
+        
+        // Même modèle paresseux que la liste, alimenté en ids par l'exécuteur
+        const char *titres[] = { "ID", "Nom", "Âge", "Taille", "Email", "Téléphone", "Grade" };
+        const int colonnes[] = { COL_ID, COL_NOM, COL_AGE, COL_TAILLE, COL_EMAIL, COL_TELEPHONE, COL_GRADE };
+        ouvrirFenetreResultats("Résultats de recherche", 800, eleveModelNouveauParIds(db),
+                               titres, colonnes, NUM_COLS, terme);
+    }
+    gtk_widget_destroy(dialog);
+}
+
+
+typedef struct {
+    GtkWidget *parent;
+    GtkWidget *fenetre;         // NULL une fois détruite
+    GtkWidget *progression;
+    guint pulsation;
+    Requete *req;
+} ExportGUI;
+
+gboolean export_pulse(gpointer user_data) {
+    ExportGUI *eg = user_data;
+    if (!eg->progression) return G_SOURCE_CONTINUE;
+    int total = eg->req ? g_atomic_int_get(&eg->req->total) : 0;
+    if (total > 0) {
+        int faits = g_atomic_int_get(&eg->req->faits);
+        char texte[64];
+        snprintf(texte, sizeof(texte), "%d / %d", faits, total);
+        gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(eg->progression), TRUE);
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(eg->progression), texte);
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(eg->progression), (double)faits / total);
+    } else {
+        gtk_progress_bar_pulse(GTK_PROGRESS_BAR(eg->progression));
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void on_export_cancel_clicked(GtkButton *button, gpointer user_data) {
+    requeteAnnuler(user_data);
+}
+
+// Fermeture par le gestionnaire de fenêtres : vaut Annuler ; la fenêtre
+// reste jusqu'à export_sur_fin, qui la détruit.
+gboolean on_export_delete(GtkWidget *widget, GdkEvent *event, gpointer user_data) {
+    ExportGUI *eg = user_data;
+    requeteAnnuler(eg->req);
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(eg->progression), TRUE);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(eg->progression), "Annulation…");
+    return TRUE;
+}
+
+void on_export_destroy(GtkWidget *widget, gpointer user_data) {
+    ExportGUI *eg = user_data;
+    eg->fenetre = NULL;
+    eg->progression = NULL;
+}
+
+void export_sur_fin(Requete *req, bool ok) {
+    ExportGUI *eg = req->data;
+    g_source_remove(eg->pulsation);
+    if (eg->fenetre) gtk_widget_destroy(eg->fenetre);
+    if (ok) {
+        GtkWidget *info = req->type == REQ_BULLETINS
+            ? gtk_message_dialog_new(GTK_WINDOW(eg->parent), GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                     "%ld bulletins générés dans '%s'.", req->lignes,
+                                     strchr(strchr(strchr(req->param, ':') + 1, ':') + 1, ':') + 1)
+            : req->type == REQ_EXPORT_TABLES
+            ? gtk_message_dialog_new(GTK_WINDOW(eg->parent), GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                     "Export des tables réussi dans '%s' (%ld lignes).", strchr(req->param, ':') + 1, req->lignes)
+            : gtk_message_dialog_new(GTK_WINDOW(eg->parent), GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                     "Exportation CSV réussie dans '%s'.", CSV_FILENAME);
+        gtk_dialog_run(GTK_DIALOG(info));
+        gtk_widget_destroy(info);
+    } else if (!g_atomic_int_get(&req->annulee)) {
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(eg->parent),
+                                                   GTK_DIALOG_MODAL,
+                                                   GTK_MESSAGE_ERROR,
+                                                   GTK_BUTTONS_OK,
+                                                   "Erreur lors de l'exportation, voir %s.", LOG_FILENAME);
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+    }
+    g_free(eg);
+    requeteUnref(req);
+}
+
+void lancerExport(GtkWidget *parent, TypeRequete type, const char *param, const char *titre) {
+    ExportGUI *eg = g_new0(ExportGUI, 1);
+    eg->parent = parent;
+    eg->fenetre = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(eg->fenetre), titre);
+    gtk_window_set_default_size(GTK_WINDOW(eg->fenetre), 300, 80);
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(eg->fenetre), vbox);
+    eg->progression = gtk_progress_bar_new();
+    gtk_box_pack_start(GTK_BOX(vbox), eg->progression, FALSE, FALSE, 0);
+    GtkWidget *btn_cancel = gtk_button_new_with_label("Annuler");
+    gtk_box_pack_start(GTK_BOX(vbox), btn_cancel, FALSE, FALSE, 0);
+    gtk_widget_show_all(eg->fenetre);
+    eg->pulsation = g_timeout_add(100, export_pulse, eg);
+
+    // La référence de l'appelant est rendue dans export_sur_fin
+    Requete *req = executeurSoumettre(type, param, NULL, export_sur_fin, eg);
+    eg->req = req;
+    g_signal_connect(btn_cancel, "clicked", G_CALLBACK(on_export_cancel_clicked), req);
+    g_signal_connect(eg->fenetre, "delete-event", G_CALLBACK(on_export_delete), eg);
+    g_signal_connect(eg->fenetre, "destroy", G_CALLBACK(on_export_destroy), eg);
+}
+
+void on_export_csv_clicked(GtkButton *button, gpointer user_data) {
+    lancerExport(GTK_WIDGET(user_data), REQ_EXPORT, NULL, "Export CSV");
+}
+
+// Toutes les tables vers un dossier, au format choisi sous le sélecteur.
+void on_export_tables_clicked(GtkButton *button, gpointer user_data) {
+    GtkWidget *chooser = gtk_file_chooser_dialog_new("Exporter les tables",
+                                                     GTK_WINDOW(user_data),
+                                                     GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER,
+                                                     "_Annuler", GTK_RESPONSE_CANCEL,
+                                                     "_Exporter", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    GtkWidget *formats = gtk_combo_box_text_new();
+    for (int f = 0; f < EXPORT_NB_FORMATS; f++) {
+        for (int c = 0; c < EXPORT_NB_COMPRESSIONS; c++) {
+#ifndef CPRONOTE_ZSTD
+            if (c == COMPRESSION_ZSTD) continue;
+#endif
+            char nom[32];
+            snprintf(nom, sizeof(nom), "%s%s", format_export_noms[f], compression_extensions[c]);
+            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(formats), nom);
+        }
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(formats), 0);
+    gtk_file_chooser_set_extra_widget(GTK_FILE_CHOOSER(chooser), formats);
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(chooser);
+        return;
+    }
+    char *dossier = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    char *format = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(formats));
+    gtk_widget_destroy(chooser);
+    char *param = g_strdup_printf("%s:%s", format, dossier);
+    lancerExport(GTK_WIDGET(user_data), REQ_EXPORT_TABLES, param, "Export des tables");
+    g_free(param);
+    g_free(format);
+    g_free(dossier);
+}
+
+// Bulletins d'un trimestre vers un dossier ; trimestre, classe et PDF sous le sélecteur.
+void on_bulletins_clicked(GtkButton *button, gpointer user_data) {
+    GtkWidget *chooser = gtk_file_chooser_dialog_new("Générer les bulletins",
+                                                     GTK_WINDOW(user_data),
+                                                     GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER,
+                                                     "_Annuler", GTK_RESPONSE_CANCEL,
+                                                     "_Générer", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    char courant[16];
+    trimestreCourant(courant, sizeof(courant));
+    GtkWidget *entry_trimestre = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(entry_trimestre), courant);
+    gtk_entry_set_placeholder_text(GTK_ENTRY(entry_trimestre), "AAAA-Tn");
+    GtkWidget *entry_classe = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(entry_classe), "Classe (toutes si vide)");
+    GtkWidget *check_pdf = gtk_check_button_new_with_label("PDF");
+    gtk_box_pack_start(GTK_BOX(hbox), gtk_label_new("Trimestre :"), FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(hbox), entry_trimestre, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(hbox), entry_classe, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(hbox), check_pdf, FALSE, FALSE, 0);
+    gtk_widget_show_all(hbox);
+    gtk_file_chooser_set_extra_widget(GTK_FILE_CHOOSER(chooser), hbox);
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(chooser);
+        return;
+    }
+    char *dossier = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    char *param = g_strdup_printf("%s:%s:%s:%s", gtk_entry_get_text(GTK_ENTRY(entry_trimestre)),
+                                  gtk_entry_get_text(GTK_ENTRY(entry_classe)),
+                                  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(check_pdf)) ? "pdf" : "html", dossier);
+    gtk_widget_destroy(chooser);
+    lancerExport(GTK_WIDGET(user_data), REQ_BULLETINS, param, "Bulletins");
+    g_free(param);
+    g_free(dossier);
+}
+
+
+/* Import CSV : la boucle GTK reste réactive, l'import avance par tranches
+ * depuis un callback idle qui met à jour la barre de progression. */
+typedef struct {
+    ImportCSV *imp;
+    GtkWidget *fenetre;
+    GtkWidget *progression;
+    GtkWidget *parent;
+    bool annule;
+} ImportGUI;
+
+void on_import_cancel_clicked(GtkButton *button, gpointer user_data) {
+    ImportGUI *ig = user_data;
+    ig->annule = true;
+}
+
+// Fermeture par le gestionnaire de fenêtres : vaut Annuler, la fenêtre est
+// détruite par import_idle une fois le lot en cours validé.
+gboolean on_import_delete(GtkWidget *widget, GdkEvent *event, gpointer user_data) {
+    on_import_cancel_clicked(NULL, user_data);
+    return TRUE;
+}
+
+// Chaque tranche valide son lot avant de rendre la main : aucune transaction
+// ne reste ouverte entre deux appels, où une écriture de l'utilisateur s'y
+// joindrait (et serait annulée avec le lot en cas d'échec).
+gboolean import_idle(gpointer user_data) {
+    ImportGUI *ig = user_data;
+    bool encore = !ig->annule && importEtape(ig->imp, IMPORT_TRANCHE_GUI);
+    encore = importValiderLot(ig->imp) && encore;
+    char texte[128];
+    snprintf(texte, sizeof(texte), "%ld importés, %ld rejetés", ig->imp->importees, ig->imp->rejetees);
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ig->progression), importProgression(ig->imp));
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(ig->progression), texte);
+    if (encore) return G_SOURCE_CONTINUE;
+
+    bool echec = ig->imp->echec;
+    long importees = ig->imp->importees;
+    long rejetees = ig->imp->rejetees;
+    importFermer(ig->imp);
+    gtk_widget_destroy(ig->fenetre);
+    GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(ig->parent),
+                                               GTK_DIALOG_MODAL,
+                                               echec ? GTK_MESSAGE_ERROR : rejetees ? GTK_MESSAGE_WARNING : GTK_MESSAGE_INFO,
+                                               GTK_BUTTONS_OK,
+                                               "%s : %ld élèves importés, %ld lignes rejetées (voir '%s').",
+                                               echec ? "Import arrêté sur une erreur d'écriture (voir log.txt)" :
+                                               ig->annule ? "Import interrompu" : "Import terminé",
+                                               importees, rejetees, CSV_REJETS_FILENAME);
+    gtk_dialog_run(GTK_DIALOG(info));
+    gtk_widget_destroy(info);
+    free(ig);
+    return G_SOURCE_REMOVE;
+}
+
+void on_import_csv_clicked(GtkButton *button, gpointer user_data) {
+    GtkWidget *chooser = gtk_file_chooser_dialog_new("Importer un fichier CSV",
+                                                     GTK_WINDOW(user_data),
+                                                     GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                     "_Annuler", GTK_RESPONSE_CANCEL,
+                                                     "_Importer", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(chooser);
+        return;
+    }
+    char *chemin = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    gtk_widget_destroy(chooser);
+    ImportCSV *imp = importOuvrir(db, chemin, CSV_REJETS_FILENAME, IMPORT_TRANCHE_GUI);
+    g_free(chemin);
+    if (!imp) {
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL,
+                                                    GTK_MESSAGE_ERROR,
+                                                    GTK_BUTTONS_OK,
+                                                    "Erreur lors de l'ouverture du fichier CSV.");
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+        return;
+    }
+
+    ImportGUI *ig = calloc(1, sizeof(ImportGUI));
+    ig->imp = imp;
+    ig->parent = GTK_WIDGET(user_data);
+    ig->fenetre = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(ig->fenetre), "Import CSV");
+    gtk_window_set_default_size(GTK_WINDOW(ig->fenetre), 400, 80);
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(ig->fenetre), vbox);
+    ig->progression = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(ig->progression), TRUE);
+    gtk_box_pack_start(GTK_BOX(vbox), ig->progression, FALSE, FALSE, 0);
+    GtkWidget *btn_cancel = gtk_button_new_with_label("Annuler");
+    g_signal_connect(btn_cancel, "clicked", G_CALLBACK(on_import_cancel_clicked), ig);
+    g_signal_connect(ig->fenetre, "delete-event", G_CALLBACK(on_import_delete), ig);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_cancel, FALSE, FALSE, 0);
+    gtk_widget_show_all(ig->fenetre);
+    g_idle_add(import_idle, ig);
+}
+
+/* Sauvegarde et restauration : une étape par passage dans la boucle GTK
+ * (voir Sauvegarde), après l'attente demandée si la base est occupée ;
+ * progression dans la barre d'état de la fenêtre principale. */
+typedef struct {
+    Sauvegarde *s;
+    GtkWidget *barre;
+    GtkWidget *parent;
+    bool planifiee;             // instantané avec rotation, sans boîte de dialogue
+    GThread *publication;
+} SauvegardeGUI;
+
+SauvegardeGUI sauvegarde_gui;
+
+typedef struct {
+    char temporaire[264];
+    char chemin[256];
+    bool planifiee;
+    bool ok;
+} PublicationSauvegarde;
+
+gboolean sauvegarde_publiee(gpointer user_data) {
+    PublicationSauvegarde *pub = user_data;
+    if (sauvegarde_gui.publication) {
+        g_thread_join(sauvegarde_gui.publication);
+        sauvegarde_gui.publication = NULL;
+    }
+    gtk_widget_hide(sauvegarde_gui.barre);
+    if (pub->ok) auditer("sauvegarde fichier=%s", pub->chemin);
+    if (!pub->planifiee) {
+        GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(sauvegarde_gui.parent),
+                                                   GTK_DIALOG_MODAL,
+                                                   pub->ok ? GTK_MESSAGE_INFO : GTK_MESSAGE_ERROR,
+                                                   GTK_BUTTONS_OK,
+                                                   pub->ok ? "Sauvegarde écrite dans '%s'." : "Erreur lors de la sauvegarde dans '%s'.",
+                                                   pub->chemin);
+        gtk_dialog_run(GTK_DIALOG(info));
+        gtk_widget_destroy(info);
+    }
+    g_free(pub);
+    return G_SOURCE_REMOVE;
+}
+
+gpointer sauvegarde_publication_thread(gpointer user_data) {
+    PublicationSauvegarde *pub = user_data;
+    if (pub->planifiee) sauvegardeRotation(SAUVEGARDE_PREFIXE, SAUVEGARDE_NB_ARCHIVES);
+    pub->ok = sauvegardePublier(pub->temporaire, pub->chemin);
+    g_idle_add(sauvegarde_publiee, pub);
+    return NULL;
+}
+
+// Fin de la restauration : les fenêtres ouvertes relisent la base.
+void restauration_finie(Sauvegarde *s) {
+    bool ok = restaurationTerminer(db, s);
+    gtk_widget_hide(sauvegarde_gui.barre);
+    gtk_widget_set_sensitive(sauvegarde_gui.parent, TRUE);
+    // la copie ne passe pas par le suivi des changements
+    if (ok) {
+        for (GSList *l = modeles_ouverts; l; l = l->next) eleveModelRecharger(l->data);
+    }
+    GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(sauvegarde_gui.parent),
+                                               GTK_DIALOG_MODAL,
+                                               ok ? GTK_MESSAGE_INFO : GTK_MESSAGE_ERROR,
+                                               GTK_BUTTONS_OK,
+                                               ok ? "Base restaurée." : "Erreur lors de la restauration (voir log.txt).");
+    gtk_dialog_run(GTK_DIALOG(info));
+    gtk_widget_destroy(info);
+}
+
+gboolean sauvegarde_idle(gpointer user_data);
+
+// Fin de l'attente d'une base occupée : les étapes reprennent.
+gboolean sauvegarde_reprise(gpointer user_data) {
+    if (sauvegarde_gui.s) g_idle_add(sauvegarde_idle, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+gboolean sauvegarde_idle(gpointer user_data) {
+    Sauvegarde *s = sauvegarde_gui.s;
+    if (!s) return G_SOURCE_REMOVE;
+    bool encore = sauvegardeEtape(s);
+    char texte[96];
+    snprintf(texte, sizeof(texte), "%s : %.0f %% (%d / %d pages)%s", s->restauration ? "Restauration" : "Sauvegarde",
+             sauvegardeProgression(s) * 100, s->total - s->restantes, s->total, s->attente_ms ? ", base occupée" : "");
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(sauvegarde_gui.barre), sauvegardeProgression(s));
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(sauvegarde_gui.barre), texte);
+    if (encore && s->attente_ms > 0) {
+        g_timeout_add(s->attente_ms, sauvegarde_reprise, NULL);
+        return G_SOURCE_REMOVE;
+    }
+    if (encore) return G_SOURCE_CONTINUE;
+    sauvegarde_gui.s = NULL;
+    if (s->restauration) {
+        restauration_finie(s);
+        free(s);
+        return G_SOURCE_REMOVE;
+    }
+
+    PublicationSauvegarde *pub = g_new0(PublicationSauvegarde, 1);
+    snprintf(pub->temporaire, sizeof(pub->temporaire), "%s", s->temporaire);
+    snprintf(pub->chemin, sizeof(pub->chemin), "%s", s->chemin);
+    pub->planifiee = sauvegarde_gui.planifiee;
+    if (sauvegardeTerminer(s)) {
+        // fsync et renommage hors de la boucle GTK
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(sauvegarde_gui.barre), "Sauvegarde : écriture sur disque...");
+        sauvegarde_gui.publication = g_thread_new("sauvegarde", sauvegarde_publication_thread, pub);
+    } else {
+        sauvegarde_publiee(pub);
+    }
+    free(s);
+    return G_SOURCE_REMOVE;
+}
+
+// Lance une sauvegarde, sauf si une autre est en cours (ou en publication).
+bool sauvegardeLancer(const char *chemin, bool planifiee) {
+    if (sauvegarde_gui.s || sauvegarde_gui.publication) return false;
+    sauvegarde_gui.s = sauvegardeOuvrir(db, chemin);
+    if (!sauvegarde_gui.s) return false;
+    sauvegarde_gui.planifiee = planifiee;
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(sauvegarde_gui.barre), 0.0);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(sauvegarde_gui.barre), "Sauvegarde : 0 %");
+    gtk_widget_show(sauvegarde_gui.barre);
+    g_idle_add(sauvegarde_idle, NULL);
+    return true;
+}
+
+gboolean sauvegarde_planifiee(gpointer user_data) {
+    char chemin[256];
+    snprintf(chemin, sizeof(chemin), "%s.1", SAUVEGARDE_PREFIXE);
+    sauvegardeLancer(chemin, true);     // déjà en cours : on attend le prochain créneau
+    return G_SOURCE_CONTINUE;
+}
+
+// Arrêt de l'application : la copie en cours est abandonnée, une publication
+// en cours est attendue.
+void sauvegardeArreter(void) {
+    if (sauvegarde_gui.s) {
+        if (sauvegarde_gui.s->restauration) restaurationTerminer(db, sauvegarde_gui.s);
+        else sauvegardeTerminer(sauvegarde_gui.s);
+        free(sauvegarde_gui.s);
+        sauvegarde_gui.s = NULL;
+    }
+    if (sauvegarde_gui.publication) {
+        g_thread_join(sauvegarde_gui.publication);
+        sauvegarde_gui.publication = NULL;
+    }
+}
+
+void on_backup_clicked(GtkButton *button, gpointer user_data) {
+    if (sauvegarde_gui.s || sauvegarde_gui.publication) return;
+    GtkWidget *chooser = gtk_file_chooser_dialog_new("Sauvegarder la base",
+                                                     GTK_WINDOW(user_data),
+                                                     GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                     "_Annuler", GTK_RESPONSE_CANCEL,
+                                                     "_Sauvegarder", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(chooser), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser), "eleves-sauvegarde.db");
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(chooser);
+        return;
+    }
+    char *chemin = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    gtk_widget_destroy(chooser);
+    bool ok = sauvegardeLancer(chemin, false);
+    g_free(chemin);
+    if (!ok) {
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL,
+                                                    GTK_MESSAGE_ERROR,
+                                                    GTK_BUTTONS_OK,
+                                                    "Erreur lors de l'ouverture de la sauvegarde.");
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+    }
+}
+
+void on_restore_clicked(GtkButton *button, gpointer user_data) {
+    if (sauvegarde_gui.s || sauvegarde_gui.publication) return;
+    GtkWidget *chooser = gtk_file_chooser_dialog_new("Restaurer une sauvegarde",
+                                                     GTK_WINDOW(user_data),
+                                                     GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                     "_Annuler", GTK_RESPONSE_CANCEL,
+                                                     "_Restaurer", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(chooser);
+        return;
+    }
+    char *chemin = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    gtk_widget_destroy(chooser);
+    GtkWidget *confirm = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                  GTK_DIALOG_MODAL,
+                                                  GTK_MESSAGE_WARNING,
+                                                  GTK_BUTTONS_OK_CANCEL,
+                                                  "Remplacer toute la base par '%s' ?", chemin);
+    int reponse = gtk_dialog_run(GTK_DIALOG(confirm));
+    gtk_widget_destroy(confirm);
+    if (reponse != GTK_RESPONSE_OK) {
+        g_free(chemin);
+        return;
+    }
+    sauvegarde_gui.s = restaurationOuvrir(db, chemin);
+    g_free(chemin);
+    if (!sauvegarde_gui.s) {
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
+                                                    GTK_DIALOG_MODAL,
+                                                    GTK_MESSAGE_ERROR,
+                                                    GTK_BUTTONS_OK,
+                                                    "Erreur lors de la restauration (voir log.txt).");
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+        return;
+    }
+    // rien d'autre ne part de la fenêtre principale pendant la copie
+    gtk_widget_set_sensitive(sauvegarde_gui.parent, FALSE);
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(sauvegarde_gui.barre), 0.0);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(sauvegarde_gui.barre), "Restauration : 0 %");
+    gtk_widget_show(sauvegarde_gui.barre);
+    g_idle_add(sauvegarde_idle, NULL);
+}
+
+/*
+ * Instantané en colonnes construit au démarrage dans un thread, par sa
+ * propre connexion : la fenêtre de connexion n'attend pas le parcours de la
+ * table. Il n'est rattaché à la connexion principale que si aucune
+ * transaction n'y a été écrite entre-temps (compteur de versions inchangé,
+ * pas de transaction ouverte) ; sinon il est relu, au plus
+ * COLONNES_CONSTRUCTIONS fois.
+ */
+#define COLONNES_CONSTRUCTIONS 3
+
+typedef struct {
+    ColonnesEleves *c;
+    unsigned version;           // de la connexion principale au lancement
+    int essais;
+} ConstructionColonnes;
+
+void colonnesLancerConstruction(ConstructionColonnes *cc);
+
+gboolean colonnes_construites(gpointer user_data) {
+    ConstructionColonnes *cc = user_data;
+    if (!sqlite3_get_autocommit(db)) {
+        g_timeout_add(100, colonnes_construites, cc);      // écritures de la transaction ouverte non suivies
+        return G_SOURCE_REMOVE;
+    }
+    if (cc->c && versionDonnees(db) != cc->version) {
+        colonnesLiberer(cc->c);
+        cc->c = NULL;
+        if (++cc->essais < COLONNES_CONSTRUCTIONS) {
+            colonnesLancerConstruction(cc);
+            return G_SOURCE_REMOVE;
+        }
+        journal(LOG_AVERT, "Instantané en colonnes abandonné", "constructions=%d", cc->essais);
+    }
+    if (cc->c) {
+        colonnesLiberer(colonnes);
+        colonnes = cc->c;
+        colonnes->db = db;
+        journal(LOG_INFO, "Instantané en colonnes construit", "eleves=%d duree_ms=%.1f memoire_ko=%zu",
+                colonnes->n, colonnes->duree_construction * 1e3, colonnesMemoire(colonnes) / 1024);
+    }
+    g_free(cc);
+    return G_SOURCE_REMOVE;
+}
+
+gpointer colonnes_construction_thread(gpointer user_data) {
+    ConstructionColonnes *cc = user_data;
+    sqlite3 *lecture = NULL;
+    if (sqlite3_open_v2(DB_NAME, &lecture, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK) {
+        configurerAttente(lecture);
+        cc->c = colonnesLire(lecture);
+    } else {
+        log_error(sqlite3_errmsg(lecture));
+    }
+    sqlite3_close(lecture);
+    g_idle_add(colonnes_construites, cc);
+    return NULL;
+}
+
+void colonnesLancerConstruction(ConstructionColonnes *cc) {
+    if (!cc) cc = g_new0(ConstructionColonnes, 1);
+    cc->version = versionDonnees(db);
+    g_thread_unref(g_thread_new("colonnes", colonnes_construction_thread, cc));
+}
+
+/*
+ * Index de trigrammes relu dans un thread, par sa propre connexion : au
+ * démarrage, la recherche se contente du plein texte jusqu'à ce qu'il soit
+ * prêt, ensuite l'ancien contenu sert jusqu'à l'échange. Les écritures de la
+ * connexion principale validées pendant la lecture sont rejouées
+ * (trigrammesEchanger) ; celles des autres connexions et processus font
+ * avancer PRAGMA data_version, vérifié avant chaque recherche.
+ */
+typedef struct {
+    TrigrammesEleves *neuf;
+    sqlite3_int64 data_version;     // de la connexion principale au lancement
+    int generation;
+} ConstructionTrigrammes;
+
+gboolean trigrammes_construits(gpointer user_data) {
+    ConstructionTrigrammes *ct = user_data;
+    TrigrammesEleves *t = trigrammes;
+    if (ct->neuf && ct->generation == t->generation) {
+        trigrammesEchanger(t, ct->neuf);
+        t->data_version = ct->data_version;
+        journal(LOG_INFO, "Index de trigrammes construit", "eleves=%d duree_ms=%.1f memoire_ko=%zu",
+                t->n, t->duree_construction * 1e3, trigrammesMemoire(t) / 1024);
+    } else {
+        differerAnnuler(&t->rattrapage);    // relecture écartée : restauration ou archivage entre-temps
+        t->rattraper = false;
+    }
+    trigrammesLiberer(ct->neuf);
+    g_free(ct);
+    return G_SOURCE_REMOVE;
+}
+
+gpointer trigrammes_construction_thread(gpointer user_data) {
+    ConstructionTrigrammes *ct = user_data;
+    sqlite3 *lecture = NULL;
+    if (sqlite3_open_v2(DB_NAME, &lecture, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK) {
+        configurerAttente(lecture);
+        ct->neuf = trigrammesLire(lecture);
+    } else {
+        log_error(sqlite3_errmsg(lecture));
+    }
+    sqlite3_close(lecture);
+    g_idle_add(trigrammes_construits, ct);
+    return NULL;
+}
+
+void trigrammesRelire(void) {
+    TrigrammesEleves *t = trigrammes;
+    if (!t || t->rattraper) return;
+    ConstructionTrigrammes *ct = g_new0(ConstructionTrigrammes, 1);
+    ct->data_version = versionExterne(db);
+    ct->generation = t->generation;
+    t->rattraper = true;
+    t->perime = false;
+    g_thread_unref(g_thread_new("trigrammes", trigrammes_construction_thread, ct));
+}
+
+// Avant une recherche : relit l'index si une autre connexion a écrit depuis
+// sa lecture, ou si une écriture n'a pu y être reportée.
+void trigrammesVerifier(void) {
+    TrigrammesEleves *t = trigrammes;
+    if (t && !t->rattraper && (t->perime || versionExterne(db) != t->data_version)) trigrammesRelire();
+}
+
+// Fenêtre « Statistiques par classe », lue dans l'instantané en colonnes, ou
+// en SQL tant qu'il n'y en a pas.
+void on_stats_grades_clicked(GtkButton *button, gpointer user_data) {
+    StatsGrade *stats = NULL;
+    int nb;
+    if (colonnes) {
+        stats = malloc(sizeof(StatsGrade) * (colonnes->nb_grades > 0 ? colonnes->nb_grades : 1));
+        nb = stats ? colonnesStatsParGrade(colonnes, stats) : -1;
+    } else {
+        nb = statsParGradeSQL(db, &stats);
+    }
+    if (nb < 0) {
+        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                                    "Erreur lors du calcul des statistiques (voir log.txt).");
+        gtk_dialog_run(GTK_DIALOG(error));
+        gtk_widget_destroy(error);
+        free(stats);
+        return;
+    }
+    Sortie s = { NULL, NULL, 0, 0, false };
+    for (int i = 0; i < nb; i++) {
+        sortiePrintf(&s, "%s : %ld élèves, âge moyen %.1f (%d à %d), taille moyenne %.2f m (%.2f à %.2f)\n",
+                     stats[i].grade[0] ? stats[i].grade : "(sans classe)", stats[i].nb, stats[i].age_moyen,
+                     stats[i].age_min, stats[i].age_max, stats[i].taille_moyenne, stats[i].taille_min, stats[i].taille_max);
+    }
+    free(stats);
+
+    GtkWidget *fenetre = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(fenetre), "Statistiques par classe");
+    gtk_window_set_default_size(GTK_WINDOW(fenetre), 700, 400);
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_container_add(GTK_CONTAINER(fenetre), scrolled_window);
+    GtkWidget *texte = gtk_text_view_new();
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(texte), FALSE);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), texte);
+    gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(texte)), s.buf ? s.buf : "Aucun élève.", -1);
+    free(s.buf);
+    gtk_widget_show_all(fenetre);
+}
+
+/*
+ * Fenêtre « Diagnostics » : rapport texte rafraîchi toutes les
+ * DIAG_RAFRAICHIR_S secondes, activation de l'instrumentation, seuil des
+ * requêtes lentes et export JSON à la demande.
+ */
+#define DIAG_RAFRAICHIR_S 2
+
+typedef struct {
+    GtkWidget *fenetre;
+    GtkWidget *texte;
+    GtkWidget *actif;
+    GtkWidget *seuil;
+    guint minuterie;
+} FenetreDiagnostics;
+
+void diagnosticsAfficher(FenetreDiagnostics *fd) {
+    Sortie s = { NULL, NULL, 0, 0, false };
+    diagRapportTexte(&s);
+    GtkTextBuffer *tampon = gtk_text_view_get_buffer(GTK_TEXT_VIEW(fd->texte));
+    gtk_text_buffer_set_text(tampon, s.buf ? s.buf : "", -1);
+    free(s.buf);
+}
+
+gboolean diagnostics_rafraichir(gpointer user_data) {
+    diagnosticsAfficher(user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+void on_diagnostics_toggled(GtkToggleButton *bouton, gpointer user_data) {
+    diagActiver(gtk_toggle_button_get_active(bouton));
+    diagnosticsAfficher(user_data);
+}
+
+void on_diagnostics_seuil_changed(GtkSpinButton *spin, gpointer user_data) {
+    diagSeuilLent(gtk_spin_button_get_value(spin));
+}
+
+void on_diagnostics_reset_clicked(GtkButton *button, gpointer user_data) {
+    diagReinitialiser();
+    diagnosticsAfficher(user_data);
+}
+
+void on_diagnostics_export_clicked(GtkButton *button, gpointer user_data) {
+    FenetreDiagnostics *fd = user_data;
+    bool ok = diagExporter(DIAG_FICHIER);
+    GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(fd->fenetre),
+                                               GTK_DIALOG_MODAL,
+                                               ok ? GTK_MESSAGE_INFO : GTK_MESSAGE_ERROR,
+                                               GTK_BUTTONS_OK,
+                                               ok ? "Diagnostics exportés dans %s." : "Erreur lors de l'export de %s.",
+                                               DIAG_FICHIER);
+    gtk_dialog_run(GTK_DIALOG(info));
+    gtk_widget_destroy(info);
+}
+
+void on_diagnostics_destroy(GtkWidget *widget, gpointer user_data) {
+    FenetreDiagnostics *fd = user_data;
+    g_source_remove(fd->minuterie);
+    g_free(fd);
+}
+
+void on_diagnostics_clicked(GtkButton *button, gpointer user_data) {
+    FenetreDiagnostics *fd = g_new0(FenetreDiagnostics, 1);
+    fd->fenetre = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(fd->fenetre), "Diagnostics");
+    gtk_window_set_default_size(GTK_WINDOW(fd->fenetre), 900, 600);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(fd->fenetre), vbox);
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+    fd->actif = gtk_check_button_new_with_label("Instrumentation active");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(fd->actif), diagActif());
+    gtk_box_pack_start(GTK_BOX(hbox), fd->actif, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(hbox), gtk_label_new("Requête lente au-delà de (ms) :"), FALSE, FALSE, 0);
+    fd->seuil = gtk_spin_button_new_with_range(0, 60000, 10);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(fd->seuil), atomic_load(&diag.seuil_lent_us) / 1e3);
+    gtk_box_pack_start(GTK_BOX(hbox), fd->seuil, FALSE, FALSE, 0);
+    GtkWidget *btn_export = gtk_button_new_with_label("Exporter JSON");
+    gtk_box_pack_end(GTK_BOX(hbox), btn_export, FALSE, FALSE, 0);
+    GtkWidget *btn_reset = gtk_button_new_with_label("Remettre à zéro");
+    gtk_box_pack_end(GTK_BOX(hbox), btn_reset, FALSE, FALSE, 0);
+
+    GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+    gtk_box_pack_start(GTK_BOX(vbox), scrolled_window, TRUE, TRUE, 0);
+    fd->texte = gtk_text_view_new();
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(fd->texte), FALSE);
+    gtk_text_view_set_monospace(GTK_TEXT_VIEW(fd->texte), TRUE);
+    gtk_container_add(GTK_CONTAINER(scrolled_window), fd->texte);
+
+    g_signal_connect(fd->actif, "toggled", G_CALLBACK(on_diagnostics_toggled), fd);
+    g_signal_connect(fd->seuil, "value-changed", G_CALLBACK(on_diagnostics_seuil_changed), fd);
+    g_signal_connect(btn_reset, "clicked", G_CALLBACK(on_diagnostics_reset_clicked), fd);
+    g_signal_connect(btn_export, "clicked", G_CALLBACK(on_diagnostics_export_clicked), fd);
+    g_signal_connect(fd->fenetre, "destroy", G_CALLBACK(on_diagnostics_destroy), fd);
+    fd->minuterie = g_timeout_add_seconds(DIAG_RAFRAICHIR_S, diagnostics_rafraichir, fd);
+    diagnosticsAfficher(fd);
+    gtk_widget_show_all(fd->fenetre);
+}
+
+void on_quit_clicked(GtkButton *button, gpointer user_data) {
+    gtk_main_quit();
+}
+
+GtkWidget* create_main_window() {
+    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), "Gestion des Élèves");
+    gtk_window_set_default_size(GTK_WINDOW(window), 800, 600);
+    g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
+    
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(window), vbox);
+    
+    GtkWidget *btn_add = gtk_button_new_with_label("Ajouter un Élève");
+    g_signal_connect(btn_add, "clicked", G_CALLBACK(on_add_student_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_add, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_list = gtk_button_new_with_label("Lister les Élèves");
+    g_signal_connect(btn_list, "clicked", G_CALLBACK(on_list_students_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_list, FALSE, FALSE, 0);
+    
+    if (partitions.n > 1) {
+        GtkWidget *btn_list_all = gtk_button_new_with_label("Lister toutes les années");
+        g_signal_connect(btn_list_all, "clicked", G_CALLBACK(on_list_all_students_clicked), window);
+        gtk_box_pack_start(GTK_BOX(vbox), btn_list_all, FALSE, FALSE, 0);
+    }
+    
+    GtkWidget *btn_delete = gtk_button_new_with_label("Supprimer un Élève");
+    g_signal_connect(btn_delete, "clicked", G_CALLBACK(on_delete_student_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_delete, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_search = gtk_button_new_with_label("Rechercher un Élève");
+    g_signal_connect(btn_search, "clicked", G_CALLBACK(on_search_student_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_search, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_export = gtk_button_new_with_label("Exporter CSV");
+    g_signal_connect(btn_export, "clicked", G_CALLBACK(on_export_csv_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_export, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_export_tables = gtk_button_new_with_label("Exporter les tables");
+    g_signal_connect(btn_export_tables, "clicked", G_CALLBACK(on_export_tables_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_export_tables, FALSE, FALSE, 0);
+
+    GtkWidget *btn_bulletins = gtk_button_new_with_label("Bulletins");
+    g_signal_connect(btn_bulletins, "clicked", G_CALLBACK(on_bulletins_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_bulletins, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_import = gtk_button_new_with_label("Importer CSV");
+    g_signal_connect(btn_import, "clicked", G_CALLBACK(on_import_csv_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_import, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_backup = gtk_button_new_with_label("Sauvegarder la base");
+    g_signal_connect(btn_backup, "clicked", G_CALLBACK(on_backup_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_backup, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_restore = gtk_button_new_with_label("Restaurer une sauvegarde");
+    g_signal_connect(btn_restore, "clicked", G_CALLBACK(on_restore_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_restore, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_stats = gtk_button_new_with_label("Statistiques par classe");
+    g_signal_connect(btn_stats, "clicked", G_CALLBACK(on_stats_grades_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_stats, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_diagnostics = gtk_button_new_with_label("Diagnostics");
+    g_signal_connect(btn_diagnostics, "clicked", G_CALLBACK(on_diagnostics_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_diagnostics, FALSE, FALSE, 0);
+    
+    GtkWidget *btn_quit = gtk_button_new_with_label("Quitter");
+    g_signal_connect(btn_quit, "clicked", G_CALLBACK(on_quit_clicked), window);
+    gtk_box_pack_start(GTK_BOX(vbox), btn_quit, FALSE, FALSE, 0);
+    
+    // barre d'état de la sauvegarde, visible seulement pendant une copie
+    sauvegarde_gui.parent = window;
+    sauvegarde_gui.barre = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(sauvegarde_gui.barre), TRUE);
+    gtk_widget_set_no_show_all(sauvegarde_gui.barre, TRUE);
+    gtk_box_pack_end(GTK_BOX(vbox), sauvegarde_gui.barre, FALSE, FALSE, 0);
+    g_timeout_add_seconds(SAUVEGARDE_INTERVALLE_S, sauvegarde_planifiee, NULL);
+    
+    return window;
+}
+
+/* Connexion : la vérification (dérivation du mot de passe) passe par
+ * l'exécuteur ; la fenêtre reste insensible jusqu'à son retour. */
+typedef struct {
+    Requete *req;
+    GtkWidget *fenetre;
+    GtkWidget *formulaire;      // identifiants et bouton
+} ConnexionGUI;
+
+void connexion_sur_fin(Requete *req, bool ok) {
+    ConnexionGUI *cg = req->data;
+    if (!cg) return;                // fenêtre fermée entre-temps
+    cg->req = NULL;
+    requeteUnref(req);
+    if (ok) {
+        gtk_widget_destroy(cg->fenetre);
+        GtkWidget *main_window = create_main_window();
+        gtk_widget_show_all(main_window);
+        return;
+    }
+    gtk_widget_set_sensitive(cg->formulaire, TRUE);
+    GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(cg->fenetre), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                               "Nom d'utilisateur ou mot de passe incorrect.");
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
+}
+
+void on_login_destroy(GtkWidget *widget, gpointer user_data) {
+    ConnexionGUI *cg = user_data;
+    if (cg->req) {
+        requeteAnnuler(cg->req);
+        cg->req->data = NULL;
+        requeteUnref(cg->req);
+    }
+    g_free(cg);
+}
+
+void on_login_clicked(GtkButton *button, gpointer user_data) {
+    ConnexionGUI *cg = user_data;
+    GtkWidget *entry_username = GTK_WIDGET(g_object_get_data(G_OBJECT(button), "entry_username"));
+    GtkWidget *entry_password = GTK_WIDGET(g_object_get_data(G_OBJECT(button), "entry_password"));
+    const char *username = gtk_entry_get_text(GTK_ENTRY(entry_username));
+    const char *password = gtk_entry_get_text(GTK_ENTRY(entry_password));
+    if (cg->req) return;
+    gtk_widget_set_sensitive(cg->formulaire, FALSE);
+    cg->req = executeurSoumettreSecret(REQ_CONNEXION, username, password, NULL, connexion_sur_fin, cg);
+}
+/*fenêtre de connexion */
+GtkWidget* create_login_window() {
+    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), "Connexion");
+    gtk_window_set_default_size(GTK_WINDOW(window), 300, 200);
+
+    
+    GtkWidget *grid = gtk_grid_new();
+    gtk_container_add(GTK_CONTAINER(window), grid);
+    ConnexionGUI *cg = g_new0(ConnexionGUI, 1);
+    cg->fenetre = window;
+    cg->formulaire = grid;
+    g_signal_connect(window, "destroy", G_CALLBACK(on_login_destroy), cg);
+    
+    GtkWidget *label_user = gtk_label_new("Nom d'utilisateur:");
+    GtkWidget *entry_user = gtk_entry_new();
+    GtkWidget *label_pass = gtk_label_new("Mot de passe:");
+    GtkWidget *entry_pass = gtk_entry_new();
+    gtk_entry_set_visibility(GTK_ENTRY(entry_pass), FALSE);
+    
+    GtkWidget *button_login = gtk_button_new_with_label("Se connecter");
+    
+    gtk_grid_attach(GTK_GRID(grid), label_user, 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_user, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), label_pass, 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), entry_pass, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), button_login, 0, 2, 2, 1);
+    
+    g_object_set_data(G_OBJECT(button_login), "entry_username", entry_user);
+    g_object_set_data(G_OBJECT(button_login), "entry_password", entry_pass);
+    g_signal_connect(button_login, "clicked", G_CALLBACK(on_login_clicked), cg);
+    
+    return window;
+}
+
+int main(int argc, char *argv[]) {
+    if (estLigneDeCommande(argc, argv)) {
+        return mainCommandes(argc, argv);       // avant gtk_init, pour les scripts
+    }
+    if (argc > 1 && strcmp(argv[1], "--reindexer") == 0) {
+        // Commande ponctuelle : pas besoin de GTK
+        bool ok = initDB(&db) && reconstruireIndexRecherche(db) && reconstruireBitmapsPresences(db);
+        fermerDB(db);
+        fprintf(ok ? stdout : stderr, ok ? "Index de recherche et bitmaps de présences reconstruits.\n"
+                                         : "Erreur: Impossible de reconstruire les index\n");
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 2 && strcmp(argv[1], "--archiver") == 0) {
+        long deplaces = 0;
+        bool ok = initDB(&db) && partitionsOuvrir(db, ".", true) && archiverAnnee(db, atoi(argv[2]), &deplaces);
+        partitionsFermer();
+        fermerDB(db);
+        if (ok) printf("%ld élèves archivés dans " PARTITION_FORMAT ".\n", deplaces, atoi(argv[2]));
+        else fprintf(stderr, "Erreur: archivage impossible (voir log.txt)\n");
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 2 && strcmp(argv[1], "--exporter") == 0) {
+        // --exporter dossier [format] [travailleurs]
+        OptionsExport o = { EXPORT_CSV, COMPRESSION_AUCUNE, argc > 4 ? atoi(argv[4]) : 0, NULL, NULL };
+        if (argc > 3 && !lireFormatExport(argv[3], &o)) {
+            fprintf(stderr, "Erreur: format inconnu '%s' (csv, jsonl ou colonnes, suivi de .gz ou .zst)\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+        BilanExport b;
+        bool ok = initDB(&db) && partitionsOuvrir(db, ".", true) && exporterTables(db, argv[2], &o, &b);
+        partitionsFermer();
+        fermerDB(db);
+        if (ok) printf("%d fichiers, %ld lignes, %.1f Mo en %.2f s (%.1f Mo/s, %d travailleurs).\n", b.fichiers, b.lignes,
+                       b.octets_ecrits / 1e6, b.secondes, b.octets_encodes / 1e6 / b.secondes, b.travailleurs);
+        else fprintf(stderr, "Erreur: export impossible (voir log.txt)\n");
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 3 && strcmp(argv[1], "--bulletins") == 0) {
+        // --bulletins trimestre dossier [classe] [pdf]
+        OptionsBulletins o = { 0 };
+        o.grade = argc > 4 && argv[4][0] ? argv[4] : NULL;
+        o.pdf = argc > 5 && strcmp(argv[5], "pdf") == 0;
+        o.progres = progresBulletinsConsole;
+        BilanBulletins b;
+        bool ok = initDB(&db) && partitionsOuvrir(db, ".", true) && genererBulletins(db, argv[2], argv[3], &o, &b);
+        partitionsFermer();
+        fermerDB(db);
+        if (ok) printf("%d bulletins, %d fichiers, %.1f Mo en %.2f s (lecture %.2f s, %.0f bulletins/s, %d travailleurs).\n",
+                       b.eleves, b.fichiers, b.octets / 1e6, b.secondes, b.secondes_lecture,
+                       b.secondes > 0 ? b.eleves / b.secondes : 0, b.travailleurs);
+        else fprintf(stderr, "Erreur: bulletins impossibles (voir log.txt)\n");
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    for (int i = 1; i < argc; i++) {
+        // --diagnostics [seuil ms] : instrumentation dès le démarrage, rapport à la sortie
+        if (strcmp(argv[i], "--diagnostics") != 0) continue;
+        if (i + 1 < argc && atof(argv[i + 1]) > 0) diagSeuilLent(atof(argv[i + 1]));
+        diagActiver(true);
+    }
+    gtk_init(&argc, &argv);
+    
+    if (!initDB(&db)) {
+        fprintf(stderr, "Erreur: Impossible d'initialiser la base de données\n");
+        return EXIT_FAILURE;
+    }
+    partitionsOuvrir(db, ".", true);     // archives ouvertes au premier accès
+    trigrammes = trigrammesNouveau();       // vide : plein texte seul jusqu'à la lecture
+    if (trigrammes) {
+        trigrammesSuivre(trigrammes, db);
+        trigrammesRelire();
+    }
+    colonnesLancerConstruction(NULL);
+    if (!executeurDemarrer()) {
+        fprintf(stderr, "Erreur: Impossible de démarrer l'exécuteur de requêtes\n");
+        return EXIT_FAILURE;
+    }
+    suivreChangements(db, changements_notifier);
+    if (!auditDemarrer(DB_NAME, db)) {
+        fprintf(stderr, "Erreur: Impossible de démarrer la piste d'audit\n");
+        return EXIT_FAILURE;
+    }
     
-    gtk_widget_show_all(dialog);
-    int result = gtk_dialog_run(GTK_DIALOG(dialog));
-    if(result == GTK_RESPONSE_OK) {
-        Personne p;
-        strncpy(p.nom, gtk_entry_get_text(GTK_ENTRY(entry_nom)), MAX_NOM);
-        p.age = atoi(gtk_entry_get_text(GTK_ENTRY(entry_age)));
-        p.taille = atof(gtk_entry_get_text(GTK_ENTRY(entry_taille)));
-        strncpy(p.email, gtk_entry_get_text(GTK_ENTRY(entry_email)), MAX_EMAIL);
-        strncpy(p.telephone, gtk_entry_get_text(GTK_ENTRY(entry_telephone)), MAX_TELEPHONE);
-        strncpy(p.grade, gtk_entry_get_text(GTK_ENTRY(entry_grade)), MAX_GRADE);
-        if (ajouterEleve(db, &p)) {
-            GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                       GTK_DIALOG_MODAL,
-                                                       GTK_MESSAGE_INFO,
-                                                       GTK_BUTTONS_OK,
-                                                       "Élève ajouté avec succès !");
-            gtk_dialog_run(GTK_DIALOG(info));
-            gtk_widget_destroy(info);
+    GtkWidget *login_window = create_login_window();
+    gtk_widget_show_all(login_window);
+    
+    gtk_main();
+    
+    sauvegardeArreter();
+    executeurArreter();     // un export en cours peut encore auditer
+    auditArreter();
+    if (diagActif()) diagExporter(DIAG_FICHIER);
+    partitionsFermer();
+    trigrammesLiberer(trigrammes);
+    colonnesLiberer(colonnes);
+    cacheResultatsVider(0);
+    fermerDB(db);
+    diagFermer();
+    return EXIT_SUCCESS;
+}
+#elif !defined(CPRONOTE_BENCH)
+// Version sans GTK : la ligne de commande seule, sans charger les
+// bibliothèques graphiques au démarrage.
+int main(int argc, char *argv[]) {
+    return mainCommandes(argc, argv);
+}
+#endif /* CPRONOTE_HEADLESS */
+
+
+#ifdef CPRONOTE_BENCH
+/*
+ * Micro-benchmark du registre de requêtes préparées.
+ * compile : gcc -O2 -DCPRONOTE_BENCH C-Pronote.c -o C-Pronote-bench -lsqlite3 -lz -pthread
+ * "sans cache" passe par une seconde connexion non enregistrée : chaque appel
+ * prépare puis finalise sa requête, comme avant le registre.
+ */
+double maintenant_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+bool ouvrirBaseBench(sqlite3 **bdd) {
+    if (sqlite3_open(":memory:", bdd) != SQLITE_OK) return false;
+    return creerSchema(*bdd) &&
+           sqlite3_exec(*bdd, "INSERT INTO users (username, password_hash, role) VALUES ('bench', 'bench', 'admin');", 0, 0, NULL) == SQLITE_OK;
+}
+
+void benchCrud(sqlite3 *bdd, const char *libelle, int n) {
+    Personne p = { 0, "Dupont", 15, 1.70f, "dupont@ecole.fr", "0600000000", "3A", 0 };
+    double t0 = maintenant_s();
+    sqlite3_exec(bdd, "BEGIN;", 0, 0, NULL);
+    for (int i = 0; i < n; i++) ajouterEleve(bdd, &p);
+    double t1 = maintenant_s();
+    for (int i = 1; i <= n; i++) modifierEleve(bdd, i, &p);
+    double t2 = maintenant_s();
+    for (int i = 1; i <= n; i++) supprimerEleve(bdd, i);
+    double t3 = maintenant_s();
+    sqlite3_exec(bdd, "COMMIT;", 0, 0, NULL);
+    printf("%-12s ajouter   %10.0f ops/s\n", libelle, n / (t1 - t0));
+    printf("%-12s modifier  %10.0f ops/s\n", libelle, n / (t2 - t1));
+    printf("%-12s supprimer %10.0f ops/s\n", libelle, n / (t3 - t2));
+}
+
+void benchLogin(sqlite3 *bdd, const char *libelle, int n) {
+    sqlite3 *principale = db;
+    db = bdd;
+    double t0 = maintenant_s();
+    for (int i = 0; i < n; i++) check_login("bench", "bench");
+    double t1 = maintenant_s();
+    db = principale;
+    printf("%-12s login     %10.0f ops/s\n", libelle, n / (t1 - t0));
+}
+
+bool benchRequetes(int n) {
+    sqlite3 *sans_cache = NULL;
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db) || !ouvrirBaseBench(&sans_cache)) {
+        return false;
+    }
+    benchCrud(sans_cache, "sans cache", n);
+    benchCrud(db, "avec cache", n);
+    benchLogin(sans_cache, "sans cache", n);
+    benchLogin(db, "avec cache", n);
+    sqlite3_close(sans_cache);
+    fermerDB(db);
+    db = NULL;
+    return true;
+}
+
+// Import de n lignes (dont 1 % invalides et des champs entre guillemets)
+// dans une base sur disque, pour inclure le coût des COMMIT.
+int bench_refuser_validation(void *data) {
+    return 1;
+}
+
+bool benchImport(int n) {
+    const char *csv = "bench_import.csv";
+    const char *base = "bench_import.db";
+    FILE *fp = fopen(csv, "w");
+    if (!fp) return false;
+    fprintf(fp, "ID,Nom,Age,Taille,Email,Telephone,Grade\n");
+    for (int i = 0; i < n; i++) {
+        if (i % 100 == 99) {
+            fprintf(fp, ",Ligne invalide,abc,1.70,x@ecole.fr,0600000000,3A\n");
         } else {
-            GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                        GTK_DIALOG_MODAL,
-                                                        GTK_MESSAGE_ERROR,
-                                                        GTK_BUTTONS_OK,
-                                                        "Erreur lors de l'ajout de l'élève.");
-            gtk_dialog_run(GTK_DIALOG(error));
-            gtk_widget_destroy(error);
+            fprintf(fp, ",\"Dupont, \"\"Jean\"\" %d\",%d,%.2f,eleve%d@ecole.fr,06%08d,%dA\n",
+                    i, 11 + i % 8, 1.40 + (i % 50) / 100.0, i, i, 3 + i % 4);
+        }
+    }
+    fclose(fp);
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db)) {
+        return false;
+    }
+    long importees = 0, rejetees = 0;
+    double t0 = maintenant_s();
+    bool ok = importerCSV(db, csv, &importees, &rejetees);
+    double t1 = maintenant_s();
+    printf("import       %ld lignes, %ld rejets, %10.0f lignes/s\n", importees, rejetees, (importees + rejetees) / (t1 - t0));
+    // validation refusée (commit_hook) : rien de compté, rien d'écrit, pas
+    // de transaction laissée ouverte
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_NB_ELEVES);
+    int avant = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    sqlite3_reset(stmt);
+    sqlite3_commit_hook(db, bench_refuser_validation, NULL);
+    bool refuse = !importerCSV(db, csv, &importees, &rejetees) && importees == 0;
+    sqlite3_commit_hook(db, NULL, NULL);
+    refuse = refuse && sqlite3_get_autocommit(db) && sqlite3_step(stmt) == SQLITE_ROW &&
+             sqlite3_column_int(stmt, 0) == avant;
+    libererRequete(stmt);
+    ok = ok && refuse;
+    printf("import       validation refusée : %s\n", refuse ? "lot annulé, non compté" : "INCOHÉRENT");
+    fermerDB(db);
+    db = NULL;
+    remove(csv);
+    remove(base);
+    remove(CSV_REJETS_FILENAME);
+    return ok;
+}
+
+void remplirBaseBench(int n) {
+    const char *noms[] = { "Dupont", "Martin", "Lefèvre", "Bernard", "Petit", "Durand", "Moreau", "Laurent" };
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    for (int i = 0; i < n; i++) {
+        Personne p = { 0, "", 11 + i % 8, 1.50f, "", "0600000000", "", 0 };
+        snprintf(p.nom, sizeof(p.nom), "%s %d", noms[i % 8], i);
+        snprintf(p.email, sizeof(p.email), "eleve%d@ecole.fr", i);
+        snprintf(p.grade, sizeof(p.grade), "%d%c", 3 + i % 4, 'A' + i % 3);
+        ajouterEleve(db, &p);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+}
+
+// Recherche plein texte contre l'ancien LIKE '%terme%' sur n élèves.
+bool benchRecherche(int n) {
+    const char *termes[] = { "dupont", "lef", "mar 3a", "eleve4242" };
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(n);
+    sqlite3_stmt *like;
+    sqlite3_prepare_v2(db, "SELECT * FROM eleves WHERE nom LIKE '%' || ?1 || '%' OR email LIKE '%' || ?1 || '%' "
+                           "OR grade LIKE '%' || ?1 || '%';", -1, &like, NULL);
+    for (int t = 0; t < 4; t++) {
+        char expr[MAX_QUERY];
+        construireRequeteFTS(termes[t], expr, sizeof(expr));
+        int lignes_fts = 0, lignes_like = 0;
+        double t0 = maintenant_s();
+        sqlite3_stmt *stmt = obtenirRequete(db, STMT_RECHERCHE_ELEVES);
+        sqlite3_bind_text(stmt, 1, expr, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, RECHERCHE_MAX_RESULTATS);
+        while (sqlite3_step(stmt) == SQLITE_ROW) lignes_fts++;
+        libererRequete(stmt);
+        double t1 = maintenant_s();
+        sqlite3_bind_text(like, 1, termes[t], -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(like) == SQLITE_ROW) lignes_like++;
+        sqlite3_reset(like);
+        double t2 = maintenant_s();
+        printf("recherche    %-12s fts %8.3f ms (%d)   like %8.3f ms (%d)\n",
+               termes[t], (t1 - t0) * 1e3, lignes_fts, (t2 - t1) * 1e3, lignes_like);
+    }
+    sqlite3_finalize(like);
+    fermerDB(db);
+    db = NULL;
+    return true;
+}
+
+// Rendu de n élèves en mémoire (tableau) et en flux vers un fichier.
+bool benchRendu(int n) {
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(n);
+    double t0 = maintenant_s();
+    char *tableau = listerElevesStr(db);
+    double t1 = maintenant_s();
+    printf("rendu        tableau  %10.0f lignes/s (%zu octets)\n", n / (t1 - t0), tableau ? strlen(tableau) : 0);
+    free(tableau);
+    const char *noms[] = { "csv", "jsonl", "tsv" };
+    const FormatRendu *formats[] = { &format_csv, &format_jsonl, &format_tsv };
+    for (int i = 0; i < 3; i++) {
+        t0 = maintenant_s();
+        bool ok = exporterEleves(db, "bench_rendu.out", formats[i]);
+        t1 = maintenant_s();
+        printf("rendu        %-8s %10.0f lignes/s%s\n", noms[i], n / (t1 - t0), ok ? "" : " (échec)");
+    }
+    remove("bench_rendu.out");
+    fermerDB(db);
+    db = NULL;
+    return true;
+}
+
+unsigned aleaBench(unsigned *etat) {
+    *etat = *etat * 1103515245u + 12345u;
+    return *etat >> 8;
+}
+
+// n notes sur n/20 élèves : coût des triggers à l'écriture, moyennes d'une
+// classe par les agrégats contre un AVG() sur notes, puis cohérence après
+// des modifications et suppressions aléatoires.
+bool benchNotes(int n) {
+    const char *matieres[] = { "maths", "francais", "anglais", "histoire", "svt", "physique", "eps", "arts" };
+    unsigned graine = 42;
+    int nb_eleves = n / 20 > 0 ? n / 20 : 1;
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(nb_eleves);
+    double t0 = maintenant_s();
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    for (int i = 0; i < n; i++) {
+        char date[16];
+        int mois = 1 + aleaBench(&graine) % 12;
+        snprintf(date, sizeof(date), "%d-%02d-%02d", mois >= 9 ? 2024 : 2025, mois, 1 + aleaBench(&graine) % 28);
+        ajouterNote(db, 1 + aleaBench(&graine) % nb_eleves, matieres[aleaBench(&graine) % 8],
+                    (aleaBench(&graine) % 41) / 2.0, NULL, date);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    double t1 = maintenant_s();
+    printf("notes        insertion %10.0f notes/s\n", n / (t1 - t0));
+
+    MoyenneEleve *moy;
+    t0 = maintenant_s();
+    int nb = moyennesClasse(db, "3A", "2024-T1", NULL, &moy);
+    t1 = maintenant_s();
+    free(moy);
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, "SELECT e.id, AVG(n.note) FROM eleves e JOIN notes n ON n.eleve_id = e.id "
+                           "WHERE e.grade = '3A' AND " SQL_TRIMESTRE("n.date") " = '2024-T1' GROUP BY e.id, n.matiere;",
+                       -1, &stmt, NULL);
+    double t2 = maintenant_s();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    }
+    double t3 = maintenant_s();
+    sqlite3_finalize(stmt);
+    printf("notes        moyennes classe (%d élèves) %8.3f ms, AVG() sur notes %8.3f ms\n",
+           nb, (t1 - t0) * 1e3, (t3 - t2) * 1e3);
+
+    sqlite3_exec(db, "UPDATE notes SET note = 20 - note WHERE id % 7 = 0;"
+                     "UPDATE notes SET matiere = 'latin', date = '2025-05-02' WHERE id % 11 = 0;"
+                     "DELETE FROM notes WHERE id % 5 = 0;", 0, 0, NULL);
+    long ecarts = verifierAgregatsNotes(db);
+    printf("notes        cohérence après modifications : %ld écarts\n", ecarts);
+    fermerDB(db);
+    db = NULL;
+    return ecarts == 0;
+}
+
+// Une année de présences (jours ouvrés) pour n élèves : taux d'absence
+// d'une classe sur un mois et palmarès des absents, par les bitmaps contre
+// les requêtes sur les lignes de presences.
+bool benchPresences(int n) {
+    unsigned graine = 7;
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(n);
+    sqlite3_stmt *ins = obtenirRequete(db, STMT_INSERT_PRESENCE);
+    long lignes = 0;
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    for (int jour = 0; jour < 300; jour++) {
+        if (jour % 7 >= 5) continue;            // week-end
+        char date[32];
+        dateCivile(jourCivil(2024, 9, 2) + jour, date, sizeof(date));
+        for (int e = 1; e <= n; e++) {
+            unsigned r = aleaBench(&graine) % 100;
+            sqlite3_bind_int(ins, 1, e);
+            sqlite3_bind_text(ins, 2, date, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins, 3, r < 5 ? "absent" : r < 7 ? "retard" : "present", -1, SQLITE_STATIC);
+            sqlite3_step(ins);
+            sqlite3_reset(ins);
+            lignes++;
+        }
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    libererRequete(ins);
+    double t0 = maintenant_s();
+    reconstruireBitmapsPresences(db);
+    double t1 = maintenant_s();
+    printf("presences    %ld lignes, reconstruction des bitmaps %8.1f ms\n", lignes, (t1 - t0) * 1e3);
+    enregistrerPresence(db, 1, "2024-10-07", "absent");
+    enregistrerPresence(db, 1, "2024-10-08", "retard");
+
+    int annee;
+    int debut = jourScolaire("2024-10-01", &annee), fin = jourScolaire("2024-11-01", &annee);
+    PresencesClasse pc;
+    AbsentRang top[10];
+    long absences, saisies;
+    t0 = maintenant_s();
+    chargerPresencesClasse(db, "3A", annee, &pc);
+    double taux = tauxAbsenceClasse(&pc, debut, fin, &absences, &saisies);
+    int nb_top = topAbsents(&pc, debut, fin, 10, top);
+    int serie = 0;
+    for (int i = 0; i < pc.n; i++) {
+        int s = plusLongueSerieAbsences(&pc, i, 0, PRESENCE_JOURS);
+        if (s > serie) serie = s;
+    }
+    t1 = maintenant_s();
+
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, "SELECT COUNT(*), SUM(p.status = 'absent') FROM eleves e JOIN presences p ON p.eleve_id = e.id "
+                           "WHERE e.grade = '3A' AND p.date >= '2024-10-01' AND p.date < '2024-11-01';", -1, &stmt, NULL);
+    double t2 = maintenant_s();
+    sqlite3_step(stmt);
+    long saisies_sql = sqlite3_column_int64(stmt, 0), absences_sql = sqlite3_column_int64(stmt, 1);
+    sqlite3_finalize(stmt);
+    sqlite3_prepare_v2(db, "SELECT p.eleve_id, COUNT(*) AS a FROM eleves e JOIN presences p ON p.eleve_id = e.id "
+                           "WHERE e.grade = '3A' AND p.status = 'absent' AND p.date >= '2024-10-01' AND p.date < '2024-11-01' "
+                           "GROUP BY p.eleve_id ORDER BY a DESC, p.eleve_id LIMIT 10;", -1, &stmt, NULL);
+    bool top_egal = true;
+    for (int i = 0; sqlite3_step(stmt) == SQLITE_ROW; i++) {
+        top_egal = top_egal && i < nb_top && top[i].eleve_id == sqlite3_column_int(stmt, 0) &&
+                   top[i].absences == sqlite3_column_int(stmt, 1);
+    }
+    double t3 = maintenant_s();
+    sqlite3_finalize(stmt);
+    printf("presences    bitmaps %8.3f ms, SQL %8.3f ms (taux %.4f, plus longue série %d)\n",
+           (t1 - t0) * 1e3, (t3 - t2) * 1e3, taux, serie);
+    int ecarts = verifierBitmapsPresences(db, "3A", annee);
+    bool ok = absences == absences_sql && saisies == saisies_sql && top_egal && ecarts == 0;
+    printf("presences    résultats %s SQL (%d élèves divergents)\n", ok ? "identiques au" : "DIFFÉRENTS du", ecarts);
+    // dates hors calendrier refusées, 29 février des seules années bissextiles
+    bool dates = jourScolaire("2024-02-31", &annee) < 0 && jourScolaire("2024-04-31", &annee) < 0 &&
+                 jourScolaire("2023-02-29", &annee) < 0 && jourScolaire("1900-02-29", &annee) < 0 &&
+                 jourScolaire("2024-02-29", &annee) >= 0 && jourScolaire("2000-02-29", &annee) >= 0 &&
+                 !enregistrerPresence(db, 1, "2025-06-31", "absent");
+    ok = ok && dates;
+    printf("presences    dates invalides %s\n", dates ? "refusées" : "ACCEPTÉES (ÉCHEC)");
+    libererPresencesClasse(&pc);
+    fermerDB(db);
+    db = NULL;
+    return ok;
+}
+
+bool benchPlans(void) {
+    if (!ouvrirBaseBench(&db)) return false;
+    bool ok = verifierPlansRequetes(db);
+    printf("plans        %s\n", ok ? "conformes" : "RÉGRESSION");
+    sqlite3_close(db);
+    db = NULL;
+    return ok;
+}
+
+/*
+ * Suite de référence : base générée de façon déterministe (même graine,
+ * mêmes lignes), latences mesurées appel par appel, résultat en JSON sur
+ * stdout pour comparer deux versions. La progression s'affiche sur stderr.
+ */
+#define SUITE_ECHANTILLONS 1000     // appels chronométrés par opération unitaire
+#define SUITE_PASSES 5              // passes des opérations sur toute la table
+#define SUITE_APPELS_CLASSE 24      // deux passes sur les 12 classes générées
+#define SUITE_GRAINE 20240902u
+
+typedef struct {
+    const char *op;
+    double *durees;                 // secondes, une par appel
+    int n;
+    long lignes;                    // lignes traitées au total
+    double total;
+} MesureBench;
+
+void mesureInit(MesureBench *m, const char *op, int capacite) {
+    m->op = op;
+    m->durees = malloc(sizeof(double) * capacite);
+    m->n = 0;
+    m->lignes = 0;
+    m->total = 0;
+}
+
+void mesureAjouter(MesureBench *m, double duree, long lignes) {
+    m->durees[m->n++] = duree;
+    m->lignes += lignes;
+    m->total += duree;
+}
+
+int comparerDurees(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Centile par rang le plus proche, sur les durées triées.
+double centile(const double *triees, int n, double p) {
+    int rang = (int)(p * n + 0.999999);
+    if (rang < 1) rang = 1;
+    return triees[rang - 1];
+}
+
+void mesureJSON(FILE *fp, MesureBench *m, bool derniere) {
+    qsort(m->durees, m->n, sizeof(double), comparerDurees);
+    fprintf(fp, "        {\"op\":\"%s\",\"appels\":%d,\"lignes\":%ld,\"lignes_par_s\":%.1f,"
+                "\"p50_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}%s\n",
+            m->op, m->n, m->lignes, m->total > 0 ? m->lignes / m->total : 0.0,
+            centile(m->durees, m->n, 0.50) * 1e6, centile(m->durees, m->n, 0.99) * 1e6,
+            m->durees[m->n - 1] * 1e6, derniere ? "" : ",");
+    free(m->durees);
+}
+
+// Génère n élèves, n notes et n présences : les présences couvrent 200
+// jours ouvrés à partir du 2 septembre 2024 pour les n/200 premiers élèves.
+bool genererBaseBench(sqlite3 *bdd, int n, unsigned graine) {
+    const char *prenoms[] = { "Jean", "Marie", "Lucas", "Emma", "Hugo", "Léa", "Louis", "Chloé",
+                              "Nathan", "Manon", "Jules", "Camille", "Arthur", "Inès", "Paul", "Zoé" };
+    const char *noms[] = { "Dupont", "Martin", "Lefèvre", "Bernard", "Petit", "Durand", "Moreau", "Laurent",
+                           "Simon", "Michel", "Garcia", "Roux", "Fournier", "Girard", "Bonnet", "Mercier" };
+    const char *matieres[] = { "maths", "francais", "anglais", "histoire", "svt", "physique", "eps", "arts" };
+    bool ok = sqlite3_exec(bdd, "BEGIN;", 0, 0, NULL) == SQLITE_OK;
+    for (int i = 0; ok && i < n; i++) {
+        Personne p = { 0, "", 11 + aleaBench(&graine) % 8, 1.40f + (aleaBench(&graine) % 50) / 100.0f, "", "", "", 0 };
+        const char *prenom = prenoms[aleaBench(&graine) % 16], *nom = noms[aleaBench(&graine) % 16];
+        snprintf(p.nom, sizeof(p.nom), "%s %s", prenom, nom);
+        snprintf(p.email, sizeof(p.email), "eleve%d@ecole.fr", i + 1);
+        snprintf(p.telephone, sizeof(p.telephone), "06%08u", aleaBench(&graine) % 100000000u);
+        snprintf(p.grade, sizeof(p.grade), "%d%c", 3 + aleaBench(&graine) % 4, 'A' + aleaBench(&graine) % 3);
+        ok = ajouterEleve(bdd, &p);
+    }
+    for (int i = 0; ok && i < n; i++) {
+        char date[32];
+        dateCivile(jourCivil(2024, 9, 2) + aleaBench(&graine) % 300, date, sizeof(date));
+        ok = ajouterNote(bdd, 1 + aleaBench(&graine) % n, matieres[aleaBench(&graine) % 8],
+                         (aleaBench(&graine) % 41) / 2.0, NULL, date);
+    }
+    sqlite3_stmt *ins = ok ? obtenirRequete(bdd, STMT_INSERT_PRESENCE) : NULL;
+    for (int i = 0; ins && i < n; i++) {
+        char date[32];
+        int ouvre = i % 200;
+        dateCivile(jourCivil(2024, 9, 2) + ouvre / 5 * 7 + ouvre % 5, date, sizeof(date));
+        unsigned r = aleaBench(&graine) % 100;
+        sqlite3_bind_int(ins, 1, 1 + i / 200);
+        sqlite3_bind_text(ins, 2, date, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(ins, 3, r < 5 ? "absent" : r < 7 ? "retard" : "present", -1, SQLITE_STATIC);
+        ok = sqlite3_step(ins) == SQLITE_DONE;
+        sqlite3_reset(ins);
+    }
+    if (ins) libererRequete(ins);
+    ok = ok && reconstruireBitmapsPresences(bdd);
+    if (!ok) log_error(sqlite3_errmsg(bdd));
+    sqlite3_exec(bdd, ok ? "COMMIT;" : "ROLLBACK;", 0, 0, NULL);
+    return ok;
+}
+
+// Un palier de la suite : génère la base puis chronomètre chaque opération.
+bool benchSuitePalier(FILE *fp, int n, bool dernier) {
+    enum { AJOUTER, MODIFIER, SUPPRIMER, RECHERCHER, LOGIN, MOYENNES, ABSENCES, LISTER, EXPORTER, NB_MESURES };
+    MesureBench m[NB_MESURES];
+    unsigned graine = SUITE_GRAINE;
+    int k = n < SUITE_ECHANTILLONS ? n : SUITE_ECHANTILLONS;
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    fprintf(stderr, "suite        %d lignes : génération...\n", n);
+    double t0 = maintenant_s();
+    if (!genererBaseBench(db, n, graine)) {
+        fermerDB(db);
+        db = NULL;
+        return false;
+    }
+    double generation = maintenant_s() - t0;
+
+    mesureInit(&m[AJOUTER], "ajouterEleve", k);
+    mesureInit(&m[MODIFIER], "modifierEleve", k);
+    mesureInit(&m[SUPPRIMER], "supprimerEleve", k);
+    mesureInit(&m[RECHERCHER], "rechercherEleve", k);
+    mesureInit(&m[LOGIN], "check_login", k);
+    mesureInit(&m[MOYENNES], "moyennesClasse", SUITE_APPELS_CLASSE);
+    mesureInit(&m[ABSENCES], "tauxAbsenceClasse", SUITE_APPELS_CLASSE);
+    mesureInit(&m[LISTER], "listerElevesStr", SUITE_PASSES);
+    mesureInit(&m[EXPORTER], "exporterCSV", SUITE_PASSES);
+
+    bool ok = true;
+    Personne p = { 0, "Bench Suite", 15, 1.70f, "suite@ecole.fr", "0600000000", "3A", 0 };
+    for (int i = 0; i < k; i++) {
+        t0 = maintenant_s();
+        ok = ajouterEleve(db, &p) && ok;
+        mesureAjouter(&m[AJOUTER], maintenant_s() - t0, 1);
+    }
+    for (int i = 0; i < k; i++) {
+        int id = 1 + aleaBench(&graine) % n;
+        t0 = maintenant_s();
+        ok = modifierEleve(db, id, &p) && ok;
+        mesureAjouter(&m[MODIFIER], maintenant_s() - t0, 1);
+    }
+    // les suppressions portent sur les élèves ajoutés par la mesure
+    for (int i = 0; i < k; i++) {
+        t0 = maintenant_s();
+        ok = supprimerEleve(db, n + 1 + i) && ok;
+        mesureAjouter(&m[SUPPRIMER], maintenant_s() - t0, 1);
+    }
+    for (int i = 0; i < k; i++) {
+        char terme[32];
+        char *res = NULL;
+        snprintf(terme, sizeof(terme), "eleve%u", 1 + aleaBench(&graine) % n);
+        t0 = maintenant_s();
+        ok = rechercherEleve(db, terme, &res) && ok;
+        double duree = maintenant_s() - t0;
+        long lignes = 0;
+        for (const char *c = res; c && *c; c++) lignes += *c == '\n';
+        if (res) lignes -= 4;       // en-tête et séparateurs du tableau
+        mesureAjouter(&m[RECHERCHER], duree, lignes);
+        free(res);
+    }
+    for (int i = 0; i < k; i++) {
+        t0 = maintenant_s();
+        ok = check_login("bench", "bench") && ok;
+        mesureAjouter(&m[LOGIN], maintenant_s() - t0, 1);
+    }
+    for (int i = 0; i < SUITE_APPELS_CLASSE; i++) {
+        char grade[8];
+        MoyenneEleve *moy = NULL;
+        snprintf(grade, sizeof(grade), "%d%c", 3 + i % 4, 'A' + i % 3);
+        t0 = maintenant_s();
+        int nb = moyennesClasse(db, grade, "2024-T1", NULL, &moy);
+        mesureAjouter(&m[MOYENNES], maintenant_s() - t0, nb > 0 ? nb : 0);
+        ok = nb >= 0 && ok;
+        free(moy);
+    }
+    for (int i = 0; i < SUITE_APPELS_CLASSE; i++) {
+        char grade[8];
+        PresencesClasse pc;
+        long absences, saisies;
+        snprintf(grade, sizeof(grade), "%d%c", 3 + i % 4, 'A' + i % 3);
+        t0 = maintenant_s();
+        bool charge = chargerPresencesClasse(db, grade, 2024, &pc);
+        if (charge) tauxAbsenceClasse(&pc, 0, PRESENCE_JOURS, &absences, &saisies);
+        mesureAjouter(&m[ABSENCES], maintenant_s() - t0, charge ? pc.n : 0);
+        if (charge) libererPresencesClasse(&pc);
+        ok = charge && ok;
+    }
+    for (int i = 0; i < SUITE_PASSES; i++) {
+        t0 = maintenant_s();
+        char *tableau = listerElevesStr(db);
+        mesureAjouter(&m[LISTER], maintenant_s() - t0, n);
+        ok = tableau != NULL && ok;
+        free(tableau);
+    }
+    // même chemin que exporterCSV, vers un fichier temporaire
+    for (int i = 0; i < SUITE_PASSES; i++) {
+        t0 = maintenant_s();
+        ok = exporterEleves(db, "bench_suite.csv", &format_csv) && ok;
+        mesureAjouter(&m[EXPORTER], maintenant_s() - t0, n);
+    }
+    remove("bench_suite.csv");
+
+    fprintf(fp, "    {\"lignes\":%d,\"generation_s\":%.3f,\"operations\":[\n", n, generation);
+    for (int i = 0; i < NB_MESURES; i++) mesureJSON(fp, &m[i], i == NB_MESURES - 1);
+    fprintf(fp, "    ]}%s\n", dernier ? "" : ",");
+    fermerDB(db);
+    db = NULL;
+    return ok;
+}
+
+// Paliers 10k, 100k et 1M, ou le seul palier demandé.
+bool benchSuite(int n) {
+    int paliers[] = { 10000, 100000, 1000000 };
+    int nb = 3;
+    if (n > 0) {
+        paliers[0] = n;
+        nb = 1;
+    }
+    bool ok = true;
+    printf("{\"sqlite\":\"%s\",\"schema\":%d,\"graine\":%u,\"paliers\":[\n",
+           sqlite3_libversion(), migrations[NB_MIGRATIONS - 1].version, SUITE_GRAINE);
+    for (int i = 0; i < nb; i++) ok = benchSuitePalier(stdout, paliers[i], i == nb - 1) && ok;
+    printf("]}\n");
+    return ok;
+}
+
+// Coût d'un appel à journal() depuis plusieurs threads producteurs ; les
+// lignes perdues (anneau plein) sont comptées, jamais attendues.
+#define BENCH_JOURNAL_THREADS 4
+
+typedef struct {
+    int n;
+    int numero;
+    double *durees;
+} ProducteurBench;
+
+void *bench_journal_producteur(void *arg) {
+    ProducteurBench *p = arg;
+    for (int i = 0; i < p->n; i++) {
+        double t0 = maintenant_s();
+        journal(LOG_AVERT, "Bench journal", "thread=%d ligne=%d table=eleves", p->numero, i);
+        p->durees[i] = maintenant_s() - t0;
+    }
+    return NULL;
+}
+
+bool lireFichierBench(const char *chemin, Sortie *s);
+
+bool benchJournal(int n) {
+    const char *chemin = "bench_journal.txt";
+    pthread_t threads[BENCH_JOURNAL_THREADS];
+    ProducteurBench prod[BENCH_JOURNAL_THREADS];
+    int par_thread = n / BENCH_JOURNAL_THREADS > 0 ? n / BENCH_JOURNAL_THREADS : 1;
+    double *durees = malloc(sizeof(double) * par_thread * BENCH_JOURNAL_THREADS);
+    if (!durees) return false;
+    journalArreter();
+    journal_global.chemin = chemin;
+    remove(chemin);
+    bool ok = journalDemarrer();
+    long perdus_avant = atomic_load(&journal_global.perdus);
+    double t0 = maintenant_s();
+    for (int i = 0; ok && i < BENCH_JOURNAL_THREADS; i++) {
+        prod[i] = (ProducteurBench){ par_thread, i, durees + (size_t)i * par_thread };
+        ok = pthread_create(&threads[i], NULL, bench_journal_producteur, &prod[i]) == 0;
+    }
+    for (int i = 0; ok && i < BENCH_JOURNAL_THREADS; i++) pthread_join(threads[i], NULL);
+    double t1 = maintenant_s();
+    long perdus = atomic_load(&journal_global.perdus) - perdus_avant;
+    journalArreter();
+    double t2 = maintenant_s();
+    // signal fatal : le processus fils n'a pas de thread de vidage, seul le
+    // gestionnaire peut écrire sa dernière ligne
+    int statut = 0;
+    bool signal_ecrit = journalDemarrer();
+    pid_t fils = signal_ecrit ? fork() : -1;
+    if (fils == 0) {
+        journal(LOG_ERREUR, "bench signal fatal", "pid=%d", (int)getpid());
+        raise(SIGSEGV);
+        _exit(0);
+    }
+    signal_ecrit = fils > 0 && waitpid(fils, &statut, 0) == fils && WIFSIGNALED(statut);
+    journalArreter();
+    long total = (long)par_thread * BENCH_JOURNAL_THREADS;
+    qsort(durees, total, sizeof(double), comparerDurees);
+    printf("journal      %d threads, %ld appels : %6.0f ns/appel (p50 %.0f ns, p99 %.0f ns), vidage final %.1f ms\n",
+           BENCH_JOURNAL_THREADS, total, (t1 - t0) / total * 1e9, centile(durees, total, 0.50) * 1e9,
+           centile(durees, total, 0.99) * 1e9, (t2 - t1) * 1e3);
+    printf("journal      %ld lignes perdues (anneau plein, sans attente des appelants)\n", perdus);
+    free(durees);
+    Sortie contenu = { 0 };
+    signal_ecrit = signal_ecrit && lireFichierBench(chemin, &contenu);
+    sortieEcrire(&contenu, "", 1);
+    signal_ecrit = signal_ecrit && !contenu.erreur && strstr(contenu.buf, "] ERREUR bench signal fatal pid=");
+    free(contenu.buf);
+    ok = ok && signal_ecrit;
+    printf("journal      dernière ligne avant SIGSEGV %s\n", signal_ecrit ? "écrite" : "PERDUE (ÉCHEC)");
+    for (int i = 1; i <= LOG_NB_ARCHIVES; i++) {
+        char archive[64];
+        snprintf(archive, sizeof(archive), "%s.%d", chemin, i);
+        remove(archive);
+    }
+    remove(chemin);
+    journal_global.chemin = LOG_FILENAME;
+    return ok;
+}
+
+// Piste d'audit sur une base fichier : ajouts en autocommit sans audit,
+// avec l'audit groupé, puis avec une ligne de logs validée par action.
+bool benchAudit(int n) {
+    const char *base = "bench_audit.db";
+    int k = n < 5000 ? n : 5000;
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db)) return false;
+    configurerAttente(db);
+    sqlite3_exec(db, "INSERT INTO users (username, password_hash, role) VALUES ('bench', 'bench', 'admin');", 0, 0, NULL);
+    Personne p = { 0, "Audit", 15, 1.70f, "audit@ecole.fr", "0600000000", "3A", 0 };
+    double t0 = maintenant_s();
+    for (int i = 0; i < k; i++) ajouterEleve(db, &p);
+    double t1 = maintenant_s();
+    bool ok = auditDemarrer(base, db) && check_login("bench", "bench");
+    double t2 = maintenant_s();
+    for (int i = 0; ok && i < k; i++) ajouterEleve(db, &p);
+    double t3 = maintenant_s();
+    auditArreter();
+    double t4 = maintenant_s();
+    sqlite3_stmt *ins = obtenirRequete(db, STMT_INSERT_AUDIT);
+    for (int i = 0; ok && i < k; i++) {
+        ajouterEleve(db, &p);
+        sqlite3_bind_int(ins, 1, 1);
+        sqlite3_bind_text(ins, 2, "ajout", -1, SQLITE_STATIC);
+        sqlite3_bind_text(ins, 3, "2025-01-01 00:00:00.000", -1, SQLITE_STATIC);
+        sqlite3_step(ins);
+        sqlite3_reset(ins);
+    }
+    libererRequete(ins);
+    double t5 = maintenant_s();
+    printf("audit        sans audit      %8.0f ajouts/s\n", k / (t1 - t0));
+    printf("audit        audit groupé    %8.0f ajouts/s (vidage final %.1f ms)\n", k / (t3 - t2), (t4 - t3) * 1e3);
+    printf("audit        ligne à ligne   %8.0f ajouts/s\n", k / (t5 - t4));
+
+    LigneAudit *lignes;
+    t0 = maintenant_s();
+    int nb = lireAudit(db, atomic_load(&utilisateur_courant), "2000-01-01", "2100-01-01", 2 * k + 1, &lignes);
+    t1 = maintenant_s();
+    // k ajouts audités + la connexion, + k lignes écrites à la main (user 1)
+    printf("audit        %d lignes lues pour l'utilisateur en %.3f ms\n", nb, (t1 - t0) * 1e3);
+    ok = ok && nb == 2 * k + 1 && audit.ecrits == k + 1;
+    free(lignes);
+
+    // transaction annulée : ses actions ne sont pas écrites ; lots en échec
+    // (table logs absente un moment) : gardés en file puis écrits
+    long ecrits = audit.ecrits;
+    bool suite = auditDemarrer(base, db);
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    sqlite3_exec(db, "ALTER TABLE logs RENAME TO logs_absents;", 0, 0, NULL);
+    for (int i = 0; i < 10; i++) auditer("bench lot en echec %d", i);
+    sqlite3_sleep(3 * AUDIT_DELAI_MS);
+    sqlite3_exec(db, "ALTER TABLE logs_absents RENAME TO logs;", 0, 0, NULL);
+    auditArreter();
+    sqlite3_stmt *stmt = NULL;
+    int retenus = -1;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM logs WHERE action LIKE 'bench lot en echec %';", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        retenus = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    suite = suite && retenus == 10 && audit.ecrits == ecrits + 11;
+    printf("audit        transaction annulée et lots en échec : %s (%d/10 retenus, %ld écrits)\n",
+           suite ? "aucun événement perdu ni en trop" : "INCOHÉRENT", retenus, audit.ecrits - ecrits);
+    ok = ok && suite;
+    atomic_store(&utilisateur_courant, 0);
+    fermerDB(db);
+    db = NULL;
+    remove(base);
+    return ok;
+}
+
+// Coût du suivi des changements sur n ajouts groupés, puis fusion d'une
+// séquence mêlant modifications, suppressions et transaction annulée.
+int notifications_bench = 0;
+
+void bench_notifier(void) {
+    notifications_bench++;
+}
+
+bool benchChangements(int n) {
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    double t0 = maintenant_s();
+    remplirBaseBench(n);
+    double t1 = maintenant_s();
+    fermerDB(db);
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    suivreChangements(db, bench_notifier);
+    double t2 = maintenant_s();
+    remplirBaseBench(n);
+    double t3 = maintenant_s();
+    ChangementEleve *ch;
+    int nb = prendreChangements(&ch);
+    bool ok = nb == n && ch[0].type == CHANGEMENT_INSERTION && notifications_bench == 1;
+    free(ch);
+    printf("changements  ajouts %8.0f lignes/s sans suivi, %8.0f avec (%d changements, %d notification)\n",
+           n / (t1 - t0), n / (t3 - t2), nb, notifications_bench);
+
+    Personne p = { 0, "Modifié", 16, 1.60f, "modifie@ecole.fr", "0600000000", "4B", 0 };
+    modifierEleve(db, 1, &p);
+    supprimerEleve(db, 1);                  // modification puis suppression : suppression
+    ajouterEleve(db, &p);
+    supprimerEleve(db, n + 1);              // ajout puis suppression : rien
+    modifierEleve(db, 2, &p);
+    modifierEleve(db, 2, &p);               // deux modifications : une seule
+    sqlite3_exec(db, "BEGIN; DELETE FROM eleves WHERE id = 3; ROLLBACK;", 0, 0, NULL);
+    nb = prendreChangements(&ch);
+    ok = ok && nb == 2 && ch[0].id == 1 && ch[0].type == CHANGEMENT_SUPPRESSION &&
+         ch[1].id == 2 && ch[1].type == CHANGEMENT_MODIFICATION;
+    printf("changements  fusion %s\n", ok ? "conforme" : "INCORRECTE");
+    free(ch);
+
+    // COMMIT en échec après commit_hook (simulé) : rien de publié
+    int notifiees = notifications_bench;
+    sqlite3_exec(db, "BEGIN; DELETE FROM eleves WHERE id = 4;", 0, 0, NULL);
+    transaction_commit_hook(db);
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    nb = prendreChangements(&ch);
+    free(ch);
+    bool echec_ok = nb == 0 && notifications_bench == notifiees;
+    fermerDB(db);
+    db = NULL;
+
+    // en WAL, publication dès que la transaction est écrite
+    const char *base = "bench_changements.db";
+    remove(base);
+    bool wal_ok = sqlite3_open(base, &db) == SQLITE_OK &&
+                  sqlite3_exec(db, "PRAGMA journal_mode = WAL;", 0, 0, NULL) == SQLITE_OK && creerSchema(db);
+    if (wal_ok) {
+        suivreChangements(db, bench_notifier);
+        notifiees = notifications_bench;
+        sqlite3_exec(db, "BEGIN; INSERT INTO eleves (nom) VALUES ('WAL');", 0, 0, NULL);
+        wal_ok = notifications_bench == notifiees;
+        sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+        wal_ok = wal_ok && notifications_bench == notifiees + 1;
+        nb = prendreChangements(&ch);
+        wal_ok = wal_ok && nb == 1 && ch[0].type == CHANGEMENT_INSERTION;
+        free(ch);
+    }
+    suivi.db = NULL;
+    sqlite3_close(db);
+    db = NULL;
+    remove(base);
+    remove("bench_changements.db-wal");
+    remove("bench_changements.db-shm");
+    printf("changements  COMMIT en échec après commit_hook : %s ; publication après écriture (WAL) : %s\n",
+           echec_ok ? "rien de publié" : "PUBLIÉ À TORT", wal_ok ? "immédiate" : "INCORRECTE");
+    return ok && echec_ok && wal_ok;
+}
+
+bool procheBench(double a, double b, double ecart) {
+    return a - b < ecart && b - a < ecart;
+}
+
+// Statistiques par grade sur n élèves : instantané en colonnes contre les
+// mêmes agrégats en SQL, puis cohérence après des écritures.
+bool benchColonnes(int n) {
+    char sql[512];
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    // génération en SQL, sans l'index plein texte (inutile ici)
+    snprintf(sql, sizeof(sql),
+             "DROP TRIGGER eleves_fts_ai; DROP TRIGGER eleves_fts_ad; DROP TRIGGER eleves_fts_au;"
+             "WITH RECURSIVE s(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM s WHERE i < %d) "
+             "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+             "SELECT 'Eleve ' || i, 11 + (i * 7919) %% 8, 1.40 + ((i * 104729) %% 50) / 100.0, '', '', "
+             "(3 + i %% 4) || char(65 + (i / 7) %% 3) FROM s;", n);
+    if (sqlite3_exec(db, sql, 0, 0, NULL) != SQLITE_OK) return false;
+    colonnes = colonnesConstruire(db);
+    if (!colonnes) return false;
+    printf("colonnes     construction %8.1f ms, %.1f Mo pour %d lignes\n",
+           colonnes->duree_construction * 1e3, colonnesMemoire(colonnes) / 1048576.0, colonnes->n);
+
+    StatsGrade stats[COLONNES_MAX_GRADES];
+    double t0 = maintenant_s();
+    int nb = colonnesStatsParGrade(colonnes, stats);
+    double t1 = maintenant_s();
+    long classes[8];
+    colonnesHistogrammeAge(colonnes, NULL, 11, 8, classes);
+    double t2 = maintenant_s();
+    long filtre = colonnesCompter(colonnes, "4B", 13, 15, 1.50f, 1.70f);
+    double t3 = maintenant_s();
+    printf("colonnes     par grade %8.2f ms, histogramme %8.2f ms, comptage filtré %8.2f ms\n",
+           (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t3 - t2) * 1e3);
+
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, "SELECT grade, COUNT(*), MIN(age), MAX(age), AVG(age), MIN(taille), MAX(taille), AVG(taille) "
+                           "FROM eleves GROUP BY grade ORDER BY grade;", -1, &stmt, NULL);
+    t0 = maintenant_s();
+    bool ok = true;
+    int lignes = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *grade = colonneTexte(stmt, 0);
+        int i = 0;
+        while (i < nb && strcmp(stats[i].grade, grade) != 0) i++;
+        ok = ok && i < nb && stats[i].nb == sqlite3_column_int64(stmt, 1) &&
+             stats[i].age_min == sqlite3_column_int(stmt, 2) && stats[i].age_max == sqlite3_column_int(stmt, 3) &&
+             procheBench(stats[i].age_moyen, sqlite3_column_double(stmt, 4), 1e-6) &&
+             procheBench(stats[i].taille_moyenne, sqlite3_column_double(stmt, 7), 1e-4);
+        lignes++;
+    }
+    t1 = maintenant_s();
+    sqlite3_finalize(stmt);
+    sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM eleves WHERE grade = '4B' AND age BETWEEN 13 AND 15 "
+                           "AND taille BETWEEN 1.50 AND 1.70;", -1, &stmt, NULL);
+    t2 = maintenant_s();
+    sqlite3_step(stmt);
+    // taille stockée en REAL, comparée en float dans l'instantané : écarts possibles aux bornes
+    long filtre_sql = sqlite3_column_int64(stmt, 0);
+    t3 = maintenant_s();
+    sqlite3_finalize(stmt);
+    printf("colonnes     SQL : par grade %8.2f ms, comptage filtré %8.2f ms\n", (t1 - t0) * 1e3, (t3 - t2) * 1e3);
+    ok = ok && lignes == nb;
+
+    Personne p = { 0, "Nouveau", 30, 2.10f, "", "", "Term", 0 };
+    ajouterEleve(db, &p);
+    p.age = 9;
+    modifierEleve(db, 1, &p);
+    for (int id = 2; id <= n && id < 50; id++) supprimerEleve(db, id);
+    nb = colonnesStatsParGrade(colonnes, stats);
+    long total = 0;
+    for (int i = 0; i < nb; i++) total += stats[i].nb;
+    int attendu = n + 1 - (n < 50 ? n - 1 : 48);
+    ok = ok && total == attendu && colonnesCompter(colonnes, "Term", 9, 30, 0, 3) == 2;
+    printf("colonnes     résultats %s SQL (filtré %ld / %ld), après écritures %ld lignes\n",
+           ok ? "identiques au" : "DIFFÉRENTS du", filtre, filtre_sql, total);
+
+    // dans une transaction de l'appelant : reporté à la validation, oublié à l'annulation
+    p.age = 99;
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    supprimerEleve(db, 1);
+    bool transaction_ok = colonnesCompter(colonnes, "Term", 99, 99, 0, 3) == 0 && colonnesIndice(colonnes, 1) >= 0;
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    transaction_ok = transaction_ok && colonnesCompter(colonnes, "Term", 99, 99, 0, 3) == 0 && colonnesIndice(colonnes, 1) >= 0;
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    supprimerEleve(db, 1);
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    transactionConfirmer(db);               // base en mémoire : pas de wal_hook
+    transaction_ok = transaction_ok && colonnesCompter(colonnes, "Term", 99, 99, 0, 3) == 1 && colonnesIndice(colonnes, 1) < 0;
+    printf("colonnes     transaction annulée puis validée : %s\n", transaction_ok ? "conforme" : "INCOHÉRENT");
+    ok = ok && transaction_ok;
+
+    // dictionnaire de grades plein : instantané abandonné, statistiques en SQL
+    for (int g = 0; g < COLONNES_MAX_GRADES && colonnes; g++) {
+        snprintf(p.grade, sizeof(p.grade), "G%d", g);
+        ajouterEleve(db, &p);
+    }
+    StatsGrade *sql_stats = NULL;
+    int nb_sql = statsParGradeSQL(db, &sql_stats);
+    long total_sql = 0, total_table = -1;
+    for (int i = 0; i < nb_sql; i++) total_sql += sql_stats[i].nb;
+    free(sql_stats);
+    sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM eleves;", -1, &stmt, NULL);
+    if (sqlite3_step(stmt) == SQLITE_ROW) total_table = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    bool plein_ok = !colonnes && nb_sql > COLONNES_MAX_GRADES && total_sql == total_table;
+    printf("colonnes     %d grades : instantané %s, SQL %ld lignes sur %ld\n", nb_sql,
+           colonnes ? "GARDÉ (ÉCHEC)" : "abandonné", total_sql, total_table);
+    ok = ok && plein_ok;
+    colonnesLiberer(colonnes);
+    colonnes = NULL;
+    fermerDB(db);
+    db = NULL;
+    return ok;
+}
+
+// Lots de lignes : tableaux de Personne contre lots compacts (arène), sur n élèves.
+bool benchCompact(int n) {
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(n);
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT * FROM eleves ORDER BY id;", -1, &stmt, NULL) != SQLITE_OK) return false;
+
+    // avant : un tableau fixe de Personne par lot, comme l'ancien exécuteur
+    long allocations = 0;
+    double t0 = maintenant_s();
+    Personne *lignes = NULL;
+    int k = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (!lignes) {
+            lignes = calloc(EXEC_LOT_LIGNES, sizeof(Personne));
+            allocations++;
+        }
+        lireEleve(stmt, &lignes[k++]);
+        if (k == EXEC_LOT_LIGNES) {
+            free(lignes);
+            lignes = NULL;
+            k = 0;
+        }
+    }
+    free(lignes);
+    double t1 = maintenant_s();
+    printf("compact      Personne  %8.1f ms, %5zu o/ligne, %6.0f allocations/100k lignes\n",
+           (t1 - t0) * 1e3, sizeof(Personne), allocations * 1e5 / n);
+
+    // après : un lot neuf par envoi, puis un lot réutilisé (pages du modèle)
+    for (int reutilise = 0; reutilise < 2; reutilise++) {
+        sqlite3_reset(stmt);
+        LotEleves lot = { 0 };
+        allocations = 0;
+        size_t utiles = 0;
+        t0 = maintenant_s();
+        if (!reutilise) lotReserver(&lot, EXEC_LOT_LIGNES, EXEC_LOT_OCTETS);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (!lotAjouterLigne(&lot, stmt)) return false;
+            if (lot.n == EXEC_LOT_LIGNES) {
+                utiles += lot.n * sizeof(EleveCompact) + lot.arene.taille;
+                if (reutilise) {
+                    lotVider(&lot);
+                } else {
+                    allocations += lot.allocations;
+                    lotLiberer(&lot);
+                    lotReserver(&lot, EXEC_LOT_LIGNES, EXEC_LOT_OCTETS);
+                }
+            }
+        }
+        utiles += lot.n * sizeof(EleveCompact) + lot.arene.taille;
+        allocations += lot.allocations;
+        lotLiberer(&lot);
+        t1 = maintenant_s();
+        printf("compact      %-9s %8.1f ms, %5.0f o/ligne, %6.0f allocations/100k lignes\n",
+               reutilise ? "réutilisé" : "neuf", (t1 - t0) * 1e3, (double)utiles / n, allocations * 1e5 / n);
+    }
+
+    // exécuteur : lots pris dans une réserve, EXEC_LOTS_EN_VOL en attente de
+    // livraison au plus, rendus à la réserve une fois livrés
+    sqlite3_reset(stmt);
+    ReserveLots reserve = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+    LotEleves *en_vol[EXEC_LOTS_EN_VOL + 1];
+    int nb_vol = 0;
+    allocations = 0;
+    t0 = maintenant_s();
+    LotEleves *courant = NULL;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (!courant && !(courant = reservePrendre(&reserve))) {
+            courant = calloc(1, sizeof(LotEleves));
+            if (!courant || !lotReserver(courant, EXEC_LOT_LIGNES, EXEC_LOT_OCTETS)) return false;
+            allocations += 1 + courant->allocations;
+        }
+        long avant = courant->allocations;
+        if (!lotAjouterLigne(courant, stmt)) return false;
+        allocations += courant->allocations - avant;
+        if (courant->n == EXEC_LOT_LIGNES) {
+            en_vol[nb_vol++] = courant;
+            courant = NULL;
+            if (nb_vol > EXEC_LOTS_EN_VOL) {            // le plus ancien est livré
+                lotVider(en_vol[0]);
+                if (!reserveRendre(&reserve, en_vol[0])) {
+                    lotLiberer(en_vol[0]);
+                    free(en_vol[0]);
+                }
+                memmove(en_vol, en_vol + 1, sizeof(en_vol[0]) * --nb_vol);
+            }
+        }
+    }
+    t1 = maintenant_s();
+    if (courant) en_vol[nb_vol++] = courant;
+    for (int i = 0; i < nb_vol; i++) {
+        lotLiberer(en_vol[i]);
+        free(en_vol[i]);
+    }
+    LotEleves *libre;
+    while ((libre = reservePrendre(&reserve))) {
+        lotLiberer(libre);
+        free(libre);
+    }
+    printf("compact      %-9s %8.1f ms, %6.0f allocations/100k lignes (%d lots en vol)\n",
+           "réserve", (t1 - t0) * 1e3, allocations * 1e5 / n, EXEC_LOTS_EN_VOL);
+
+    // conversion : lotVersPersonne rend exactement ce que lit lireEleve
+    sqlite3_reset(stmt);
+    LotEleves lot = { 0 };
+    bool ok = true;
+    int lues = 0;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        Personne a, b;
+        lireEleve(stmt, &a);
+        lotVider(&lot);
+        ok = lotAjouterLigne(&lot, stmt);
+        lotVersPersonne(&lot, 0, &b);
+        ok = ok && a.id == b.id && a.age == b.age && a.taille == b.taille && strcmp(a.nom, b.nom) == 0 &&
+             strcmp(a.email, b.email) == 0 && strcmp(a.telephone, b.telephone) == 0 && strcmp(a.grade, b.grade) == 0;
+        lues++;
+    }
+    lotLiberer(&lot);
+    sqlite3_finalize(stmt);
+    ok = ok && lues == n;
+    printf("compact      conversion %s sur %d lignes\n", ok ? "identique" : "DIFFÉRENTE", lues);
+    fermerDB(db);
+    db = NULL;
+    return ok;
+}
+
+int compterElevesBench(const char *chemin) {
+    sqlite3 *bdd;
+    sqlite3_stmt *stmt;
+    int n = -1;
+    if (sqlite3_open_v2(chemin, &bdd, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(bdd, "SELECT COUNT(*) FROM eleves;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) n = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(bdd);
+    return n;
+}
+
+// Sauvegarde à chaud d'une base fichier de n élèves, avec un ajout entre
+// chaque étape, puis restauration.
+bool benchSauvegarde(int n) {
+    const char *base = "bench_sauvegarde_source.db", *copie = "bench_sauvegarde.db";
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db)) return false;
+    remplirBaseBench(n);
+    Sauvegarde *s = sauvegardeOuvrir(db, copie);
+    if (!s) return false;
+    Personne p = { 0, "Pendant", 15, 1.60f, "", "", "3A", 0 };
+    double *durees = malloc(sizeof(double) * 1024);
+    int nb = 0, cap = 1024;
+    double t0 = maintenant_s();
+    for (bool encore = true; encore;) {
+        double d0 = maintenant_s();
+        encore = sauvegardeEtape(s);
+        if (nb == cap) durees = realloc(durees, sizeof(double) * (cap *= 2));
+        durees[nb++] = maintenant_s() - d0;
+        if (encore) ajouterEleve(db, &p);       // l'interface continue d'écrire
+    }
+    double t1 = maintenant_s();
+    int total = s->total;
+    bool ok = sauvegardeTerminer(s) && sauvegardePublier(s->temporaire, s->chemin);
+    double t2 = maintenant_s();
+    free(s);
+    qsort(durees, nb, sizeof(double), comparerDurees);
+    printf("sauvegarde   %d pages en %ld étapes, %8.1f ms (+ %6.1f ms fsync), étape p99 %6.2f ms, max %6.2f ms\n",
+           total, (long)nb, (t1 - t0) * 1e3, (t2 - t1) * 1e3, centile(durees, nb, 0.99) * 1e3, durees[nb - 1] * 1e3);
+    free(durees);
+
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_NB_ELEVES);
+    int source = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    libererRequete(stmt);
+    int sauves = compterElevesBench(copie);
+    ok = ok && sauves == source;
+
+    // restauration : les suppressions faites après la copie disparaissent
+    for (int id = 1; id <= 10 && id <= n; id++) supprimerEleve(db, id);
+    t0 = maintenant_s();
+    ok = ok && restaurerSauvegarde(db, copie);
+    t1 = maintenant_s();
+    stmt = obtenirRequete(db, STMT_NB_ELEVES);
+    int restaures = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    libererRequete(stmt);
+    ok = ok && restaures == sauves;
+    printf("sauvegarde   %d élèves copiés (source %d), restauration %8.1f ms : %s\n",
+           sauves, source, (t1 - t0) * 1e3, ok ? "identique" : "DIFFÉRENTE");
+
+    // base occupée par une autre connexion : attentes croissantes, puis abandon
+    // sans rien changer
+    sqlite3 *autre = NULL;
+    bool occupee = sqlite3_open(base, &autre) == SQLITE_OK && sqlite3_exec(autre, "BEGIN IMMEDIATE;", 0, 0, NULL) == SQLITE_OK;
+    s = occupee ? restaurationOuvrir(db, copie) : NULL;
+    int refus = 0, attente_ms = 0;
+    while (s && sauvegardeEtape(s)) {
+        refus++;
+        attente_ms += s->attente_ms;
+    }
+    occupee = s && refus == SAUVEGARDE_ESSAIS_OCCUPEE - 1 && s->rc == SQLITE_BUSY && !restaurationTerminer(db, s);
+    free(s);
+    sqlite3_exec(autre, "ROLLBACK;", 0, 0, NULL);
+    stmt = obtenirRequete(db, STMT_NB_ELEVES);
+    occupee = occupee && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == restaures;
+    libererRequete(stmt);
+    // écritures d'une autre connexion entre les étapes : reprises plafonnées
+    s = sauvegardeOuvrir(db, copie);
+    bool reprises = s != NULL;
+    for (bool encore = reprises; encore;) {
+        s->pages_par_etape = SAUVEGARDE_PAGES_MIN;      // assez d'étapes pour être reprise
+        encore = sauvegardeEtape(s);
+        if (encore) {
+            sqlite3_exec(autre, "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+                                "VALUES ('Autre poste', 15, 1.60, '', '', '3A');", 0, 0, NULL);
+        }
+    }
+    if (s) {
+        reprises = s->rc == SQLITE_BUSY && s->reprises > SAUVEGARDE_REPRISES_MAX && !sauvegardeTerminer(s);
+        free(s);
+    }
+    sqlite3_close(autre);
+    printf("sauvegarde   base occupée : abandon après %d attentes (%d ms) %s ; autre connexion : reprises plafonnées %s\n",
+           refus, attente_ms, occupee ? "ok" : "ÉCHEC", reprises ? "ok" : "ÉCHEC");
+    ok = ok && occupee && reprises;
+    fermerDB(db);
+    db = NULL;
+    remove(base);
+    remove(copie);
+    return ok;
+}
+
+#define BENCH_PARTITIONS_ANNEES 4
+
+int bench_dernier_id;
+bool bench_ordre_ok;
+
+void benchOrdreLigne(Sortie *s, const LigneEleve *l) {
+    bench_ordre_ok = bench_ordre_ok && l->id > bench_dernier_id;
+    bench_dernier_id = l->id;
+}
+
+// Latence de l'année courante seule, en ms par appel (COUNT et page du milieu).
+double benchAnneeCourante(sqlite3 *bdd, int n) {
+    double t0 = maintenant_s();
+    for (int k = 0; k < 20; k++) {
+        sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_NB_ELEVES);
+        sqlite3_step(stmt);
+        sqlite3_int64 max_id = sqlite3_column_int64(stmt, 1);
+        libererRequete(stmt);
+        stmt = obtenirRequete(bdd, STMT_PAGE_ELEVES);
+        sqlite3_bind_int64(stmt, 1, max_id - n / 2);
+        sqlite3_bind_int(stmt, 2, MODELE_TAILLE_PAGE);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+        }
+        libererRequete(stmt);
+    }
+    return (maintenant_s() - t0) * 1e3 / 20;
+}
+
+// Référence : la même requête, partition après partition sur un seul thread.
+long benchLireSequentiel(StmtId requete, const char *expr) {
+    long lignes = 0;
+    for (int i = 0; i < partitions.n; i++) {
+        sqlite3 *bdd;
+        sqlite3_stmt *stmt;
+        sqlite3_open_v2(partitions.parts[i].chemin, &bdd, SQLITE_OPEN_READONLY, NULL);
+        sqlite3_prepare_v2(bdd, stmt_sql[requete], -1, &stmt, NULL);
+        if (expr) {
+            sqlite3_bind_text(stmt, 1, expr, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, RECHERCHE_MAX_RESULTATS);
+        }
+        LotEleves lot = { 0 };
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (lot.n == EXEC_LOT_LIGNES) lotVider(&lot);
+            lotAjouterLigne(&lot, stmt);
+            lignes++;
+        }
+        lotLiberer(&lot);
+        sqlite3_finalize(stmt);
+        sqlite3_close(bdd);
+    }
+    return lignes;
+}
+
+// n élèves par année : BENCH_PARTITIONS_ANNEES années archivées, plus l'année
+// courante ; lectures fusionnées contre lectures partition par partition.
+bool benchPartitions(int n) {
+    const char *dossier = "bench_partitions";
+    char chemin[512], sql[1024];
+    mkdir(dossier, 0755);
+    snprintf(chemin, sizeof(chemin), "%s/eleves.db", dossier);
+    remove(chemin);
+    for (int a = 0; a < BENCH_PARTITIONS_ANNEES; a++) {
+        snprintf(sql, sizeof(sql), "%s/" PARTITION_FORMAT, dossier, 2019 + a);
+        remove(sql);
+    }
+    if (sqlite3_open(chemin, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db) ||
+        !partitionsOuvrir(db, dossier, true)) {
+        return false;
+    }
+    for (int a = 0; a <= BENCH_PARTITIONS_ANNEES; a++) {
+        int annee = 2019 + a;
+        snprintf(sql, sizeof(sql),
+                 "BEGIN;"
+                 "CREATE TEMP TABLE depart AS SELECT COALESCE(MAX(id), 0) AS id FROM eleves;"
+                 "WITH RECURSIVE s(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM s WHERE i < %d) "
+                 "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+                 "SELECT 'Eleve ' || i || ' Annee%d', 11 + i %% 8, 1.50, 'eleve' || i || '@ecole.fr', '', (3 + i %% 4) || 'A' FROM s;"
+                 "INSERT INTO notes (eleve_id, matiere, note, date) "
+                 "SELECT id, 'maths', 12, '%d-10-01' FROM eleves WHERE id > (SELECT id FROM temp.depart);"
+                 "DROP TABLE temp.depart;"
+                 "COMMIT;", n, annee, annee);
+        if (sqlite3_exec(db, sql, 0, 0, NULL) != SQLITE_OK) return false;
+    }
+    double avant = benchAnneeCourante(db, n);
+    double t0 = maintenant_s();
+    long total_archives = 0;
+    for (int a = 0; a < BENCH_PARTITIONS_ANNEES; a++) {
+        long deplaces = 0;
+        if (!archiverAnnee(db, 2019 + a, &deplaces)) return false;
+        total_archives += deplaces;
+    }
+    double t1 = maintenant_s();
+    double apres = benchAnneeCourante(db, n);
+    printf("partitions   %ld élèves archivés en %d années (%8.1f ms), année courante : %d élèves\n",
+           total_archives, BENCH_PARTITIONS_ANNEES, (t1 - t0) * 1e3, n);
+    printf("partitions   année courante %6.2f ms/appel avec tout l'historique, %6.2f ms après archivage\n", avant, apres);
+
+    // export fusionné : ordre des ids et total
+    FILE *nul = fopen("/dev/null", "w");
+    Sortie sortie = { nul, NULL, 0, 0, false };
+    const FormatRendu ordre = { NULL, benchOrdreLigne, NULL };
+    bench_dernier_id = 0;
+    bench_ordre_ok = true;
+    t0 = maintenant_s();
+    long lignes = rendreElevesPartitions(&ordre, &sortie);
+    t1 = maintenant_s();
+    fclose(nul);
+    double t2 = maintenant_s();
+    long sequentiel = benchLireSequentiel(STMT_LISTE_PARTITION, NULL);
+    double t3 = maintenant_s();
+    long attendu = (long)n * (BENCH_PARTITIONS_ANNEES + 1);
+    bool ok = lignes == attendu && sequentiel == attendu && bench_ordre_ok;
+    printf("partitions   lecture de %d partitions : fusion parallèle %8.1f ms, une par une %8.1f ms, %ld lignes %s\n",
+           partitions.n, (t1 - t0) * 1e3, (t3 - t2) * 1e3, lignes, bench_ordre_ok ? "dans l'ordre" : "DÉSORDONNÉES");
+
+    // recherche sur toutes les partitions, routeur par id
+    char expr[MAX_QUERY];
+    construireRequeteFTS("annee2020", expr, sizeof(expr));
+    Fusion *fu = fusionOuvrir(STMT_RECHERCHE_PARTITION, expr, RECHERCHE_MAX_RESULTATS);
+    const LotEleves *lot;
+    int i, trouves = 0, id_archive = 0;
+    while (trouves < RECHERCHE_MAX_RESULTATS && fusionSuivante(fu, &lot, &i)) {
+        if (!id_archive) id_archive = lot->lignes[i].id;
+        ok = ok && strstr(lotChaine(lot, lot->lignes[i].nom), "Annee2020") != NULL;
+        trouves++;
+    }
+    fusionFermer(fu);
+    int annee = partitionLireEleve(id_archive, NULL);
+    ok = ok && trouves == (n < RECHERCHE_MAX_RESULTATS ? n : RECHERCHE_MAX_RESULTATS) && annee == 2020;
+    // un terme présent dans toutes les partitions : chacune trie ses résultats
+    construireRequeteFTS("eleve", expr, sizeof(expr));
+    int page[MODELE_TAILLE_PAGE];
+    t0 = maintenant_s();
+    fu = fusionOuvrir(STMT_RECHERCHE_PARTITION, expr, RECHERCHE_MAX_RESULTATS);
+    for (trouves = 0; trouves < RECHERCHE_MAX_RESULTATS && fusionSuivante(fu, &lot, &i); trouves++) {
+        if (trouves < MODELE_TAILLE_PAGE) page[trouves] = lot->lignes[i].id;
+    }
+    fusionFermer(fu);
+    t1 = maintenant_s();
+    benchLireSequentiel(STMT_RECHERCHE_PARTITION, expr);
+    t2 = maintenant_s();
+    printf("partitions   recherche : fusion parallèle %8.2f ms, une par une %8.2f ms ; élève %d routé vers %d : %s\n",
+           (t1 - t0) * 1e3, (t2 - t1) * 1e3, id_archive, annee, ok ? "ok" : "ÉCHEC");
+    // page de résultats de toutes les années : une requête par partition
+    // contre un routage par id
+    int nb_page = trouves < MODELE_TAILLE_PAGE ? trouves : MODELE_TAILLE_PAGE;
+    LotEleves groupe = { 0 }, unitaire = { 0 };
+    t0 = maintenant_s();
+    bool lu = lireElevesParIds(db, page, nb_page, &groupe);
+    t1 = maintenant_s();
+    for (int k = 0; k < nb_page; k++) {
+        sqlite3_stmt *stmt = obtenirRequete(db, STMT_ELEVE_PAR_ID);
+        sqlite3_bind_int(stmt, 1, page[k]);
+        if (sqlite3_step(stmt) == SQLITE_ROW) lotAjouterLigne(&unitaire, stmt);
+        else partitionLireEleve(page[k], &unitaire);
+        libererRequete(stmt);
+    }
+    t2 = maintenant_s();
+    bool memes = lu && groupe.n == nb_page && unitaire.n == nb_page;
+    for (int k = 0; memes && k < nb_page; k++) {
+        int j = lotIndiceId(&groupe, page[k]);
+        memes = j >= 0 && strcmp(lotChaine(&groupe, groupe.lignes[j].nom), lotChaine(&unitaire, unitaire.lignes[k].nom)) == 0;
+    }
+    ok = ok && memes;
+    printf("partitions   page de %d résultats : par partition %6.2f ms, par id %6.2f ms, %s\n",
+           nb_page, (t1 - t0) * 1e3, (t2 - t1) * 1e3, memes ? "identiques" : "DIFFÉRENTS");
+    lotLiberer(&groupe);
+    lotLiberer(&unitaire);
+    partitionsFermer();
+    fermerDB(db);
+    db = NULL;
+    remove(chemin);
+    for (int a = 0; a < BENCH_PARTITIONS_ANNEES; a++) {
+        snprintf(sql, sizeof(sql), "%s/" PARTITION_FORMAT, dossier, 2019 + a);
+        remove(sql);
+    }
+    rmdir(dossier);
+    return ok;
+}
+
+// Recherche floue : id du meilleur résultat pour le terme, 0 si aucun.
+int premierFloue(const char *terme) {
+    ResultatFloue res[10];
+    return trigrammesChercher(trigrammes, terme, 10, res) > 0 ? res[0].id : 0;
+}
+
+// Le meilleur résultat approchant du terme porte-t-il ce nom (préfixe) ?
+bool floueTrouve(const char *terme, const char *attendu) {
+    int id = premierFloue(terme);
+    sqlite3_stmt *stmt = obtenirRequete(db, STMT_ELEVE_PAR_ID);
+    if (!stmt || id == 0) return false;
+    sqlite3_bind_int(stmt, 1, id);
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW && strncmp(colonneTexte(stmt, 1), attendu, strlen(attendu)) == 0;
+    libererRequete(stmt);
+    return ok;
+}
+
+// Recherche tolérante aux fautes par trigrammes sur n élèves.
+bool benchFloue(int n) {
+    const char *termes[] = { "Dupon", "Lefevre", "Dupomt", "Bernrad", "martn 1234", "Kovalczyk" };
+    const char *attendus[] = { "Dupont", "Lefèvre", "Dupont", "Bernard", "Martin", "Kowalczyk" };
+    char sql[1024];
+    if (!ouvrirBaseBench(&db) || !preparerRequetes(db)) return false;
+    snprintf(sql, sizeof(sql),
+             "DROP TRIGGER eleves_fts_ai; DROP TRIGGER eleves_fts_ad; DROP TRIGGER eleves_fts_au;"
+             "WITH RECURSIVE s(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM s WHERE i < %d - 1), "
+             "noms(k, nom) AS (VALUES (0, 'Dupont'), (1, 'Martin'), (2, 'Lefèvre'), (3, 'Bernard'), "
+             "(4, 'Petit'), (5, 'Durand'), (6, 'Moreau'), (7, 'Laurent')) "
+             "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+             "SELECT nom || ' ' || i, 11 + i %% 8, 1.50, 'eleve' || i || '@ecole.fr', '', (3 + i %% 4) || char(65 + i %% 3) "
+             "FROM s JOIN noms ON k = i %% 8;"
+             "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+             "VALUES ('Kowalczyk Anna', 14, 1.60, 'anna.k@ecole.fr', '', '4A');", n);
+    if (sqlite3_exec(db, sql, 0, 0, NULL) != SQLITE_OK) return false;
+    trigrammes = trigrammesConstruire(db);
+    if (!trigrammes) return false;
+    printf("floue        construction %8.1f ms, %.1f Mo pour %d lignes\n",
+           trigrammes->duree_construction * 1e3, trigrammesMemoire(trigrammes) / 1048576.0, trigrammes->n);
+
+    const int tours = 20, nb_termes = sizeof(termes) / sizeof(termes[0]);
+    double *durees = malloc(sizeof(double) * tours * nb_termes);
+    ResultatFloue res[RECHERCHE_FLOUE_MAX];
+    int k = 0;
+    bool ok = durees != NULL;
+    for (int t = 0; ok && t < nb_termes; t++) {
+        for (int r = 0; r < tours; r++) {
+            double t0 = maintenant_s();
+            trigrammesChercher(trigrammes, termes[t], RECHERCHE_FLOUE_MAX, res);
+            durees[k++] = maintenant_s() - t0;
         }
+        bool trouve = floueTrouve(termes[t], attendus[t]);
+        printf("floue        \"%s\" -> %s\n", termes[t], trouve ? attendus[t] : "NON TROUVÉ");
+        ok = ok && trouve;
     }
-    gtk_widget_destroy(dialog);
+    if (durees) {
+        qsort(durees, k, sizeof(double), comparerDurees);
+        printf("floue        requête p50 %8.2f ms, p99 %8.2f ms\n", centile(durees, k, 0.50) * 1e3, centile(durees, k, 0.99) * 1e3);
+        free(durees);
+    }
+
+    // tenue à jour par les chemins d'écriture
+    Personne p = { 0, "Zébulon Tournesol", 12, 1.40f, "", "", "6A", 0 };
+    ajouterEleve(db, &p);
+    int id = (int)sqlite3_last_insert_rowid(db);
+    bool ajout = premierFloue("zebulon tournsol") == id;
+    snprintf(p.nom, sizeof(p.nom), "Zacharie Tournesol");
+    modifierEleve(db, id, &p);
+    bool modif = premierFloue("zacharie") == id && premierFloue("zebulon") != id;
+    supprimerEleve(db, id);
+    bool suppr = premierFloue("zacharie") != id;
+    printf("floue        ajout %s, modification %s, suppression %s\n",
+           ajout ? "ok" : "ÉCHEC", modif ? "ok" : "ÉCHEC", suppr ? "ok" : "ÉCHEC");
+    ok = ok && ajout && modif && suppr;
+
+    // dans une transaction : rien avant la validation, rien après l'annulation
+    snprintf(p.nom, sizeof(p.nom), "Zéphyrin Capucine");
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    id = (int)sqlite3_last_insert_rowid(db);
+    bool transaction_ok = premierFloue("zephyrin capucine") != id;
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    transaction_ok = transaction_ok && premierFloue("zephyrin capucine") != id;
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    ajouterEleve(db, &p);
+    id = (int)sqlite3_last_insert_rowid(db);
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    transactionConfirmer(db);               // base en mémoire : pas de wal_hook
+    transaction_ok = transaction_ok && premierFloue("zephyrin capucine") == id;
+    // relecture : les écritures validées pendant la lecture sont rejouées
+    trigrammes->rattraper = true;
+    TrigrammesEleves *neuf = trigrammesLire(db);
+    supprimerEleve(db, id);
+    snprintf(p.nom, sizeof(p.nom), "Barnabé Quenouille");
+    ajouterEleve(db, &p);
+    int id_pendant = (int)sqlite3_last_insert_rowid(db);
+    bool relecture = neuf != NULL;
+    if (neuf) trigrammesEchanger(trigrammes, neuf);
+    trigrammesLiberer(neuf);
+    relecture = relecture && premierFloue("zephyrin capucine") != id && premierFloue("barnabe quenouille") == id_pendant &&
+                !trigrammes->rattraper && trigrammes->n == n + 2;
+    printf("floue        transaction annulée puis validée : %s, relecture avec rattrapage : %s\n",
+           transaction_ok ? "conforme" : "INCOHÉRENT", relecture ? "conforme" : "INCOHÉRENT");
+    ok = ok && transaction_ok && relecture;
+    trigrammesLiberer(trigrammes);
+    trigrammes = NULL;
+    fermerDB(db);
+    db = NULL;
+    return ok;
 }
 
-void on_list_students_clicked(GtkWidget *widget, gpointer data) {
-    GtkWidget *window;
-    GtkWidget *scrolled_window;
-    GtkWidget *treeview;
-    GtkListStore *store;
-    GtkTreeViewColumn *column;
-    GtkCellRenderer *renderer;
-    sqlite3 *db;
-    sqlite3_stmt *stmt;
-    int rc;
+// Charge de travail des diagnostics : n ajouts, n lectures par id, quelques recherches.
+double chargeDiagnostics(int n) {
+    Personne p = { 0, "Dupont", 15, 1.70f, "dupont@ecole.fr", "0600000000", "3A", 0 };
+    double t0 = maintenant_s();
+    sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+    for (int i = 0; i < n; i++) ajouterEleve(db, &p);
+    sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+    sqlite3_int64 premier = sqlite3_last_insert_rowid(db) - n + 1;
+    for (int i = 0; i < n; i++) {
+        sqlite3_stmt *stmt = obtenirRequete(db, STMT_ELEVE_PAR_ID);
+        sqlite3_bind_int64(stmt, 1, premier + i);
+        sqlite3_step(stmt);
+        libererRequete(stmt);
+    }
+    for (int i = 0; i < 20; i++) {
+        char *res = NULL;
+        rechercherEleve(db, "dupont", &res);
+        free(res);
+    }
+    return maintenant_s() - t0;
+}
 
-    // Ouvrir la base de données
-    rc = sqlite3_open("eleves.db", &db);
-    if (rc != SQLITE_OK) {
-        g_printerr("Erreur ouverture base: %s\n", sqlite3_errmsg(db));
-        return;
+// Instrumentation : coût inactif et actif, statistiques et requêtes lentes.
+bool benchDiagnostics(int n) {
+    const char *base = "bench_diagnostics.db", *json = "bench_diagnostics.json";
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db)) return false;
+    diagSuivre(db);
+    const long appels = 10000000;
+    double t0 = maintenant_s(), somme = 0;
+    for (long i = 0; i < appels; i++) somme += diagDebut();
+    double t1 = maintenant_s();
+    printf("diagnostics  minuteur inactif %6.2f ns/appel\n", (t1 - t0) / appels * 1e9 + somme);
+
+    double inactif = chargeDiagnostics(n);
+    sqlite3_exec(db, "DELETE FROM eleves;", 0, 0, NULL);
+    diagReinitialiser();
+    diagActiver(true);
+    double actif = chargeDiagnostics(n);
+    printf("diagnostics  charge inactive %8.1f ms, active %8.1f ms (%+.1f %%)\n",
+           inactif * 1e3, actif * 1e3, (actif / inactif - 1) * 100);
+
+    pthread_mutex_lock(&diag.mutex);
+    DiagRequete *insertion = diagRequete(stmt_sql[STMT_INSERT_ELEVE]);
+    DiagRequete *lecture = diagRequete(stmt_sql[STMT_ELEVE_PAR_ID]);
+    bool ok = diag.fonctions[DIAG_AJOUTER].appels == n && diag.fonctions[DIAG_RECHERCHER].appels == 20 &&
+              insertion && insertion->mesure.appels == n && lecture && lecture->mesure.appels == n &&
+              lecture->mesure.lignes == n && atomic_load(&diag.caches[DIAG_CACHE_REQUETES][0]) >= 2L * n;
+    pthread_mutex_unlock(&diag.mutex);
+
+    diagSeuilLent(0);           // tout est lent : la requête suivante est journalisée avec son plan
+    sqlite3_exec(db, "SELECT COUNT(*) FROM eleves WHERE age > 12;", 0, 0, NULL);
+    diagSeuilLent(DIAG_SEUIL_LENT_MS);
+    pthread_mutex_lock(&diag.mutex);
+    const DiagLente *l = diag.nb_lentes ? &diag.lentes[(diag.nb_lentes - 1) % DIAG_LENTES_MAX] : NULL;
+    bool lente = l && strstr(l->sql, "age > 12") && strstr(l->plan, "SCAN");
+    if (l) printf("diagnostics  requête lente %.3f ms, plan : %s\n", l->duree_ms, l->plan);
+    pthread_mutex_unlock(&diag.mutex);
+
+    bool exporte = diagExporter(json);
+    FILE *fp = fopen(json, "r");
+    long taille = 0;
+    if (fp) {
+        exporte = exporte && fgetc(fp) == '{';
+        fseek(fp, 0, SEEK_END);
+        taille = ftell(fp);
+        fclose(fp);
     }
+    printf("diagnostics  statistiques %s, requête lente %s, export JSON %ld octets\n",
+           ok ? "exactes" : "FAUSSES", lente ? "journalisée" : "ABSENTE", taille);
+    diagActiver(false);
+    diagReinitialiser();
+    fermerDB(db);
+    db = NULL;
+    diagFermer();
+    remove(base);
+    remove(json);
+    return ok && lente && exporte;
+}
 
-    // Créer la fenêtre
-    window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_title(GTK_WINDOW(window), "Liste des étudiants");
-    gtk_window_set_default_size(GTK_WINDOW(window), 600, 400);
-    g_signal_connect(window, "destroy", G_CALLBACK(gtk_widget_destroy), NULL);
+// Contenu d'un fichier, décompressé s'il est gzip (membres concaténés compris).
+bool lireFichierBench(const char *chemin, Sortie *s) {
+    gzFile gz = gzopen(chemin, "rb");
+    if (!gz) return false;
+    char tampon[65536];
+    int n;
+    while ((n = gzread(gz, tampon, sizeof(tampon))) > 0) sortieEcrire(s, tampon, n);
+    gzclose(gz);
+    return n == 0 && !s->erreur;
+}
 
-    // Ajouter un défilement
-    scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-    gtk_container_add(GTK_CONTAINER(window), scrolled_window);
+bool memesFichiersBench(const char *a, const char *b) {
+    Sortie x = { NULL, NULL, 0, 0, false }, y = { NULL, NULL, 0, 0, false };
+    bool ok = lireFichierBench(a, &x) && lireFichierBench(b, &y) && x.len == y.len && memcmp(x.buf, y.buf, x.len) == 0;
+    free(x.buf);
+    free(y.buf);
+    return ok;
+}
 
-    // Créer le modèle de données
-    store = gtk_list_store_new(3, G_TYPE_INT, G_TYPE_STRING, G_TYPE_INT);
-    
-    // Exécuter la requête
-    rc = sqlite3_prepare_v2(db, "SELECT id, nom, age FROM eleves", -1, &stmt, NULL);
-    if (rc == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            GtkTreeIter iter;
-            gtk_list_store_append(store, &iter);
-            gtk_list_store_set(store, &iter,
-                0, sqlite3_column_int(stmt, 0),
-                1, sqlite3_column_text(stmt, 1),
-                2, sqlite3_column_int(stmt, 2),
-                -1);
-        }
+// Lignes d'un fichier au format colonnes, -1 s'il est mal formé.
+long lireColonnesBench(const char *chemin) {
+    Sortie s = { NULL, NULL, 0, 0, false };
+    if (!lireFichierBench(chemin, &s) || s.len < 12 || memcmp(s.buf, "CPCOL1\n", 8) != 0) {
+        free(s.buf);
+        return -1;
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+    const unsigned char *p = (const unsigned char*)s.buf, *fin = p + s.len;
+    #define U32(q) ((uint32_t)(q)[0] | (uint32_t)(q)[1] << 8 | (uint32_t)(q)[2] << 16 | (uint32_t)(q)[3] << 24)
+    uint32_t colonnes = U32(p + 8);
+    p += 12;
+    for (uint32_t c = 0; c < colonnes && p + 2 <= fin; c++) p += 2 + (p[0] | p[1] << 8);
+    long lignes = 0;
+    while (p + 8 <= fin && p + 4 + U32(p) <= fin) {
+        lignes += U32(p + 4);
+        p += 4 + U32(p);
+    }
+    #undef U32
+    bool ok = p == fin;
+    free(s.buf);
+    return ok ? lignes : -1;
+}
 
-    // Créer le TreeView
-    treeview = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
-    gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(treeview), TRUE);
-    gtk_container_add(GTK_CONTAINER(scrolled_window), treeview);
+void retirerDossierBench(const char *dossier) {
+    DIR *d = opendir(dossier);
+    struct dirent *ent;
+    char chemin[512];
+    while (d && (ent = readdir(d))) {
+        if (ent->d_name[0] == '.') continue;
+        snprintf(chemin, sizeof(chemin), "%s/%s", dossier, ent->d_name);
+        remove(chemin);
+    }
+    if (d) closedir(d);
+    rmdir(dossier);
+}
+
+// Export parallèle de toutes les tables : débit par format (en Mo encodés
+// par seconde, avant compression), passage à l'échelle avec le nombre de
+// travailleurs, et sortie identique quel que soit ce nombre.
+bool benchExports(int n) {
+    const char *base = "bench_exports.db";
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db) ||
+        !genererBaseBench(db, n, 7)) return false;
+    // tables exportées (toutes sauf users, parametres et sessions)
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, "SELECT (SELECT COUNT(*) FROM eleves) + (SELECT COUNT(*) FROM notes) + "
+                           "(SELECT COUNT(*) FROM presences) + (SELECT COUNT(*) FROM logs) + "
+                           "(SELECT COUNT(*) FROM notes_agregats) + (SELECT COUNT(*) FROM presences_bitmaps), "
+                           "(SELECT COUNT(*) FROM eleves);", -1, &stmt, NULL);
+    long attendues = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    long eleves = sqlite3_column_int64(stmt, 1);
+    sqlite3_finalize(stmt);
+    long processeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("exports      %ld lignes dans 6 tables, %ld processeurs\n", attendues, processeurs);
 
-    // Ajouter les colonnes
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("ID", renderer, "text", 0, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    bool ok = true;
+    char dossier[64];
+    for (int f = 0; f < EXPORT_NB_FORMATS; f++) {
+        for (int c = 0; c < 2; c++) {
+            OptionsExport o = { f, c, 1, NULL, NULL };
+            BilanExport b;
+            snprintf(dossier, sizeof(dossier), "bench_exports_%s%s", format_export_noms[f], c ? "_gz" : "");
+            bool fait = exporterTables(db, dossier, &o, &b) && b.lignes == attendues && b.fichiers == 6;
+            ok = ok && fait;
+            char nom[32];
+            snprintf(nom, sizeof(nom), "%s%s", format_export_noms[f], compression_extensions[c]);
+            printf("exports      %-12s %2d trav. %8.1f Mo/s  %8.1f Mo encodés -> %8.1f Mo écrits %s\n",
+                   nom, 1, b.octets_encodes / 1e6 / b.secondes,
+                   b.octets_encodes / 1e6, b.octets_ecrits / 1e6, fait ? "" : "(ÉCHEC)");
+        }
+    }
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Nom", renderer, "text", 1, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    // passage à l'échelle sur le format le plus coûteux en calcul
+    const int paliers[] = { 1, 2, 4, 8 };
+    double reference = 0;
+    for (int k = 0; k < 4; k++) {
+        OptionsExport o = { EXPORT_JSONL, COMPRESSION_GZIP, paliers[k], NULL, NULL };
+        BilanExport b;
+        snprintf(dossier, sizeof(dossier), "bench_exports_par%d", paliers[k]);
+        bool fait = exporterTables(db, dossier, &o, &b) && b.lignes == attendues;
+        ok = ok && fait;
+        double debit = b.octets_encodes / 1e6 / b.secondes;
+        if (k == 0) reference = debit;
+        printf("exports      %-12s %2d trav. %8.1f Mo/s  (x%.2f)%s\n", "jsonl.gz", paliers[k], debit, debit / reference, fait ? "" : " (ÉCHEC)");
+    }
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Age", renderer, "text", 2, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    // même sortie quel que soit le nombre de travailleurs ; les membres gzip
+    // concaténés redonnent le fichier brut ; colonnes relisible
+    OptionsExport o = { EXPORT_JSONL, COMPRESSION_AUCUNE, 4, NULL, NULL };
+    ok = ok && exporterTables(db, "bench_exports_jsonl4", &o, NULL);
+    bool identiques = memesFichiersBench("bench_exports_jsonl/notes.jsonl", "bench_exports_jsonl4/notes.jsonl") &&
+                      memesFichiersBench("bench_exports_jsonl/eleves.jsonl", "bench_exports_par8/eleves.jsonl.gz") &&
+                      memesFichiersBench("bench_exports_csv/presences_bitmaps.csv", "bench_exports_csv_gz/presences_bitmaps.csv.gz");
+    long colonnes = lireColonnesBench("bench_exports_colonnes_gz/eleves.col.gz");
+    ok = ok && identiques && colonnes == eleves;
+    printf("exports      sorties %s, colonnes relues : %ld élèves sur %ld\n", identiques ? "identiques" : "DIFFÉRENTES", colonnes, eleves);
 
-    // Afficher la fenêtre
-    gtk_widget_show_all(window);
+    const char *dossiers[] = { "bench_exports_csv", "bench_exports_csv_gz", "bench_exports_jsonl", "bench_exports_jsonl_gz",
+                               "bench_exports_colonnes", "bench_exports_colonnes_gz", "bench_exports_par1", "bench_exports_par2",
+                               "bench_exports_par4", "bench_exports_par8", "bench_exports_jsonl4" };
+    for (int i = 0; i < (int)(sizeof(dossiers) / sizeof(dossiers[0])); i++) retirerDossierBench(dossiers[i]);
+    fermerDB(db);
+    db = NULL;
+    remove(base);
+    return ok;
 }
 
+#define BENCH_CONCURRENCE_DUREE_S 0.5
+#define BENCH_CONCURRENCE_ELEVES 64         // élèves disputés par les écrivains
 
-void on_delete_student_clicked(GtkButton *button, gpointer user_data) {
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Supprimer un Élève",
-                                                    GTK_WINDOW(user_data),
-                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                    "_Supprimer", GTK_RESPONSE_OK,
-                                                    "_Annuler", GTK_RESPONSE_CANCEL,
-                                                    NULL);
-    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    GtkWidget *entry = gtk_entry_new();
-    gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "Entrez l'ID de l'élève");
-    gtk_container_add(GTK_CONTAINER(content_area), entry);
-    gtk_widget_show_all(dialog);
-    int response = gtk_dialog_run(GTK_DIALOG(dialog));
-    if(response == GTK_RESPONSE_OK) {
-        int id = atoi(gtk_entry_get_text(GTK_ENTRY(entry)));
-        if (supprimerEleve(db, id)) {
-            GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                       GTK_DIALOG_MODAL,
-                                                       GTK_MESSAGE_INFO,
-                                                       GTK_BUTTONS_OK,
-                                                       "Élève supprimé avec succès !");
-            gtk_dialog_run(GTK_DIALOG(info));
-            gtk_widget_destroy(info);
-        } else {
-            GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                        GTK_DIALOG_MODAL,
-                                                        GTK_MESSAGE_ERROR,
-                                                        GTK_BUTTONS_OK,
-                                                        "Erreur: Aucun élève trouvé avec cet ID.");
-            gtk_dialog_run(GTK_DIALOG(error));
-            gtk_widget_destroy(error);
+typedef struct {
+    long ajouts;
+    long modifications;
+    long conflits;
+    long echecs;
+    long attentes;
+} BilanEcrivain;
+
+// Un poste : ajouts (1 sur 4) et modifications lues puis réécrites avec
+// leur version, jusqu'à `fin` ; le bilan part dans le tube `fd`.
+void ecrivainBench(const char *base, unsigned graine, double fin, int fd) {
+    sqlite3 *bdd;
+    BilanEcrivain b = { 0 };
+    if (ouvrirBase(base, &bdd)) {
+        while (maintenant_s() < fin) {
+            unsigned r = aleaBench(&graine);
+            if (r % 4 == 0) {
+                Personne p = { 0, "Concurrent", 15, 1.60f, "", "", "3A", 0 };
+                if (ajouterEleve(bdd, &p)) b.ajouts++;
+                else b.echecs++;
+                continue;
+            }
+            Personne p;
+            sqlite3_stmt *stmt = obtenirRequete(bdd, STMT_ELEVE_PAR_ID);
+            sqlite3_bind_int(stmt, 1, 1 + r % BENCH_CONCURRENCE_ELEVES);
+            bool lu = sqlite3_step(stmt) == SQLITE_ROW;
+            if (lu) lireEleve(stmt, &p);
+            libererRequete(stmt);
+            if (!lu) {
+                b.echecs++;
+                continue;
+            }
+            p.age++;
+            ResultatModif res = modifierEleveVersion(bdd, p.id, &p);
+            if (res == MODIF_OK) b.modifications++;
+            else if (res == MODIF_CONFLIT) b.conflits++;
+            else b.echecs++;
         }
+        fermerDB(bdd);
     }
-    gtk_widget_destroy(dialog);
+    b.attentes = atomic_load(&attentes_occupee);
+    ssize_t ecrits = write(fd, &b, sizeof(b));
+    _exit(ecrits == sizeof(b) ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
-void on_search_student_clicked(GtkButton *button, gpointer user_data) {
-    // Boîte de dialogue pour saisir le terme de recherche
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Rechercher un Élève",
-                                                    GTK_WINDOW(user_data),
-                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                    "_Rechercher", GTK_RESPONSE_OK,
-                                                    "_Annuler", GTK_RESPONSE_CANCEL,
-                                                    NULL);
-    GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    GtkWidget *entry = gtk_entry_new();
-    gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "Entrez un terme de recherche");
-    gtk_container_add(GTK_CONTAINER(content_area), entry);
-    gtk_widget_show_all(dialog);
-    
-    int response = gtk_dialog_run(GTK_DIALOG(dialog));
-    if (response == GTK_RESPONSE_OK) {
-        const char *terme = gtk_entry_get_text(GTK_ENTRY(entry));
-        
-        // Création de la fenêtre qui affichera les résultats
-        GtkWidget *result_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-        gtk_window_set_title(GTK_WINDOW(result_window), "Résultats de recherche");
-        gtk_window_set_default_size(GTK_WINDOW(result_window), 800, 400);
-        
-        // Création du modèle pour le TreeView
-        enum { COL_ID, COL_NOM, COL_AGE, COL_TAILLE, COL_EMAIL, COL_TELEPHONE, COL_GRADE, NUM_COLS };
-        GtkListStore *store = gtk_list_store_new(NUM_COLS,
-                                                 G_TYPE_INT,
-                                                 G_TYPE_STRING,
-                                                 G_TYPE_INT,
-                                                 G_TYPE_DOUBLE,
-                                                 G_TYPE_STRING,
-                                                 G_TYPE_STRING,
-                                                 G_TYPE_STRING);
-        
-        // Préparation de la requête pour récupérer les élèves correspondants
-        char sql[MAX_QUERY];
-        snprintf(sql, MAX_QUERY,
-                 "SELECT * FROM eleves WHERE nom LIKE '%%%s%%' OR email LIKE '%%%s%%' OR grade LIKE '%%%s%%';",
-                 terme, terme, terme);
+// Écrivains concurrents (processus) sur une base WAL : validations par
+// seconde, taux de conflits optimistes, et aucune modification perdue (la
+// somme des versions suit le nombre de modifications validées).
+bool benchConcurrence(void) {
+    const char *base = "bench_concurrence.db";
+    const int paliers[] = { 1, 2, 4, 8, 16 };
+    bool ok = true;
+    for (int k = 0; k < 5 && ok; k++) {
+        remove(base);
+        remove("bench_concurrence.db-wal");
+        remove("bench_concurrence.db-shm");
+        if (!ouvrirBase(base, &db)) return false;
+        Personne p = { 0, "Disputé", 14, 1.55f, "", "", "3B", 0 };
+        sqlite3_exec(db, "BEGIN;", 0, 0, NULL);
+        for (int i = 0; i < BENCH_CONCURRENCE_ELEVES; i++) ajouterEleve(db, &p);
+        sqlite3_exec(db, "COMMIT;", 0, 0, NULL);
+        fermerDB(db);                   // pas de connexion ouverte à travers fork()
+        db = NULL;
+
+        int tubes[16];
+        pid_t pids[16];
+        double fin = maintenant_s() + BENCH_CONCURRENCE_DUREE_S;
+        for (int w = 0; w < paliers[k]; w++) {
+            int fd[2];
+            if (pipe(fd) != 0) return false;
+            pids[w] = fork();
+            if (pids[w] == 0) {
+                close(fd[0]);
+                ecrivainBench(base, 1234567u * (w + 1), fin, fd[1]);
+            }
+            close(fd[1]);
+            tubes[w] = fd[0];
+        }
+        BilanEcrivain total = { 0 };
+        for (int w = 0; w < paliers[k]; w++) {
+            BilanEcrivain b;
+            int statut;
+            if (read(tubes[w], &b, sizeof(b)) != sizeof(b)) {
+                memset(&b, 0, sizeof(b));
+                ok = false;
+            }
+            close(tubes[w]);
+            waitpid(pids[w], &statut, 0);
+            total.ajouts += b.ajouts;
+            total.modifications += b.modifications;
+            total.conflits += b.conflits;
+            total.echecs += b.echecs;
+            total.attentes += b.attentes;
+        }
+
+        // vérification : ni ajout ni modification perdus
+        sqlite3 *verif;
         sqlite3_stmt *stmt;
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                int id = sqlite3_column_int(stmt, 0);
-                const char *nom = sqlite3_column_text(stmt, 1) ? (const char *)sqlite3_column_text(stmt, 1) : "";
-                int age = sqlite3_column_int(stmt, 2);
-                double taille = sqlite3_column_double(stmt, 3);
-                const char *email = sqlite3_column_text(stmt, 4) ? (const char *)sqlite3_column_text(stmt, 4) : "";
-                const char *telephone = sqlite3_column_text(stmt, 5) ? (const char *)sqlite3_column_text(stmt, 5) : "";
-                const char *grade = sqlite3_column_text(stmt, 6) ? (const char *)sqlite3_column_text(stmt, 6) : "";
-                
-                GtkTreeIter iter;
-                gtk_list_store_append(store, &iter);
-                gtk_list_store_set(store, &iter,
-                                   COL_ID, id,
-                                   COL_NOM, nom,
-                                   COL_AGE, age,
-                                   COL_TAILLE, taille,
-                                   COL_EMAIL, email,
-                                   COL_TELEPHONE, telephone,
-                                   COL_GRADE, grade,
-                                   -1);
+        long lignes = -1, versions = -1;
+        if (sqlite3_open_v2(base, &verif, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+            sqlite3_prepare_v2(verif, "SELECT COUNT(*), (SELECT SUM(version - 1) FROM eleves WHERE id <= ?) FROM eleves;",
+                               -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, BENCH_CONCURRENCE_ELEVES);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                lignes = sqlite3_column_int64(stmt, 0);
+                versions = sqlite3_column_int64(stmt, 1);
             }
             sqlite3_finalize(stmt);
-        } else {
-            log_error(sqlite3_errmsg(db));
         }
-        
-        // Création du TreeView et de ses colonnes
-        GtkWidget *treeview = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
-        g_object_unref(store); // Le modèle est maintenant référencé par le treeview
-        
-        // Fonction utilitaire pour ajouter une colonne
-        void add_column(const gchar *title, int col_index) {
-            GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
-            GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(title, renderer, "text", col_index, NULL);
-            gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
-        }
-        add_column("ID", COL_ID);
-        add_column("Nom", COL_NOM);
-        add_column("Âge", COL_AGE);
-        add_column("Taille", COL_TAILLE);
-        add_column("Email", COL_EMAIL);
-        add_column("Téléphone", COL_TELEPHONE);
-        add_column("Grade", COL_GRADE);
-        
-        // Placement du TreeView dans une fenêtre avec un GtkScrolledWindow
-        GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-        gtk_container_add(GTK_CONTAINER(scrolled_window), treeview);
-        gtk_container_add(GTK_CONTAINER(result_window), scrolled_window);
-        
-        gtk_widget_show_all(result_window);
+        sqlite3_close(verif);
+        bool coherent = lignes == BENCH_CONCURRENCE_ELEVES + total.ajouts && versions == total.modifications;
+        ok = ok && coherent && total.echecs == 0;
+        long validees = total.ajouts + total.modifications;
+        long tentees = total.modifications + total.conflits;
+        printf("concurrence  %2d écrivains %8.0f validations/s  conflits %5.1f %%  échecs %ld  attentes %ld  %s\n",
+               paliers[k], validees / BENCH_CONCURRENCE_DUREE_S, tentees ? 100.0 * total.conflits / tentees : 0.0,
+               total.echecs, total.attentes, coherent ? "cohérent" : "INCOHÉRENT");
     }
-    gtk_widget_destroy(dialog);
+    remove(base);
+    remove("bench_concurrence.db-wal");
+    remove("bench_concurrence.db-shm");
+    return ok;
 }
 
+// Cache de résultats : recherche répétée avec et sans cache, invalidation
+// par une écriture de la connexion puis d'une autre connexion, plafond.
+bool benchCache(int n) {
+    const char *base = "bench_cache.db";
+    const char *termes[] = { "dupont", "lef", "mar 3a", "eleve4242" };
+    const int tours = 1000;
+    remove(base);
+    remove("bench_cache.db-wal");
+    remove("bench_cache.db-shm");
+    if (!ouvrirBase(base, &db)) return false;
+    remplirBaseBench(n);
+    cacheResultatsVider(CACHE_RESULTATS_OCTETS);
+    bool ok = true;
+    for (int t = 0; t < 4 && ok; t++) {
+        char *premier = NULL, *res = NULL;
+        double t0 = maintenant_s();
+        ok = rechercherEleve(db, termes[t], &premier);
+        double t1 = maintenant_s();
+        for (int r = 0; r < tours && ok; r++) {
+            free(res);
+            ok = rechercherEleve(db, termes[t], &res);
+        }
+        double t2 = maintenant_s();
+        // lecture seule du lot gardé (état de la base compris), sans le rendu texte
+        char expr[MAX_QUERY], cle[CACHE_CLE_MAX];
+        EtatCache etat;
+        LotEleves lot = { 0 };
+        construireRequeteFTS(termes[t], expr, sizeof(expr));
+        cacheResultatsCle(cle, sizeof(cle), "recherche-complete", expr);
+        bool garde = true;
+        for (int r = 0; r < tours && garde; r++) {
+            garde = cacheResultatsEtat(db, &etat) && cacheResultatsLire(&etat, cle, &lot, NULL);
+        }
+        double t3 = maintenant_s();
+        bool identique = (!premier && !res) || (premier && res && strcmp(premier, res) == 0);
+        printf("cache        %-12s sans %8.3f ms   avec %8.2f µs (lecture %6.2f µs, %d lignes)   %s\n", termes[t],
+               (t1 - t0) * 1e3, (t2 - t1) / tours * 1e6, (t3 - t2) / tours * 1e6, lot.n,
+               identique && garde ? "identique" : "DIFFÉRENT");
+        ok = ok && identique && garde;
+        lotLiberer(&lot);
+        free(premier);
+        free(res);
+    }
 
-void on_export_csv_clicked(GtkButton *button, gpointer user_data) {
-    if(exporterCSV(db)) {
-        GtkWidget *info = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                   GTK_DIALOG_MODAL,
-                                                   GTK_MESSAGE_INFO,
-                                                   GTK_BUTTONS_OK,
-                                                   "Exportation CSV réussie dans '%s'.", CSV_FILENAME);
-        gtk_dialog_run(GTK_DIALOG(info));
-        gtk_widget_destroy(info);
-    } else {
-        GtkWidget *error = gtk_message_dialog_new(GTK_WINDOW(user_data),
-                                                   GTK_DIALOG_MODAL,
-                                                   GTK_MESSAGE_ERROR,
-                                                   GTK_BUTTONS_OK,
-                                                   "Erreur lors de l'exportation CSV.");
-        gtk_dialog_run(GTK_DIALOG(error));
-        gtk_widget_destroy(error);
+    // écriture par la connexion elle-même, puis par une autre connexion
+    char *res = NULL;
+    Personne p = { 0, "Dupont Zéphyrin", 13, 1.52f, "zephyrin@ecole.fr", "", "4B", 0 };
+    ajouterEleve(db, &p);
+    ok = rechercherEleve(db, "dupont", &res) && ok;
+    bool locale = res && strstr(res, "Zéphyrin");
+    free(res);
+    res = NULL;
+    sqlite3 *autre = NULL;
+    bool distante = false;
+    if (sqlite3_open(base, &autre) == SQLITE_OK) {
+        configurerAttente(autre);
+        sqlite3_exec(autre, "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+                            "VALUES ('Dupont Ysaline', 12, 1.45, 'ysaline@ecole.fr', '', '3A');", 0, 0, NULL);
+        ok = rechercherEleve(db, "dupont", &res) && ok;
+        distante = res && strstr(res, "Ysaline");
+        free(res);
+    }
+    sqlite3_close(autre);
+    // lignes lues dans une transaction puis annulées
+    res = NULL;
+    sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, NULL);
+    sqlite3_exec(db, "INSERT INTO eleves (nom, age, taille, email, telephone, grade) "
+                     "VALUES ('Dupont Wilfried', 14, 1.60, 'wilfried@ecole.fr', '', '4B');", 0, 0, NULL);
+    ok = rechercherEleve(db, "dupont", &res) && ok;
+    bool vue = res && strstr(res, "Wilfried");
+    free(res);
+    res = NULL;
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+    ok = rechercherEleve(db, "dupont", &res) && ok;
+    bool annulee = vue && res && !strstr(res, "Wilfried");
+    free(res);
+    printf("cache        invalidation : écriture locale %s, autre connexion %s, annulation %s\n",
+           locale ? "ok" : "ÉCHEC", distante ? "ok" : "ÉCHEC", annulee ? "ok" : "ÉCHEC");
+    ok = ok && locale && distante && annulee;
+
+    // plafond : des recherches toutes différentes ne le dépassent jamais
+    size_t plafond = 64 * 1024, max_octets = 0;
+    cacheResultatsVider(plafond);
+    long evictions = cache_resultats.evictions;
+    for (int i = 0; i < 500 && ok; i++) {
+        char terme[32];
+        snprintf(terme, sizeof(terme), "eleve%d", i * 7 % (n > 0 ? n : 1));
+        res = NULL;
+        ok = rechercherEleve(db, terme, &res);
+        free(res);
+        if (cache_resultats.octets > max_octets) max_octets = cache_resultats.octets;
     }
+    evictions = cache_resultats.evictions - evictions;
+    printf("cache        plafond %zu Ko : au plus %zu Ko occupés, %ld évictions\n",
+           plafond / 1024, max_octets / 1024, evictions);
+    ok = ok && max_octets <= plafond && evictions > 0;
+    printf("cache        succès %ld, échecs %ld (dont %ld périmés)\n",
+           cache_resultats.succes, cache_resultats.echecs, cache_resultats.perimees);
+    cacheResultatsVider(CACHE_RESULTATS_OCTETS);
+    fermerDB(db);
+    db = NULL;
+    remove(base);
+    remove("bench_cache.db-wal");
+    remove("bench_cache.db-shm");
+    return ok;
 }
 
+// Bulletins du premier trimestre : débit (bulletins par seconde) avec 1, 2
+// et 4 travailleurs, fichier commun identique quel que soit ce nombre, un
+// fichier par élève et appréciations échappées.
+bool benchBulletins(int n) {
+    const char *base = "bench_bulletins.db";
+    remove(base);
+    if (sqlite3_open(base, &db) != SQLITE_OK || !creerSchema(db) || !preparerRequetes(db) ||
+        !genererBaseBench(db, n, 11)) return false;
+    // quelques notes commentées par élève dans le trimestre, dont une à échapper
+    const char *matieres[] = { "maths", "francais", "anglais", "histoire" };
+    unsigned graine = 5;
+    bool ok = sqlite3_exec(db, "BEGIN;", 0, 0, NULL) == SQLITE_OK;
+    for (int i = 0; ok && i < n * 4; i++) {
+        char date[32], commentaire[64];
+        dateCivile(jourCivil(2024, 9, 2) + aleaBench(&graine) % 110, date, sizeof(date));
+        snprintf(commentaire, sizeof(commentaire), i % 97 == 0 ? "Travail <sérieux> & \"régulier\" %d" : "Bon trimestre %d", i);
+        ok = ajouterNote(db, 1 + i % n, matieres[aleaBench(&graine) % 4], (aleaBench(&graine) % 41) / 2.0,
+                         i % 3 == 0 ? commentaire : NULL, date);
+    }
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", 0, 0, NULL);
+    printf("bulletins    %d élèves, trimestre 2024-T1, %ld processeurs\n", n, sysconf(_SC_NPROCESSORS_ONLN));
 
-void on_quit_clicked(GtkButton *button, gpointer user_data) {
-    gtk_main_quit();
-}
+    const int paliers[] = { 1, 2, 4 };
+    char dossier[64], chemin[128];
+    double reference = 0;
+    for (int k = 0; ok && k < 3; k++) {
+        OptionsBulletins o = { 0 };
+        o.travailleurs = paliers[k];
+        BilanBulletins b;
+        snprintf(dossier, sizeof(dossier), "bench_bulletins_%d", paliers[k]);
+        bool fait = genererBulletins(db, "2024-T1", dossier, &o, &b) && b.eleves == n && b.fichiers == n + 1;
+        ok = ok && fait;
+        double debit = b.secondes > 0 ? b.eleves / b.secondes : 0;
+        if (k == 0) reference = debit;
+        printf("bulletins    %2d trav. %8.0f bulletins/s  lecture %6.1f ms  total %7.1f ms  %6.1f Mo  (x%.2f)%s\n",
+               b.travailleurs, debit, b.secondes_lecture * 1e3, b.secondes * 1e3, b.octets / 1e6,
+               reference > 0 ? debit / reference : 0, fait ? "" : " (ÉCHEC)");
+    }
 
-GtkWidget* create_main_window() {
-    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_title(GTK_WINDOW(window), "Gestion des Élèves");
-    gtk_window_set_default_size(GTK_WINDOW(window), 800, 600);
-    g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
-    
-    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-    gtk_container_add(GTK_CONTAINER(window), vbox);
-    
-    GtkWidget *btn_add = gtk_button_new_with_label("Ajouter un Élève");
-    g_signal_connect(btn_add, "clicked", G_CALLBACK(on_add_student_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_add, FALSE, FALSE, 0);
-    
-    GtkWidget *btn_list = gtk_button_new_with_label("Lister les Élèves");
-    g_signal_connect(btn_list, "clicked", G_CALLBACK(on_list_students_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_list, FALSE, FALSE, 0);
-    
-    GtkWidget *btn_delete = gtk_button_new_with_label("Supprimer un Élève");
-    g_signal_connect(btn_delete, "clicked", G_CALLBACK(on_delete_student_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_delete, FALSE, FALSE, 0);
-    
-    GtkWidget *btn_search = gtk_button_new_with_label("Rechercher un Élève");
-    g_signal_connect(btn_search, "clicked", G_CALLBACK(on_search_student_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_search, FALSE, FALSE, 0);
-    
-    GtkWidget *btn_export = gtk_button_new_with_label("Exporter CSV");
-    g_signal_connect(btn_export, "clicked", G_CALLBACK(on_export_csv_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_export, FALSE, FALSE, 0);
-    
-    GtkWidget *btn_quit = gtk_button_new_with_label("Quitter");
-    g_signal_connect(btn_quit, "clicked", G_CALLBACK(on_quit_clicked), window);
-    gtk_box_pack_start(GTK_BOX(vbox), btn_quit, FALSE, FALSE, 0);
-    
-    return window;
+    bool identiques = memesFichiersBench("bench_bulletins_1/bulletins.html", "bench_bulletins_2/bulletins.html") &&
+                      memesFichiersBench("bench_bulletins_1/bulletins.html", "bench_bulletins_4/bulletins.html") &&
+                      memesFichiersBench("bench_bulletins_1/bulletin-1.html", "bench_bulletins_4/bulletin-1.html");
+    Sortie s = { NULL, NULL, 0, 0, false };
+    snprintf(chemin, sizeof(chemin), "bench_bulletins_4/bulletin-%d.html", n);
+    bool dernier = lireFichierBench(chemin, &s);
+    free(s.buf);
+    s = (Sortie){ NULL, NULL, 0, 0, false };
+    bool echappe = lireFichierBench("bench_bulletins_1/bulletin-1.html", &s) && (sortieEcrire(&s, "", 1), !s.erreur) &&
+                   strstr(s.buf, "&lt;sérieux&gt; &amp; &quot;régulier&quot;") && !strstr(s.buf, "<sérieux>");
+    free(s.buf);
+    ok = ok && identiques && dernier && echappe;
+    printf("bulletins    sorties %s, fichier du dernier élève %s, appréciations %s\n",
+           identiques ? "identiques" : "DIFFÉRENTES", dernier ? "présent" : "ABSENT (ÉCHEC)",
+           echappe ? "échappées" : "NON ÉCHAPPÉES (ÉCHEC)");
+
+    OptionsBulletins o = { 0 };
+    bool refuse = !genererBulletins(db, "2024-T4", "bench_bulletins_1", &o, NULL);
+    ok = ok && refuse;
+    printf("bulletins    trimestre invalide %s\n", refuse ? "refusé" : "ACCEPTÉ (ÉCHEC)");
+
+    for (int k = 0; k < 3; k++) {
+        snprintf(dossier, sizeof(dossier), "bench_bulletins_%d", paliers[k]);
+        retirerDossierBench(dossier);
+    }
+    fermerDB(db);
+    db = NULL;
+    remove(base);
+    return ok;
 }
 
-gboolean check_login(const char *username, const char *password) {
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT password_hash FROM users WHERE username = ?;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        log_error("Échec de préparation de la requête de connexion");
-        return FALSE;
+// Ligne de commande : ouverture, authentification et première réponse
+// (médiane sur plusieurs lancements, sans le coût de exec ni du chargeur),
+// débit d'un lot lu sur stdin contre une commande par lancement, codes de
+// sortie. Chaque lancement repart sans session en mémoire, comme un nouveau
+// processus, et paie la dérivation étalonnée s'il donne le mot de passe ;
+// avec le jeton de `session`, il ne la paie pas.
+bool benchCommandes(int n) {
+    const char *base = "bench_commandes.db";
+    remove(base);
+    remove("bench_commandes.db-wal");
+    remove("bench_commandes.db-shm");
+    if (!ouvrirBase(base, &db) || !genererBaseBench(db, n, 3) ||
+        sqlite3_exec(db, "INSERT INTO users (username, password_hash, role) VALUES ('bench', 'bench', 'admin');",
+                     0, 0, NULL) != SQLITE_OK) return false;
+    fermerDB(db);
+    db = NULL;
+    FILE *nul = fopen("/dev/null", "w");
+    if (!nul) return false;
+    Commandes c = { NULL, nul, false, NULL, false };
+    char *recherche[] = { "search", "eleve42" }, *ajout[] = { "add", "Bench Commande", "12", "1.5", "b@c.fr", "06", "5A" };
+    char *ouvrir[] = { "session" };
+    printf("commandes    %d élèves\n", n);
+
+    // jeton d'une session : étalonne et réécrit le mot de passe au passage
+    char jeton[65] = "";
+    size_t taille = 0;
+    char *texte = NULL;
+    FILE *sortie = open_memstream(&texte, &taille);
+    Commandes session = { NULL, sortie, false, NULL, false };
+    bool ok = sortie && lancerCommandes(&session, base, "bench", "bench", NULL, NULL, 1, ouvrir) == CMD_OK;
+    if (sortie) fclose(sortie);
+    ok = ok && taille == 65 && sscanf(texte, "%64s", jeton) == 1;
+    free(texte);
+
+    const int par_mot_de_passe = 5, lancements = 51;
+    double durees[51];
+    for (int i = 0; i < par_mot_de_passe && ok; i++) {
+        sessionsVider();
+        double t0 = maintenant_s();
+        ok = lancerCommandes(&c, base, "bench", "bench", NULL, NULL, 2, recherche) == CMD_OK;
+        durees[i] = maintenant_s() - t0;
     }
-    sqlite3_bind_text(stmt, 1, username, -1, SQLITE_TRANSIENT);
-    int rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        const unsigned char *stored_hash = sqlite3_column_text(stmt, 0);
-        if (strcmp((const char*)stored_hash, password) == 0) {
-            sqlite3_finalize(stmt);
-            return TRUE;
-        }
+    qsort(durees, par_mot_de_passe, sizeof(double), comparerDurees);
+    double mot_de_passe = durees[par_mot_de_passe / 2];
+    for (int i = 0; i < lancements && ok; i++) {
+        sessionsVider();
+        double t0 = maintenant_s();
+        ok = lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 2, recherche) == CMD_OK;
+        durees[i] = maintenant_s() - t0;
     }
-    sqlite3_finalize(stmt);
-    return FALSE;
-}
+    qsort(durees, lancements, sizeof(double), comparerDurees);
+    printf("commandes    search : médiane %6.2f ms  max %6.2f ms par jeton, %6.2f ms par mot de passe "
+           "(ouverture, connexion, réponse)%s\n",
+           durees[lancements / 2] * 1e3, durees[lancements - 1] * 1e3, mot_de_passe * 1e3, ok ? "" : " (ÉCHEC)");
 
-void on_login_clicked(GtkButton *button, gpointer user_data) {
-    GtkWidget *entry_username = GTK_WIDGET(g_object_get_data(G_OBJECT(button), "entry_username"));
-    GtkWidget *entry_password = GTK_WIDGET(g_object_get_data(G_OBJECT(button), "entry_password"));
-    const char *username = gtk_entry_get_text(GTK_ENTRY(entry_username));
-    const char *password = gtk_entry_get_text(GTK_ENTRY(entry_password));
-    
-    if (check_login(username, password)) {
-        GtkWidget *login_window = GTK_WIDGET(user_data);
-        gtk_widget_destroy(login_window);
-        
-        GtkWidget *main_window = create_main_window();
-        gtk_widget_show_all(main_window);
-    } else {
-        GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                                   "Nom d'utilisateur ou mot de passe incorrect.");
-        gtk_dialog_run(GTK_DIALOG(dialog));
-        gtk_widget_destroy(dialog);
+    // mille ajouts : un lancement chacun, puis un seul lot
+    const int ajouts = 1000;
+    double t0 = maintenant_s();
+    for (int i = 0; i < ajouts && ok; i++) {
+        sessionsVider();
+        ok = lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 7, ajout) == CMD_OK;
     }
+    double separes = maintenant_s() - t0;
+    FILE *flux = open_memstream(&texte, &taille);
+    for (int i = 0; flux && i < ajouts; i++) fprintf(flux, "add\tLot %d\t12\t1.5\tl%d@c.fr\t06\t5A\n", i, i);
+    if (flux) fclose(flux);
+    FILE *in = texte ? fmemopen(texte, taille, "r") : NULL;
+    t0 = maintenant_s();
+    sessionsVider();
+    ok = ok && in && lancerCommandes(&c, base, "bench", NULL, jeton, in, 0, NULL) == CMD_OK;
+    double lot = maintenant_s() - t0;
+    if (in) fclose(in);
+    free(texte);
+    printf("commandes    %d ajouts : %8.0f/s un lancement chacun, %8.0f/s en un lot (x%.0f)%s\n", ajouts,
+           ajouts / separes, ajouts / lot, separes / lot, ok ? "" : " (ÉCHEC)");
+
+    // un lot en erreur n'écrit rien ; codes de sortie
+    const char *annule = "add\tAnnule\t12\t1.5\ta@c.fr\t06\t5A\ndelete\t999999999\n";
+    in = fmemopen((void*)annule, strlen(annule), "r");
+    sortie = open_memstream(&texte, &taille);
+    Commandes annulees = { NULL, sortie, false, NULL, false };
+    CodeCommande code_lot = in && sortie ? lancerCommandes(&annulees, base, "bench", NULL, jeton, in, 0, NULL) : CMD_ERREUR;
+    if (in) fclose(in);
+    if (sortie) fclose(sortie);
+    bool muet = sortie && taille == 0;     // pas d'id de la ligne annulée
+    free(texte);
+    char *annule_cherche[] = { "search", "annule" }, *absent[] = { "update", "999999999", "age=3" };
+    sortie = open_memstream(&texte, &taille);
+    Commandes compte = { NULL, sortie, true, NULL, false };
+    bool rien = sortie && lancerCommandes(&compte, base, "bench", NULL, jeton, NULL, 2, annule_cherche) == CMD_OK;
+    if (sortie) fclose(sortie);
+    rien = rien && taille == 0 && muet;
+    free(texte);
+    CodeCommande refus = lancerCommandes(&c, base, "bench", "mauvais", NULL, NULL, 2, recherche);
+    CodeCommande inconnu = lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 3, absent);
+    bool codes = code_lot == CMD_ABSENT && rien && refus == CMD_REFUS && inconnu == CMD_ABSENT;
+    ok = ok && codes;
+    printf("commandes    lot annulé %s, codes de sortie %s\n", rien ? "sans effet" : "ÉCRIT (ÉCHEC)",
+           codes ? "corrects" : "INCORRECTS (ÉCHEC)");
+
+    // jetons refusés : faux, sur un autre nom, prolongé par lui-même, expiré,
+    // émis avant un changement de mot de passe (le mot de passe reprend)
+    char faux[65];
+    memcpy(faux, jeton, sizeof(faux));
+    faux[0] = faux[0] == '0' ? '1' : '0';
+    bool refuses = lancerCommandes(&c, base, "bench", NULL, faux, NULL, 2, recherche) == CMD_REFUS &&
+                   lancerCommandes(&c, base, "personne", NULL, jeton, NULL, 2, recherche) == CMD_REFUS &&
+                   lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 1, ouvrir) == CMD_REFUS &&
+                   lancerCommandes(&c, base, "bench", "bench", faux, NULL, 2, recherche) == CMD_OK;
+    sqlite3 *bdd = NULL;
+    bool expire = sqlite3_open(base, &bdd) == SQLITE_OK &&
+                  sqlite3_exec(bdd, "UPDATE sessions SET expiration = 0;", 0, 0, NULL) == SQLITE_OK;
+    refuses = refuses && expire && lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 2, recherche) == CMD_REFUS;
+    bool change = sqlite3_exec(bdd, "UPDATE sessions SET expiration = strftime('%s', 'now') + 60;"
+                                    "UPDATE users SET password_hash = 'bench' WHERE username = 'bench';",
+                               0, 0, NULL) == SQLITE_OK;
+    sqlite3_close(bdd);
+    refuses = refuses && change && lancerCommandes(&c, base, "bench", NULL, jeton, NULL, 2, recherche) == CMD_REFUS;
+    ok = ok && refuses;
+    printf("commandes    jetons faux, expirés ou révoqués %s\n", refuses ? "refusés" : "ACCEPTÉS (ÉCHEC)");
+    fclose(nul);
+    remove(base);
+    remove("bench_commandes.db-wal");
+    remove("bench_commandes.db-shm");
+    return ok;
 }
-/*fenêtre de connexion */
-GtkWidget* create_login_window() {
-    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_title(GTK_WINDOW(window), "Connexion");
-    gtk_window_set_default_size(GTK_WINDOW(window), 300, 200);
 
-    
-    GtkWidget *grid = gtk_grid_new();
-    gtk_container_add(GTK_CONTAINER(window), grid);
-    
-    GtkWidget *label_user = gtk_label_new("Nom d'utilisateur:");
-    GtkWidget *entry_user = gtk_entry_new();
-    GtkWidget *label_pass = gtk_label_new("Mot de passe:");
-    GtkWidget *entry_pass = gtk_entry_new();
-    gtk_entry_set_visibility(GTK_ENTRY(entry_pass), FALSE);
-    
-    GtkWidget *button_login = gtk_button_new_with_label("Se connecter");
-    
-    gtk_grid_attach(GTK_GRID(grid), label_user, 0, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_user, 1, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), label_pass, 0, 1, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), entry_pass, 1, 1, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), button_login, 0, 2, 2, 1);
-    
-    g_object_set_data(G_OBJECT(button_login), "entry_username", entry_user);
-    g_object_set_data(G_OBJECT(button_login), "entry_password", entry_pass);
-    g_signal_connect(button_login, "clicked", G_CALLBACK(on_login_clicked), window);
-    
-    return window;
+// Connexions : PBKDF2 contre les vecteurs de test (RFC 7914), connexions
+// par seconde à chaque coût (dérivation complète, puis session ouverte),
+// réécriture des mots de passe en clair ou moins coûteux, refus.
+bool benchConnexion(int n) {
+    const struct { const char *mdp, *sel; long iterations; const char *attendu; } vecteurs[] = {
+        { "passwd", "salt", 1, "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc" },
+        { "password", "salt", 4096, "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a" },
+    };
+    bool ok = true;
+    for (int v = 0; v < 2; v++) {
+        uint8_t out[32];
+        char hexa[65];
+        pbkdf2Sha256(vecteurs[v].mdp, (const uint8_t*)vecteurs[v].sel, strlen(vecteurs[v].sel), vecteurs[v].iterations, out);
+        versHexa(out, 32, hexa);
+        ok = ok && strcmp(hexa, vecteurs[v].attendu) == 0;
+    }
+    printf("connexion    PBKDF2-HMAC-SHA256 %s\n", ok ? "conforme aux vecteurs de test" : "NON CONFORME (ÉCHEC)");
+    if (!ouvrirBaseBench(&db)) return false;
+
+    // le premier identifiantsIterations() étalonne et enregistre
+    double t0 = maintenant_s();
+    long etalonnees = identifiantsIterations(db);
+    printf("connexion    étalonnage : %ld itérations pour %d ms (%.0f ms)\n", etalonnees, IDENTIFIANTS_CIBLE_MS,
+           (maintenant_s() - t0) * 1e3);
+    const long couts[] = { 1000, 10000, PBKDF2_ITERATIONS_MIN, etalonnees, etalonnees * 2 };
+    for (int k = 0; k < 5 && ok; k++) {
+        char sql[128];
+        snprintf(sql, sizeof(sql), "UPDATE parametres SET valeur = %ld WHERE cle = 'pbkdf2_iterations';", couts[k]);
+        sqlite3_exec(db, sql, 0, 0, NULL);
+        sessionsVider();
+        ok = check_login("bench", "bench");     // réécrit au nouveau coût (plus élevé)
+        int tours = 0;
+        t0 = maintenant_s();
+        do {
+            sessionsVider();
+            ok = check_login("bench", "bench") && ok;
+            tours++;
+        } while (ok && maintenant_s() - t0 < 0.3);
+        double derivation = (maintenant_s() - t0) / tours;
+        t0 = maintenant_s();
+        for (int i = 0; i < n && ok; i++) ok = check_login("bench", "bench");
+        double session = (maintenant_s() - t0) / n;
+        printf("connexion    %8ld itér. %8.1f connexions/s (%7.2f ms)  en session %9.0f/s (%5.2f µs)%s\n",
+               couts[k], 1 / derivation, derivation * 1e3, 1 / session, session * 1e6, ok ? "" : " (ÉCHEC)");
+    }
+
+    // coût abaissé : pas de réécriture, et le leurre d'un nom inconnu garde
+    // le coût des empreintes stockées ; mot de passe en clair : haché à la
+    // connexion, la session ouverte avec l'ancien ne vaut plus
+    sqlite3_stmt *stmt;
+    char stocke[IDENTIFIANT_MAX] = "";
+    #define LIRE_STOCKE() do { \
+        sqlite3_prepare_v2(db, "SELECT password_hash FROM users WHERE username = 'bench';", -1, &stmt, NULL); \
+        if (sqlite3_step(stmt) == SQLITE_ROW) snprintf(stocke, sizeof(stocke), "%s", sqlite3_column_text(stmt, 0)); \
+        sqlite3_finalize(stmt); \
+    } while (0)
+    sqlite3_exec(db, "UPDATE parametres SET valeur = 1000 WHERE cle = 'pbkdf2_iterations';", 0, 0, NULL);
+    bool leurre = coutLeurre(db, 1000) == couts[4];
+    LIRE_STOCKE();
+    char avant[IDENTIFIANT_MAX];
+    snprintf(avant, sizeof(avant), "%s", stocke);
+    sessionsVider();
+    ok = check_login("bench", "bench") && ok;
+    LIRE_STOCKE();
+    bool garde = strcmp(avant, stocke) == 0;
+    sqlite3_exec(db, "UPDATE users SET password_hash = 'autre' WHERE username = 'bench';", 0, 0, NULL);
+    bool ancien_refuse = !check_login("bench", "bench");
+    bool clair_accepte = check_login("bench", "autre");
+    LIRE_STOCKE();
+    char attendu[64];
+    snprintf(attendu, sizeof(attendu), PBKDF2_PREFIXE "1000$");
+    bool hache = strncmp(stocke, attendu, strlen(attendu)) == 0;
+    #undef LIRE_STOCKE
+    bool refus = !check_login("bench", "Autre") && !check_login("bench", "") && !check_login("personne", "autre");
+    bool verifie = garde && leurre && ancien_refuse && clair_accepte && hache && refus;
+    ok = ok && verifie;
+    printf("connexion    coût abaissé %s%s, clair %s, session périmée %s, refus %s\n",
+           garde ? "sans réécriture" : "RÉÉCRIT (ÉCHEC)", leurre ? "" : ", leurre au coût courant (ÉCHEC)",
+           hache ? "haché" : "NON HACHÉ (ÉCHEC)",
+           ancien_refuse ? "refusée" : "ACCEPTÉE (ÉCHEC)", refus && clair_accepte ? "corrects" : "INCORRECTS (ÉCHEC)");
+    sessionsVider();
+    fermerDB(db);
+    db = NULL;
+    return ok;
 }
 
 int main(int argc, char *argv[]) {
-    gtk_init(&argc, &argv);
-    
-    if (!initDB(&db)) {
-        fprintf(stderr, "Erreur: Impossible d'initialiser la base de données\n");
+    const char *quoi = argc > 1 ? argv[1] : "tout";
+    int n = argc > 2 ? atoi(argv[2]) : 100000;
+    bool tout = strcmp(quoi, "tout") == 0;
+    bool ok = true;
+    if (tout || strcmp(quoi, "requetes") == 0) ok = benchRequetes(n) && ok;
+    if (tout || strcmp(quoi, "import") == 0) ok = benchImport(n) && ok;
+    if (tout || strcmp(quoi, "recherche") == 0) ok = benchRecherche(n) && ok;
+    if (tout || strcmp(quoi, "rendu") == 0) ok = benchRendu(n) && ok;
+    if (tout || strcmp(quoi, "notes") == 0) ok = benchNotes(n) && ok;
+    if (tout || strcmp(quoi, "presences") == 0) ok = benchPresences(n) && ok;
+    if (tout || strcmp(quoi, "plans") == 0) ok = benchPlans() && ok;
+    if (tout || strcmp(quoi, "journal") == 0) ok = benchJournal(n) && ok;
+    if (tout || strcmp(quoi, "audit") == 0) ok = benchAudit(n) && ok;
+    if (tout || strcmp(quoi, "changements") == 0) ok = benchChangements(n) && ok;
+    if (tout || strcmp(quoi, "colonnes") == 0) ok = benchColonnes(n) && ok;
+    if (tout || strcmp(quoi, "compact") == 0) ok = benchCompact(n) && ok;
+    if (tout || strcmp(quoi, "sauvegarde") == 0) ok = benchSauvegarde(n) && ok;
+    if (tout || strcmp(quoi, "partitions") == 0) ok = benchPartitions(n) && ok;
+    if (tout || strcmp(quoi, "floue") == 0) ok = benchFloue(n) && ok;
+    if (tout || strcmp(quoi, "diagnostics") == 0) ok = benchDiagnostics(n) && ok;
+    if (tout || strcmp(quoi, "exports") == 0) ok = benchExports(n) && ok;
+    if (tout || strcmp(quoi, "concurrence") == 0) ok = benchConcurrence() && ok;
+    if (tout || strcmp(quoi, "cache") == 0) ok = benchCache(n) && ok;
+    if (tout || strcmp(quoi, "bulletins") == 0) ok = benchBulletins(n) && ok;
+    if (tout || strcmp(quoi, "commandes") == 0) ok = benchCommandes(n) && ok;
+    if (tout || strcmp(quoi, "connexion") == 0) ok = benchConnexion(n) && ok;
+    // la suite est longue (jusqu'à 1M lignes) : seulement sur demande
+    if (strcmp(quoi, "suite") == 0) ok = benchSuite(argc > 2 ? n : 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Erreur: benchmark en échec (voir log.txt)\n");
         return EXIT_FAILURE;
     }
-    
-    GtkWidget *login_window = create_login_window();
-    gtk_widget_show_all(login_window);
-    
-    gtk_main();
-    
-    sqlite3_close(db);
     return EXIT_SUCCESS;
 }
-
+#endif /* CPRONOTE_BENCH */